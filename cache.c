@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <elf.h>
+#include "js.h"
+#include "cache.h"
+
+/*
+ * compiled program cache.
+ * a resolved tree built at AST_IMAGE_BASE has no pointer leaving its
+ * region,so the region is written behind a header and later runs of the
+ * same source map it back at the same address,no scanning,parsing or
+ * fix ups. the file name is a hash of the source and of the build that
+ * wrote it,a rebuilt interpreter never maps a tree of another layout.
+ * the build is the gnu build id the linker puts in the executable,any
+ * object file relinked gives another one.
+ * a tree is only written when no word of it points into this process
+ * outside the region.
+ */
+
+#define CACHE_MAGIC "JSTREE01"
+#define CACHE_HEADER_SIZE 4096
+#define CACHE_PATH_SIZE 4096
+#define CACHE_MAX_RANGES 4096 /*mappings of the process looked at by cache_points_outside*/
+
+extern char __ehdr_start[]; /*the elf header of the executable,placed there by the linker*/
+
+unsigned long long cache_build = 0; /*CACHE_build_key,worked out once*/
+
+typedef struct
+{
+    char magic[8];
+    unsigned long long key;
+    unsigned long base;
+    unsigned long length; /*bytes of the image behind the header*/
+    StatementList *statement_list;
+} CacheHeader;
+
+unsigned long long cache_hash(unsigned long long hash, char *p, int length)
+{
+    int i;
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)p[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*the gnu build id note of the executable,its length or 0 when it was linked without one*/
+int cache_build_id(unsigned char **id)
+{
+    Elf64_Ehdr *ehdr = (Elf64_Ehdr *)__ehdr_start;
+    Elf64_Phdr *phdr = (Elf64_Phdr *)(__ehdr_start + ehdr->e_phoff);
+    Elf64_Nhdr *note;
+    char *bias = NULL;
+    char *p;
+    char *end;
+    int i;
+    for (i = 0; i < ehdr->e_phnum; i++)
+    { /*the segment holding the header tells where the executable was loaded*/
+        if (PT_LOAD == phdr[i].p_type && 0 == phdr[i].p_offset)
+        {
+            bias = __ehdr_start - phdr[i].p_vaddr;
+        }
+    }
+    for (i = 0; i < ehdr->e_phnum && NULL != bias; i++)
+    {
+        if (PT_NOTE != phdr[i].p_type)
+        {
+            continue;
+        }
+        p = bias + phdr[i].p_vaddr;
+        end = p + phdr[i].p_memsz;
+        while (p + sizeof(Elf64_Nhdr) <= end)
+        {
+            note = (Elf64_Nhdr *)p;
+            p += sizeof(Elf64_Nhdr) + ((note->n_namesz + 3) & ~3);
+            if (NT_GNU_BUILD_ID == note->n_type && 4 == note->n_namesz && 0 == memcmp(note + 1, "GNU", 4))
+            {
+                *id = (unsigned char *)p;
+                return note->n_descsz;
+            }
+            p += (note->n_descsz + 3) & ~3;
+        }
+    }
+    return 0;
+}
+
+/*hash of the executable file,for a build without an id note*/
+unsigned long long cache_hash_executable(unsigned long long hash)
+{
+    char buffer[65536];
+    int fd = open("/proc/self/exe", O_RDONLY);
+    int n;
+    if (fd < 0)
+    {
+        return hash;
+    }
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        hash = cache_hash(hash, buffer, n);
+    }
+    close(fd);
+    return hash;
+}
+
+/*hash of the build and of the sizes of what goes into images*/
+unsigned long long CACHE_build_key()
+{
+    char build[256];
+    unsigned char *id;
+    int length;
+    if (0 != cache_build)
+    {
+        return cache_build;
+    }
+    sprintf(build,
+            "%d %d %d %d %d %d %d %d %d %d",
+            (int)sizeof(Expression),
+            (int)sizeof(Statement),
+            (int)sizeof(JsFunction),
+            (int)sizeof(Block),
+            (int)sizeof(StatementList),
+            (int)sizeof(AstChunk),
+            (int)sizeof(Heap),
+            (int)sizeof(ExecuteEnvironment),
+            (int)sizeof(VariableList),
+            (int)sizeof(JsKvList));
+    cache_build = cache_hash(14695981039346656037ULL, build, strlen(build));
+    length = cache_build_id(&id);
+    cache_build = 0 != length ? cache_hash(cache_build, (char *)id, length) : cache_hash_executable(cache_build);
+    return cache_build;
+}
+
+/*source hash mixed with the build*/
+unsigned long long cache_key(char *source, int length)
+{
+    return cache_hash(CACHE_build_key(), source, length);
+}
+
+char *CACHE_directory()
+{
+    char *dir = getenv("JS_CACHE_DIR");
+    if (NULL == dir || 0 == dir[0])
+    {
+        return NULL;
+    }
+    return dir;
+}
+
+void cache_path(char *path, unsigned long long key)
+{
+    snprintf(path, CACHE_PATH_SIZE, "%s/%016llx.jstree", CACHE_directory(), key);
+}
+
+int CACHE_load(JsInterpreter *inter, char *source, int length)
+{
+    char path[CACHE_PATH_SIZE];
+    CacheHeader header;
+    struct stat st;
+    unsigned long long key = cache_key(source, length);
+    AstChunk *chunk;
+    unsigned long mapped;
+    int fd;
+    cache_path(path, key);
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (sizeof(header) != pread(fd, &header, sizeof(header), 0) ||
+        0 != memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) ||
+        key != header.key ||
+        AST_IMAGE_BASE != header.base ||
+        0 != fstat(fd, &st) ||
+        st.st_size < CACHE_HEADER_SIZE + header.length)
+    {
+        close(fd);
+        return -1;
+    }
+    mapped = (header.length + getpagesize() - 1) & ~(unsigned long)(getpagesize() - 1);
+    chunk = mmap((void *)header.base, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, CACHE_HEADER_SIZE);
+    close(fd);
+    if (MAP_FAILED == chunk)
+    {
+        return -1;
+    }
+    if ((void *)header.base != chunk)
+    { /*the address is taken,pointers of the image would be wrong*/
+        munmap(chunk, mapped);
+        return -1;
+    }
+    chunk->mapped = mapped;
+    chunk->limit = chunk->top; /*nothing more goes into the image*/
+    chunk->next = inter->ast;
+    inter->ast = chunk;
+    inter->statement_list = header.statement_list;
+    return 0;
+}
+
+/*
+ * 1 when a word of the image holds an address this process maps outside
+ * the region,a literal of the binary,a piece of the source or something
+ * malloc gave. a later run would read a place of another process there.
+ * every word is taken for a pointer,an int that looks like one only costs
+ * the cache entry.
+ */
+int cache_points_outside(char *image, unsigned long length)
+{
+    unsigned long *ranges = malloc(sizeof(unsigned long) * 2 * CACHE_MAX_RANGES);
+    unsigned long *word;
+    unsigned long w;
+    FILE *maps = fopen("/proc/self/maps", "r");
+    int count = 0;
+    int lo;
+    int hi;
+    int mid;
+    int outside = 0;
+    if (NULL == ranges || NULL == maps)
+    { /*nothing to check against,the tree is not written*/
+        free(ranges);
+        if (NULL != maps)
+        {
+            fclose(maps);
+        }
+        return 1;
+    }
+    while (count < CACHE_MAX_RANGES && 2 == fscanf(maps, "%lx-%lx%*[^\n]", ranges + 2 * count, ranges + 2 * count + 1))
+    { /*the kernel lists them in address order*/
+        count++;
+    }
+    outside = !feof(maps) && count == CACHE_MAX_RANGES;
+    fclose(maps);
+    for (word = (unsigned long *)image; !outside && (char *)(word + 1) <= image + length; word++)
+    {
+        w = *word;
+        if (w >= AST_IMAGE_BASE && w < AST_IMAGE_BASE + AST_IMAGE_SIZE)
+        {
+            continue;
+        }
+        lo = 0;
+        hi = count;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (w < ranges[2 * mid])
+            {
+                hi = mid;
+            }
+            else if (w >= ranges[2 * mid + 1])
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                outside = 1;
+                break;
+            }
+        }
+    }
+    free(ranges);
+    return outside;
+}
+
+int CACHE_store(JsInterpreter *inter, char *source, int length)
+{
+    char path[CACHE_PATH_SIZE];
+    char tmp[CACHE_PATH_SIZE + 32];
+    char pad[CACHE_HEADER_SIZE];
+    CacheHeader header;
+    AstChunk *chunk = inter->ast;
+    int fd;
+    int ok;
+    if (NULL == chunk || (AstChunk *)AST_IMAGE_BASE != chunk || NULL != chunk->next)
+    { /*part of the tree is outside the region*/
+        return -1;
+    }
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.key = cache_key(source, length);
+    header.base = AST_IMAGE_BASE;
+    header.length = chunk->top - (char *)chunk;
+    header.statement_list = inter->statement_list;
+    if (0 != cache_points_outside((char *)chunk, header.length))
+    {
+        return -1;
+    }
+    cache_path(path, header.key);
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    mkdir(CACHE_directory(), 0755);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    memset(pad, 0, sizeof(pad));
+    memcpy(pad, &header, sizeof(header));
+    ok = CACHE_HEADER_SIZE == write(fd, pad, CACHE_HEADER_SIZE) &&
+         header.length == write(fd, chunk, header.length);
+    close(fd);
+    if (!ok || 0 != rename(tmp, path))
+    { /*a reader never sees a half written file*/
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include "js.h"
+
+/*hash of the build and the node layout,an image of another build never fits*/
+unsigned long long CACHE_build_key();
+
+/*directory of cached trees from JS_CACHE_DIR,NULL when caching is off*/
+char *CACHE_directory();
+
+/*map the cached tree of this source,-1 when there is none that fits*/
+int CACHE_load(JsInterpreter *inter, char *source, int length);
+
+/*write the resolved tree out for later runs,-1 when it can not be cached*/
+int CACHE_store(JsInterpreter *inter, char *source, int length);
+
+#endif
@@ -0,0 +1,334 @@
+#include <string.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+#include "js.h"
+#include "error.h"
+#include "util.h"
+#include "stack.h"
+#include "interprete.h"
+#include "expression.h"
+#include "js_value.h"
+#include "promise.h"
+#include "loop.h"
+#include "coroutine.h"
+
+extern char gc_sweep_should_executing;
+
+/*
+ * async calls.
+ * the evaluator recurses on the c stack,so a call that awaits keeps its
+ * c frames where they are: each async call runs on a stack of its own and
+ * await switches back to whoever resumed it. a mapping holds a guard page,
+ * the c stack,the state,the value stack and the frame arena of one call,
+ * only the pages it touches cost memory. mappings of ended calls are kept
+ * for the next ones.
+ * while suspended,its values and frames are reachable from its heap cell,
+ * see gc_scan. a suspended call nothing can resume anymore is collected.
+ */
+
+unsigned long coroutine_size(void)
+{
+    return sysconf(_SC_PAGESIZE) + COROUTINE_STACK_SIZE + sizeof(JsCoroutineState) + sizeof(JsValue) * COROUTINE_VALUES + COROUTINE_ARENA_SIZE;
+}
+
+/*a pooled mapping,else a new one with the page below the stack as guard*/
+JsCoroutineState *coroutine_state(JsInterpreter *inter, int line)
+{
+    JsCoroutineState *state = inter->coroutine_pool;
+    char *region;
+    inter->coroutine_taken++;
+    if (NULL != state)
+    {
+        inter->coroutine_pool = state->next;
+        inter->coroutine_pooled--;
+        return state;
+    }
+    region = mmap(NULL, coroutine_size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (MAP_FAILED == region)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "coroutine", line);
+        return NULL;
+    }
+    if (0 != mprotect(region, sysconf(_SC_PAGESIZE), PROT_NONE))
+    {
+        munmap(region, coroutine_size());
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "coroutine", line);
+        return NULL;
+    }
+    state = (JsCoroutineState *)(region + sysconf(_SC_PAGESIZE) + COROUTINE_STACK_SIZE);
+    state->region = region;
+    inter->coroutine_mapped++;
+    if (inter->coroutine_taken >= COROUTINE_POOL && inter->coroutine_taken >= inter->coroutine_mapped / 2)
+    { /*the pool ran dry,abandoned generators give theirs back once gc finds them*/
+        inter->coroutine_taken = 0;
+        gc_sweep_should_executing = 1;
+    }
+    return state;
+}
+
+void COROUTINE_release(JsInterpreter *inter, JsCoroutineState *state)
+{
+    if (inter->coroutine_pooled >= COROUTINE_POOL)
+    {
+        munmap(state->region, coroutine_size());
+        inter->coroutine_mapped--;
+        return;
+    }
+    state->next = inter->coroutine_pool;
+    inter->coroutine_pool = state;
+    inter->coroutine_pooled++;
+}
+
+/*the stack,arena and frames of the interpreter and the ones kept in state trade places*/
+void coroutine_exchange(JsInterpreter *inter, JsCoroutineState *state)
+{
+    Stack stack = inter->stack;
+    FrameArena arena = inter->arena;
+    ExecuteEnvironment *frames = inter->frames;
+    inter->stack = state->stack;
+    inter->arena = state->arena;
+    inter->frames = state->frames;
+    state->stack = stack;
+    state->arena = arena;
+    state->frames = frames;
+}
+
+/*the bottom of every coroutine stack,it never returns*/
+void coroutine_main(void)
+{
+    JsInterpreter *inter = current_interpreter;
+    JsCoroutineState *state = inter->coroutine->state;
+    JsObject *object = JS_VALUE_TYPE_OBJECT == state->receiver.typ ? state->receiver.u.object : NULL;
+    eval_call_frame(inter, &inter->env, object, state->func.u.func, state->args_count, state->line);
+    state->value = pop_stack(&inter->stack);
+    state->rejected = 0;
+    state->done = 1;
+    swapcontext(&state->context, &state->resumer);
+}
+
+/*
+ * runs co until it awaits,yields or ends,value is what it yielded or its result.
+ * an ended async call settles its promise.
+ */
+char coroutine_switch(JsInterpreter *inter, JsCoroutine *co, JsValue *value)
+{
+    JsCoroutineState *state = co->state;
+    JsValue promise;
+    char rejected;
+    coroutine_exchange(inter, state);
+    state->back = inter->coroutine;
+    inter->coroutine = co;
+    swapcontext(&state->resumer, &state->context);
+    inter->coroutine = state->back;
+    state->back = NULL;
+    coroutine_exchange(inter, state);
+    *value = state->value;
+    if (0 == state->done)
+    {
+        return 0;
+    }
+    promise = state->promise;
+    rejected = state->rejected;
+    co->state = NULL;
+    COROUTINE_release(inter, state);
+    if (JS_VALUE_TYPE_PROMISE != promise.typ)
+    { /*a generator*/
+        return 1;
+    }
+    if (0 != rejected)
+    {
+        PROMISE_reject(inter, promise.u.promise, value, co->line);
+    }
+    else
+    {
+        PROMISE_resolve(inter, promise.u.promise, value, co->line);
+    }
+    return 1;
+}
+
+int COROUTINE_start(JsInterpreter *inter, JsObject *object, JsFunction *func, int args_count, int line)
+{
+    JsCoroutine *co = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_COROUTINE, 0, line);
+    JsCoroutineState *state = coroutine_state(inter, line);
+    JsValue value;
+    int i;
+    state->stack.vs = (JsValue *)(state + 1);
+    state->stack.sp = 0;
+    state->stack.alloc = COROUTINE_VALUES;
+    state->arena.base = (char *)(state->stack.vs + COROUTINE_VALUES);
+    state->arena.top = state->arena.base;
+    state->arena.limit = state->arena.base + COROUTINE_ARENA_SIZE;
+    state->frames = NULL;
+    state->back = NULL;
+    state->next = NULL;
+    state->func.typ = JS_VALUE_TYPE_FUNCTION;
+    state->func.u.func = func;
+    state->receiver.typ = 0; /*no receiver*/
+    if (NULL != object)
+    {
+        state->receiver.typ = JS_VALUE_TYPE_OBJECT;
+        state->receiver.u.object = object;
+    }
+    state->args_count = args_count;
+    state->value.typ = JS_VALUE_TYPE_UNDEFINED;
+    state->rejected = 0;
+    state->done = 0;
+    state->line = line;
+    state->promise.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (0 != func->async)
+    {
+        state->promise = PROMISE_create(inter, line);
+    }
+    co->state = state;
+    for (i = 0; i < args_count; i++)
+    { /*the args go over to its own stack*/
+        push_stack(&state->stack, inter->stack.vs + inter->stack.sp - args_count + i);
+    }
+    inter->stack.sp -= args_count;
+    getcontext(&state->context);
+    state->context.uc_stack.ss_sp = state->region + sysconf(_SC_PAGESIZE);
+    state->context.uc_stack.ss_size = COROUTINE_STACK_SIZE;
+    state->context.uc_link = NULL;
+    makecontext(&state->context, coroutine_main, 0);
+    if (0 == func->async)
+    { /*a generator waits for its first next*/
+        value.typ = JS_VALUE_TYPE_COROUTINE;
+        value.u.coroutine = co;
+        push_stack(&inter->stack, &value);
+        return 0;
+    }
+    push_stack(&inter->stack, &state->promise);
+    coroutine_switch(inter, co, &value);
+    return 0;
+}
+
+void COROUTINE_resume(JsInterpreter *inter, JsCoroutine *co, const JsValue *value, char rejected)
+{
+    JsCoroutineState *state = co->state;
+    JsValue v;
+    if (NULL == state || 0 != state->done)
+    {
+        return;
+    }
+    state->value = *value;
+    state->rejected = rejected;
+    coroutine_switch(inter, co, &v);
+}
+
+/*co itself or one of the coroutines that resumed the running one*/
+char coroutine_running(JsInterpreter *inter, JsCoroutine *co)
+{
+    JsCoroutine *c;
+    for (c = inter->coroutine; NULL != c; c = c->state->back)
+    {
+        if (c == co)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+char COROUTINE_next(JsInterpreter *inter, JsCoroutine *co, const JsValue *sent, JsValue *value, int line)
+{
+    JsCoroutineState *state = co->state;
+    if (NULL == state)
+    {
+        value->typ = JS_VALUE_TYPE_UNDEFINED;
+        return 1;
+    }
+    if (0 != coroutine_running(inter, co))
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_GENERATOR_RUNNING, "next", line);
+        return 1;
+    }
+    state->value = *sent;
+    state->rejected = 0;
+    return coroutine_switch(inter, co, value);
+}
+
+void COROUTINE_return(JsInterpreter *inter, JsCoroutine *co, int line)
+{
+    JsCoroutineState *state = co->state;
+    if (NULL == state)
+    {
+        return;
+    }
+    if (0 != coroutine_running(inter, co))
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_GENERATOR_RUNNING, "return", line);
+        return;
+    }
+    co->state = NULL; /*its c frames are dropped where they are,nothing on them owns memory*/
+    COROUTINE_release(inter, state);
+}
+
+int COROUTINE_yield(JsInterpreter *inter, int line)
+{
+    JsCoroutineState *state = inter->coroutine->state;
+    state->value = pop_stack(&inter->stack);
+    swapcontext(&state->context, &state->resumer);
+    push_stack(&inter->stack, &state->value);
+    return 0;
+}
+
+/*the program has nothing to switch back to,it runs the event loop until p settles*/
+int coroutine_await_top(JsInterpreter *inter, int line)
+{
+    JsValue v = peek_stack(&inter->stack, 0);
+    JsPromise *p;
+    if (JS_VALUE_TYPE_PROMISE != v.typ)
+    {
+        return 0;
+    }
+    p = v.u.promise;
+    p->handled = 1;
+    LOOP_run_until(inter, p);
+    if (JS_PROMISE_PENDING == p->state)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_PROMISE_NEVER_SETTLES, "await", line);
+        return RUNTIME_ERROR_PROMISE_NEVER_SETTLES;
+    }
+    if (JS_PROMISE_REJECTED == p->state)
+    {
+        PROMISE_fail(inter, p, line);
+        return RUNTIME_ERROR_PROMISE_REJECTED;
+    }
+    pop_stack(&inter->stack);
+    push_stack(&inter->stack, &p->value);
+    return 0;
+}
+
+int COROUTINE_await(JsInterpreter *inter, int line)
+{
+    JsCoroutineState *state;
+    JsValue target;
+    JsValue none;
+    JsValue v;
+    if (NULL == inter->coroutine)
+    {
+        return coroutine_await_top(inter, line);
+    }
+    state = inter->coroutine->state;
+    target.typ = JS_VALUE_TYPE_COROUTINE;
+    target.u.coroutine = inter->coroutine;
+    none.typ = JS_VALUE_TYPE_UNDEFINED;
+    v = pop_stack(&inter->stack);
+    if (JS_VALUE_TYPE_PROMISE == v.typ)
+    {
+        PROMISE_react(inter, v.u.promise, &none, &none, &target, line);
+    }
+    else
+    { /*a plain value comes back after the microtasks queued before*/
+        LOOP_queue_reaction(inter, &none, &v, &target, 0, line);
+    }
+    swapcontext(&state->context, &state->resumer);
+    if (0 != state->rejected)
+    { /*nothing catches it,the call ends with its promise rejected by the same reason*/
+        state->done = 1;
+        swapcontext(&state->context, &state->resumer);
+    }
+    push_stack(&inter->stack, &state->value);
+    return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+#include "js.h"
+
+/*
+ * calls the async func on a coroutine of its own,args_count args are on top
+ * of the stack,its promise takes their place. it runs until its first await.
+ * a generator func gets its coroutine in their place,it runs on next.
+ */
+int COROUTINE_start(JsInterpreter *inter, JsObject *object, JsFunction *func, int args_count, int line);
+
+/*
+ * await the value on top of the stack,what it settles to takes its place.
+ * a coroutine is suspended until then,the program runs the event loop.
+ */
+int COROUTINE_await(JsInterpreter *inter, int line);
+
+/*goes on with the await of co,value is what it gives,a rejected one ends the call*/
+void COROUTINE_resume(JsInterpreter *inter, JsCoroutine *co, const JsValue *value, char rejected);
+
+/*
+ * runs the generator co until it yields or ends,sent is what its yield gives.
+ * value is what it yielded or returned,it returns 1 once co ended.
+ */
+char COROUTINE_next(JsInterpreter *inter, JsCoroutine *co, const JsValue *sent, JsValue *value, int line);
+
+/*ends a suspended generator where it is,a for of left early does*/
+void COROUTINE_return(JsInterpreter *inter, JsCoroutine *co, int line);
+
+/*suspends the running generator with the value on top of the stack,what next sends takes its place*/
+int COROUTINE_yield(JsInterpreter *inter, int line);
+
+/*the mapping of a coroutine gc found suspended and unreachable*/
+void COROUTINE_release(JsInterpreter *inter, JsCoroutineState *state);
+
+#endif
@@ -3,7 +3,12 @@
 #include "util.h"
 #include <string.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include "interprete.h"
+#include "heap.h"
+#include "output.h"
+#include "create.h"
+#include "loop.h"
 
 JsInterpreter *
 JS_create_interpreter()
@@ -26,12 +31,18 @@ JS_create_interpreter()
         return NULL;
     }
     interpreter->statement_list = NULL;
-    interpreter->heapenv = NULL;
     interpreter->interpreter_memory = inter_memory;
-    interpreter->heap = NULL;
     interpreter->env.outter = NULL;
     interpreter->env.vars = NULL;
     interpreter->env.funcs = NULL;
+    interpreter->env.in_arena = 0;
+    interpreter->env.cells = NULL;
+    interpreter->env.lexical = NULL;
+    interpreter->env.next = NULL;
+    interpreter->frames = NULL;
+    interpreter->tail_func = NULL;
+    interpreter->tail_argc = 0;
+    interpreter->ast = NULL;
     interpreter->stack.sp = 0;
     interpreter->stack.alloc = 1024 * 1024;
     interpreter->stack.vs = MEM_alloc(interpreter->execute_memory, sizeof(JsValue) * interpreter->stack.alloc, 0);
@@ -41,25 +52,141 @@ JS_create_interpreter()
         MEM_close_storage(interpreter->execute_memory);
         return NULL;
     }
+    interpreter->arena.base = MEM_alloc(interpreter->execute_memory, FRAME_ARENA_SIZE, 0);
+    if (NULL == interpreter->arena.base)
+    {
+        MEM_close_storage(inter_memory);
+        MEM_close_storage(interpreter->execute_memory);
+        return NULL;
+    }
+    interpreter->arena.top = interpreter->arena.base;
+    interpreter->arena.limit = interpreter->arena.base + FRAME_ARENA_SIZE;
+    if (0 != gc_open(interpreter) ||
+        0 != gc_add_space(interpreter, &interpreter->env, sizeof(ExecuteEnvironment)))
+    {
+        MEM_close_storage(inter_memory);
+        MEM_close_storage(interpreter->execute_memory);
+        return NULL;
+    }
+    OUTPUT_open(&interpreter->output, 1);
+    interpreter->readers = NULL;
+    interpreter->reader_count = 0;
+    interpreter->reader_alloc = 0;
+    interpreter->typed_value.typ = JS_VALUE_TYPE_UNDEFINED;
+    interpreter->typed_dest = NULL;
+    interpreter->typed_index = 0;
+    LOOP_open(&interpreter->loop);
+    interpreter->coroutine = NULL;
+    interpreter->coroutine_pool = NULL;
+    interpreter->coroutine_pooled = 0;
+    interpreter->coroutine_mapped = 0;
+    interpreter->coroutine_taken = 0;
     return interpreter;
 }
 
+/*bump allocate a node of the tree,nodes parsed one after another sit next to each other*/
+void *CREATE_alloc_node(int size)
+{
+    AstChunk *chunk = current_interpreter->ast;
+    char *p;
+    size = (size + 7) & ~7;
+    if (NULL == chunk || chunk->top + size > chunk->limit)
+    {
+        int chunk_size = size > AST_CHUNK_SIZE ? size : AST_CHUNK_SIZE;
+        chunk = (AstChunk *)MEM_alloc(current_interpreter->interpreter_memory, sizeof(AstChunk) + chunk_size, get_line_number());
+        if (NULL == chunk)
+        {
+            return NULL;
+        }
+        chunk->top = (char *)(chunk + 1);
+        chunk->limit = chunk->top + chunk_size;
+        chunk->mapped = 0;
+        chunk->next = current_interpreter->ast;
+        current_interpreter->ast = chunk;
+    }
+    p = chunk->top;
+    chunk->top += size;
+    return p;
+}
+
+/*
+ * build the tree in one region at AST_IMAGE_BASE,reserved but only
+ * backed where nodes are written. every pointer of such a tree stays
+ * inside the region,so it can be cached as a plain image.
+ * returns -1 when the address is taken,the tree then goes to chunks.
+ */
+int CREATE_open_ast_image(JsInterpreter *inter)
+{
+    AstChunk *chunk = mmap((void *)AST_IMAGE_BASE,
+                           AST_IMAGE_SIZE,
+                           PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                           -1,
+                           0);
+    if (MAP_FAILED == chunk)
+    {
+        return -1;
+    }
+    if ((void *)AST_IMAGE_BASE != chunk)
+    {
+        munmap(chunk, AST_IMAGE_SIZE);
+        return -1;
+    }
+    chunk->top = (char *)(chunk + 1);
+    chunk->limit = (char *)chunk + AST_IMAGE_SIZE;
+    chunk->mapped = AST_IMAGE_SIZE;
+    chunk->next = inter->ast;
+    inter->ast = chunk;
+    return 0;
+}
+
+/*the tree is a single image,nothing was allocated outside the region*/
+int CREATE_is_ast_image(JsInterpreter *inter)
+{
+    return NULL != inter->ast && (AstChunk *)AST_IMAGE_BASE == inter->ast && NULL == inter->ast->next;
+}
+
+/*the whole tree goes away chunk by chunk,no walk over the nodes*/
+void CREATE_free_ast(JsInterpreter *inter)
+{
+    AstChunk *next;
+    while (NULL != inter->ast)
+    {
+        next = inter->ast->next;
+        if (0 != inter->ast->mapped)
+        {
+            munmap(inter->ast, inter->ast->mapped);
+        }
+        else
+        {
+            MEM_free(inter->interpreter_memory, (char *)inter->ast);
+        }
+        inter->ast = next;
+    }
+    inter->statement_list = NULL;
+}
+
 char *CREATE_identifier(char *i)
 {
-    int length = strlen(i);
-    char *identifier = (char *)MEM_alloc(current_interpreter->interpreter_memory, length + 1, get_line_number());
+    return CREATE_identifier_with_length(i, strlen(i));
+}
+
+/*copy of the first length bytes,the scanner hands out pieces of the source*/
+char *CREATE_identifier_with_length(char *i, int length)
+{
+    char *identifier = (char *)CREATE_alloc_node(length + 1);
     if (NULL == identifier)
     {
         return NULL;
     }
-    strncpy(identifier, i, length);
+    memcpy(identifier, i, length);
     identifier[length] = 0;
     return identifier;
 }
 
 Expression *CREATE_alloc_expression(EXPRESSION_TYPE typ)
 {
-    Expression *e = (Expression *)MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *e = (Expression *)CREATE_alloc_node(sizeof(Expression));
     if (NULL == e)
     {
         return NULL;
@@ -77,49 +204,54 @@ StatementList *CREATE_chain_statement_list(StatementList *list, Statement *s)
     }
     if (NULL == list)
     {
-        StatementList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(StatementList), get_line_number());
+        StatementList *list = CREATE_alloc_node(sizeof(StatementList));
         if (NULL == list)
         {
             return NULL;
         }
         list->next = NULL;
         list->statement = s;
+        list->last = list;
         return list;
     }
-    StatementList *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(StatementList), get_line_number());
+    StatementList *new = CREATE_alloc_node(sizeof(StatementList));
     if (NULL == new)
     {
         return list; /*this time faild,but return old list*/
     }
     new->statement = s;
     new->next = NULL;
-    StatementList *listp = list;
-    while (NULL != listp->next)
-    {
-        listp = listp->next;
-    }
-    listp->next = new;
+    new->last = new;
+    list->last->next = new;
+    list->last = new;
     return list;
 }
 
 JsFunction *CREATE_function(char *name, ParameterList *parameterlist, Block *block)
 {
-    JsFunction *f = MEM_alloc(current_interpreter->interpreter_memory, sizeof(JsFunction), get_line_number());
+    JsFunction *f = CREATE_alloc_node(sizeof(JsFunction));
     if (NULL == f)
     {
         return NULL;
     }
     f->typ = JS_FUNCTION_TYPE_USER;
+    f->async = 0;
+    f->generator = 0;
     f->block = block;
     f->parameter_list = parameterlist;
     f->name = name;
     f->env = NULL;
+    f->captures = 0;
+    f->name_captured = 0;
+    f->uses_this = 0;
+    f->uses_arguments = 0;
+    f->parameter_count = 0;
     return f;
 }
 
 Expression *CREATE_function_expression(char *name, ParameterList *parameterlist, Block *block)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(JsFunction), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression) + sizeof(JsFunction));
     new->line = get_line_number();
     new->typ = EXPRESSION_TYPE_CREATE_FUNCTION;
     new->u.func = (JsFunction *)(new + 1);
@@ -127,18 +259,26 @@ Expression *CREATE_function_expression(char *name, ParameterList *parameterlist,
     new->u.func->parameter_list = parameterlist;
     new->u.func->block = block;
     new->u.func->typ = JS_FUNCTION_TYPE_USER;
+    new->u.func->async = 0;
+    new->u.func->generator = 0;
     new->u.func->env = NULL;
+    new->u.func->captures = 0;
+    new->u.func->name_captured = 0;
+    new->u.func->uses_this = 0;
+    new->u.func->uses_arguments = 0;
+    new->u.func->parameter_count = 0;
     return new;
 }
 
 ParameterList *CREATE_parameter_list(char *identifier)
 {
-    ParameterList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ParameterList), get_line_number());
+    ParameterList *list = CREATE_alloc_node(sizeof(ParameterList));
     if (NULL == list)
     {
         return NULL;
     }
     list->identifier = identifier;
+    list->captured = 0;
     list->next = NULL;
     return list;
 }
@@ -149,13 +289,14 @@ ParameterList *CREATE_chain_parameter_list(ParameterList *list, char *identifier
     {
         return NULL;
     }
-    ParameterList *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ParameterList), get_line_number());
+    ParameterList *new = CREATE_alloc_node(sizeof(ParameterList));
     if (NULL == new)
     {
         return list;
     }
     new->next = NULL;
     new->identifier = identifier;
+    new->captured = 0;
     ParameterList *next = list;
     while (NULL != next->next)
     {
@@ -167,13 +308,14 @@ ParameterList *CREATE_chain_parameter_list(ParameterList *list, char *identifier
 
 StatementList *CREATE_statement_list(Statement *s)
 {
-    StatementList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(StatementList), get_line_number());
+    StatementList *list = CREATE_alloc_node(sizeof(StatementList));
     if (NULL == list)
     {
         return NULL;
     }
     list->statement = s;
     list->next = NULL;
+    list->last = list;
     s->line = get_line_number();
     return list;
 }
@@ -181,7 +323,7 @@ StatementList *CREATE_statement_list(Statement *s)
 Statement *
 CREATE_expression_statement(Expression *e)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement));
     if (NULL == s)
     {
         return NULL;
@@ -195,7 +337,7 @@ CREATE_expression_statement(Expression *e)
 Statement *
 CREATE_break_statement()
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement));
     if (NULL == s)
     {
         return NULL;
@@ -208,7 +350,7 @@ CREATE_break_statement()
 Statement *
 CREATE_if_statement(Expression *condition, Block *then, StatementElsifList *elseiflist, Block *els)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement) + sizeof(StatementIf), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement) + sizeof(StatementIf));
     if (NULL == s)
     {
         return NULL;
@@ -226,7 +368,7 @@ CREATE_if_statement(Expression *condition, Block *then, StatementElsifList *else
 StatementElsifList *
 CREATE_elsif_list(Expression *condition, Block *block)
 {
-    StatementElsifList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(StatementElsifList), get_line_number());
+    StatementElsifList *list = CREATE_alloc_node(sizeof(StatementElsifList));
     if (NULL == list)
     {
         return NULL;
@@ -257,7 +399,7 @@ CREATE_chain_elsif_list(StatementElsifList *list, StatementElsifList *els)
 Statement *
 CREATE_while_statement(Expression *condition, Block *block, char is_do)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement) + sizeof(StatementWhile), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement) + sizeof(StatementWhile));
     if (NULL == s)
     {
         return NULL;
@@ -274,7 +416,7 @@ CREATE_while_statement(Expression *condition, Block *block, char is_do)
 Statement *
 CREATE_for_statement(Expression *init, Expression *condition, Expression *afterblock, Block *block)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement) + sizeof(StatementFor), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement) + sizeof(StatementFor));
     if (NULL == s)
     {
         return NULL;
@@ -292,7 +434,7 @@ CREATE_for_statement(Expression *init, Expression *condition, Expression *afterb
 Statement *
 CREATE_for_in_statement(char *identifier, Expression *target, Block *block)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement) + sizeof(StatementForIn), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement) + sizeof(StatementForIn));
     if (NULL == s)
     {
         return NULL;
@@ -302,14 +444,28 @@ CREATE_for_in_statement(char *identifier, Expression *target, Block *block)
     s->u.forin_statement->identifer = identifier;
     s->u.forin_statement->target = target;
     s->u.forin_statement->block = block;
+    s->u.forin_statement->captured = 0;
+    s->u.forin_statement->of = 0;
     s->line = get_line_number();
     return s;
 }
 
+Statement *
+CREATE_for_of_statement(char *identifier, Expression *target, Block *block)
+{
+    Statement *s = CREATE_for_in_statement(identifier, target, block);
+    if (NULL == s)
+    {
+        return NULL;
+    }
+    s->u.forin_statement->of = 1;
+    return s;
+}
+
 Statement *
 CREATE_return_statement(Expression *e)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement));
     if (NULL == s)
     {
         return NULL;
@@ -323,7 +479,7 @@ CREATE_return_statement(Expression *e)
 Statement *
 CREATE_continue_statement()
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Statement), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(Statement));
     if (NULL == s)
     {
         return NULL;
@@ -336,19 +492,21 @@ CREATE_continue_statement()
 Block *
 CREATE_block(StatementList *list)
 {
-    Block *b = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Block), get_line_number());
+    Block *b = CREATE_alloc_node(sizeof(Block));
     if (NULL == b)
     {
         return NULL;
     }
     b->list = list;
+    b->need_env = 1;
+    b->has_captured = 0;
     return b;
 }
 
 ExpressionList *
 CREATE_expression_list(Expression *e)
 {
-    ExpressionList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ExpressionList), get_line_number());
+    ExpressionList *list = CREATE_alloc_node(sizeof(ExpressionList));
     if (NULL == list)
     {
         return NULL;
@@ -383,7 +541,7 @@ CREATE_chain_expression_list(ExpressionList *list, Expression *e)
 Expression *
 CREATE_assign_expression(Expression *e1, Expression *e2)
 {
-    Expression *e = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionBinary), get_line_number());
+    Expression *e = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionBinary));
     if (NULL == e)
     {
         return NULL;
@@ -399,7 +557,7 @@ CREATE_assign_expression(Expression *e1, Expression *e2)
 Expression *
 CREATE_self_assign_op_expression(EXPRESSION_TYPE typ, Expression *e1, Expression *e2)
 {
-    Expression *e = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionBinary), get_line_number());
+    Expression *e = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionBinary));
     if (NULL == e)
     {
         return NULL;
@@ -415,7 +573,7 @@ CREATE_self_assign_op_expression(EXPRESSION_TYPE typ, Expression *e1, Expression
 StatementSwitchCaseList *
 CREATE_switch_case(Expression *match, StatementList *list)
 {
-    StatementSwitchCaseList *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(StatementSwitchCaseList), get_line_number());
+    StatementSwitchCaseList *s = CREATE_alloc_node(sizeof(StatementSwitchCaseList));
     s->line = get_line_number();
     s->match = match;
     s->list = list;
@@ -438,19 +596,21 @@ CREATE_chain_switch_case(StatementSwitchCaseList *list, StatementSwitchCaseList
 Statement *
 CREATE_switch_statement(Expression *condition, StatementSwitchCaseList *list, StatementList *d)
 {
-    Statement *s = MEM_alloc(current_interpreter->interpreter_memory, sizeof(StatementSwitch) + sizeof(Statement), get_line_number());
+    Statement *s = CREATE_alloc_node(sizeof(StatementSwitch) + sizeof(Statement));
     s->typ = STATEMENT_TYPE_SWITCH;
     s->u.switch_statement = (StatementSwitch *)(s + 1);
     s->u.switch_statement->condition = condition;
     s->u.switch_statement->list = list;
     s->u.switch_statement->defaultpart = d;
+    s->u.switch_statement->need_env = 1;
+    s->u.switch_statement->has_captured = 0;
     return s;
 }
 
 Expression *
 CREATE_assign_function_expression(Expression *dest, char *identifier, JsFunction *func)
 {
-    Expression *e = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionAssignFunction), get_line_number());
+    Expression *e = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionAssignFunction));
     if (NULL == e)
     {
         return NULL;
@@ -467,7 +627,7 @@ CREATE_assign_function_expression(Expression *dest, char *identifier, JsFunction
 Expression *
 CREATE_binary_expression(EXPRESSION_TYPE typ, Expression *left, Expression *right)
 {
-    Expression *e = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionBinary), get_line_number());
+    Expression *e = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionBinary));
     if (NULL == e)
     {
         return NULL;
@@ -480,10 +640,72 @@ CREATE_binary_expression(EXPRESSION_TYPE typ, Expression *left, Expression *righ
     return e;
 }
 
+/*the function runs as a coroutine when called*/
+JsFunction *CREATE_async_function(JsFunction *f)
+{
+    f->async = 1;
+    return f;
+}
+
+/*a call gives a generator,the body runs as next asks for values*/
+JsFunction *CREATE_generator_function(JsFunction *f)
+{
+    f->generator = 1;
+    return f;
+}
+
+Expression *
+CREATE_await_expression(Expression *e)
+{
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
+    if (NULL == new)
+    {
+        return NULL;
+    }
+    new->typ = EXPRESSION_TYPE_AWAIT;
+    new->u.unary = e;
+    new->line = get_line_number();
+    return new;
+}
+
+/*e is NULL for a bare yield*/
+Expression *
+CREATE_yield_expression(Expression *e)
+{
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
+    if (NULL == new)
+    {
+        return NULL;
+    }
+    new->typ = EXPRESSION_TYPE_YIELD;
+    new->u.unary = e;
+    new->line = get_line_number();
+    return new;
+}
+
+/*a regular expression literal,the program is compiled when it first runs*/
+Expression *
+CREATE_regexp_expression(char *source, char *flags)
+{
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
+    ExpressionRegExp *regexp = CREATE_alloc_node(sizeof(ExpressionRegExp));
+    if (NULL == new || NULL == regexp)
+    {
+        return NULL;
+    }
+    regexp->source = source;
+    regexp->flags = flags;
+    regexp->prog = NULL;
+    new->typ = EXPRESSION_TYPE_REGEXP;
+    new->u.regexp = regexp;
+    new->line = get_line_number();
+    return new;
+}
+
 Expression *
 CREATE_minus_expression(Expression *e)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -497,7 +719,7 @@ CREATE_minus_expression(Expression *e)
 Expression *
 CREATE_not_expression(Expression *e)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -511,7 +733,7 @@ CREATE_not_expression(Expression *e)
 Expression *
 CREATE_index_expression(Expression *e, INDEX_TYPE typ, Expression *index, char *identifier)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionIndex), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionIndex));
     if (NULL == new)
     {
         return NULL;
@@ -529,7 +751,7 @@ CREATE_index_expression(Expression *e, INDEX_TYPE typ, Expression *index, char *
 Expression *
 CREATE_method_call_expression(Expression *e, char *method, ArgumentList *args)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionMethodCall), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionMethodCall));
     if (NULL == new)
     {
         return NULL;
@@ -546,7 +768,7 @@ CREATE_method_call_expression(Expression *e, char *method, ArgumentList *args)
 Expression *
 CREATE_incdec_expression(Expression *e, EXPRESSION_TYPE typ)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -560,7 +782,7 @@ CREATE_incdec_expression(Expression *e, EXPRESSION_TYPE typ)
 ExpressionList *
 CREATE_argument_list(Expression *e)
 {
-    ExpressionList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ExpressionList), get_line_number());
+    ExpressionList *list = CREATE_alloc_node(sizeof(ExpressionList));
     if (NULL == list)
     {
         return NULL;
@@ -576,7 +798,7 @@ CREATE_chain_argument_list(ExpressionList *list, Expression *e)
     {
         return NULL;
     }
-    ExpressionList *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ExpressionList), get_line_number());
+    ExpressionList *new = CREATE_alloc_node(sizeof(ExpressionList));
     if (NULL == new)
     {
         return list;
@@ -595,7 +817,7 @@ CREATE_chain_argument_list(ExpressionList *list, Expression *e)
 Expression *
 CREATE_function_call_expression(char *funcname, Expression *pre, ArgumentList *args)
 {
-    Expression *e = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionFunctionCall), get_line_number());
+    Expression *e = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionFunctionCall));
     if (NULL == e)
     {
         return NULL;
@@ -613,6 +835,7 @@ CREATE_function_call_expression(char *funcname, Expression *pre, ArgumentList *a
     e->u.function_call->func = funcname;
     e->u.function_call->e = pre;
     e->u.function_call->args = args;
+    e->u.function_call->tail = 0;
     e->line = get_line_number();
     return e;
 }
@@ -620,7 +843,7 @@ CREATE_function_call_expression(char *funcname, Expression *pre, ArgumentList *a
 Expression *
 CREATE_identifier_expression(char *identifier)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -634,7 +857,7 @@ CREATE_identifier_expression(char *identifier)
 Expression *
 CREATE_localvariable_declare_expression(char *identifier, Expression *assignment)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionCreateLocalVariable), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionCreateLocalVariable));
     if (NULL == new)
     {
         return NULL;
@@ -643,6 +866,7 @@ CREATE_localvariable_declare_expression(char *identifier, Expression *assignment
     new->u.create_var = (ExpressionCreateLocalVariable *)(new + 1);
     new->u.create_var->identifier = identifier;
     new->u.create_var->expression = assignment;
+    new->u.create_var->captured = 0;
     new->line = get_line_number();
     return new;
 }
@@ -650,7 +874,7 @@ CREATE_localvariable_declare_expression(char *identifier, Expression *assignment
 Expression *
 CREATE_boolean_expression(JSBool value)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -664,7 +888,7 @@ CREATE_boolean_expression(JSBool value)
 Expression *
 CREATE_null_expression()
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -677,7 +901,7 @@ CREATE_null_expression()
 Expression *
 CREATE_array_expression(ExpressionList *list)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -691,7 +915,7 @@ CREATE_array_expression(ExpressionList *list)
 Expression *
 CREATE_object_expression(ExpressionObjectKVList *list)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression));
     if (NULL == new)
     {
         return NULL;
@@ -705,7 +929,7 @@ CREATE_object_expression(ExpressionObjectKVList *list)
 Expression *
 CREATE_new_expression(char *identifer, ExpressionList *args)
 {
-    Expression *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(Expression) + sizeof(ExpressionNew), get_line_number());
+    Expression *new = CREATE_alloc_node(sizeof(Expression) + sizeof(ExpressionNew));
     if (NULL == new)
     {
         return NULL;
@@ -720,7 +944,7 @@ CREATE_new_expression(char *identifer, ExpressionList *args)
 
 ExpressionObjectKV *CREATE_object_kv(char *identifier_key, Expression *expression_key, Expression *value, JsFunction *func)
 {
-    ExpressionObjectKV *new = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ExpressionObjectKV), get_line_number());
+    ExpressionObjectKV *new = CREATE_alloc_node(sizeof(ExpressionObjectKV));
     new->identifier_key = identifier_key;
     new->expression_key = expression_key;
     new->value = value;
@@ -731,7 +955,7 @@ ExpressionObjectKV *CREATE_object_kv(char *identifier_key, Expression *expressio
 
 ExpressionObjectKVList *CREATE_object_kv_list(ExpressionObjectKV *kv)
 {
-    ExpressionObjectKVList *list = MEM_alloc(current_interpreter->interpreter_memory, sizeof(ExpressionObjectKVList), get_line_number());
+    ExpressionObjectKVList *list = CREATE_alloc_node(sizeof(ExpressionObjectKVList));
     list->kv = kv;
     list->next = NULL;
     return list;
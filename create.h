@@ -6,14 +6,28 @@
 JsInterpreter *
 JS_create_interpreter();
 
+void *CREATE_alloc_node(int size);
+
+int CREATE_open_ast_image(JsInterpreter *inter);
+
+int CREATE_is_ast_image(JsInterpreter *inter);
+
+void CREATE_free_ast(JsInterpreter *inter);
+
 char *CREATE_identifier(char *i);
 
+char *CREATE_identifier_with_length(char *i, int length);
+
 Expression *CREATE_alloc_expression(EXPRESSION_TYPE typ);
 
 StatementList *CREATE_chain_statement_list(StatementList *list, Statement *s);
 
 JsFunction *CREATE_function(char *name, ParameterList *parameterlist, Block *block);
 
+JsFunction *CREATE_async_function(JsFunction *f);
+
+JsFunction *CREATE_generator_function(JsFunction *f);
+
 JsFunction *CREATE_global_function(char *name, ParameterList *parameterlist, Block *block);
 
 ParameterList *CREATE_parameter_list(char *identifier);
@@ -61,6 +75,15 @@ Expression *
 CREATE_binary_expression(EXPRESSION_TYPE typ, Expression *left, Expression *right);
 Expression *
 CREATE_minus_expression(Expression *e);
+
+Expression *
+CREATE_await_expression(Expression *e);
+
+Expression *
+CREATE_yield_expression(Expression *e);
+
+Expression *
+CREATE_regexp_expression(char *source, char *flags);
 Expression *
 CREATE_index_expression(Expression *e, INDEX_TYPE typ, Expression *index, char *identifier);
 
@@ -97,4 +120,36 @@ CREATE_object_expression();
 Expression *
 CREATE_new_expression(char *identifer, ExpressionList *args);
 
+Expression *CREATE_function_expression(char *name, ParameterList *parameterlist, Block *block);
+
+Statement *
+CREATE_for_in_statement(char *identifier, Expression *target, Block *block);
+
+Statement *
+CREATE_for_of_statement(char *identifier, Expression *target, Block *block);
+
+Expression *
+CREATE_self_assign_op_expression(EXPRESSION_TYPE typ, Expression *e1, Expression *e2);
+
+StatementSwitchCaseList *
+CREATE_switch_case(Expression *match, StatementList *list);
+
+StatementSwitchCaseList *
+CREATE_chain_switch_case(StatementSwitchCaseList *list, StatementSwitchCaseList *e);
+
+Statement *
+CREATE_switch_statement(Expression *condition, StatementSwitchCaseList *list, StatementList *d);
+
+Expression *
+CREATE_assign_function_expression(Expression *dest, char *identifier, JsFunction *func);
+
+Expression *
+CREATE_not_expression(Expression *e);
+
+ExpressionObjectKV *CREATE_object_kv(char *identifier_key, Expression *expression_key, Expression *value, JsFunction *func);
+
+ExpressionObjectKVList *CREATE_object_kv_list(ExpressionObjectKV *kv);
+
+ExpressionObjectKVList *CREATE_chain_object_kv_list(ExpressionObjectKVList *list, ExpressionObjectKV *kv);
+
 #endif
@@ -2,11 +2,14 @@
 #include <stdio.h>
 #include "string.h"
 #include "unistd.h"
+#include "util.h"
+#include "output.h"
 
 MessageFormat CompileErrorMessages[] = {
 	{"dummy"},
 	{"invalid charater"},
 	{"can`t alloc memory"},
+	{"unterminated regular expression"},
 	{"dummy"}};
 MessageFormat RuntimeErrorMessages[] = {
 	{"dummy"},
@@ -24,19 +27,42 @@ MessageFormat RuntimeErrorMessages[] = {
 	{"not a function or method"},
 	{"method not found"},
 	{"can not use this as left value"},
-	{"unkown new type,only support Object and Array"},
+	{"unkown new type,only support Object,Array,Map and Set"},
 	{"normal value on heap"},
+	{"invalid json"},
+	{"can`t open file"},
+	{"await only in an async function or at top level"},
+	{"promise rejected and not handled"},
+	{"promise never settles,nothing left to run"},
+	{"yield only in a generator function"},
+	{"generator is already running"},
+	{"for of needs an array,string,map,set,generator or an object with next"},
+	{"invalid regular expression"},
+	{"internal error"},
 	{"dummy"},
 };
 
+/*what the script printed goes out before the error,_exit flushes nothing*/
+void error_flush()
+{
+	if (NULL != current_interpreter)
+	{
+		OUTPUT_flush(&current_interpreter->output);
+	}
+}
+
 void ERROR_compile_error(COMPILE_ERROR typ, char *buf)
 {
+	error_flush();
 	printf("compile failed,err:%s buf:%s", CompileErrorMessages[typ].message, buf);
+	fflush(stdout);
 	_exit(1);
 }
 
 void ERROR_runtime_error(RUNTIME_ERROR typ, char *who, int line)
 {
+	error_flush();
 	printf("runtime failed,%s:%s line:%d\n", who, RuntimeErrorMessages[typ].message, line);
+	fflush(stdout);
 	_exit(1);
 }
@@ -7,6 +7,7 @@ typedef enum
 {
 	CHARACTER_INVALID_ERR = 1,
 	CANNOT_ALLOC_MEMORY,
+	REGEXP_UNTERMINATED_ERR,
 } COMPILE_ERROR;
 
 typedef enum
@@ -26,7 +27,17 @@ typedef enum
 	RUNTIME_ERROR_METHOD_NOT_FOUND,
 	RUNTIME_ERROR_CAN_NOT_USE_THIS_AS_LEFT_VALUE,
 	RUNTIME_ERROR_UNKOWN_NEW_TYPE,
-	RUNTIME_ERROR_NORMAL_VALUE_ON_HEAP
+	RUNTIME_ERROR_NORMAL_VALUE_ON_HEAP,
+	RUNTIME_ERROR_INVALID_JSON,
+	RUNTIME_ERROR_CAN_NOT_OPEN_FILE,
+	RUNTIME_ERROR_AWAIT_OUTSIDE_ASYNC,
+	RUNTIME_ERROR_PROMISE_REJECTED,
+	RUNTIME_ERROR_PROMISE_NEVER_SETTLES,
+	RUNTIME_ERROR_YIELD_OUTSIDE_GENERATOR,
+	RUNTIME_ERROR_GENERATOR_RUNNING,
+	RUNTIME_ERROR_NOT_ITERABLE,
+	RUNTIME_ERROR_INVALID_REGEXP,
+	RUNTIME_ERROR_INTERNAL
 } RUNTIME_ERROR;
 
 void ERROR_compile_error(COMPILE_ERROR typ, char *buf);
@@ -0,0 +1,67 @@
+function factory(i) {
+	var s = "v" + i;
+	return function () {
+		return s;
+	};
+}
+
+var keep = [];
+var last;
+for (var i = 0; i < 40000; i++) {
+	var f = factory(i);
+	last = {a: i, b: "x" + i, c: [i, i + 1, "y" + i]};
+	if (0 == i % 1000) {
+		keep.push(f);
+	}
+}
+console.log(keep.length + " " + keep[3]() + " " + keep[39]() + " " + last.b + " " + last.c[2]);
+
+var objects = [];
+for (var i = 0; i < 20000; i++) {
+	objects.push({v: i, name: "k" + i});
+}
+var tot = 0;
+for (var i = 0; i < 20000; i++) {
+	tot += objects[i].v;
+}
+console.log(tot + " " + objects[19999].name);
+
+var chain = {next: null, n: -1, label: "end"};
+for (var i = 0; i < 30000; i++) {
+	chain = {next: chain, n: i, label: "n" + i};
+	if (0 == i % 3) {
+		chain = chain.next;
+	}
+}
+var count = 0;
+var sum = 0;
+while (chain.n >= 0) {
+	count++;
+	sum += chain.n;
+	chain = chain.next;
+}
+console.log(count + " " + sum);
+
+var m = new Map();
+for (var i = 0; i < 20000; i++) {
+	m.set("k" + i, {v: i});
+}
+var fromMap = 0;
+for (var i = 0; i < 20000; i++) {
+	fromMap += m.get("k" + i).v;
+}
+for (var i = 0; i < 20000; i = i + 2) {
+	m.delete("k" + i);
+}
+for (var i = 0; i < 10000; i++) {
+	m.set(i, {v: "again" + i});
+}
+console.log(fromMap + " " + m.size + " " + m.get("k19999").v + " " + m.get(9999).v);
+
+/*
+expected output:
+40 v3000 v39000 x39999 y39999
+199990000 k19999
+20000 300000000
+199990000 20000 19999 again9999
+*/
@@ -0,0 +1,102 @@
+function* count(from, to) {
+	for (var i = from; i <= to; i++) {
+		yield i;
+	}
+	return "done at " + to;
+}
+
+var g = count(1, 2);
+var r = g.next();
+console.log(r.value + " " + r.done);
+r = g.next();
+console.log(r.value + " " + r.done);
+r = g.next();
+console.log(r.value + " " + r.done);
+r = g.next();
+console.log(r.value + " " + r.done);
+
+var early = count(1, 100);
+console.log(early.next().value);
+r = early.return("stopped");
+console.log(r.value + " " + r.done);
+r = early.next();
+console.log(r.value + " " + r.done);
+
+var fresh = count(1, 3);
+r = fresh.return("before start");
+console.log(r.value + " " + r.done);
+console.log(fresh.next().done);
+
+function* echo() {
+	var total = 0;
+	var got = yield "ready";
+	while (got != null) {
+		total = total + got;
+		got = yield total;
+	}
+	return "total " + total;
+}
+var e = echo();
+console.log(e.next().value);
+console.log(e.next(5).value);
+console.log(e.next(10).value);
+r = e.next(null);
+console.log(r.value + " " + r.done);
+
+function* pairs(n) {
+	for (var a of count(1, n)) {
+		for (var b of count(a, n)) {
+			yield a * 10 + b;
+		}
+	}
+}
+var all = [];
+for (var p of pairs(3)) {
+	all.push(p);
+}
+console.log(all);
+
+function* squares(source) {
+	for (var v of source) {
+		yield v * v;
+	}
+}
+var seen = 0;
+for (var s of squares(count(1, 1000))) {
+	seen++;
+	if (s > 50) {
+		console.log("broke at " + s + " after " + seen);
+		break;
+	}
+}
+
+var lazy = 0;
+function* logged() {
+	lazy++;
+	yield lazy;
+}
+var l = logged();
+console.log("created " + lazy);
+l.next();
+console.log("started " + lazy);
+
+/*
+expected output:
+1 false
+2 false
+done at 2 true
+undefined true
+1
+stopped true
+undefined true
+before start true
+true
+ready
+5
+15
+total 15 true
+[11,12,13,22,23,33]
+broke at 64 after 8
+created 0
+started 1
+*/
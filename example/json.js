@@ -0,0 +1,42 @@
+var o = JSON.parse('{"a":1,"b":[true,false,null],"a":2,"c":{"d":"x","d":"y"}}');
+console.log(JSON.stringify(o));
+var keys = 0;
+for (var k in o) {
+	keys++;
+}
+console.log(keys);
+console.log(o.a + " " + o.c.d);
+
+var s = JSON.parse('"tab\tquote\"slash\\ é😀 end"');
+console.log(s);
+console.log(JSON.stringify(s));
+
+var long = JSON.parse('"0123456789abcde\n0123456789abcdef\"0123456789abcdefghijklmnopqrstuvwxyz"');
+console.log(JSON.stringify(long));
+var plain = JSON.parse('"0123456789abcdef0123456789abcdef0123456789abcdef"');
+console.log(plain);
+
+var nested = JSON.parse(' { "list" : [ 1 , 2.5 , -3e2 , { "deep" : [ [ [ ] ] ] } ] , "empty" : { } } ');
+console.log(JSON.stringify(nested));
+console.log(nested.list[1] + nested.list[2]);
+
+console.log(JSON.stringify({name: "lily", age: 18, tags: ["a", "b"]}));
+console.log(JSON.stringify([1, "two", null, true]));
+
+JSON.parse('{"a":1,}');
+
+/*
+expected output:
+{"a":2,"b":[true,false,null],"c":{"d":"y"}}
+3
+2 y
+tab	quote"slash\ é😀 end
+"tab\tquote\"slash\\ é😀 end"
+"0123456789abcde\n0123456789abcdef\"0123456789abcdefghijklmnopqrstuvwxyz"
+0123456789abcdef0123456789abcdef0123456789abcdef
+{"list":[1,2.5,-300,{"deep":[[[]]]}],"empty":{}}
+-297.500000
+{"name":"lily","age":18,"tags":["a","b"]}
+[1,"two",null,true]
+runtime failed,JSON.parse,expected key at 7:invalid json line:26
+*/
@@ -0,0 +1,70 @@
+console.log("script start");
+
+setTimeout(function () {
+	console.log("timeout 0 a");
+	queueMicrotask(function () {
+		console.log("microtask from timeout a");
+	});
+	Promise.resolve(1).then(function (v) {
+		console.log("then from timeout a " + v);
+	});
+}, 0);
+setTimeout(function () {
+	console.log("timeout 0 b");
+}, 0);
+
+queueMicrotask(function () {
+	console.log("microtask 1");
+	queueMicrotask(function () {
+		console.log("microtask queued by microtask");
+	});
+});
+Promise.resolve(2).then(function (v) {
+	console.log("then " + v);
+});
+
+var cancelled = setTimeout(function () {
+	console.log("never printed");
+}, 10);
+setTimeout(function () {
+	console.log("timeout 20");
+}, 20);
+clearTimeout(cancelled);
+
+var ticks = 0;
+var interval = setInterval(function () {
+	ticks++;
+	console.log("interval " + ticks);
+	if (3 == ticks) {
+		clearInterval(interval);
+		setTimeout(function () {
+			console.log("after interval");
+		}, 0);
+	}
+}, 40);
+
+var late = setTimeout(function () {
+	console.log("late timeout");
+	clearTimeout(late);
+}, 200);
+
+console.log("script end");
+
+/*
+expected output:
+script start
+script end
+microtask 1
+then 2
+microtask queued by microtask
+timeout 0 a
+microtask from timeout a
+then from timeout a 1
+timeout 0 b
+timeout 20
+interval 1
+interval 2
+interval 3
+after interval
+late timeout
+*/
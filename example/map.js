@@ -0,0 +1,92 @@
+var m = new Map();
+m.set("a", 1);
+m.set("b", 2);
+m.set("c", 3);
+m.delete("a");
+m.set("a", 4);
+m.set("b", 5);
+console.log(m.keys());
+console.log(m.values());
+console.log(m.size + " " + m.has("a") + " " + m.get("b") + " " + m.get("gone"));
+
+var churn = new Map();
+for (var i = 0; i < 8; i++) {
+	churn.set(i, i);
+}
+for (var round = 0; round < 1000; round++) {
+	churn.delete(round);
+	churn.set(round + 8, round);
+}
+console.log(churn.size + " " + churn.has(999) + " " + churn.has(1000) + " " + churn.get(1007));
+console.log(churn.keys());
+
+var grow = new Map();
+for (var j = 0; j < 5000; j++) {
+	grow.set("k" + j, j * 2);
+}
+var sum = 0;
+var missing = 0;
+for (var j = 0; j < 5000; j++) {
+	sum = sum + grow.get("k" + j);
+	if (!grow.has("k" + j)) {
+		missing++;
+	}
+}
+console.log(grow.size + " " + sum + " " + missing + " " + grow.has("k5000"));
+for (var j = 0; j < 5000; j = j + 2) {
+	grow.delete("k" + j);
+}
+var first = 0;
+for (var entry of grow) {
+	if (first < 3) {
+		console.log(entry[0] + " " + entry[1]);
+	}
+	first++;
+}
+console.log(first + " " + grow.size);
+
+var mixed = new Map();
+mixed.set(1, "int");
+mixed.set(1.0, "float one");
+mixed.set("1", "string");
+mixed.set(true, "bool");
+mixed.set(null, "null");
+console.log(mixed.size + " " + mixed.get(1) + " " + mixed.get("1") + " " + mixed.get(null));
+
+var s = new Set([3, 1, 3, 2, 1]);
+console.log(s.values());
+s.delete(3);
+s.add(3);
+s.add(1);
+console.log(s.values());
+console.log(s.size);
+for (var v of s) {
+	console.log(v);
+}
+s.clear();
+s.add("again");
+console.log(s.values());
+console.log(s.size);
+
+/*
+expected output:
+[b,c,a]
+[5,3,4]
+3 true 5 undefined
+8 false true 999
+[1000,1001,1002,1003,1004,1005,1006,1007]
+5000 24995000 0 false
+k1 2
+k3 6
+k5 10
+2500 2500
+4 float one string null
+[3,1,2]
+[1,2,3]
+3
+1
+2
+3
+[again]
+1
+*/
@@ -0,0 +1,96 @@
+async function double(x) {
+	var v = await x;
+	return v * 2;
+}
+
+async function fail(reason) {
+	await null;
+	return Promise.reject(reason);
+}
+
+async function passOn(reason) {
+	var v = await fail(reason);
+	console.log("never printed " + v);
+	return v;
+}
+
+setTimeout(function () {
+	console.log("timeout 0");
+}, 0);
+
+console.log("start");
+
+double(21).then(function (v) {
+	console.log("await on a number " + v);
+});
+double(Promise.resolve(5)).then(function (v) {
+	console.log("await on a promise " + v);
+});
+
+Promise.reject("first").then(function (v) {
+	console.log("never printed " + v);
+}).then(function (v) {
+	console.log("never printed " + v);
+}).catch(function (e) {
+	console.log("caught " + e);
+	return "recovered";
+}).then(function (v) {
+	console.log("after catch " + v);
+});
+
+new Promise(function (resolve, reject) {
+	reject("from executor");
+	resolve("ignored");
+}).catch(function (e) {
+	console.log("caught " + e);
+});
+
+passOn("deep").catch(function (e) {
+	console.log("caught through awaits " + e);
+});
+
+Promise.all([double(1), 3, Promise.resolve(4)]).then(function (all) {
+	console.log("all " + all[0] + " " + all[1] + " " + all[2]);
+});
+Promise.race([new Promise(function (resolve) {
+	setTimeout(function () {
+		resolve("slow");
+	}, 30);
+}), new Promise(function (resolve) {
+	setTimeout(function () {
+		resolve("fast");
+	}, 5);
+})]).then(function (v) {
+	console.log("race " + v);
+});
+
+async function main() {
+	var t = await new Promise(function (resolve) {
+		setTimeout(function () {
+			resolve("timer value");
+		}, 50);
+	});
+	console.log("main got " + t);
+	var n = await 7;
+	console.log("main got " + n);
+}
+main();
+
+console.log("end");
+
+/*
+expected output:
+start
+end
+caught from executor
+await on a number 42
+await on a promise 10
+caught first
+all 2 3 4
+after catch recovered
+caught through awaits deep
+timeout 0
+race fast
+main got timer value
+main got 7
+*/
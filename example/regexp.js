@@ -0,0 +1,100 @@
+var text = "the quick brown fox jumps over the lazy dog";
+console.log(/fox/.test(text));
+console.log(/cat/.test(text));
+console.log(text.replace(/o+/g, "0"));
+console.log(text.match(/\w+/g).length);
+console.log("a1b22c333".split(/\d+/));
+
+var dated = /(\d+)-(\d+)-(\d+)/;
+var date = dated.exec("due 2024-03-15 noon");
+console.log(date[0] + " " + date[1] + " " + date[2] + " " + date[3] + " at " + dated.index);
+var opt = /(a)|(b)/.exec("b");
+console.log(opt[1] + " " + opt[2]);
+var again = /(?:(a)|b)+/.exec("ab");
+console.log(again[0] + " " + again[1]);
+console.log(/(cat|category|dog)s?/.exec("categorys")[0]);
+console.log(/^(?:one|two|three)$/.test("two") + " " + /^(?:one|two|three)$/.test("twos"));
+
+console.log(/^abc$/.test("abc") + " " + /^abc$/.test("xabc"));
+console.log(/^b/m.test("a\nb") + " " + /^b/.test("a\nb"));
+var line = /a$/m;
+line.exec("ba\nc");
+console.log(line.index);
+
+console.log(/a{3}/.exec("aaaaa")[0]);
+console.log(/a{2,3}/.exec("aaaaa")[0]);
+console.log(/a{2,}?/.exec("aaaaa")[0]);
+console.log(/a{0}b/.exec("aab")[0]);
+console.log(/x*/.exec("abc")[0] + "|" + /(a*)*b/.exec("aab")[0] + "|" + /(a|)+b/.exec("aab")[1] + "|");
+console.log(/a??b/.exec("aab")[0] + " " + /a+?/.exec("aaa")[0]);
+console.log("a{,5}".match(/a{,5}/)[0]);
+
+var many = "";
+for (var i = 0; i < 20000; i++) {
+	many = many + "a";
+}
+var range = /a{19990,20010}/;
+var whole = range.exec(many);
+console.log(/^a{20000}$/.test(many) + " " + /^a{20001}$/.test(many) + " " + (whole[0] == many));
+
+console.log(/(\w)\1/.exec("abccd")[0]);
+var ahead = /foo(?=bar)/;
+ahead.exec("foobaz foobar");
+console.log(ahead.index);
+console.log(/\bfox\b/.test(text) + " " + /\box\b/.test(text));
+console.log(/(?!the)\b\w+/.exec(text)[0]);
+
+var slow = "";
+for (var j = 0; j < 30; j++) {
+	slow = slow + "x";
+}
+console.log(/(x+x+)+y/.test(slow));
+console.log(/(x+x+)+y/.test(slow + "y"));
+console.log(/^(a|aa)+$/.test("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab"));
+
+var g = /o/g;
+var found = "";
+while (g.test(text)) {
+	found = found + g.lastIndex + " ";
+}
+console.log(found);
+console.log(/ab+c/gi.source + " " + /ab+c/gi.flags);
+console.log(text.replace(/(\w+) (\w+)/, "$2 $1"));
+
+new RegExp("(unclosed");
+
+/*
+expected output:
+true
+false
+the quick br0wn f0x jumps 0ver the lazy d0g
+9
+[a,b,c,]
+2024-03-15 2024 03 15 at 4
+undefined b
+ab undefined
+cat
+true false
+true false
+true false
+1
+aaa
+aaa
+aa
+b
+|aab|a|
+ab a
+a{,5}
+true false true
+cc
+7
+true false
+quick
+false
+true
+false
+13 18 27 42 
+ab+c gi
+quick the brown fox jumps over the lazy dog
+runtime failed,missing ):invalid regular expression line:64
+*/
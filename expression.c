@@ -7,6 +7,11 @@
 #include <string.h>
 #include "expression.h"
 #include "interprete.h"
+#include "map.h"
+#include "typed.h"
+#include "promise.h"
+#include "coroutine.h"
+#include "regexp.h"
 
 int get_expression_list_length(ExpressionList *list)
 {
@@ -28,6 +33,16 @@ int eval_negative_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expr
 	return 0;
 }
 
+/*a typed array element from get_left_value_index goes back into the array,converted the way the array stores it*/
+void eval_store_left_value(JsInterpreter *inter, JsValue *dest)
+{
+	if (dest == &inter->typed_value)
+	{
+		TYPED_set(inter->typed_dest, inter->typed_index, dest);
+		TYPED_get(inter->typed_dest, inter->typed_index, dest);
+	}
+}
+
 int eval_increment_decrement_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	JsValue *left = get_left_value(inter, env, e->u.unary);
@@ -46,6 +61,7 @@ int eval_increment_decrement_expression(JsInterpreter *inter, ExecuteEnvironment
 	{
 		*left = js_increment_or_decrement(left, 0);
 	}
+	eval_store_left_value(inter, left);
 	if (EXPRESSION_TYPE_PRE_DECREMENT == e->typ || EXPRESSION_TYPE_PRE_INCREMENT == e->typ)
 	{
 		push_stack(&inter->stack, left);
@@ -103,13 +119,106 @@ int eval_string_expression(JsInterpreter *inter, Expression *e)
 	return 0;
 }
 
+/*get an operand without a round trip through the stack when it is an int literal or a variable*/
+void eval_operand(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e, JsValue *v)
+{
+	JsValue *var;
+	if (EXPRESSION_TYPE_INT == e->typ)
+	{
+		v->typ = JS_VALUE_TYPE_INT;
+		v->u.intvalue = e->u.int_value;
+		return;
+	}
+	if (EXPRESSION_TYPE_IDENTIFIER == e->typ)
+	{
+		var = INTERPRETE_search_variable_from_env(env, e->u.identifier);
+		if (NULL != var)
+		{
+			*v = *var;
+			return;
+		}
+	}
+	eval_expression(inter, env, e);
+	*v = pop_stack(&inter->stack);
+}
+
+/*
+ * an operand read by eval_operand is not on the stack,so gc does not see it.
+ * put a heap value back there while the other operand may still run code.
+ */
+int eval_root_operand(JsInterpreter *inter, JsValue *v, Expression *other)
+{
+	switch (v->typ)
+	{
+	case JS_VALUE_TYPE_STRING:
+	case JS_VALUE_TYPE_ARRAY:
+	case JS_VALUE_TYPE_OBJECT:
+	case JS_VALUE_TYPE_FUNCTION:
+	case JS_VALUE_TYPE_MAP:
+	case JS_VALUE_TYPE_BUFFER:
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+	case JS_VALUE_TYPE_PROMISE:
+	case JS_VALUE_TYPE_COROUTINE:
+	case JS_VALUE_TYPE_REGEXP:
+		break;
+	case JS_VALUE_TYPE_UNDEFINED:
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_INT:
+	case JS_VALUE_TYPE_FLOAT:
+	case JS_VALUE_TYPE_BOOL:
+	case JS_VALUE_TYPE_STRING_LITERAL:
+	default:
+		return 0;
+	}
+	if (EXPRESSION_TYPE_INT == other->typ || EXPRESSION_TYPE_FLOAT == other->typ || EXPRESSION_TYPE_BOOL == other->typ ||
+		EXPRESSION_TYPE_STRING == other->typ || EXPRESSION_TYPE_NULL == other->typ || EXPRESSION_TYPE_IDENTIFIER == other->typ)
+	{ /*a leaf runs no code*/
+		return 0;
+	}
+	push_stack(&inter->stack, v);
+	return 1;
+}
+
 int eval_arithmetic_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	JsValue v;
-	eval_expression(inter, env, e->u.binary->right);
-	eval_expression(inter, env, e->u.binary->left);
-	JsValue left = pop_stack(&inter->stack);
-	JsValue right = pop_stack(&inter->stack);
+	JsValue left;
+	JsValue right;
+	eval_operand(inter, env, e->u.binary->right, &right);
+	int rooted = eval_root_operand(inter, &right, e->u.binary->left);
+	eval_operand(inter, env, e->u.binary->left, &left);
+	if (1 == rooted)
+	{
+		pop_stack(&inter->stack);
+	}
+	if (JS_VALUE_TYPE_INT == left.typ && JS_VALUE_TYPE_INT == right.typ)
+	{ /*int fast path,div always gives float so it goes the slow way*/
+		v.typ = JS_VALUE_TYPE_INT;
+		if (EXPRESSION_TYPE_ADD == e->typ)
+		{
+			v.u.intvalue = left.u.intvalue + right.u.intvalue;
+			push_stack(&inter->stack, &v);
+			return 0;
+		}
+		if (EXPRESSION_TYPE_SUB == e->typ)
+		{
+			v.u.intvalue = left.u.intvalue - right.u.intvalue;
+			push_stack(&inter->stack, &v);
+			return 0;
+		}
+		if (EXPRESSION_TYPE_MUL == e->typ)
+		{
+			v.u.intvalue = left.u.intvalue * right.u.intvalue;
+			push_stack(&inter->stack, &v);
+			return 0;
+		}
+		if (EXPRESSION_TYPE_MOD == e->typ)
+		{
+			v.u.intvalue = (0 == left.u.intvalue || 0 == right.u.intvalue) ? 0 : left.u.intvalue % right.u.intvalue;
+			push_stack(&inter->stack, &v);
+			return 0;
+		}
+	}
 	if (EXPRESSION_TYPE_MUL == e->typ)
 	{
 		v = js_value_mul(&left, &right);
@@ -139,10 +248,46 @@ int eval_relation_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expr
 	JsValue v;
 	v.typ = JS_VALUE_TYPE_BOOL;
 	v.u.boolvalue = JS_BOOL_FALSE;
-	eval_expression(inter, env, e->u.binary->left);
-	eval_expression(inter, env, e->u.binary->right);
-	JsValue right = pop_stack(&inter->stack);
-	JsValue left = pop_stack(&inter->stack);
+	JsValue left;
+	JsValue right;
+	eval_operand(inter, env, e->u.binary->left, &left);
+	int rooted = eval_root_operand(inter, &left, e->u.binary->right);
+	eval_operand(inter, env, e->u.binary->right, &right);
+	if (1 == rooted)
+	{
+		pop_stack(&inter->stack);
+	}
+	if (JS_VALUE_TYPE_INT == left.typ && JS_VALUE_TYPE_INT == right.typ)
+	{ /*int fast path*/
+		int result = 0;
+		if (EXPRESSION_TYPE_EQ == e->typ)
+		{
+			result = left.u.intvalue == right.u.intvalue;
+		}
+		else if (EXPRESSION_TYPE_NE == e->typ)
+		{
+			result = left.u.intvalue != right.u.intvalue;
+		}
+		else if (EXPRESSION_TYPE_GE == e->typ)
+		{
+			result = left.u.intvalue >= right.u.intvalue;
+		}
+		else if (EXPRESSION_TYPE_GT == e->typ)
+		{
+			result = left.u.intvalue > right.u.intvalue;
+		}
+		else if (EXPRESSION_TYPE_LE == e->typ)
+		{
+			result = left.u.intvalue <= right.u.intvalue;
+		}
+		else if (EXPRESSION_TYPE_LT == e->typ)
+		{
+			result = left.u.intvalue < right.u.intvalue;
+		}
+		v.u.boolvalue = result ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+		push_stack(&inter->stack, &v);
+		return 0;
+	}
 	if (EXPRESSION_TYPE_EQ == e->typ)
 	{
 		v.u.boolvalue = js_value_equal(&left, &right);
@@ -182,14 +327,39 @@ int eval_relation_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expr
 int eval_self_op_assign_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	eval_expression(inter, env, e->u.binary->right); /*get assign value*/
-	JsValue value = pop_stack(&inter->stack);
+	JsValue value = peek_stack(&inter->stack, 0); /*keep it for gc until dest is found*/
 	JsValue *dest = get_left_value(inter, env, e->u.binary->left);
 	if (NULL == dest)
 	{
 		ERROR_runtime_error(RUNTIME_ERROR_VARIABLE_NOT_FOUND, "", e->line);
 		return RUNTIME_ERROR_VARIABLE_NOT_FOUND;
 	}
+	pop_stack(&inter->stack);
 	JsValue newvalue;
+	if (JS_VALUE_TYPE_INT == dest->typ && JS_VALUE_TYPE_INT == value.typ)
+	{ /*int fast path*/
+		if (EXPRESSION_TYPE_PLUS_ASSIGN == e->typ)
+		{
+			dest->u.intvalue += value.u.intvalue;
+			eval_store_left_value(inter, dest);
+			push_stack(&inter->stack, dest);
+			return 0;
+		}
+		if (EXPRESSION_TYPE_MINUS_ASSIGN == e->typ)
+		{
+			dest->u.intvalue -= value.u.intvalue;
+			eval_store_left_value(inter, dest);
+			push_stack(&inter->stack, dest);
+			return 0;
+		}
+		if (EXPRESSION_TYPE_MUL_ASSIGN == e->typ)
+		{
+			dest->u.intvalue *= value.u.intvalue;
+			eval_store_left_value(inter, dest);
+			push_stack(&inter->stack, dest);
+			return 0;
+		}
+	}
 	switch (e->typ)
 	{
 	case EXPRESSION_TYPE_PLUS_ASSIGN:
@@ -207,8 +377,15 @@ int eval_self_op_assign_expression(JsInterpreter *inter, ExecuteEnvironment *env
 	case EXPRESSION_TYPE_MOD_ASSIGN:
 		newvalue = js_value_mod(dest, &value);
 		break;
+	case EXPRESSION_TYPE_AWAIT: /*never an assignment,dest stays*/
+	case EXPRESSION_TYPE_YIELD:
+	case EXPRESSION_TYPE_REGEXP:
+	default:
+		newvalue = *dest;
+		break;
 	}
 	*dest = newvalue;
+	eval_store_left_value(inter, dest);
 	push_stack(&inter->stack, dest);
 	return 0;
 }
@@ -216,13 +393,14 @@ int eval_self_op_assign_expression(JsInterpreter *inter, ExecuteEnvironment *env
 int eval_assign_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	eval_expression(inter, env, e->u.binary->right); /*get assign value*/
-	JsValue value = pop_stack(&inter->stack);
+	JsValue value = peek_stack(&inter->stack, 0); /*keep it for gc until dest is found*/
 	JsValue *dest = get_left_value(inter, env, e->u.binary->left);
 	if (NULL == dest)
 	{
 		ERROR_runtime_error(RUNTIME_ERROR_VARIABLE_NOT_FOUND, "", e->line);
 		return RUNTIME_ERROR_VARIABLE_NOT_FOUND;
 	}
+	pop_stack(&inter->stack);
 	if (JS_VALUE_TYPE_STRING_LITERAL == value.typ)
 	{
 		int length = strlen(value.u.literal_string);
@@ -239,14 +417,14 @@ int eval_assign_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expres
 	{
 		*dest = value;
 	}
-	extern gc_sweep_should_executing;
+	eval_store_left_value(inter, dest);
+	push_stack(&inter->stack, dest); /*before gc,dest may be in an object nothing else holds*/
+	extern char gc_sweep_should_executing;
 	if (1 == gc_sweep_should_executing)
 	{
-		gc_mark(env);
-		gc_sweep(inter);
+		gc_collect(inter);
 		gc_sweep_should_executing = 0;
 	}
-	push_stack(&inter->stack, dest);
 	return 0;
 }
 
@@ -288,14 +466,103 @@ int eval_array_index_expression(JsInterpreter *inter, ExecuteEnvironment *env, J
 	return RUNTIME_ERROR_FIELD_NOT_DEFINED;
 }
 
+int eval_typed_index_expression(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *typed, ExpressionIndex *index, int line)
+{
+	JsValue key;
+	JsValue v;
+	if (INDEX_TYPE_EXPRESSION == index->typ && JS_VALUE_TYPE_TYPED_ARRAY == typed->typ)
+	{
+		eval_operand(inter, env, index->index, &key);
+		if (JS_VALUE_TYPE_INT != key.typ)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_INDEX_HAS_WRONG_TYPE, "array index must be int", line);
+			return RUNTIME_ERROR_INDEX_HAS_WRONG_TYPE;
+		}
+		if (key.u.intvalue < 0 || key.u.intvalue >= typed->u.typed->length)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, "", line);
+			return RUNTIME_ERROR_INDEX_OUT_RANGE;
+		}
+		TYPED_get(typed->u.typed, key.u.intvalue, &v);
+		push_stack(&inter->stack, &v);
+		return 0;
+	}
+	if (INDEX_TYPE_IDENTIFIER != index->typ)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_INDEX_THIS_TYPE, "ArrayBuffer", line);
+		return RUNTIME_ERROR_CANNOT_INDEX_THIS_TYPE;
+	}
+	v.typ = JS_VALUE_TYPE_INT;
+	if (JS_VALUE_TYPE_BUFFER == typed->typ && 0 == strcmp("byteLength", index->identifier))
+	{
+		v.u.intvalue = typed->u.buffer->length;
+	}
+	else if (JS_VALUE_TYPE_BUFFER == typed->typ)
+	{
+		v.typ = 0;
+	}
+	else if (0 == strcmp("length", index->identifier))
+	{
+		v.u.intvalue = typed->u.typed->length;
+	}
+	else if (0 == strcmp("byteLength", index->identifier))
+	{
+		v.u.intvalue = typed->u.typed->length * TYPED_element_size(typed->u.typed->kind);
+	}
+	else if (0 == strcmp("byteOffset", index->identifier))
+	{
+		v.u.intvalue = typed->u.typed->offset;
+	}
+	else if (0 == strcmp("buffer", index->identifier))
+	{
+		v.typ = JS_VALUE_TYPE_BUFFER;
+		v.u.buffer = typed->u.typed->buffer;
+	}
+	else
+	{
+		v.typ = 0;
+	}
+	if (0 == v.typ)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_FIELD_NOT_DEFINED, index->identifier, line);
+		return RUNTIME_ERROR_FIELD_NOT_DEFINED;
+	}
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
 int eval_index_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	eval_expression(inter, env, e->u.index->e);
-	JsValue v = pop_stack(&inter->stack);
+	JsValue v = peek_stack(&inter->stack, 0); /*stays on the stack while the index is evaluated*/
 	ExpressionIndex *index = e->u.index;
+	int ret;
 	if (JS_VALUE_TYPE_ARRAY == v.typ)
 	{ /*handle array part*/
-		return eval_array_index_expression(inter, env, &v, index, e->line);
+		ret = eval_array_index_expression(inter, env, &v, index, e->line);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_TYPED_ARRAY == v.typ || JS_VALUE_TYPE_BUFFER == v.typ)
+	{
+		ret = eval_typed_index_expression(inter, env, &v, index, e->line);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_MAP == v.typ && INDEX_TYPE_IDENTIFIER == index->typ && 0 == strcmp("size", index->identifier))
+	{
+		v.typ = JS_VALUE_TYPE_INT;
+		v.u.intvalue = v.u.map->size;
+		pop_stack(&inter->stack);
+		push_stack(&inter->stack, &v);
+		return 0;
+	}
+	if (JS_VALUE_TYPE_REGEXP == v.typ && INDEX_TYPE_IDENTIFIER == index->typ)
+	{
+		v = REGEXP_field(inter, v.u.regexp, index->identifier, e->line);
+		pop_stack(&inter->stack);
+		push_stack(&inter->stack, &v);
+		return 0;
 	}
 
 	if (JS_VALUE_TYPE_OBJECT != v.typ)
@@ -315,7 +582,7 @@ int eval_index_expression(JsInterpreter *inter, ExecuteEnvironment *env, Express
 		JsValue key = pop_stack(&inter->stack);
 		if (JS_VALUE_TYPE_STRING == key.typ)
 		{
-			value = INTERPRETER_search_field_from_object_include_prototype(v.u.object, *key.u.string->s);
+			value = INTERPRETER_search_field_from_object_include_prototype(v.u.object, key.u.string->s);
 		}
 		if (JS_VALUE_TYPE_STRING_LITERAL == key.typ)
 		{
@@ -327,6 +594,7 @@ int eval_index_expression(JsInterpreter *inter, ExecuteEnvironment *env, Express
 		ERROR_runtime_error(RUNTIME_ERROR_FIELD_NOT_DEFINED, "not found", e->line);
 		return RUNTIME_ERROR_FIELD_NOT_DEFINED;
 	}
+	pop_stack(&inter->stack);
 	push_stack(&inter->stack, value);
 	return 0;
 }
@@ -339,6 +607,7 @@ int eval_array_expression(JsInterpreter *inter, ExecuteEnvironment *env, Express
 	JsArray *array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, length * 2 + 1, e->line);
 	v.u.array = array;
 	array->length = 0;
+	push_stack(&inter->stack, &v); /*on the stack first so gc sees it while elements are evaluated*/
 	ExpressionList *list = e->u.expression_list;
 	JsValue vv;
 	while (NULL != list)
@@ -349,75 +618,89 @@ int eval_array_expression(JsInterpreter *inter, ExecuteEnvironment *env, Express
 		array->length++;
 		list = list->next;
 	}
-	push_stack(&inter->stack, &v);
 	return 0;
 }
 
-int eval_method_and_function_call(
+/*the call itself,its args_count arguments are on top of the stack,the result takes their place*/
+int eval_call_stack_args(
 	JsInterpreter *inter,
 	ExecuteEnvironment *env,
 	JsObject *object,
 	JsFunction *func,
-	ArgumentList *args,
+	int args_count,
 	int line)
 {
-	ExecuteEnvironment *callenv = INTERPRETER_alloc_env(inter, env, line);
-	ExecuteEnvironment *closureenv = NULL;
-	if (NULL == object)
-	{
-		object = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_OBJECT, 0, line);
-		closureenv = get_last_not_null_outter_env(func->env);
-		if (NULL != closureenv)
-		{
-			callenv->outter = func->env;
-			closureenv->outter = env;
-		}
+	if (0 != func->async || 0 != func->generator)
+	{ /*the body runs on a coroutine of its own,the caller gets its promise or the generator*/
+		return COROUTINE_start(inter, object, func, args_count, line);
 	}
-	else
+	return eval_call_frame(inter, env, object, func, args_count, line);
+}
+
+/*a user function run on the current stack,an async one too when its coroutine starts*/
+int eval_call_frame(
+	JsInterpreter *inter,
+	ExecuteEnvironment *env,
+	JsObject *object,
+	JsFunction *func,
+	int args_count,
+	int line)
+{
+	ParameterList *paras;
+	JsValue v;
+	int i;
+	char tail_calls = 0;
+call:
+	if (0 != tail_calls && (0 != func->async || 0 != func->generator))
 	{
-		closureenv = get_last_not_null_outter_env(object->env);
-		if (NULL != closureenv)
-		{
-			callenv->outter = object->env;
-			closureenv->outter = env;
-		}
+		COROUTINE_start(inter, object, func, args_count, line);
+		goto callend;
 	}
-	ParameterList *paras = func->parameter_list;
-	JsValue v;
-	v.typ = JS_VALUE_TYPE_NULL;
-	int args_count = get_expression_list_length(args);
+	paras = func->parameter_list;
+	JsValue *argv = inter->stack.vs + inter->stack.sp - args_count;
+	ExecuteEnvironment *callenv = INTERPRETER_alloc_call_env(inter, env, func, line);
 
-	JsValue arguments;
-	JsArray *arguments_arr = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, args_count, line);
-	arguments.typ = JS_VALUE_TYPE_ARRAY;
-	arguments.u.array = arguments_arr;
-	while (NULL != args)
-	{
-		/*make value*/
-		eval_expression(inter, env, args->expression);
-		v = pop_stack(&inter->stack);
-		if (NULL != paras)
+	if (0 != func->uses_arguments)
+	{ /*only materialized for functions that read it,others see their args in the slots*/
+		JsValue arguments;
+		JsArray *arguments_arr = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, args_count, line);
+		arguments.typ = JS_VALUE_TYPE_ARRAY;
+		arguments.u.array = arguments_arr;
+		for (i = 0; i < args_count; i++)
 		{
-			INTERPRETER_create_variable(inter, callenv, paras->identifier, &v, line);
-			paras = paras->next;
+			arguments_arr->elements[i] = argv[i];
 		}
-		arguments_arr->elements[arguments_arr->length] = v;
-		arguments_arr->length++;
-		args = args->next;
+		arguments_arr->length = args_count;
+		INTERPRETER_bind_slot(callenv, func->parameter_count, "arguments", &arguments);
 	}
 	v.typ = JS_VALUE_TYPE_NULL;
-	while (NULL != paras)
+	for (i = 0; NULL != paras; i++)
 	{ /*args are more than paras,no big deal*/
-		INTERPRETER_create_variable(inter, callenv, paras->identifier, &v, line);
+		if (0 != paras->captured)
+		{
+			INTERPRETER_create_variable(inter, callenv->cells, paras->identifier, i < args_count ? argv + i : &v, line);
+		}
+		else
+		{
+			INTERPRETER_bind_slot(callenv, i, paras->identifier, i < args_count ? argv + i : &v);
+		}
 		paras = paras->next;
 	}
-	INTERPRETER_create_variable(inter, callenv, "arguments", &arguments, line);
-	JsValue this;
-	this.typ = JS_VALUE_TYPE_OBJECT;
-	this.u.object = object;
-	INTERPRETER_create_variable(inter, callenv, "this", &this, line);
+	inter->stack.sp -= args_count;
+	if (0 != func->uses_this)
+	{ /*a function that never reads this does not need a receiver object*/
+		if (NULL == object)
+		{
+			object = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_OBJECT, 0, line);
+		}
+		JsValue this;
+		this.typ = JS_VALUE_TYPE_OBJECT;
+		this.u.object = object;
+		INTERPRETER_bind_slot(callenv, func->parameter_count + 1, "this", &this);
+	}
 	StatementList *list = func->block->list;
 	StatementResult ret;
+	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	while (NULL != list)
 	{
 		ret = INTERPRETER_execute_statement(inter, callenv, list->statement);
@@ -426,11 +709,11 @@ int eval_method_and_function_call(
 		case STATEMENT_RESULT_TYPE_NORMAL:
 			break; /*nothing to do*/
 		case STATEMENT_RESULT_TYPE_CONTINUE:
-			INTERPRETER_free_env(inter, callenv);
+			INTERPRETER_release_env(inter, callenv);
 			ERROR_runtime_error(RUNTIME_ERROR_CONTINUE_RETURN_BREAK_CAN_NOT_BE_IN_THIS_SCOPE, "continue", list->statement->line);
 			return RUNTIME_ERROR_CONTINUE_RETURN_BREAK_CAN_NOT_BE_IN_THIS_SCOPE;
 		case STATEMENT_RESULT_TYPE_BREAK:
-			INTERPRETER_free_env(inter, callenv);
+			INTERPRETER_release_env(inter, callenv);
 			ERROR_runtime_error(RUNTIME_ERROR_CONTINUE_RETURN_BREAK_CAN_NOT_BE_IN_THIS_SCOPE, "break", list->statement->line);
 			return RUNTIME_ERROR_CONTINUE_RETURN_BREAK_CAN_NOT_BE_IN_THIS_SCOPE;
 		case STATEMENT_RESULT_TYPE_RETURN:
@@ -439,63 +722,158 @@ int eval_method_and_function_call(
 		list = list->next;
 	}
 funcend:
-	callenv->outter = env;
-	if (NULL != closureenv)
-	{
-		closureenv->outter = NULL;
+	/*nothing on the arena escapes,captured variables are in cell envs on the heap*/
+	INTERPRETER_release_env(inter, callenv);
+	if (NULL != inter->tail_func)
+	{ /*return f(...),f runs here in place of the finished call,its callee and args are on the stack*/
+		func = inter->tail_func;
+		args_count = inter->tail_argc;
+		inter->tail_func = NULL;
+		object = NULL;
+		if (0 != tail_calls)
+		{ /*callee of the previous tail call*/
+			remove_stack(&inter->stack, args_count + 1);
+		}
+		tail_calls = 1;
+		goto call;
 	}
 	if (STATEMENT_RESULT_TYPE_RETURN != ret.typ)
 	{ /*push a default value*/
 		v.typ = JS_VALUE_TYPE_NULL;
 		push_stack(&inter->stack, &v);
-		INTERPRETER_free_env(inter, callenv);
 	}
-	else
+callend:
+	if (0 != tail_calls)
 	{
-		INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, callenv, &ret);
+		remove_stack(&inter->stack, 1);
 	}
 	return 0;
 }
 
-int eval_function_call_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+int eval_method_and_function_call(
+	JsInterpreter *inter,
+	ExecuteEnvironment *env,
+	JsObject *object,
+	JsFunction *func,
+	ArgumentList *args,
+	int line)
 {
-	/*only support search global function now!!*/
-	JsFunction *func = NULL;
+	int args_count = 0;
+	/*arguments stay on the stack until they are bound,so gc still sees them*/
+	while (NULL != args)
+	{
+		eval_expression(inter, env, args->expression);
+		args_count++;
+		args = args->next;
+	}
+	return eval_call_stack_args(inter, env, object, func, args_count, line);
+}
+
+/*
+ * operand of a tail return.
+ * a user function is not called here,its value and args are left on the
+ * stack for the running call to pick up once its frame is released.
+ * returns 0 when it is not a tail call and the operand is still to be evaluated.
+ */
+int eval_tail_call(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	JsValue v;
+	ArgumentList *args;
+	int args_count = 0;
+	if (EXPRESSION_TYPE_FUNCTION_CALL != e->typ && EXPRESSION_TYPE_EXPRESSION_FUNCTION_CALL != e->typ)
+	{
+		return 0;
+	}
+	if (0 == e->u.function_call->tail)
+	{
+		return 0;
+	}
+	args = e->u.function_call->args;
 	if (NULL != e->u.function_call->func)
 	{
-		func = INTERPRETER_search_func_from_env(env, e->u.function_call->func);
+		v.typ = JS_VALUE_TYPE_FUNCTION;
+		v.u.func = INTERPRETER_search_func_from_env(env, e->u.function_call->func);
+		if (NULL == v.u.func || JS_FUNCTION_TYPE_USER != v.u.func->typ)
+		{
+			return 0;
+		}
+		push_stack(&inter->stack, &v);
 	}
 	else
 	{
 		eval_expression(inter, env, e->u.function_call->e);
-		JsValue v = pop_stack(&inter->stack);
-		if (JS_VALUE_TYPE_FUNCTION != v.typ)
-		{
-			ERROR_runtime_error(RUNTIME_ERROR_NOT_A_FUNCTION, "", e->line);
-			return RUNTIME_ERROR_NOT_A_FUNCTION;
+		v = peek_stack(&inter->stack, 0);
+		if (JS_VALUE_TYPE_FUNCTION != v.typ || JS_FUNCTION_TYPE_USER != v.u.func->typ)
+		{ /*builtins and errors take the usual path,the callee is already on the stack*/
+			eval_function_call_on_stack(inter, env, e);
+			return 1;
 		}
-		func = v.u.func;
 	}
-	if (NULL == func)
+	while (NULL != args)
 	{
-		ERROR_runtime_error(RUNTIME_ERROR_FUNCTION_NOT_FOUND, e->u.function_call->func, e->line);
-		return RUNTIME_ERROR_FUNCTION_NOT_FOUND;
+		eval_expression(inter, env, args->expression);
+		args_count++;
+		args = args->next;
 	}
+	inter->tail_func = v.u.func;
+	inter->tail_argc = args_count;
+	return 1;
+}
+
+int eval_function_call(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, Expression *e)
+{
 	if (JS_FUNCTION_TYPE_BUILDIN == func->typ)
 	{
 		/*execute build in function*/
-		return eval_build_in_function(inter, env, func->buildin, e->u.function_call->args);
+		return eval_build_in_function(inter, env, func, e->u.function_call->args, e->line);
 	}
 
 	return eval_method_and_function_call(inter, env, NULL, func, e->u.function_call->args, e->line);
 }
 
+/*callee value is on top of the stack,a closure stays there during the call*/
+int eval_function_call_on_stack(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	int ret;
+	JsValue v = peek_stack(&inter->stack, 0);
+	if (JS_VALUE_TYPE_FUNCTION != v.typ)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_NOT_A_FUNCTION, "", e->line);
+		return RUNTIME_ERROR_NOT_A_FUNCTION;
+	}
+	ret = eval_function_call(inter, env, v.u.func, e);
+	remove_stack(&inter->stack, 1);
+	return ret;
+}
+
+int eval_function_call_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	/*only support search global function now!!*/
+	JsFunction *func = NULL;
+	if (NULL != e->u.function_call->func)
+	{
+		func = INTERPRETER_search_func_from_env(env, e->u.function_call->func);
+	}
+	else
+	{
+		eval_expression(inter, env, e->u.function_call->e);
+		return eval_function_call_on_stack(inter, env, e);
+	}
+	if (NULL == func)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_FUNCTION_NOT_FOUND, e->u.function_call->func, e->line);
+		return RUNTIME_ERROR_FUNCTION_NOT_FOUND;
+	}
+	return eval_function_call(inter, env, func, e);
+}
+
 int eval_object_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 
 	JsValue v;
 	v.typ = JS_VALUE_TYPE_OBJECT;
 	v.u.object = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_OBJECT, 0, e->line);
+	push_stack(&inter->stack, &v); /*on the stack first so gc sees it while fields are evaluated*/
 	ExpressionObjectKVList *list = e->u.object_kv_list;
 	JsValue value;
 	while (NULL != list)
@@ -509,15 +887,14 @@ int eval_object_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expres
 			}
 			else
 			{
-				value.typ = JS_VALUE_TYPE_FUNCTION;
-				value.u.func = list->kv->func;
+				value = INTERPRETER_create_function_value(inter, env, list->kv->func, list->kv->line);
 			}
 			INTERPRETE_create_object_field(inter, v.u.object, list->kv->identifier_key, &value, list->kv->line);
 		}
 		else
 		{ /*expression*/
 			eval_expression(inter, env, list->kv->expression_key);
-			JsValue key = pop_stack(&inter->stack);
+			JsValue key = peek_stack(&inter->stack, 0); /*keep key for gc while value is evaluated*/
 			if (JS_VALUE_TYPE_STRING_LITERAL != key.typ && JS_VALUE_TYPE_STRING != key.typ)
 			{
 				ERROR_runtime_error(RUNTIME_ERROR_INDEX_HAS_WRONG_TYPE, "only string can be used as object key", list->kv->expression_key->line);
@@ -530,9 +907,9 @@ int eval_object_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expres
 			}
 			else
 			{
-				value.typ = JS_VALUE_TYPE_FUNCTION;
-				value.u.func = list->kv->func;
+				value = INTERPRETER_create_function_value(inter, env, list->kv->func, list->kv->line);
 			}
+			pop_stack(&inter->stack);
 			if (JS_VALUE_TYPE_STRING_LITERAL == key.typ)
 			{
 				INTERPRETE_create_object_field(inter, v.u.object, key.u.literal_string, &value, list->kv->value->line);
@@ -544,6 +921,135 @@ int eval_object_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expres
 		}
 		list = list->next;
 	}
+	return 0;
+}
+
+/*new Map([[k,v],...]) and new Set([v,...]),or a copy of another map or set*/
+int eval_new_map_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e, char set)
+{
+	JsValue v = MAP_create(inter, set, e->line);
+	JsMap *map = v.u.map;
+	JsValue from;
+	JsValue *element;
+	int i;
+	push_stack(&inter->stack, &v);
+	if (NULL == e->u.new->args)
+	{
+		return 0;
+	}
+	eval_expression(inter, env, e->u.new->args->expression);
+	from = pop_stack(&inter->stack); /*nothing below collects*/
+	if (JS_VALUE_TYPE_MAP == from.typ)
+	{
+		for (i = 0; i < from.u.map->used; i++)
+		{
+			if (0 != from.u.map->entries[i].key.typ)
+			{
+				MAP_set(inter, map, &from.u.map->entries[i].key, &from.u.map->entries[i].value, e->line);
+			}
+		}
+		return 0;
+	}
+	if (JS_VALUE_TYPE_ARRAY != from.typ)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, e->u.new->identifier, e->line);
+		return RUNTIME_ERROR_TYPE_NOE_RIGHT;
+	}
+	for (i = 0; i < from.u.array->length; i++)
+	{
+		element = from.u.array->elements + i;
+		if (0 != set)
+		{
+			MAP_set(inter, map, element, element, e->line);
+		}
+		else if (JS_VALUE_TYPE_ARRAY == element->typ && element->u.array->length >= 2)
+		{
+			MAP_set(inter, map, element->u.array->elements, element->u.array->elements + 1, e->line);
+		}
+		else
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "Map entry must be [key,value]", e->line);
+			return RUNTIME_ERROR_TYPE_NOE_RIGHT;
+		}
+	}
+	return 0;
+}
+
+/*new ArrayBuffer(length) when kind is 0,else new Float64Array(...) and the like*/
+int eval_new_typed_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e, JS_TYPED_TYPE kind)
+{
+	ExpressionList *list;
+	JsValue args[3];
+	JsValue v;
+	int count = 0;
+	int i;
+	for (list = e->u.new->args; NULL != list; list = list->next)
+	{ /*on the stack until the array is made*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	for (i = 0; i < count && i < 3; i++)
+	{
+		args[i] = inter->stack.vs[inter->stack.sp - count + i];
+	}
+	if (0 != kind)
+	{
+		v = TYPED_create(inter, kind, args, i, e->line);
+	}
+	else if (0 == i)
+	{
+		v = TYPED_create_buffer(inter, 0, e->line);
+	}
+	else if (JS_VALUE_TYPE_INT == args[0].typ)
+	{
+		v = TYPED_create_buffer(inter, args[0].u.intvalue, e->line);
+	}
+	else
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "ArrayBuffer", e->line);
+		return RUNTIME_ERROR_TYPE_NOE_RIGHT;
+	}
+	inter->stack.sp -= count;
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
+/*new Promise(executor),executor(resolve,reject) runs at once*/
+int eval_new_promise_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	JsValue executor;
+	JsValue v;
+	if (NULL == e->u.new->args)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "Promise needs an executor", e->line);
+		return RUNTIME_ERROR_TYPE_NOE_RIGHT;
+	}
+	eval_expression(inter, env, e->u.new->args->expression);
+	executor = peek_stack(&inter->stack, 0); /*stays on the stack while it runs*/
+	if (JS_VALUE_TYPE_FUNCTION != executor.typ)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_NOT_A_FUNCTION, "Promise executor", e->line);
+		return RUNTIME_ERROR_NOT_A_FUNCTION;
+	}
+	v = PROMISE_construct(inter, &executor, e->line);
+	pop_stack(&inter->stack);
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
+/*new RegExp(pattern,flags)*/
+int eval_new_regexp_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	ExpressionList *list;
+	JsValue v;
+	int count = 0;
+	for (list = e->u.new->args; NULL != list; list = list->next)
+	{ /*on the stack until all are evaluated*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	v = REGEXP_construct(inter, inter->stack.vs + inter->stack.sp - count, count, e->line);
+	inter->stack.sp -= count;
 	push_stack(&inter->stack, &v);
 	return 0;
 }
@@ -566,6 +1072,38 @@ int eval_new_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expressio
 		arraye.u.expression_list = new->args;
 		return eval_array_expression(inter, env, &arraye);
 	}
+	if (0 == strcmp("Map", new->identifier))
+	{
+		return eval_new_map_expression(inter, env, e, 0);
+	}
+	if (0 == strcmp("Set", new->identifier))
+	{
+		return eval_new_map_expression(inter, env, e, 1);
+	}
+	if (0 == strcmp("ArrayBuffer", new->identifier))
+	{
+		return eval_new_typed_expression(inter, env, e, 0);
+	}
+	if (0 == strcmp("Float64Array", new->identifier))
+	{
+		return eval_new_typed_expression(inter, env, e, JS_TYPED_FLOAT64);
+	}
+	if (0 == strcmp("Int32Array", new->identifier))
+	{
+		return eval_new_typed_expression(inter, env, e, JS_TYPED_INT32);
+	}
+	if (0 == strcmp("Uint8Array", new->identifier))
+	{
+		return eval_new_typed_expression(inter, env, e, JS_TYPED_UINT8);
+	}
+	if (0 == strcmp("Promise", new->identifier))
+	{
+		return eval_new_promise_expression(inter, env, e);
+	}
+	if (0 == strcmp("RegExp", new->identifier))
+	{
+		return eval_new_regexp_expression(inter, env, e);
+	}
 	ERROR_runtime_error(RUNTIME_ERROR_UNKOWN_NEW_TYPE, new->identifier, e->line);
 	return RUNTIME_ERROR_UNKOWN_NEW_TYPE;
 }
@@ -573,11 +1111,11 @@ int eval_new_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expressio
 int eval_assign_function_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	ExpressionAssignFunction *assign = e->u.assign_function;
+	Expression identifier;
 
 	Expression *left_value_expression = assign->dest;
 	if (NULL == left_value_expression)
 	{
-		Expression identifier;
 		identifier.typ = EXPRESSION_TYPE_IDENTIFIER;
 		identifier.u.identifier = assign->identifier;
 		left_value_expression = &identifier;
@@ -589,18 +1127,27 @@ int eval_assign_function_expression(JsInterpreter *inter, ExecuteEnvironment *en
 		ERROR_runtime_error(RUNTIME_ERROR_VARIABLE_NOT_FOUND, "", e->line);
 		return RUNTIME_ERROR_VARIABLE_NOT_FOUND;
 	}
-	left->typ = JS_VALUE_TYPE_FUNCTION;
-	left->u.func = assign->func;
+	*left = INTERPRETER_create_function_value(inter, env, assign->func, e->line);
+	eval_store_left_value(inter, left);
 	push_stack(&inter->stack, left);
 	return 0;
 }
 
 int eval_create_function_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
+	/*a function declaration is a variable holding the function*/
 	JsFunction *func = e->u.func;
-	INTERPRETE_create_function(inter, env, func, e->line);
-	JsValue v;
-	v.typ = JS_VALUE_TYPE_FUNCTION;
+	JsValue v = INTERPRETER_create_function_value(inter, env, func, e->line);
+	ExecuteEnvironment *declenv = INTERPRETER_declare_env(env, func->name_captured);
+	Variable *var = search_variable_from_variablelist(declenv->vars, func->name);
+	if (NULL == var)
+	{
+		INTERPRETER_create_variable(inter, declenv, func->name, &v, e->line);
+	}
+	else
+	{
+		var->value = v;
+	}
 	push_stack(&inter->stack, &v);
 	return 0;
 }
@@ -623,6 +1170,29 @@ int eval_not_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expressio
 	return 0;
 }
 
+/*the value of the operand once it settles,see COROUTINE_await*/
+int eval_await_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	eval_expression(inter, env, e->u.unary);
+	return COROUTINE_await(inter, e->line);
+}
+
+/*what the next call that resumes the generator sends,see COROUTINE_yield*/
+int eval_yield_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
+{
+	JsValue v;
+	if (NULL == e->u.unary)
+	{
+		v.typ = JS_VALUE_TYPE_UNDEFINED;
+		push_stack(&inter->stack, &v);
+	}
+	else
+	{
+		eval_expression(inter, env, e->u.unary);
+	}
+	return COROUTINE_yield(inter, e->line);
+}
+
 int eval_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	JsValue v;
@@ -705,14 +1275,21 @@ int eval_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e
 	case EXPRESSION_TYPE_ASSIGN_FUNCTION:
 		return eval_assign_function_expression(inter, env, e);
 	case EXPRESSION_TYPE_FUNCTION:
-		v.typ = JS_VALUE_TYPE_FUNCTION;
-		v.u.func = e->u.func;
+		v = INTERPRETER_create_function_value(inter, env, e->u.func, e->line);
 		push_stack(&inter->stack, &v);
 		return 0;
 	case EXPRESSION_TYPE_NOT:
 		return eval_not_expression(inter, env, e);
 	case EXPRESSION_TYPE_CREATE_FUNCTION:
 		return eval_create_function_expression(inter, env, e);
+	case EXPRESSION_TYPE_AWAIT:
+		return eval_await_expression(inter, env, e);
+	case EXPRESSION_TYPE_YIELD:
+		return eval_yield_expression(inter, env, e);
+	case EXPRESSION_TYPE_REGEXP:
+		v = REGEXP_literal(inter, e->u.regexp, e->line);
+		push_stack(&inter->stack, &v);
+		return 0;
 	}
 
 	return 0;
@@ -723,15 +1300,17 @@ int eval_array_method_push(JsInterpreter *inter, ExecuteEnvironment *env, JsValu
 	int length = get_expression_list_length(call->args);
 	int total_length = length + array->u.array->length;
 	if (total_length > array->u.array->alloc)
-	{ //resize array
-		JsValue *t = MEM_alloc(inter->execute_memory, sizeof(JsValue) * total_length, call->e->line);
+	{ /*grow by half as much again,pushing one at a time copies each element a few times only*/
+		int alloc = total_length + total_length / 2;
+		JsValue *t = gc_payload_alloc(inter, sizeof(JsValue) * alloc, call->e->line);
 		int i = 0;
 		for (; i < array->u.array->length; i++)
 		{ //copy from old
 			t[i] = array->u.array->elements[i];
 		}
-		MEM_free(inter->execute_memory, array->u.array->elements);
+		gc_payload_free(inter, array->u.array->elements);
 		array->u.array->elements = t;
+		array->u.array->alloc = alloc;
 	}
 	ArgumentList *list = call->args;
 	JsValue v;
@@ -780,18 +1359,263 @@ int eval_array_method(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *ar
 	return RUNTIME_ERROR_METHOD_NOT_FOUND;
 }
 
+/*set,get,add,has,delete,clear,keys,values and entries of a Map or Set*/
+int eval_map_method(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *map, ExpressionMethodCall *call)
+{
+	JsMap *m = map->u.map;
+	char *method = call->method;
+	int line = call->e->line;
+	ArgumentList *list;
+	JsMapEntry *entry;
+	JsValue args[2];
+	JsValue v;
+	int count = 0;
+	int i;
+	for (list = call->args; NULL != list; list = list->next)
+	{ /*on the stack until all are evaluated*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	args[0].typ = JS_VALUE_TYPE_UNDEFINED;
+	args[1].typ = JS_VALUE_TYPE_UNDEFINED;
+	for (i = 0; i < count && i < 2; i++)
+	{
+		args[i] = inter->stack.vs[inter->stack.sp - count + i];
+	}
+	inter->stack.sp -= count;
+	v.typ = JS_VALUE_TYPE_UNDEFINED;
+	if (0 == m->set && 0 == strcmp(method, "get"))
+	{
+		entry = MAP_find(inter, m, args, line);
+		if (NULL != entry)
+		{
+			v = entry->value;
+		}
+	}
+	else if (0 == m->set && 0 == strcmp(method, "set"))
+	{
+		MAP_set(inter, m, args, args + 1, line);
+		v = *map;
+	}
+	else if (0 != m->set && 0 == strcmp(method, "add"))
+	{
+		MAP_set(inter, m, args, args, line);
+		v = *map;
+	}
+	else if (0 == strcmp(method, "has"))
+	{
+		v.typ = JS_VALUE_TYPE_BOOL;
+		v.u.boolvalue = NULL != MAP_find(inter, m, args, line) ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+	}
+	else if (0 == strcmp(method, "delete"))
+	{
+		v.typ = JS_VALUE_TYPE_BOOL;
+		v.u.boolvalue = 0 != MAP_delete(inter, m, args, line) ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+	}
+	else if (0 == strcmp(method, "clear"))
+	{
+		MAP_clear(m);
+	}
+	else if (0 == strcmp(method, "keys"))
+	{
+		v = MAP_items(inter, m, MAP_ITEM_KEYS, line);
+	}
+	else if (0 == strcmp(method, "values"))
+	{
+		v = MAP_items(inter, m, MAP_ITEM_VALUES, line);
+	}
+	else if (0 == strcmp(method, "entries"))
+	{
+		v = MAP_items(inter, m, MAP_ITEM_ENTRIES, line);
+	}
+	else
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_METHOD_NOT_FOUND, method, line);
+		return RUNTIME_ERROR_METHOD_NOT_FOUND;
+	}
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
+/*the bulk methods of a typed array,see TYPED_call*/
+int eval_typed_method(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *typed, ExpressionMethodCall *call)
+{
+	ArgumentList *list;
+	JsValue args[2];
+	JsValue v;
+	int count = 0;
+	int i;
+	for (list = call->args; NULL != list; list = list->next)
+	{ /*on the stack until all are evaluated*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	for (i = 0; i < count && i < 2; i++)
+	{
+		args[i] = inter->stack.vs[inter->stack.sp - count + i];
+	}
+	inter->stack.sp -= count;
+	v = TYPED_call(typed, call->method, args, i, call->e->line);
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
+/*then and catch,each gives a new promise settled by what the handler returns*/
+int eval_promise_method(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *promise, ExpressionMethodCall *call)
+{
+	ArgumentList *list;
+	JsValue args[2];
+	JsValue none;
+	JsValue v;
+	int count = 0;
+	int i;
+	for (list = call->args; NULL != list; list = list->next)
+	{ /*on the stack until all are evaluated*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	none.typ = JS_VALUE_TYPE_UNDEFINED;
+	args[0] = none;
+	args[1] = none;
+	for (i = 0; i < count && i < 2; i++)
+	{
+		args[i] = inter->stack.vs[inter->stack.sp - count + i];
+	}
+	inter->stack.sp -= count;
+	if (0 == strcmp(call->method, "then"))
+	{
+		v = PROMISE_then(inter, promise->u.promise, args, args + 1, call->e->line);
+	}
+	else if (0 == strcmp(call->method, "catch"))
+	{
+		v = PROMISE_then(inter, promise->u.promise, &none, args, call->e->line);
+	}
+	else
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_METHOD_NOT_FOUND, call->method, call->e->line);
+		return RUNTIME_ERROR_METHOD_NOT_FOUND;
+	}
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
+/*next(v) and return(v),each gives {value,done}*/
+int eval_generator_method(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *generator, ExpressionMethodCall *call)
+{
+	ArgumentList *list;
+	JsValue sent;
+	JsValue result;
+	JsValue done;
+	JsValue v;
+	int count = 0;
+	for (list = call->args; NULL != list; list = list->next)
+	{ /*on the stack until all are evaluated*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	sent.typ = JS_VALUE_TYPE_UNDEFINED;
+	if (0 < count)
+	{
+		sent = inter->stack.vs[inter->stack.sp - count];
+	}
+	inter->stack.sp -= count;
+	done.typ = JS_VALUE_TYPE_BOOL;
+	if (0 == strcmp(call->method, "next"))
+	{
+		push_stack(&inter->stack, &sent); /*the generator may run gc before it takes it*/
+		done.u.boolvalue = COROUTINE_next(inter, generator->u.coroutine, &sent, &v, call->e->line) ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+		inter->stack.sp--;
+	}
+	else if (0 == strcmp(call->method, "return"))
+	{
+		COROUTINE_return(inter, generator->u.coroutine, call->e->line);
+		done.u.boolvalue = JS_BOOL_TRUE;
+		v = sent;
+	}
+	else
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_METHOD_NOT_FOUND, call->method, call->e->line);
+		return RUNTIME_ERROR_METHOD_NOT_FOUND;
+	}
+	push_stack(&inter->stack, &v);
+	result.typ = JS_VALUE_TYPE_OBJECT;
+	result.u.object = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_OBJECT, 0, call->e->line);
+	INTERPRETE_create_object_field(inter, result.u.object, "value", &v, call->e->line);
+	INTERPRETE_create_object_field(inter, result.u.object, "done", &done, call->e->line);
+	inter->stack.sp--;
+	push_stack(&inter->stack, &result);
+	return 0;
+}
+
+/*test and exec of a RegExp,match,replace and split of a string,see regexp.h*/
+int eval_regexp_method(JsInterpreter *inter, ExecuteEnvironment *env, JsValue *receiver, ExpressionMethodCall *call)
+{
+	ArgumentList *list;
+	JsValue v;
+	int count = 0;
+	for (list = call->args; NULL != list; list = list->next)
+	{ /*on the stack until the call is done,a replacement function may run gc*/
+		eval_expression(inter, env, list->expression);
+		count++;
+	}
+	if (JS_VALUE_TYPE_REGEXP == receiver->typ)
+	{
+		v = REGEXP_call(inter, receiver->u.regexp, call->method, inter->stack.vs + inter->stack.sp - count, count, call->e->line);
+	}
+	else
+	{
+		v = REGEXP_string_call(inter, receiver, call->method, inter->stack.vs + inter->stack.sp - count, count, call->e->line);
+	}
+	inter->stack.sp -= count;
+	push_stack(&inter->stack, &v);
+	return 0;
+}
+
 int eval_method_call_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	ExpressionMethodCall *call = e->u.method_call;
 
 	eval_expression(inter, env, call->e);
 
-	JsValue object = pop_stack(&inter->stack);
+	JsValue object = peek_stack(&inter->stack, 0); /*receiver stays on the stack during the call*/
+	int ret;
 
 	/*handle array*/
 	if (JS_VALUE_TYPE_ARRAY == object.typ)
 	{
-		return eval_array_method(inter, env, &object, call);
+		ret = eval_array_method(inter, env, &object, call);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_MAP == object.typ)
+	{
+		ret = eval_map_method(inter, env, &object, call);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_TYPED_ARRAY == object.typ)
+	{
+		ret = eval_typed_method(inter, env, &object, call);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_PROMISE == object.typ)
+	{
+		ret = eval_promise_method(inter, env, &object, call);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_COROUTINE == object.typ)
+	{
+		ret = eval_generator_method(inter, env, &object, call);
+		remove_stack(&inter->stack, 1);
+		return ret;
+	}
+	if (JS_VALUE_TYPE_REGEXP == object.typ || JS_VALUE_TYPE_STRING == object.typ || JS_VALUE_TYPE_STRING_LITERAL == object.typ)
+	{
+		ret = eval_regexp_method(inter, env, &object, call);
+		remove_stack(&inter->stack, 1);
+		return ret;
 	}
 	if (JS_VALUE_TYPE_OBJECT != object.typ)
 	{
@@ -814,37 +1638,52 @@ int eval_method_call_expression(JsInterpreter *inter, ExecuteEnvironment *env, E
 	if (JS_FUNCTION_TYPE_BUILDIN == func->typ)
 	{
 		/*execute buildin function*/
-		return eval_build_in_function(inter, env, func->buildin, call->args);
+		ret = eval_build_in_function(inter, env, func, call->args, e->line);
 	}
-
-	/*call user function*/
-
-	return eval_method_and_function_call(inter, env, object.u.object, func, call->args, e->line);
+	else
+	{
+		/*call user function*/
+		ret = eval_method_and_function_call(inter, env, object.u.object, func, call->args, e->line);
+	}
+	remove_stack(&inter->stack, 1);
+	return ret;
 }
 
-int eval_build_in_function(JsInterpreter *inter, ExecuteEnvironment *env, JsFunctionBuildin *func, ArgumentList *args)
+/*count arguments are on top of the stack,the result takes their place*/
+int eval_build_in_stack_args(JsInterpreter *inter, JsFunction *function, int count, int line)
 {
+	JsFunctionBuildin *func = function->buildin;
 	JsValue vs[BUILD_IN_FUNCTION_MAX_ARGS];
 	int i = 0;
-	ArgumentList *list = args;
-	JsValue value;
-	while (NULL != list)
+	for (; i < count && i < BUILD_IN_FUNCTION_MAX_ARGS; i++)
 	{
-		eval_expression(inter, env, list->expression);
-		value = pop_stack(&inter->stack);
-		if (i < BUILD_IN_FUNCTION_MAX_ARGS)
-		{
-			vs[i] = value;
-			i++;
-		}
-		list = list->next;
+		vs[i] = inter->stack.vs[inter->stack.sp - count + i];
 	}
+	for (; i < func->args_count && i < BUILD_IN_FUNCTION_MAX_ARGS; i++)
+	{ /*missing arguments are undefined*/
+		vs[i].typ = JS_VALUE_TYPE_UNDEFINED;
+	}
+	inter->stack.sp -= count;
 	JsValue v;
 	v.typ = JS_VALUE_TYPE_NULL;
 	switch (func->args_count)
 	{
 	case 1:
-		v = func->u.func1(&vs[0]);
+		if (0 != func->with_function)
+		{
+			v = func->u.bound1(inter, function, &vs[0], line);
+		}
+		else if (0 != func->with_interpreter)
+		{
+			v = func->u.inter1(inter, &vs[0], line);
+		}
+		else
+		{
+			v = func->u.func1(&vs[0]);
+		}
+		break;
+	case 2:
+		v = func->u.inter2(inter, &vs[0], &vs[1], line);
 		break;
 	}
 
@@ -852,8 +1691,55 @@ int eval_build_in_function(JsInterpreter *inter, ExecuteEnvironment *env, JsFunc
 	return 0;
 }
 
+int eval_build_in_function(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, ArgumentList *args, int line)
+{
+	int count = 0;
+	ArgumentList *list = args;
+	/*all arguments on the stack first,later ones may run code*/
+	while (NULL != list)
+	{
+		eval_expression(inter, env, list->expression);
+		count++;
+		list = list->next;
+	}
+	return eval_build_in_stack_args(inter, func, count, line);
+}
+
+/*
+ * func(args) called from c,the way the event loop runs its callbacks.
+ * code runs and gc may collect,args must be reachable from elsewhere until
+ * they are pushed here.
+ */
+JsValue eval_call_value(JsInterpreter *inter, const JsValue *func, const JsValue *args, int count, int line)
+{
+	return eval_call_method_value(inter, NULL, func, args, count, line);
+}
+
+JsValue eval_call_method_value(JsInterpreter *inter, JsObject *object, const JsValue *func, const JsValue *args, int count, int line)
+{
+	JsValue v;
+	int i;
+	push_stack(&inter->stack, func); /*a closure stays alive during its call*/
+	for (i = 0; i < count; i++)
+	{
+		push_stack(&inter->stack, args + i);
+	}
+	if (JS_FUNCTION_TYPE_BUILDIN == func->u.func->typ)
+	{
+		eval_build_in_stack_args(inter, func->u.func, count, line);
+	}
+	else
+	{
+		eval_call_stack_args(inter, &inter->env, object, func->u.func, count, line);
+	}
+	v = pop_stack(&inter->stack);
+	pop_stack(&inter->stack);
+	return v;
+}
+
 int eval_identifier_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
+	JsValue vv;
 	JsValue *v = INTERPRETE_search_variable_from_env(env, e->u.identifier);
 	if (NULL == v)
 	{
@@ -865,7 +1751,6 @@ int eval_identifier_expression(JsInterpreter *inter, ExecuteEnvironment *env, Ex
 		}
 		else
 		{
-			JsValue vv;
 			vv.typ = JS_VALUE_TYPE_FUNCTION;
 			vv.u.func = func;
 			v = &vv;
@@ -893,20 +1778,17 @@ JsValue *get_left_value_from_current_env(ExecuteEnvironment *env, char *name)
 int eval_create_variable_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e)
 {
 	JsValue *dest = NULL;
-	VariableList *list = env->vars;
-	while (NULL != list)
+	ExecuteEnvironment *declenv = INTERPRETER_declare_env(env, e->u.create_var->captured);
+	Variable *var = search_variable_from_variablelist(declenv->vars, e->u.create_var->identifier);
+	if (NULL != var)
 	{
-		if (0 == strcmp(list->var.name, e->u.create_var->identifier))
-		{
-			dest = &list->var.value;
-		}
-		list = list->next;
+		dest = &var->value;
 	}
 	eval_expression(inter, env, e->u.create_var->expression);
 	JsValue value = pop_stack(&inter->stack);
 	if (NULL == dest)
 	{
-		Variable *var = INTERPRETER_create_variable(inter, env, e->u.create_var->identifier, NULL, e->line);
+		var = INTERPRETER_create_variable(inter, declenv, e->u.create_var->identifier, NULL, e->line);
 		dest = &var->value;
 	}
 	if (JS_VALUE_TYPE_STRING_LITERAL == value.typ)
@@ -925,6 +1807,12 @@ int eval_create_variable_expression(JsInterpreter *inter, ExecuteEnvironment *en
 		*dest = value;
 	}
 	push_stack(&inter->stack, dest);
+	extern char gc_sweep_should_executing;
+	if (1 == gc_sweep_should_executing)
+	{ /*a loop that only declares would never collect otherwise*/
+		gc_collect(inter);
+		gc_sweep_should_executing = 0;
+	}
 	return 0;
 }
 
@@ -932,7 +1820,7 @@ JsValue *get_left_value_index(JsInterpreter *inter, ExecuteEnvironment *env, Exp
 {
 	ExpressionIndex *index = e->u.index;
 	eval_expression(inter, env, index->e);
-	JsValue v = pop_stack(&inter->stack);
+	JsValue v = peek_stack(&inter->stack, 0); /*stays on the stack while the index is evaluated*/
 	if (JS_VALUE_TYPE_ARRAY == v.typ)
 	{
 		if (INDEX_TYPE_IDENTIFIER == index->typ)
@@ -943,6 +1831,7 @@ JsValue *get_left_value_index(JsInterpreter *inter, ExecuteEnvironment *env, Exp
 		JsArray *array = v.u.array;
 		eval_expression(inter, env, index->index);
 		JsValue key = pop_stack(&inter->stack);
+		pop_stack(&inter->stack);
 		if (JS_VALUE_TYPE_INT != key.typ)
 		{
 			ERROR_runtime_error(RUNTIME_ERROR_INDEX_HAS_WRONG_TYPE, "", e->line);
@@ -955,6 +1844,31 @@ JsValue *get_left_value_index(JsInterpreter *inter, ExecuteEnvironment *env, Exp
 		}
 		return array->elements + key.u.intvalue;
 	}
+	if (JS_VALUE_TYPE_TYPED_ARRAY == v.typ && INDEX_TYPE_EXPRESSION == index->typ)
+	{ /*the element is not a JsValue,it is handed out as a copy the assignment stores back*/
+		JsValue key;
+		eval_operand(inter, env, index->index, &key);
+		pop_stack(&inter->stack);
+		if (JS_VALUE_TYPE_INT != key.typ)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_INDEX_HAS_WRONG_TYPE, "", e->line);
+			return NULL;
+		}
+		if (key.u.intvalue < 0 || key.u.intvalue >= v.u.typed->length)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, "", e->line);
+			return NULL;
+		}
+		inter->typed_dest = v.u.typed;
+		inter->typed_index = key.u.intvalue;
+		TYPED_get(v.u.typed, key.u.intvalue, &inter->typed_value);
+		return &inter->typed_value;
+	}
+	if (JS_VALUE_TYPE_REGEXP == v.typ && INDEX_TYPE_IDENTIFIER == index->typ && 0 == strcmp("lastIndex", index->identifier))
+	{ /*the only field a RegExp lets change*/
+		pop_stack(&inter->stack);
+		return &v.u.regexp->last_index;
+	}
 	if (JS_VALUE_TYPE_OBJECT == v.typ)
 	{
 		char *fieldname = NULL;
@@ -976,6 +1890,7 @@ JsValue *get_left_value_index(JsInterpreter *inter, ExecuteEnvironment *env, Exp
 				fieldname = key.u.string->s;
 			}
 		}
+		pop_stack(&inter->stack);
 		if (NULL == fieldname)
 		{
 			ERROR_runtime_error(RUNTIME_ERROR_INDEX_HAS_WRONG_TYPE, "", e->line);
@@ -1000,7 +1915,7 @@ JsValue *get_left_value(JsInterpreter *inter, ExecuteEnvironment *env, Expressio
 		Variable *var = NULL;
 		while (NULL != env)
 		{
-			var = search_variable_from_variablelist(env->vars, e->u.identifier);
+			var = INTERPRETER_search_variable_in_env(env, e->u.identifier);
 			if (NULL != var)
 			{
 				return &var->value;
@@ -15,6 +15,10 @@ int eval_logical_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expre
 
 int eval_string_expression(JsInterpreter *inter, Expression *e);
 
+void eval_operand(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e, JsValue *v);
+
+int eval_root_operand(JsInterpreter *inter, JsValue *v, Expression *other);
+
 int eval_arithmetic_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
 
 int eval_relation_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
@@ -30,6 +34,21 @@ int eval_array_expression(JsInterpreter *inter, ExecuteEnvironment *env, Express
 
 int eval_function_call_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
 
+int eval_build_in_function(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, ArgumentList *args, int line);
+
+/*a user function called on the current stack,args_count args are on top of it*/
+int eval_call_frame(JsInterpreter *inter, ExecuteEnvironment *env, JsObject *object, JsFunction *func, int args_count, int line);
+
+/*calls a function value with args from c,gives back what it returns*/
+JsValue eval_call_value(JsInterpreter *inter, const JsValue *func, const JsValue *args, int count, int line);
+
+/*the same with object as this,a buildin gets no receiver*/
+JsValue eval_call_method_value(JsInterpreter *inter, JsObject *object, const JsValue *func, const JsValue *args, int count, int line);
+
+int eval_function_call_on_stack(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
+
+int eval_tail_call(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
+
 int get_expression_list_length(ExpressionList *list);
 
 int eval_identifier_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
@@ -1,216 +1,1114 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "error.h"
 #include "heap.h"
+#include "interprete.h"
+#include "coroutine.h"
+#include "regexp.h"
 
-void push_heap(Heap *head, Heap *h)
+/*
+ * heap objects and cell envs are fixed size cells of regions carved from one
+ * reserved range. mark bits and live bits sit in bitmaps beside the regions,
+ * marking writes no object and sweep reads the bitmaps,dead cells go to a
+ * free list of their region. memory gc does not allocate but may find
+ * objects in,the global env,a restored snapshot,is a space with a mark
+ * bitmap of its own. frames on an arena are on the frames list of their
+ * stack and are scanned from there,each once.
+ * what an object owns,chars,elements,fields,is bumped in payload regions.
+ * once enough was bumped,marking copies the payload of every object it
+ * reaches into new regions and the old ones go back to the system,the
+ * headers stay where they are so values never change. regions left empty
+ * by sweep go back too.
+ * marking pushes gray objects on a stack instead of recursing,a big heap
+ * is marked by several threads. sweeping is left to the allocator,region
+ * by region,the mutator runs on as soon as marking is done.
+ */
+
+typedef enum
+{
+	GC_GRAY_ARRAY,
+	GC_GRAY_OBJECT,
+	GC_GRAY_FUNCTION,
+	GC_GRAY_MAP,
+	GC_GRAY_ENV,
+	GC_GRAY_PROMISE,
+	GC_GRAY_COROUTINE
+} GC_GRAY_TYPE;
+
+/*marked,its fields not yet*/
+typedef struct
+{
+	GC_GRAY_TYPE typ;
+	void *p;
+} GcGray;
+
+/*JS_GC_THREADS,else a marker per cpu*/
+int gc_mark_threads()
+{
+	char *env = getenv("JS_GC_THREADS");
+	long threads = NULL != env && 0 != env[0] ? atol(env) : sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+	{
+		return 1;
+	}
+	return threads > GC_MARK_THREADS ? GC_MARK_THREADS : threads;
+}
+
+/*reserve the range regions come from,-1 when not even a small one is there*/
+int gc_open(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	unsigned long length;
+	char *base = MAP_FAILED;
+	int i;
+	for (length = GC_HEAP_RESERVE; length >= 64 * GC_REGION_SIZE; length /= 2)
+	{ /*untouched pages cost nothing,a smaller range when the system will not overcommit*/
+		base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (MAP_FAILED != base)
+		{
+			break;
+		}
+	}
+	if (MAP_FAILED == base)
+	{
+		return -1;
+	}
+	gc->base = base;
+	gc->top = base;
+	gc->limit = base + length;
+	gc->regions = NULL;
+	gc->region_alloc = 0;
+	for (i = 0; i < GC_CLASS_COUNT; i++)
+	{
+		gc->current[i] = 0;
+	}
+	gc->space_count = 0;
+	gc->free_regions = -1;
+	gc->payload = -1;
+	gc->compacting = 0;
+	gc->payload_bytes = 0;
+	gc->payload_live = 0;
+	gc->buffer_bytes = 0;
+	gc->threads = gc_mark_threads();
+	gc->parallel = 0;
+	return 0;
+}
+
+/*gc marks objects in [base,base+length) but never frees them*/
+int gc_add_space(JsInterpreter *inter, void *base, unsigned long length)
+{
+	GcHeap *gc = &inter->gc;
+	GcSpace *space;
+	unsigned long size = (length / 8 + 7) / 8;
+	if (GC_SPACE_COUNT == gc->space_count)
+	{
+		return -1;
+	}
+	space = gc->spaces + gc->space_count;
+	space->marks = (unsigned char *)MEM_alloc(inter->execute_memory, size, 0);
+	if (NULL == space->marks)
+	{
+		return -1;
+	}
+	memset(space->marks, 0, size);
+	space->base = base;
+	space->limit = (char *)base + length;
+	gc->space_count++;
+	return 0;
+}
+
+int gc_region_count(GcHeap *gc)
+{
+	return (gc->top - gc->base) / GC_REGION_SIZE;
+}
+
+char *gc_region_base(GcHeap *gc, GcRegion *r)
+{
+	return gc->base + (r - gc->regions) * GC_REGION_SIZE;
+}
+
+int gc_cell_size(GC_CLASS klass)
+{
+	switch (klass)
+	{
+	case GC_CLASS_ENV:
+		return (sizeof(ExecuteEnvironment) + 7) & ~7;
+	case GC_CLASS_PAYLOAD:
+	case GC_CLASS_FREE:
+		return GC_REGION_SIZE; /*no cells*/
+	case GC_CLASS_OBJECT:
+		return (sizeof(Heap) + 7) & ~7;
+	case GC_CLASS_COUNT:
+	default:
+		ERROR_runtime_error(RUNTIME_ERROR_INTERNAL, "gc cell class", 0);
+		return GC_REGION_SIZE;
+	}
+}
+
+void gc_init_region(GcRegion *r, GC_CLASS klass)
+{
+	r->klass = klass;
+	r->frozen = 0;
+	r->evacuate = 0;
+	r->pending = 0;
+	r->cell_size = gc_cell_size(klass);
+	r->cells = GC_CLASS_PAYLOAD == klass || GC_CLASS_FREE == klass ? 0 : GC_REGION_SIZE / r->cell_size;
+	r->used = 0;
+	r->free = NULL;
+	r->next = -1;
+	memset(r->live, 0, sizeof(r->live));
+	memset(r->marks, 0, sizeof(r->marks));
+}
+
+/*a region given back before,else the next one of the range*/
+int gc_new_region(JsInterpreter *inter, GC_CLASS klass, int line)
+{
+	GcHeap *gc = &inter->gc;
+	int count = gc_region_count(gc);
+	GcRegion *regions;
+	int i = gc->free_regions;
+	if (i >= 0)
+	{
+		gc->free_regions = gc->regions[i].next;
+		gc_init_region(gc->regions + i, klass);
+		return i;
+	}
+	if (gc->top + GC_REGION_SIZE > gc->limit)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "gc heap", line);
+		return -1;
+	}
+	if (count == gc->region_alloc)
+	{
+		regions = (GcRegion *)MEM_alloc(inter->execute_memory, sizeof(GcRegion) * (count + count + 16), line);
+		if (NULL == regions)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "gc heap", line);
+			return -1;
+		}
+		if (0 != count)
+		{
+			memcpy(regions, gc->regions, sizeof(GcRegion) * count);
+			MEM_free(inter->execute_memory, (char *)gc->regions);
+		}
+		gc->regions = regions;
+		gc->region_alloc = count + count + 16;
+	}
+	gc_init_region(gc->regions + count, klass);
+	gc->top += GC_REGION_SIZE;
+	return count;
+}
+
+/*the pages go back to the system,the range stays reserved for reuse*/
+void gc_release_region(GcHeap *gc, GcRegion *r)
+{
+	madvise(gc_region_base(gc, r), GC_REGION_SIZE, MADV_DONTNEED);
+	r->klass = GC_CLASS_FREE;
+	r->evacuate = 0;
+	r->pending = 0;
+	r->cells = 0;
+	r->used = 0;
+	r->free = NULL;
+	r->next = gc->free_regions;
+	gc->free_regions = r - gc->regions;
+}
+
+void gc_sweep_region(JsInterpreter *inter, GcRegion *r);
+
+/*a cell of klass,from a free list,the untouched end of a region or a new region*/
+void *gc_alloc(JsInterpreter *inter, GC_CLASS klass, int line)
 {
-	if (NULL == head || NULL == h)
+	GcHeap *gc = &inter->gc;
+	int count = gc_region_count(gc);
+	int i;
+	int index;
+	GcRegion *r;
+	char *cell;
+	for (i = gc->current[klass]; i < count; i++)
+	{
+		r = gc->regions + i;
+		if (0 != r->pending && klass == r->klass)
+		{ /*may give it back when nothing in it lives*/
+			gc_sweep_region(inter, r);
+		}
+		if (klass == r->klass && 0 == r->frozen && (NULL != r->free || r->used < r->cells))
+		{
+			break;
+		}
+	}
+	if (i == count)
+	{
+		i = gc_new_region(inter, klass, line);
+		if (i < 0)
+		{
+			return NULL;
+		}
+	}
+	gc->current[klass] = i; /*regions before are full until the next sweep*/
+	r = gc->regions + i;
+	if (NULL != r->free)
+	{
+		cell = r->free;
+		r->free = *(char **)cell;
+	}
+	else
+	{
+		cell = gc_region_base(gc, r) + r->used * r->cell_size;
+		r->used++;
+	}
+	index = (cell - gc_region_base(gc, r)) / r->cell_size;
+	r->live[index / 8] |= 1 << (index % 8);
+	return cell;
+}
+
+/*memory owned by one heap object,bumped in the payload region*/
+void *gc_payload_alloc(JsInterpreter *inter, int size, int line)
+{
+	GcHeap *gc = &inter->gc;
+	GcRegion *r = gc->payload < 0 ? NULL : gc->regions + gc->payload;
+	char *p;
+	size = size <= 0 ? 8 : (size + 7) & ~7;
+	if (size > GC_PAYLOAD_LARGE)
+	{ /*malloc maps it on its own and unmaps it when freed*/
+		p = MEM_alloc(inter->execute_memory, size, line);
+		if (NULL == p)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "", line);
+		}
+		return p;
+	}
+	if (NULL == r || r->used + size > GC_REGION_SIZE)
+	{
+		gc->payload = gc_new_region(inter, GC_CLASS_PAYLOAD, line);
+		if (gc->payload < 0)
+		{
+			return NULL;
+		}
+		r = gc->regions + gc->payload;
+	}
+	p = gc_region_base(gc, r) + r->used;
+	r->used += size;
+	gc->payload_bytes += size;
+	return p;
+}
+
+/*only large payloads are freed one by one,the rest goes with its region*/
+void gc_payload_free(JsInterpreter *inter, void *p)
+{
+	if (NULL == p || ((char *)p >= inter->gc.base && (char *)p < inter->gc.top))
 	{
 		return;
 	}
-	Heap *oldlast = head->prev;
-	head->prev = h;
-	h->next = head;
+	MEM_free(inter->execute_memory, p);
+}
 
-	oldlast->next = h;
-	h->prev = oldlast;
+/*the new place of a payload,copied when its region is being emptied*/
+void *gc_evacuate(JsInterpreter *inter, void *p, int size)
+{
+	GcHeap *gc = &inter->gc;
+	void *copy;
+	if (0 == gc->compacting || (char *)p < gc->base || (char *)p >= gc->top ||
+		0 == gc->regions[((char *)p - gc->base) / GC_REGION_SIZE].evacuate)
+	{
+		return p;
+	}
+	copy = gc_payload_alloc(inter, size, 0);
+	memcpy(copy, p, size);
+	return copy;
 }
 
-void print_heap(Heap *head)
+/*fields are nodes with the key behind them,relink each moved node*/
+void gc_evacuate_fields(JsInterpreter *inter, JsObject *object)
 {
-	if (NULL == head)
+	JsKvList **link = &object->eles;
+	JsKvList *copy;
+	while (NULL != *link)
+	{
+		copy = gc_evacuate(inter, *link, sizeof(JsKvList) + strlen((*link)->kv.key) + 1);
+		if (copy != *link)
+		{
+			copy->kv.key = (char *)(copy + 1);
+			*link = copy;
+		}
+		link = &copy->next;
+	}
+}
+
+/*copy out the payloads of the regions filled since the last time,when that was a lot*/
+void gc_compact_begin(GcHeap *gc)
+{
+	int count = gc_region_count(gc);
+	int i;
+	if (gc->payload_bytes < GC_COMPACT_BYTES || gc->payload_bytes < gc->payload_live)
 	{
 		return;
 	}
-	Heap *next = head->next;
-	while (next != head)
+	for (i = 0; i < count; i++)
 	{
-		printf("typ:%d line:%d\n", next->typ, next->line);
-		next = next->next;
+		if (GC_CLASS_PAYLOAD == gc->regions[i].klass && 0 == gc->regions[i].frozen)
+		{
+			gc->regions[i].evacuate = 1;
+		}
 	}
+	gc->payload = -1; /*copies go to new regions*/
+	gc->payload_bytes = 0;
+	gc->compacting = 1;
 }
 
-void gc_mark_value(JsValue *const v)
+void gc_compact_end(GcHeap *gc)
 {
+	int count = gc_region_count(gc);
 	int i;
-	JsKvList *kv_list;
-	JsString *string;
-	JsArray *array;
-	ExecuteEnvironment *env;
-	switch (v->typ)
+	if (0 == gc->compacting)
 	{
-	case JS_VALUE_TYPE_STRING:
-		v->u.string->mark = 1;
-		break;
-	case JS_VALUE_TYPE_ARRAY:
-		v->u.array->mark = 1;
-		for (i = 0; i < v->u.array->length; i++)
+		return;
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (0 != gc->regions[i].evacuate)
 		{
-			gc_mark_value(v->u.array->elements + i);
+			gc_release_region(gc, gc->regions + i);
 		}
-		break;
-	case JS_VALUE_TYPE_OBJECT:
-		if (JS_OBJECT_TYPE_BUILDIN == v->u.object->typ)
+	}
+	gc->payload_live = gc->payload_bytes;
+	gc->payload_bytes = 0;
+	gc->compacting = 0;
+}
+
+void print_heap(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	int count = gc_region_count(gc);
+	GcRegion *r;
+	Heap *h;
+	int i;
+	int j;
+	for (i = 0; i < count; i++)
+	{
+		r = gc->regions + i;
+		if (GC_CLASS_OBJECT != r->klass || 0 != r->frozen)
 		{
-			break;
+			continue;
 		}
-		kv_list = v->u.object->eles;
-		v->u.object->mark = 1;
-		while (NULL != kv_list)
+		for (j = 0; j < r->used; j++)
 		{
-			gc_mark_value(&kv_list->kv.value);
-			kv_list = kv_list->next;
+			if (0 != (r->live[j / 8] & (1 << (j % 8))))
+			{
+				h = (Heap *)(gc_region_base(gc, r) + j * r->cell_size);
+				printf("typ:%d line:%d\n", h->typ, h->line);
+			}
 		}
-		env = v->u.object->env;
-		while (NULL != env)
+	}
+}
+
+/*
+ * set the bit of p,0 when it was set already.
+ * the bit is in the bitmap of the region or space p is in,p is not written.
+ * markers running side by side race for a bit,the one that sets it scans p.
+ */
+int gc_set_mark(JsInterpreter *inter, void *p)
+{
+	GcHeap *gc = &inter->gc;
+	unsigned char *marks = NULL;
+	unsigned char mask;
+	unsigned long bit = 0;
+	unsigned long offset;
+	GcRegion *r;
+	int i;
+	if ((char *)p >= gc->base && (char *)p < gc->top)
+	{ /*values point inside the cell,at the object behind the header*/
+		offset = (char *)p - gc->base;
+		r = gc->regions + offset / GC_REGION_SIZE;
+		marks = r->marks;
+		bit = offset % GC_REGION_SIZE / r->cell_size;
+	}
+	else
+	{
+		for (i = 0; i < gc->space_count; i++)
 		{
-			env->mark = 1;
-			env = env->outter;
+			if ((char *)p >= gc->spaces[i].base && (char *)p < gc->spaces[i].limit)
+			{
+				marks = gc->spaces[i].marks;
+				bit = ((char *)p - gc->spaces[i].base) / 8;
+				break;
+			}
 		}
-		break;
-	case JS_VALUE_TYPE_FUNCTION:
-		env = v->u.func->env;
-		while (NULL != env)
+	}
+	if (NULL == marks)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_NORMAL_VALUE_ON_HEAP, "gc", 0);
+		return 0;
+	}
+	mask = 1 << (bit % 8);
+	if (0 != gc->parallel)
+	{
+		if (0 != (__atomic_load_n(marks + bit / 8, __ATOMIC_RELAXED) & mask))
 		{
-			env->mark = 1;
-			env = env->outter;
+			return 0;
 		}
-		break;
+		return 0 == (__atomic_fetch_or(marks + bit / 8, mask, __ATOMIC_RELAXED) & mask);
+	}
+	if (0 != (marks[bit / 8] & mask))
+	{
+		return 0;
 	}
+	marks[bit / 8] |= mask;
+	return 1;
 }
 
-void gc_mark_env(ExecuteEnvironment *env)
+/*
+ * gray objects of one marker.
+ * the owner pushes and pops at tail,other markers steal at head,
+ * they only meet on the last item and settle it under the lock.
+ */
+typedef struct GcMarkStack_tag
 {
-	VariableList *list = env->vars;
-	while (NULL != list)
+	GcGray *items;
+	long head;
+	long tail;
+	long alloc;
+	pthread_mutex_t lock;
+} GcMarkStack;
+
+typedef struct
+{
+	JsInterpreter *inter;
+	GcMarkStack *stacks; /*one per marker*/
+	int count;
+	int active; /*markers not looking for work*/
+} GcMark;
+
+typedef struct
+{
+	GcMark *mark;
+	int id;
+} GcMarker;
+
+/*room for more,malloc and not MEM_alloc,markers run on several threads*/
+void gc_stack_grow(GcMarkStack *s)
+{
+	GcGray *items;
+	pthread_mutex_lock(&s->lock);
+	if (s->head > 0)
 	{
-		gc_mark_value(&list->var.value);
-		list = list->next;
+		memmove(s->items, s->items + s->head, sizeof(GcGray) * (s->tail - s->head));
+		__atomic_store_n(&s->tail, s->tail - s->head, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&s->head, 0, __ATOMIC_SEQ_CST);
 	}
-	JsFunctionList *funclist = env->funcs;
-	ExecuteEnvironment *closure_env;
-	while (NULL != funclist)
+	if (s->tail == s->alloc)
 	{
-		closure_env = funclist->func.env;
-		while (NULL != closure_env)
+		items = (GcGray *)realloc(s->items, sizeof(GcGray) * (s->alloc * 2 + 1024));
+		if (NULL == items)
 		{
-			closure_env->mark = 1;
-			closure_env = closure_env->outter;
+			ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "gc mark stack", 0);
 		}
-		funclist = funclist->next;
+		s->items = items;
+		s->alloc = s->alloc * 2 + 1024;
 	}
+	pthread_mutex_unlock(&s->lock);
 }
 
-void gc_mark(ExecuteEnvironment *env)
+void gc_push(GcMarkStack *s, GC_GRAY_TYPE typ, void *p)
 {
-	while (NULL != env)
+	if (s->tail == s->alloc)
 	{
-		gc_mark_env(env);
-		env = env->outter;
+		gc_stack_grow(s);
 	}
+	s->items[s->tail].typ = typ;
+	s->items[s->tail].p = p;
+	__atomic_store_n(&s->tail, s->tail + 1, __ATOMIC_RELEASE);
 }
 
-void gc_sweep_object(JsInterpreter *inter, JsObject *object)
+int gc_pop(GcMarkStack *s, GcGray *g, char parallel)
 {
-	JsKvList *list = object->eles;
-	JsKvList *next = list;
-	while (NULL != list)
+	long t = s->tail - 1;
+	if (0 == parallel)
 	{
-		next = list->next;
-		MEM_free(inter->execute_memory, list);
-		list = next;
+		if (t < s->head)
+		{
+			return 0;
+		}
+		s->tail = t;
+		*g = s->items[t];
+		return 1;
+	}
+	__atomic_store_n(&s->tail, t, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&s->head, __ATOMIC_SEQ_CST) > t)
+	{ /*a thief may be taking the last one*/
+		pthread_mutex_lock(&s->lock);
+		if (s->head > t)
+		{
+			__atomic_store_n(&s->head, 0, __ATOMIC_SEQ_CST);
+			__atomic_store_n(&s->tail, 0, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&s->lock);
+			return 0;
+		}
+		pthread_mutex_unlock(&s->lock);
+	}
+	*g = s->items[t];
+	return 1;
+}
+
+int gc_steal(GcMarkStack *s, GcGray *g)
+{
+	long h;
+	if (__atomic_load_n(&s->head, __ATOMIC_SEQ_CST) >= __atomic_load_n(&s->tail, __ATOMIC_SEQ_CST))
+	{
+		return 0;
 	}
+	pthread_mutex_lock(&s->lock);
+	h = s->head;
+	__atomic_store_n(&s->head, h + 1, __ATOMIC_SEQ_CST);
+	if (h + 1 > __atomic_load_n(&s->tail, __ATOMIC_SEQ_CST))
+	{
+		__atomic_store_n(&s->head, h, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&s->lock);
+		return 0;
+	}
+	*g = s->items[h];
+	pthread_mutex_unlock(&s->lock);
+	return 1;
 }
 
-int gc_sweep_get_mark(const Heap *h, int line)
+/*mark what v points to,objects with fields to scan become gray*/
+void gc_mark_value(JsInterpreter *inter, GcMarkStack *s, JsValue *v)
 {
-	switch (h->typ)
+	switch (v->typ)
 	{
 	case JS_VALUE_TYPE_STRING:
-		return h->u.string.mark;
+		if (0 != gc_set_mark(inter, v->u.string))
+		{
+			v->u.string->s = gc_evacuate(inter, v->u.string->s, v->u.string->alloc);
+		}
+		break;
 	case JS_VALUE_TYPE_ARRAY:
-		return h->u.array.mark;
+		if (0 != gc_set_mark(inter, v->u.array))
+		{ /*an array can hold itself,it is scanned once*/
+			v->u.array->elements = gc_evacuate(inter, v->u.array->elements, sizeof(JsValue) * v->u.array->alloc);
+			gc_push(s, GC_GRAY_ARRAY, v->u.array);
+		}
+		break;
 	case JS_VALUE_TYPE_OBJECT:
-		return h->u.object.mark;
-	default:
-		ERROR_runtime_error(RUNTIME_ERROR_NORMAL_VALUE_ON_HEAP, "", line);
+		if (JS_OBJECT_TYPE_BUILDIN != v->u.object->typ && 0 != gc_set_mark(inter, v->u.object))
+		{
+			gc_evacuate_fields(inter, v->u.object);
+			gc_push(s, GC_GRAY_OBJECT, v->u.object);
+		}
+		break;
+	case JS_VALUE_TYPE_FUNCTION:
+		if (NULL != v->u.func->env && 0 != gc_set_mark(inter, v->u.func))
+		{ /*plain functions live in the tree*/
+			gc_push(s, GC_GRAY_FUNCTION, v->u.func);
+		}
+		break;
+	case JS_VALUE_TYPE_MAP:
+		if (0 != gc_set_mark(inter, v->u.map))
+		{
+			v->u.map->entries = gc_evacuate(inter, v->u.map->entries, sizeof(JsMapEntry) * v->u.map->alloc);
+			v->u.map->slots = gc_evacuate(inter, v->u.map->slots, sizeof(int) * (v->u.map->mask + 1));
+			gc_push(s, GC_GRAY_MAP, v->u.map);
+		}
+		break;
+	case JS_VALUE_TYPE_BUFFER: /*numbers only,nothing to scan*/
+		gc_set_mark(inter, v->u.buffer);
+		break;
+	case JS_VALUE_TYPE_PROMISE:
+		if (0 != gc_set_mark(inter, v->u.promise))
+		{
+			v->u.promise->reactions = gc_evacuate(inter, v->u.promise->reactions, sizeof(JsReaction) * v->u.promise->reaction_alloc);
+			gc_push(s, GC_GRAY_PROMISE, v->u.promise);
+		}
+		break;
+	case JS_VALUE_TYPE_COROUTINE:
+		if (0 != gc_set_mark(inter, v->u.coroutine) && NULL != v->u.coroutine->state)
+		{ /*an ended call holds nothing*/
+			gc_push(s, GC_GRAY_COROUTINE, v->u.coroutine);
+		}
+		break;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		if (0 != gc_set_mark(inter, v->u.typed))
+		{
+			gc_set_mark(inter, v->u.typed->buffer);
+		}
+		break;
+	case JS_VALUE_TYPE_REGEXP: /*the program is no heap object*/
+		if (0 != gc_set_mark(inter, v->u.regexp))
+		{
+			gc_mark_value(inter, s, &v->u.regexp->last_index);
+		}
+		break;
 	}
 }
 
-void gc_sweep(JsInterpreter *inter)
+void gc_mark_env(JsInterpreter *inter, GcMarkStack *s, ExecuteEnvironment *env)
 {
-	if (NULL == inter->heap)
+	if (NULL != env && 0 != gc_set_mark(inter, env))
 	{
-		return;
+		gc_push(s, GC_GRAY_ENV, env);
+	}
+}
+
+/*a frame on an arena,the envs it leads to on the heap are marked as usual*/
+void gc_mark_frame(JsInterpreter *inter, GcMarkStack *s, ExecuteEnvironment *frame)
+{
+	VariableList *list;
+	for (list = frame->vars; NULL != list; list = list->next)
+	{
+		gc_mark_value(inter, s, &list->var.value);
+	}
+	gc_mark_env(inter, s, frame->cells);
+	if (NULL != frame->outter && 0 == frame->outter->in_arena)
+	{ /*an outter frame on the arena is on the list too*/
+		gc_mark_env(inter, s, frame->outter);
+	}
+}
+
+void gc_scan(JsInterpreter *inter, GcMarkStack *s, GcGray *g)
+{
+	JsArray *array;
+	JsMap *map;
+	JsKvList *kv_list;
+	VariableList *list;
+	ExecuteEnvironment *env;
+	JsPromise *promise;
+	JsCoroutineState *state;
+	JsValue v;
+	int i;
+	switch (g->typ)
+	{
+	case GC_GRAY_ARRAY:
+		array = g->p;
+		for (i = 0; i < array->length; i++)
+		{
+			gc_mark_value(inter, s, array->elements + i);
+		}
+		break;
+	case GC_GRAY_OBJECT:
+		for (kv_list = ((JsObject *)g->p)->eles; NULL != kv_list; kv_list = kv_list->next)
+		{
+			gc_mark_value(inter, s, &kv_list->kv.value);
+		}
+		break;
+	case GC_GRAY_FUNCTION:
+		gc_mark_env(inter, s, ((JsFunction *)g->p)->env);
+		break;
+	case GC_GRAY_MAP: /*holes have no type and mark nothing*/
+		map = g->p;
+		for (i = 0; i < map->used; i++)
+		{
+			gc_mark_value(inter, s, &map->entries[i].key);
+			gc_mark_value(inter, s, &map->entries[i].value);
+		}
+		break;
+	case GC_GRAY_ENV:
+		env = g->p;
+		for (list = env->vars; NULL != list; list = list->next)
+		{
+			gc_mark_value(inter, s, &list->var.value);
+		}
+		gc_mark_env(inter, s, env->cells);
+		gc_mark_env(inter, s, env->outter);
+		break;
+	case GC_GRAY_PROMISE:
+		promise = g->p;
+		gc_mark_value(inter, s, &promise->value);
+		for (i = 0; i < promise->reaction_count; i++)
+		{
+			gc_mark_value(inter, s, &promise->reactions[i].fulfilled);
+			gc_mark_value(inter, s, &promise->reactions[i].rejected);
+			gc_mark_value(inter, s, &promise->reactions[i].target);
+		}
+		break;
+	case GC_GRAY_COROUTINE: /*its own stack and frames when suspended,those of its resumer while it runs*/
+		state = ((JsCoroutine *)g->p)->state;
+		for (i = 0; i < state->stack.sp; i++)
+		{
+			gc_mark_value(inter, s, state->stack.vs + i);
+		}
+		for (env = state->frames; NULL != env; env = env->next)
+		{
+			gc_mark_frame(inter, s, env);
+		}
+		gc_mark_value(inter, s, &state->func);
+		gc_mark_value(inter, s, &state->receiver);
+		gc_mark_value(inter, s, &state->promise);
+		gc_mark_value(inter, s, &state->value);
+		if (NULL != state->back)
+		{
+			v.typ = JS_VALUE_TYPE_COROUTINE;
+			v.u.coroutine = state->back;
+			gc_mark_value(inter, s, &v);
+		}
+		break;
 	}
-	Heap *head = inter->heap;
-	Heap *index = inter->heap->prev;
-	Heap *prev;
-	Heap *next;
-	while (index != head)
+}
+
+/*scan the own stack empty,then steal,until every marker is out of work*/
+void *gc_marker(void *arg)
+{
+	GcMarker *marker = arg;
+	GcMark *mark = marker->mark;
+	GcMarkStack *s = mark->stacks + marker->id;
+	GcGray g;
+	int i;
+	for (;;)
 	{
-		if (1 == gc_sweep_get_mark(index, index->line))
-		{ /*reset mark*/
-			switch (index->typ)
+		while (0 != gc_pop(s, &g, 1))
+		{
+			gc_scan(mark->inter, s, &g);
+		}
+		for (i = 1; i < mark->count; i++)
+		{
+			if (0 != gc_steal(mark->stacks + (marker->id + i) % mark->count, &g))
 			{
-			case JS_VALUE_TYPE_STRING:
-				index->u.string.mark = 0;
-				break;
-			case JS_VALUE_TYPE_ARRAY:
-				index->u.array.mark = 0;
-				break;
-			case JS_VALUE_TYPE_OBJECT:
-				index->u.object.mark = 0;
 				break;
-			default:
-				ERROR_runtime_error(RUNTIME_ERROR_NORMAL_VALUE_ON_HEAP, "", index->line);
 			}
-			index = index->prev;
+		}
+		if (i < mark->count)
+		{
+			gc_scan(mark->inter, s, &g);
 			continue;
 		}
-		/*let`s sweep*/
-		if (JS_VALUE_TYPE_OBJECT == index->typ)
+		__atomic_sub_fetch(&mark->active, 1, __ATOMIC_SEQ_CST);
+		for (;;)
 		{
-			gc_sweep_object(inter, &index->u.object);
+			if (0 == __atomic_load_n(&mark->active, __ATOMIC_SEQ_CST))
+			{
+				return NULL;
+			}
+			for (i = 0; i < mark->count; i++)
+			{
+				if (__atomic_load_n(&mark->stacks[i].head, __ATOMIC_SEQ_CST) < __atomic_load_n(&mark->stacks[i].tail, __ATOMIC_SEQ_CST))
+				{
+					break;
+				}
+			}
+			if (i < mark->count)
+			{
+				__atomic_add_fetch(&mark->active, 1, __ATOMIC_SEQ_CST);
+				break;
+			}
+			sched_yield();
 		}
-		if (JS_VALUE_TYPE_STRING == index->typ)
+	}
+}
+
+/*cell regions in use,the size of the heap to mark*/
+int gc_cell_regions(GcHeap *gc)
+{
+	int count = gc_region_count(gc);
+	int cells = 0;
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		cells += 0 != gc->regions[i].cells;
+	}
+	return cells;
+}
+
+/*
+ * live values are on the value stack or reachable from the global env,the envs on the frame arena
+ * and the async call running,whose state holds the stacks and frames of the calls below it.
+ * a big heap is marked by several threads,the roots are dealt out to them
+ * and a marker that runs dry steals gray objects from the others.
+ * a compacting collection copies payloads as it marks and stays on one thread.
+ */
+void gc_mark_roots(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	GcMarkStack stacks[GC_MARK_THREADS];
+	GcMarker markers[GC_MARK_THREADS];
+	pthread_t threads[GC_MARK_THREADS];
+	GcMark mark;
+	GcGray g;
+	ExecuteEnvironment *frame;
+	JsValue v;
+	int i;
+	gc_sweep_pending(inter); /*marks of the last collection are still in the bitmaps*/
+	gc_compact_begin(gc);
+	for (i = 0; i < inter->reader_count; i++)
+	{ /*a read block is no heap object,lines already handed out are moved on their own*/
+		inter->readers[i].block = gc_evacuate(inter, inter->readers[i].block, inter->readers[i].size);
+	}
+	mark.inter = inter;
+	mark.stacks = stacks;
+	mark.count = 1;
+	if (0 == gc->compacting && gc->threads > 1 && gc_cell_regions(gc) >= GC_PARALLEL_REGIONS)
+	{
+		mark.count = gc->threads;
+	}
+	for (i = 0; i < mark.count; i++)
+	{
+		stacks[i].items = NULL;
+		stacks[i].head = 0;
+		stacks[i].tail = 0;
+		stacks[i].alloc = 0;
+		pthread_mutex_init(&stacks[i].lock, NULL);
+	}
+	gc->parallel = mark.count > 1;
+	for (i = 0; i < inter->stack.sp; i++)
+	{
+		gc_mark_value(inter, stacks + i % mark.count, inter->stack.vs + i);
+	}
+	gc_mark_env(inter, stacks, &inter->env);
+	for (frame = inter->frames, i = 0; NULL != frame; frame = frame->next, i++)
+	{
+		gc_mark_frame(inter, stacks + i % mark.count, frame);
+	}
+	if (NULL != inter->coroutine)
+	{
+		v.typ = JS_VALUE_TYPE_COROUTINE;
+		v.u.coroutine = inter->coroutine;
+		gc_mark_value(inter, stacks, &v);
+	}
+	for (i = 0; i < inter->loop.timer_count; i++)
+	{ /*callbacks waiting in the event loop*/
+		gc_mark_value(inter, stacks, &inter->loop.timers[i].func);
+	}
+	for (i = 0; i < inter->loop.job_count; i++)
+	{
+		gc_mark_value(inter, stacks, &inter->loop.jobs[(inter->loop.job_head + i) % inter->loop.job_alloc].func);
+		gc_mark_value(inter, stacks, &inter->loop.jobs[(inter->loop.job_head + i) % inter->loop.job_alloc].arg);
+		gc_mark_value(inter, stacks, &inter->loop.jobs[(inter->loop.job_head + i) % inter->loop.job_alloc].target);
+	}
+	for (i = 0; i < inter->loop.rejection_count; i++)
+	{
+		gc_mark_value(inter, stacks, inter->loop.rejections + i);
+	}
+	for (i = 0; i < inter->loop.watch_count; i++)
+	{
+		gc_mark_value(inter, stacks, &inter->loop.watches[i].readable);
+		gc_mark_value(inter, stacks, &inter->loop.watches[i].writable);
+	}
+	if (mark.count > 1)
+	{
+		mark.active = mark.count;
+		for (i = 0; i < mark.count; i++)
+		{
+			markers[i].mark = &mark;
+			markers[i].id = i;
+		}
+		for (i = 1; i < mark.count; i++)
 		{
-			MEM_free(inter->execute_memory, index->u.string.s);
+			if (0 != pthread_create(threads + i, NULL, gc_marker, markers + i))
+			{
+				ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "gc marker", 0);
+			}
+		}
+		gc_marker(markers);
+		for (i = 1; i < mark.count; i++)
+		{
+			pthread_join(threads[i], NULL);
 		}
-		if (JS_VALUE_TYPE_ARRAY == index->typ)
+	}
+	else
+	{
+		while (0 != gc_pop(stacks, &g, 0))
 		{
-			MEM_free(inter->execute_memory, index->u.array.elements);
+			gc_scan(inter, stacks, &g);
 		}
-		/*remove*/
-		prev = index->prev;
-		next = index->next;
-		prev->next = next;
-		next->prev = prev;
-		MEM_free(inter->execute_memory, index);
-		index = prev;
 	}
+	gc->parallel = 0;
+	for (i = 0; i < mark.count; i++)
+	{
+		free(stacks[i].items);
+		pthread_mutex_destroy(&stacks[i].lock);
+	}
+}
 
-	//free envs
-	ExecuteEnvironment *remains_env = NULL;
-	ExecuteEnvironment *env = inter->heapenv;
-	while (NULL != env)
+void gc_sweep_object(JsInterpreter *inter, JsObject *object)
+{
+	JsKvList *list = object->eles;
+	JsKvList *next = list;
+	while (NULL != list)
 	{
-		if (1 == env->mark)
+		next = list->next;
+		gc_payload_free(inter, list);
+		list = next;
+	}
+}
+
+/*free what a dead cell holds and give the cell back to its region*/
+void gc_sweep_cell(JsInterpreter *inter, GcRegion *r, char *cell)
+{
+	Heap *h = (Heap *)cell;
+	if (GC_CLASS_ENV == r->klass)
+	{
+		INTERPRETER_free_env(inter, (ExecuteEnvironment *)cell);
+	}
+	else if (JS_VALUE_TYPE_OBJECT == h->typ)
+	{
+		gc_sweep_object(inter, &h->u.object);
+	}
+	else if (JS_VALUE_TYPE_STRING == h->typ)
+	{
+		gc_payload_free(inter, h->u.string.s);
+	}
+	else if (JS_VALUE_TYPE_ARRAY == h->typ)
+	{
+		gc_payload_free(inter, h->u.array.elements);
+	}
+	else if (JS_VALUE_TYPE_MAP == h->typ)
+	{
+		gc_payload_free(inter, h->u.map.entries);
+		gc_payload_free(inter, h->u.map.slots);
+	}
+	else if (JS_VALUE_TYPE_BUFFER == h->typ && NULL != h->u.buffer.raw)
+	{
+		MEM_free(inter->execute_memory, h->u.buffer.raw);
+	}
+	else if (JS_VALUE_TYPE_PROMISE == h->typ)
+	{
+		gc_payload_free(inter, h->u.promise.reactions);
+	}
+	else if (JS_VALUE_TYPE_COROUTINE == h->typ && NULL != h->u.coroutine.state)
+	{ /*suspended and nothing can resume it*/
+		COROUTINE_release(inter, h->u.coroutine.state);
+	}
+	else if (JS_VALUE_TYPE_REGEXP == h->typ && 0 != h->u.regexp.owned)
+	{ /*a literal shares the program of its site*/
+		REGEXP_free(h->u.regexp.prog);
+	}
+	*(char **)cell = r->free;
+	r->free = cell;
+}
+
+/*
+ * live and not marked is dead,a byte of the bitmaps at a time.
+ * what stays live is the marks,clearing them is the only reset.
+ */
+void gc_sweep_region(JsInterpreter *inter, GcRegion *r)
+{
+	GcHeap *gc = &inter->gc;
+	char *base = gc_region_base(gc, r);
+	int bytes = (r->used + 7) / 8;
+	unsigned char dead;
+	unsigned char live = 0;
+	int j;
+	int k;
+	r->pending = 0;
+	for (j = 0; j < bytes; j++)
+	{
+		dead = r->live[j] & ~r->marks[j];
+		for (k = 0; 0 != dead; k++, dead >>= 1)
 		{
-			if (NULL == env)
+			if (0 != (dead & 1))
 			{
-				remains_env = env;
-				remains_env->next = NULL;
+				gc_sweep_cell(inter, r, base + (j * 8 + k) * r->cell_size);
 			}
-			else
-			{
-				env->next = remains_env;
-				remains_env = env;
-			}
-			env = env->next;
-			continue;
 		}
-		INTERPRETER_free_env(inter, env);
-		env = env->next;
+		r->live[j] &= r->marks[j];
+		live |= r->live[j];
+	}
+	memset(r->marks, 0, bytes);
+	if (0 == live && 0 != r->used)
+	{
+		gc_release_region(gc, r);
+	}
+}
+
+/*regions the last collection left to the allocator*/
+void gc_sweep_pending(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	int count = gc_region_count(gc);
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		if (0 != gc->regions[i].pending)
+		{
+			gc_sweep_region(inter, gc->regions + i);
+		}
+	}
+}
+
+/*marks of memory not swept go,earlier regions may have free cells now*/
+void gc_sweep_done(GcHeap *gc)
+{
+	int count = gc_region_count(gc);
+	int i;
+	for (i = 0; i < count; i++)
+	{
+		if (0 != gc->regions[i].frozen && 0 != gc->regions[i].cells)
+		{ /*shared with the fork server,never freed*/
+			memset(gc->regions[i].marks, 0, (gc->regions[i].used + 7) / 8);
+		}
+	}
+	for (i = 0; i < GC_CLASS_COUNT; i++)
+	{
+		gc->current[i] = 0;
+	}
+	for (i = 0; i < gc->space_count; i++)
+	{
+		memset(gc->spaces[i].marks, 0, ((gc->spaces[i].limit - gc->spaces[i].base) / 8 + 7) / 8);
+	}
+}
+
+/*every region now,regions still waiting are swept by their old marks first*/
+void gc_sweep(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	int count;
+	int i;
+	gc_sweep_pending(inter);
+	count = gc_region_count(gc);
+	for (i = 0; i < count; i++)
+	{
+		if (0 != gc->regions[i].cells && 0 == gc->regions[i].frozen)
+		{ /*payloads are not marked,they go with their owners*/
+			gc_sweep_region(inter, gc->regions + i);
+		}
+	}
+	gc_compact_end(gc);
+	gc_sweep_done(gc);
+}
+
+/*
+ * mark,then leave the dead cells where they are:
+ * a region is swept when the allocator comes to take a cell of it,
+ * or before the next collection marks. a compacting collection sweeps
+ * at once,the payload regions it emptied go back at its end.
+ */
+void gc_collect(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	int count;
+	int i;
+	gc_mark_roots(inter);
+	if (0 != gc->compacting)
+	{
+		gc_sweep(inter);
+		return;
+	}
+	count = gc_region_count(gc);
+	for (i = 0; i < count; i++)
+	{
+		gc->regions[i].pending = 0 != gc->regions[i].cells && 0 == gc->regions[i].frozen;
+	}
+	gc_sweep_done(gc);
+}
+
+/*
+ * called once,before the fork server forks its jobs.
+ * whatever survives a collection stays in its region and the region is
+ * frozen,later collections mark it by a bit beside it and never free it,
+ * new cells come from regions of the child.
+ */
+void gc_freeze(JsInterpreter *inter)
+{
+	GcHeap *gc = &inter->gc;
+	int count;
+	int i;
+	gc_mark_roots(inter);
+	gc_sweep(inter);
+	count = gc_region_count(gc);
+	for (i = 0; i < count; i++)
+	{
+		gc->regions[i].frozen = GC_CLASS_FREE != gc->regions[i].klass;
 	}
-	inter->heapenv = remains_env;
+	gc->payload = -1;
 }
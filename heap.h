@@ -2,11 +2,19 @@
 #define HEAP_H
 #include "js.h"
 
-void push_heap(Heap *head, Heap *h);
+int gc_open(JsInterpreter *inter);
+int gc_add_space(JsInterpreter *inter, void *base, unsigned long length);
+void *gc_alloc(JsInterpreter *inter, GC_CLASS klass, int line);
+void *gc_payload_alloc(JsInterpreter *inter, int size, int line);
+void gc_payload_free(JsInterpreter *inter, void *p);
 
-void gc_mark(ExecuteEnvironment *env);
+void gc_mark_roots(JsInterpreter *inter);
 void gc_sweep(JsInterpreter *inter);
+void gc_sweep_pending(JsInterpreter *inter);
+void gc_collect(JsInterpreter *inter);
 
-void print_heap(Heap *head);
+void gc_freeze(JsInterpreter *inter);
+
+void print_heap(JsInterpreter *inter);
 
 #endif
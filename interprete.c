@@ -4,8 +4,17 @@
 #include "interprete.h"
 #include "stack.h"
 #include "heap.h"
+#include "output.h"
+#include "json.h"
+#include "reader.h"
+#include "map.h"
 #include "js_value.h"
 #include "error.h"
+#include "expression.h"
+#include "loop.h"
+#include "promise.h"
+#include "typed.h"
+#include "coroutine.h"
 
 JsFunctionBuildin console_log_function_buildin;
 JsFunction console_log_function;
@@ -20,6 +29,17 @@ unsigned int create_heap_count = 0;
 char gc_sweep_should_executing = 0;
 
 int INTERPRETE_interprete(JsInterpreter *inter)
+{
+	if (0 != INTERPRETE_execute(inter))
+	{
+		return -1;
+	}
+	INTERPRETE_finish(inter);
+	return 0;
+}
+
+/*run the program,its globals stay alive afterwards*/
+int INTERPRETE_execute(JsInterpreter *inter)
 {
 	if (NULL == inter->statement_list)
 	{
@@ -41,13 +61,19 @@ int INTERPRETE_interprete(JsInterpreter *inter)
 		}
 		next = next->next;
 	}
+	LOOP_run(inter);
+	return 0;
+}
+
+/*free the globals and everything left on the heap*/
+void INTERPRETE_finish(JsInterpreter *inter)
+{
 	INTERPRETER_free_env(inter, &inter->env);
 	inter->env.funcs = NULL;
 	inter->env.vars = NULL;
-	gc_mark(NULL);
-	gc_sweep(inter);
-	print_heap(inter->heap);
-	return 0;
+	gc_sweep(inter); /*nothing is marked,everything goes*/
+	OUTPUT_flush(&inter->output);
+	print_heap(inter);
 }
 
 void INTERPRETE_add_buildin(JsInterpreter *inter)
@@ -63,7 +89,6 @@ void INTERPRETE_add_buildin(JsInterpreter *inter)
 	console_log.next = NULL;
 	console_object.eles = &console_log;
 	console_object.typ = JS_OBJECT_TYPE_BUILDIN;
-	console_object.env = NULL;
 	console_var_list.next = NULL;
 	console_var_list.var.name = "console";
 	console_var_list.var.value.typ = JS_VALUE_TYPE_OBJECT;
@@ -78,6 +103,10 @@ void INTERPRETE_add_buildin(JsInterpreter *inter)
 	type_of_build_in.u.func1 = js_typeof;
 
 	inter->env.funcs = &js_type_of;
+	JSON_add_buildin(inter);
+	READER_add_buildin(inter);
+	LOOP_add_buildin(inter);
+	PROMISE_add_buildin(inter);
 }
 
 
@@ -171,7 +200,7 @@ JsValue *INTERPRETE_create_object_field(JsInterpreter *inter, JsObject *obj, con
 		return v;
 	}
 	int length = strlen(key);
-	JsKvList *list = (JsKvList *)MEM_alloc(inter->execute_memory, sizeof(JsKvList) + length + 1, line);
+	JsKvList *list = (JsKvList *)gc_payload_alloc(inter, sizeof(JsKvList) + length + 1, line);
 	if (NULL == list)
 	{
 		return NULL;
@@ -197,35 +226,260 @@ JsValue *INTERPRETE_create_object_field(JsInterpreter *inter, JsObject *obj, con
 	return &list->kv.value;
 }
 
-StatementResult INTERPRETE_execute_statement_for_in(
+/*the keys of obj as strings of a new array,in the order of its fields*/
+JsValue INTERPRETER_object_keys(JsInterpreter *inter, JsObject *obj, int line)
+{
+	JsValue keys;
+	JsValue *key;
+	JsKvList *list;
+	int count = 0;
+	int length;
+	for (list = obj->eles; NULL != list; list = list->next)
+	{
+		count++;
+	}
+	keys.typ = JS_VALUE_TYPE_ARRAY;
+	keys.u.array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, count, line);
+	for (list = obj->eles; NULL != list; list = list->next)
+	{
+		length = strlen(list->kv.key);
+		key = keys.u.array->elements + keys.u.array->length++;
+		key->typ = JS_VALUE_TYPE_STRING;
+		key->u.string = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, length + 1, line);
+		memcpy(key->u.string->s, list->kv.key, length + 1);
+		key->u.string->length = length;
+	}
+	return keys;
+}
+
+/*
+ * the next value of a for of,0 once there is none. nothing is copied out
+ * up front: arrays are read by index,maps by entry,generators and objects
+ * with next are asked for one value at a time.
+ */
+int interpreter_for_of_next(JsInterpreter *inter, JsValue *target, JsValue *next, int *i, JsValue *v, int line)
+{
+	JsMap *map;
+	JsArray *pair;
+	JsValue sent;
+	JsValue result;
+	JsValue *field;
+	unsigned char *s;
+	int length;
+	int n;
+	switch (target->typ)
+	{
+	case JS_VALUE_TYPE_ARRAY: /*the length is read again,the body may push*/
+		if (*i >= target->u.array->length)
+		{
+			return 0;
+		}
+		*v = target->u.array->elements[(*i)++];
+		return 1;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		if (*i >= target->u.typed->length)
+		{
+			return 0;
+		}
+		TYPED_get(target->u.typed, (*i)++, v);
+		return 1;
+	case JS_VALUE_TYPE_STRING:
+	case JS_VALUE_TYPE_STRING_LITERAL: /*one utf-8 char at a time*/
+		s = (unsigned char *)(JS_VALUE_TYPE_STRING == target->typ ? target->u.string->s : target->u.literal_string);
+		length = JS_VALUE_TYPE_STRING == target->typ ? target->u.string->length : (int)strlen((char *)s);
+		if (*i >= length)
+		{
+			return 0;
+		}
+		n = s[*i] < 0xc0 ? 1 : s[*i] < 0xe0 ? 2 : s[*i] < 0xf0 ? 3 : 4;
+		n = n > length - *i ? length - *i : n;
+		v->typ = JS_VALUE_TYPE_STRING;
+		v->u.string = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, n + 1, line);
+		memcpy(v->u.string->s, s + *i, n);
+		v->u.string->s[n] = 0;
+		v->u.string->length = n;
+		*i += n;
+		return 1;
+	case JS_VALUE_TYPE_MAP: /*keys of a set,[key,value] of a map,holes are skipped*/
+		map = target->u.map;
+		while (*i < map->used && 0 == map->entries[*i].key.typ)
+		{
+			(*i)++;
+		}
+		if (*i >= map->used)
+		{
+			return 0;
+		}
+		if (0 != map->set)
+		{
+			*v = map->entries[(*i)++].key;
+			return 1;
+		}
+		pair = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, 2, line);
+		pair->elements[0] = map->entries[*i].key;
+		pair->elements[1] = map->entries[*i].value;
+		pair->length = 2;
+		(*i)++;
+		v->typ = JS_VALUE_TYPE_ARRAY;
+		v->u.array = pair;
+		return 1;
+	case JS_VALUE_TYPE_COROUTINE:
+		sent.typ = JS_VALUE_TYPE_UNDEFINED;
+		return 0 == COROUTINE_next(inter, target->u.coroutine, &sent, v, line);
+	case JS_VALUE_TYPE_OBJECT: /*an iterator,next() gives {value,done}*/
+		result = eval_call_method_value(inter, target->u.object, next, NULL, 0, line);
+		if (JS_VALUE_TYPE_OBJECT != result.typ)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_IS_NOT_AN_OBJECT, "next", line);
+			return 0;
+		}
+		field = INTERPRETER_search_field_from_object_include_prototype(result.u.object, "done");
+		if (NULL != field && JS_BOOL_TRUE == is_js_value_true(field))
+		{
+			return 0;
+		}
+		field = INTERPRETER_search_field_from_object_include_prototype(result.u.object, "value");
+		v->typ = JS_VALUE_TYPE_UNDEFINED;
+		if (NULL != field)
+		{
+			*v = *field;
+		}
+		return 1;
+	case JS_VALUE_TYPE_PROMISE: /*not iterable,checked by the caller*/
+	case JS_VALUE_TYPE_REGEXP:
+	case JS_VALUE_TYPE_BOOL:
+	case JS_VALUE_TYPE_INT:
+	case JS_VALUE_TYPE_FLOAT:
+	case JS_VALUE_TYPE_FUNCTION:
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_UNDEFINED:
+	case JS_VALUE_TYPE_BUFFER:
+	default:
+		break;
+	}
+	return 0;
+}
+
+/*for (x of target),the values themselves,see interpreter_for_of_next*/
+StatementResult INTERPRETE_execute_statement_for_of(
 	JsInterpreter *inter,
 	ExecuteEnvironment *env,
 	StatementForIn *in,
 	int line)
 {
+	StatementResult ret;
+	JsValue next;
+	JsValue *field;
+	Variable *var;
+	int i = 0;
+	char early = 0;
+	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
+	eval_expression(inter, env, in->target);
+	JsValue target = peek_stack(&inter->stack, 0); /*stays on the stack while looping*/
+	next.typ = JS_VALUE_TYPE_UNDEFINED;
+	switch (target.typ)
+	{
+	case JS_VALUE_TYPE_ARRAY:
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+	case JS_VALUE_TYPE_STRING:
+	case JS_VALUE_TYPE_STRING_LITERAL:
+	case JS_VALUE_TYPE_MAP:
+	case JS_VALUE_TYPE_COROUTINE:
+		break;
+	case JS_VALUE_TYPE_OBJECT: /*next is looked up once,the fields may move while the body runs*/
+		field = INTERPRETER_search_field_from_object_include_prototype(target.u.object, "next");
+		if (NULL != field && JS_VALUE_TYPE_FUNCTION == field->typ)
+		{
+			next = *field;
+			break;
+		}
+	case JS_VALUE_TYPE_PROMISE:
+	case JS_VALUE_TYPE_REGEXP:
+	case JS_VALUE_TYPE_BOOL:
+	case JS_VALUE_TYPE_INT:
+	case JS_VALUE_TYPE_FLOAT:
+	case JS_VALUE_TYPE_FUNCTION:
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_UNDEFINED:
+	case JS_VALUE_TYPE_BUFFER:
+	default:
+		pop_stack(&inter->stack);
+		ERROR_runtime_error(RUNTIME_ERROR_NOT_ITERABLE, "for of", line);
+		ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
+		return ret;
+	}
+	push_stack(&inter->stack, &next); /*next stays alive above the target*/
+	ExecuteEnvironment *forofenv = INTERPRETER_alloc_block_env(inter, env, 1, in->block->has_captured, line);
+	ExecuteEnvironment *varenv = INTERPRETER_declare_env(forofenv, in->captured);
+	var = INTERPRETER_create_variable(inter, varenv, in->identifer, NULL, -1);
+	while (0 != interpreter_for_of_next(inter, &target, &next, &i, &var->value, line))
+	{
+		ret = INTERPRETE_execute_normal_statement_list(inter, forofenv, in->block->list);
+		switch (ret.typ)
+		{
+		case STATEMENT_RESULT_TYPE_NORMAL:
+			break;
+		case STATEMENT_RESULT_TYPE_CONTINUE:
+			break;
+		case STATEMENT_RESULT_TYPE_RETURN:
+			early = 1;
+			goto end;
+		case STATEMENT_RESULT_TYPE_BREAK:
+			ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
+			early = 1;
+			goto end;
+		}
+	}
 
-	ExecuteEnvironment *forinenv = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, line);
+end:
+	if (0 != early && JS_VALUE_TYPE_COROUTINE == target.typ)
+	{ /*a generator left early is done,its stack goes back to the pool now*/
+		COROUTINE_return(inter, target.u.coroutine, line);
+	}
+	if (STATEMENT_RESULT_TYPE_RETURN != ret.typ)
+	{
+		ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
+	}
+	INTERPRETER_leave_block_env(inter, env, forofenv);
+	/*drop target and next,a return value may be above them*/
+	remove_stack(&inter->stack, STATEMENT_RESULT_TYPE_RETURN == ret.typ ? 1 : 0);
+	remove_stack(&inter->stack, STATEMENT_RESULT_TYPE_RETURN == ret.typ ? 1 : 0);
+	return ret;
+}
+
+StatementResult INTERPRETE_execute_statement_for_in(
+	JsInterpreter *inter,
+	ExecuteEnvironment *env,
+	StatementForIn *in,
+	int line)
+{
 	StatementResult ret;
 	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
+	if (0 != in->of)
+	{
+		return INTERPRETE_execute_statement_for_of(inter, env, in, line);
+	}
 	eval_expression(inter, env, in->target);
-	JsValue target = pop_stack(&inter->stack);
-	if (JS_VALUE_TYPE_ARRAY != target.typ && JS_VALUE_TYPE_OBJECT != target.typ)
+	JsValue target = peek_stack(&inter->stack, 0); /*stays on the stack while looping*/
+	if (JS_VALUE_TYPE_ARRAY != target.typ && JS_VALUE_TYPE_OBJECT != target.typ && JS_VALUE_TYPE_MAP != target.typ &&
+		JS_VALUE_TYPE_TYPED_ARRAY != target.typ)
 	{
-		INTERPRETER_free_env(inter, forinenv);
+		pop_stack(&inter->stack);
 		return ret; /*can for in this type,just return nothing to do*/
 	}
+	ExecuteEnvironment *forinenv = INTERPRETER_alloc_block_env(inter, env, 1, in->block->has_captured, line);
+	ExecuteEnvironment *varenv = INTERPRETER_declare_env(forinenv, in->captured);
 	Variable *var;
-	/*handle array part*/
-	if (JS_VALUE_TYPE_ARRAY == target.typ)
+	/*handle array part,a typed array is looped the same by index*/
+	if (JS_VALUE_TYPE_ARRAY == target.typ || JS_VALUE_TYPE_TYPED_ARRAY == target.typ)
 	{
-		JsArray *array = target.u.array;
-		int length = array->length;
+		int length = JS_VALUE_TYPE_ARRAY == target.typ ? target.u.array->length : target.u.typed->length;
 		int i = 0;
 		for (; i < length; i++)
 		{
 			if (0 == i)
 			{
-				var = INTERPRETER_create_variable(inter, forinenv, in->identifer, NULL, -1);
+				var = INTERPRETER_create_variable(inter, varenv, in->identifer, NULL, -1);
 				var->value.typ = JS_VALUE_TYPE_INT;
 				var->value.u.intvalue = 0;
 			}
@@ -249,18 +503,22 @@ StatementResult INTERPRETE_execute_statement_for_in(
 		}
 	}
 
-	if (JS_VALUE_TYPE_OBJECT == target.typ)
-	{
-		JsKvList *list = target.u.object->eles;
-		if (NULL == list)
+	if (JS_VALUE_TYPE_OBJECT == target.typ || JS_VALUE_TYPE_MAP == target.typ)
+	{ /*keys are copied out first,gc may move the fields while the body runs*/
+		JsValue keys = JS_VALUE_TYPE_MAP == target.typ ? MAP_items(inter, target.u.map, MAP_ITEM_KEYS, line)
+													   : INTERPRETER_object_keys(inter, target.u.object, line);
+		JsArray *array = keys.u.array;
+		int i;
+		pop_stack(&inter->stack);
+		push_stack(&inter->stack, &keys); /*keys stand in for the target*/
+		if (0 == array->length)
 		{
 			goto end;
 		}
-		var = INTERPRETER_create_variable(inter, forinenv, in->identifer, NULL, -1);
-		var->value.typ = JS_VALUE_TYPE_STRING_LITERAL;
-		while (NULL != list)
+		var = INTERPRETER_create_variable(inter, varenv, in->identifer, NULL, -1);
+		for (i = 0; i < array->length; i++)
 		{
-			var->value.u.literal_string = list->kv.key;
+			var->value = array->elements[i];
 			ret = INTERPRETE_execute_normal_statement_list(inter, forinenv, in->block->list);
 			switch (ret.typ)
 			{
@@ -274,7 +532,6 @@ StatementResult INTERPRETE_execute_statement_for_in(
 				ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 				goto end;
 			}
-			list = list->next;
 		}
 	}
 
@@ -283,7 +540,9 @@ end:
 	{
 		ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	}
-	INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, forinenv, &ret);
+	INTERPRETER_leave_block_env(inter, env, forinenv);
+	/*drop target,a return value may be above it*/
+	remove_stack(&inter->stack, STATEMENT_RESULT_TYPE_RETURN == ret.typ ? 1 : 0);
 	return ret;
 }
 
@@ -293,8 +552,8 @@ INTERPRETE_execute_statement_switch(JsInterpreter *inter, ExecuteEnvironment *en
 	StatementResult ret;
 	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	eval_expression(inter, env, s->condition);
-	JsValue value = pop_stack(&inter->stack);
-	ExecuteEnvironment *senv = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, s->condition->line);
+	JsValue value = peek_stack(&inter->stack, 0); /*stays on the stack while cases run*/
+	ExecuteEnvironment *senv = INTERPRETER_alloc_block_env(inter, env, s->need_env, s->has_captured, s->condition->line);
 	StatementSwitchCaseList *list = s->list;
 	JsValue match;
 	JSBool is_true;
@@ -353,30 +612,11 @@ INTERPRETE_execute_statement_switch(JsInterpreter *inter, ExecuteEnvironment *en
 	}
 
 end:
-	INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, senv, &ret);
+	INTERPRETER_leave_block_env(inter, env, senv);
+	remove_stack(&inter->stack, STATEMENT_RESULT_TYPE_RETURN == ret.typ ? 1 : 0);
 	return ret;
 }
 
-void INTERPRETE_mark_js_value_env(JsValue *v, ExecuteEnvironment *env)
-{
-	int i = 0;
-	switch (v->typ)
-	{
-	case JS_VALUE_TYPE_FUNCTION:
-		v->u.func->env = NULL;
-		break;
-	case JS_VALUE_TYPE_OBJECT:
-		v->u.object->env = NULL;
-		break;
-	case JS_VALUE_TYPE_ARRAY:
-		for (; i < v->u.array->length; i++)
-		{
-			INTERPRETE_mark_js_value_env(v->u.array->elements + i, env);
-		}
-		break;
-	}
-}
-
 StatementResult INTERPRETER_execute_statement(JsInterpreter *inter, ExecuteEnvironment *env, Statement *s)
 {
 	StatementResult ret;
@@ -418,11 +658,9 @@ StatementResult INTERPRETER_execute_statement(JsInterpreter *inter, ExecuteEnvir
 			v.typ = JS_VALUE_TYPE_NULL;
 			push_stack(&inter->stack, &v);
 		}
-		else
+		else if (0 == eval_tail_call(inter, env, s->u.return_expression))
 		{
 			eval_expression(inter, env, s->u.return_expression);
-			JsValue v = peek_stack(&inter->stack, 0);
-			INTERPRETE_mark_js_value_env(&v, NULL);
 		}
 		ret.typ = STATEMENT_RESULT_TYPE_RETURN;
 	}
@@ -445,7 +683,7 @@ StatementResult INTERPRETE_execute_statement_for(
 	StatementFor *f,
 	int line)
 {
-	ExecuteEnvironment *forenv = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, line);
+	ExecuteEnvironment *forenv = INTERPRETER_alloc_block_env(inter, env, f->block->need_env, f->block->has_captured, line);
 	StatementResult ret;
 	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	if (NULL != f->init)
@@ -501,7 +739,7 @@ end:
 	{
 		ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	}
-	INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, forenv, &ret);
+	INTERPRETER_leave_block_env(inter, env, forenv);
 	return ret;
 }
 
@@ -514,6 +752,14 @@ StatementResult INTERPRETE_execute_statement_expression(JsInterpreter *inter, Ex
 	return ret;
 }
 
+StatementResult INTERPRETE_execute_block(JsInterpreter *inter, ExecuteEnvironment *env, Block *block, int line)
+{
+	ExecuteEnvironment *blockenv = INTERPRETER_alloc_block_env(inter, env, block->need_env, block->has_captured, line);
+	StatementResult ret = INTERPRETE_execute_normal_statement_list(inter, blockenv, block->list);
+	INTERPRETER_leave_block_env(inter, env, blockenv);
+	return ret;
+}
+
 StatementResult INTERPRETE_execute_statement_if(
 	JsInterpreter *inter,
 	ExecuteEnvironment *env,
@@ -523,29 +769,18 @@ StatementResult INTERPRETE_execute_statement_if(
 
 	StatementResult ret;
 	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
-	ExecuteEnvironment *conditionenv = INTERPRETER_alloc_env(inter, env, line);
+	ExecuteEnvironment *conditionenv = INTERPRETER_alloc_block_env(inter, env, i->then->need_env, i->then->has_captured, line);
 	eval_expression(inter, conditionenv, i->condition);
 	JsValue v = pop_stack(&inter->stack);
 	JSBool is_true = is_js_value_true(&v);
-	StatementList *list;
 	if (JS_BOOL_TRUE == is_true)
 	{ /*handle true part*/
 		ret = INTERPRETE_execute_normal_statement_list(inter, conditionenv, i->then->list);
-		INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, conditionenv, &ret);
+		INTERPRETER_leave_block_env(inter, env, conditionenv);
 		return ret;
 	}
+	INTERPRETER_leave_block_env(inter, env, conditionenv);
 
-	if (NULL == i->elseIfList && NULL != i->els)
-	{ /*handle else part*/
-		ExecuteEnvironment *if_env = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, line);
-		ret = INTERPRETE_execute_normal_statement_list(inter, if_env, i->els->list);
-		INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, if_env, &ret);
-		return ret;
-	}
-	if (NULL == i->elseIfList)
-	{
-		return ret;
-	}
 	StatementElsifList *else_if_next = i->elseIfList;
 	while (NULL != else_if_next)
 	{
@@ -554,18 +789,16 @@ StatementResult INTERPRETE_execute_statement_if(
 		is_true = is_js_value_true(&v);
 		if (JS_BOOL_TRUE == is_true)
 		{
-			ExecuteEnvironment *if_env = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, line);
-			ret = INTERPRETE_execute_normal_statement_list(inter, if_env, else_if_next->elsif.block->list);
-			INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, if_env, &ret);
-			return ret;
+			return INTERPRETE_execute_block(inter, env, else_if_next->elsif.block, line);
 		}
 		else_if_next = else_if_next->next;
 	}
 
-	ExecuteEnvironment *if_env = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, line);
-	ret = INTERPRETE_execute_normal_statement_list(inter, if_env, i->els->list);
-	INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, if_env, &ret);
-	return ret;
+	if (NULL == i->els)
+	{
+		return ret;
+	}
+	return INTERPRETE_execute_block(inter, env, i->els, line);
 }
 
 StatementResult INTERPRETE_execute_statement_while(
@@ -574,7 +807,7 @@ StatementResult INTERPRETE_execute_statement_while(
 	StatementWhile *w,
 	int line)
 {
-	ExecuteEnvironment *whileenv = (ExecuteEnvironment *)INTERPRETER_alloc_env(inter, env, line);
+	ExecuteEnvironment *whileenv = INTERPRETER_alloc_block_env(inter, env, w->block->need_env, w->block->has_captured, line);
 	StatementResult ret;
 	ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	StatementList *list;
@@ -630,7 +863,7 @@ end:
 	{
 		ret.typ = STATEMENT_RESULT_TYPE_NORMAL;
 	}
-	INTERPRETER_check_return_value_free_env_or_push_in_envheap(inter, whileenv, &ret);
+	INTERPRETER_leave_block_env(inter, env, whileenv);
 	return ret;
 }
 
@@ -643,10 +876,18 @@ INTERPRETER_create_variable(
 	int line)
 {
 
-	int length = strlen(name);
-	VariableList *newlist = (VariableList *)MEM_alloc(inter->execute_memory, sizeof(VariableList) + length + 1, line);
+	VariableList *newlist;
+	if (1 == env->in_arena)
+	{
+		newlist = (VariableList *)alloc_arena(&inter->arena, sizeof(VariableList));
+	}
+	else
+	{
+		newlist = (VariableList *)MEM_alloc(inter->execute_memory, sizeof(VariableList), line);
+	}
 	if (NULL == newlist)
 	{
+		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, name, line);
 		return NULL;
 	}
 	newlist->next = NULL;
@@ -659,9 +900,7 @@ INTERPRETER_create_variable(
 		newlist->next = env->vars;
 		env->vars = newlist;
 	}
-	newlist->var.name = (char *)(newlist + 1);
-	strncpy(newlist->var.name, name, length);
-	newlist->var.name[length] = 0;
+	newlist->var.name = name; /*names come from the tree,which outlives every env*/
 	if (NULL != v)
 	{
 		newlist->var.value = *v;
@@ -673,23 +912,174 @@ INTERPRETER_create_variable(
 	return &newlist->var;
 }
 
+/*
+ * env of a scope,lives on the frame arena and goes away when the scope is left.
+ * slots are variables allocated right behind the env in the same bump.
+ */
+ExecuteEnvironment *
+INTERPRETER_alloc_frame(JsInterpreter *inter, ExecuteEnvironment *outter, int slots, int line)
+{
+	ExecuteEnvironment *env = (ExecuteEnvironment *)alloc_arena(&inter->arena, sizeof(ExecuteEnvironment) + sizeof(VariableList) * slots);
+	if (NULL == env)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "frame arena", line);
+		return NULL;
+	}
+	env->funcs = NULL;
+	env->outter = outter;
+	env->vars = NULL;
+	env->in_arena = 1;
+	env->cells = NULL;
+	env->lexical = NULL;
+	env->next = inter->frames;
+	inter->frames = env;
+	return env;
+}
+
 ExecuteEnvironment *
 INTERPRETER_alloc_env(JsInterpreter *inter, ExecuteEnvironment *outter, int line)
 {
-	ExecuteEnvironment *env = (ExecuteEnvironment *)MEM_alloc(inter->execute_memory, sizeof(ExecuteEnvironment), line);
+	return INTERPRETER_alloc_frame(inter, outter, 0, line);
+}
+
+/*bind a variable in a slot of the frame,no allocation*/
+Variable *
+INTERPRETER_bind_slot(ExecuteEnvironment *env, int slot, char *name, JsValue *v)
+{
+	VariableList *newlist = (VariableList *)(env + 1) + slot;
+	newlist->var.name = name;
+	newlist->var.value = *v;
+	newlist->next = env->vars;
+	env->vars = newlist;
+	return &newlist->var;
+}
+
+/*env for captured variables,lives on the heap until gc finds no closure using it*/
+ExecuteEnvironment *
+INTERPRETER_alloc_cell_env(JsInterpreter *inter, ExecuteEnvironment *outter, int line)
+{
+	ExecuteEnvironment *env = (ExecuteEnvironment *)gc_alloc(inter, GC_CLASS_ENV, line);
 	if (NULL == env)
 	{
-		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "alloc", line);
 		return NULL;
 	}
 	env->funcs = NULL;
 	env->outter = outter;
 	env->vars = NULL;
+	env->in_arena = 0;
+	env->cells = NULL;
+	env->lexical = NULL;
 	env->next = NULL;
-	env->mark = 0;
 	return env;
 }
 
+/*innermost env that outlives the current scope,closures created here keep it*/
+ExecuteEnvironment *
+INTERPRETER_capture_env(ExecuteEnvironment *env)
+{
+	while (NULL != env)
+	{
+		if (NULL != env->cells)
+		{
+			return env->cells;
+		}
+		if (0 == env->in_arena)
+		{
+			return env;
+		}
+		if (NULL != env->lexical)
+		{
+			return env->lexical;
+		}
+		env = env->outter;
+	}
+	return NULL;
+}
+
+/*env a declaration goes to,captured names live in the cell env*/
+ExecuteEnvironment *
+INTERPRETER_declare_env(ExecuteEnvironment *env, char captured)
+{
+	if (0 != captured && NULL != env->cells)
+	{
+		return env->cells;
+	}
+	return env;
+}
+
+/*free the env and everything allocated on the arena after it*/
+void INTERPRETER_release_env(JsInterpreter *inter, ExecuteEnvironment *env)
+{
+	inter->frames = env->next;
+	release_arena(&inter->arena, env);
+}
+
+/*block bodies that declare nothing run in the enclosing env*/
+ExecuteEnvironment *
+INTERPRETER_alloc_block_env(JsInterpreter *inter, ExecuteEnvironment *outter, char need_env, char has_captured, int line)
+{
+	ExecuteEnvironment *env;
+	if (0 == need_env)
+	{
+		return outter;
+	}
+	env = INTERPRETER_alloc_env(inter, outter, line);
+	if (0 != has_captured)
+	{
+		env->cells = INTERPRETER_alloc_cell_env(inter, INTERPRETER_capture_env(outter), line);
+	}
+	return env;
+}
+
+void INTERPRETER_leave_block_env(
+	JsInterpreter *inter,
+	ExecuteEnvironment *outter,
+	ExecuteEnvironment *env)
+{
+	if (env == outter)
+	{
+		return;
+	}
+	INTERPRETER_release_env(inter, env);
+}
+
+/*
+ * call env of a user function.
+ * a closure runs in the envs it captured,a plain function
+ * still sees its caller for names it does not declare.
+ */
+ExecuteEnvironment *
+INTERPRETER_alloc_call_env(JsInterpreter *inter, ExecuteEnvironment *caller, JsFunction *func, int line)
+{
+	ExecuteEnvironment *lexical = NULL != func->env ? func->env : &inter->env;
+	ExecuteEnvironment *callenv = INTERPRETER_alloc_frame(inter,
+														  NULL != func->env ? func->env : caller,
+														  func->parameter_count + CALL_FRAME_FIXED_SLOTS,
+														  line);
+	callenv->lexical = lexical;
+	if (0 != func->block->has_captured)
+	{
+		callenv->cells = INTERPRETER_alloc_cell_env(inter, lexical, line);
+	}
+	return callenv;
+}
+
+/*value of a function literal,closures get their own copy holding the captured envs*/
+JsValue INTERPRETER_create_function_value(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, int line)
+{
+	JsValue v;
+	v.typ = JS_VALUE_TYPE_FUNCTION;
+	v.u.func = func;
+	if (0 == func->captures)
+	{
+		return v;
+	}
+	v.u.func = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_FUNCTION, 0, line);
+	*v.u.func = *func;
+	v.u.func->env = INTERPRETER_capture_env(env);
+	return v;
+}
+
 void INTERPRETER_free_env(JsInterpreter *inter, ExecuteEnvironment *env)
 {
 	if (NULL == env)
@@ -717,17 +1107,15 @@ void INTERPRETER_free_env(JsInterpreter *inter, ExecuteEnvironment *env)
 			list = next;
 		}
 	}
-	MEM_free(inter->execute_memory, env);
 }
 
 void *
 INTERPRETER_create_heap(JsInterpreter *inter, JS_VALUE_TYPE typ, int size, int line)
 {
-	Heap *h = MEM_alloc(inter->execute_memory, sizeof(Heap), line);
+	Heap *h = gc_alloc(inter, GC_CLASS_OBJECT, line);
 	if (NULL == h)
 	{
-		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "", line);
-		return;
+		return NULL;
 	}
 	int allocsize = 0;
 	switch (typ)
@@ -738,26 +1126,33 @@ INTERPRETER_create_heap(JsInterpreter *inter, JS_VALUE_TYPE typ, int size, int l
 	case JS_VALUE_TYPE_ARRAY:
 		allocsize = sizeof(JsValue) * size;
 		break;
+	case JS_VALUE_TYPE_PROMISE: /*reactions are allocated as they come*/
+	case JS_VALUE_TYPE_COROUTINE: /*COROUTINE_start gives the state*/
+	case JS_VALUE_TYPE_REGEXP: /*the callers give the program*/
 	case JS_VALUE_TYPE_OBJECT:
-		allocsize = sizeof(JsObject);
+	case JS_VALUE_TYPE_FUNCTION:
+	case JS_VALUE_TYPE_MAP:
+	case JS_VALUE_TYPE_BUFFER:
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+	case JS_VALUE_TYPE_BOOL: /*never cells*/
+	case JS_VALUE_TYPE_INT:
+	case JS_VALUE_TYPE_FLOAT:
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_UNDEFINED:
+	case JS_VALUE_TYPE_STRING_LITERAL:
 		break;
 	}
-	char *p = MEM_alloc(inter->execute_memory, allocsize, line);
-	if (NULL == p)
-	{
-		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "", line);
-		return;
+	char *p = NULL;
+	if (JS_VALUE_TYPE_STRING == typ || JS_VALUE_TYPE_ARRAY == typ)
+	{ /*objects and closures keep everything in the header*/
+		p = gc_payload_alloc(inter, allocsize, line);
+		if (NULL == p)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "", line);
+			return NULL;
+		}
 	}
-	h->prev = NULL;
-	h->next = NULL;
 	h->line = line;
-	if (NULL == inter->heap)
-	{
-		inter->heap = MEM_alloc(inter->execute_memory, sizeof(Heap), line);
-		inter->heap->prev = inter->heap;
-		inter->heap->next = inter->heap;
-		inter->heap->line = -1;
-	}
 	h->typ = typ;
 	switch (typ)
 	{
@@ -766,25 +1161,75 @@ INTERPRETER_create_heap(JsInterpreter *inter, JS_VALUE_TYPE typ, int size, int l
 		h->u.string.length = 0;
 		h->u.string.s = (char *)p;
 		h->u.string.s[0] = 0;
-		h->u.string.mark = 0;
 		h->u.string.line = line;
 		break;
 
-	case JS_VALUE_TYPE_OBJECT:
-		h->u.object.mark = 0;
+	case JS_VALUE_TYPE_OBJECT: /*a recycled cell still holds the type of the object that died there*/
+		h->u.object.typ = JS_OBJECT_TYPE_USER;
 		h->u.object.eles = NULL;
 		h->u.object.line = line;
-		h->u.object.env = NULL;
 		break;
 	case JS_VALUE_TYPE_ARRAY:
-		h->u.array.mark = 0;
 		h->u.array.length = 0;
 		h->u.array.alloc = size;
 		h->u.array.line = line;
 		h->u.array.elements = (JsValue *)p;
 		break;
+	case JS_VALUE_TYPE_MAP: /*tables come with the first entry*/
+		h->u.map.entries = NULL;
+		h->u.map.slots = NULL;
+		h->u.map.size = 0;
+		h->u.map.used = 0;
+		h->u.map.alloc = 0;
+		h->u.map.mask = 0;
+		h->u.map.set = 0;
+		h->u.map.line = line;
+		break;
+	case JS_VALUE_TYPE_BUFFER: /*TYPED_create_buffer gives the bytes*/
+		h->u.buffer.data = NULL;
+		h->u.buffer.raw = NULL;
+		h->u.buffer.length = 0;
+		h->u.buffer.line = line;
+		break;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		h->u.typed.buffer = NULL;
+		h->u.typed.data = NULL;
+		h->u.typed.offset = 0;
+		h->u.typed.length = 0;
+		h->u.typed.line = line;
+		break;
+	case JS_VALUE_TYPE_PROMISE:
+		h->u.promise.state = JS_PROMISE_PENDING;
+		h->u.promise.handled = 0;
+		h->u.promise.value.typ = JS_VALUE_TYPE_UNDEFINED;
+		h->u.promise.reactions = NULL;
+		h->u.promise.reaction_count = 0;
+		h->u.promise.reaction_alloc = 0;
+		h->u.promise.line = line;
+		break;
+	case JS_VALUE_TYPE_COROUTINE: /*COROUTINE_start gives the state*/
+		h->u.coroutine.state = NULL;
+		h->u.coroutine.line = line;
+		break;
+	case JS_VALUE_TYPE_REGEXP: /*the callers give the program*/
+		h->u.regexp.prog = NULL;
+		h->u.regexp.source = NULL;
+		h->u.regexp.flags = NULL;
+		h->u.regexp.owned = 0;
+		h->u.regexp.last_index.typ = JS_VALUE_TYPE_INT;
+		h->u.regexp.last_index.u.intvalue = 0;
+		h->u.regexp.index = 0;
+		h->u.regexp.line = line;
+		break;
+	case JS_VALUE_TYPE_FUNCTION: /*the caller fills it in*/
+	case JS_VALUE_TYPE_BOOL: /*never cells*/
+	case JS_VALUE_TYPE_INT:
+	case JS_VALUE_TYPE_FLOAT:
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_UNDEFINED:
+	case JS_VALUE_TYPE_STRING_LITERAL:
+		break;
 	}
-	push_heap(inter->heap, h);
 	create_heap_count;
 	create_heap_count++;
 	if (0 == (create_heap_count % GC_SWEEP_TIMING))
@@ -799,10 +1244,54 @@ INTERPRETER_create_heap(JsInterpreter *inter, JS_VALUE_TYPE typ, int size, int l
 		return &h->u.object;
 	case JS_VALUE_TYPE_ARRAY:
 		return &h->u.array;
+	case JS_VALUE_TYPE_FUNCTION:
+		return &h->u.function;
+	case JS_VALUE_TYPE_MAP:
+		return &h->u.map;
+	case JS_VALUE_TYPE_BUFFER:
+		return &h->u.buffer;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		return &h->u.typed;
+	case JS_VALUE_TYPE_PROMISE:
+		return &h->u.promise;
+	case JS_VALUE_TYPE_COROUTINE:
+		return &h->u.coroutine;
+	case JS_VALUE_TYPE_REGEXP:
+		return &h->u.regexp;
+	case JS_VALUE_TYPE_BOOL: /*never cells*/
+	case JS_VALUE_TYPE_INT:
+	case JS_VALUE_TYPE_FLOAT:
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_UNDEFINED:
+	case JS_VALUE_TYPE_STRING_LITERAL:
+		break;
 	}
 	return h;
 }
 
+/*a string over chars it does not own,s[length] must be 0 and stay so*/
+JsString *INTERPRETER_create_string_view(JsInterpreter *inter, char *s, int length, int line)
+{
+	Heap *h = gc_alloc(inter, GC_CLASS_OBJECT, line);
+	if (NULL == h)
+	{
+		ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "", line);
+		return NULL;
+	}
+	h->line = line;
+	h->typ = JS_VALUE_TYPE_STRING;
+	h->u.string.alloc = length + 1; /*what compaction and snapshots copy*/
+	h->u.string.length = length;
+	h->u.string.s = s;
+	h->u.string.line = line;
+	create_heap_count++;
+	if (0 == (create_heap_count % GC_SWEEP_TIMING))
+	{
+		gc_sweep_should_executing = 1;
+	}
+	return &h->u.string;
+}
+
 /* must be string or string_literal*/
 JsValue INTERPRETER_concat_string(JsInterpreter *inter, const JsValue *v1, const JsValue *v2, int line)
 {
@@ -859,11 +1348,23 @@ INTERPRETE_search_func_from_function_list(JsFunctionList *list, char *function)
 	return NULL;
 }
 
+/*one level only,vars of the scope and its cell env*/
+Variable *
+INTERPRETER_search_variable_in_env(ExecuteEnvironment *env, char *name)
+{
+	Variable *var = search_variable_from_variablelist(env->vars, name);
+	if (NULL == var && NULL != env->cells)
+	{
+		var = search_variable_from_variablelist(env->cells->vars, name);
+	}
+	return var;
+}
+
 JsFunction *
 INTERPRETER_search_func_from_env(ExecuteEnvironment *env, char *function)
 {
 	JsFunctionList *funclist;
-	VariableList *variablelist;
+	Variable *var;
 	while (NULL != env)
 	{
 		funclist = env->funcs;
@@ -875,14 +1376,10 @@ INTERPRETER_search_func_from_env(ExecuteEnvironment *env, char *function)
 			}
 			funclist = funclist->next;
 		}
-		variablelist = env->vars;
-		while (NULL != variablelist)
+		var = INTERPRETER_search_variable_in_env(env, function);
+		if (NULL != var && JS_VALUE_TYPE_FUNCTION == var->value.typ)
 		{
-			if (0 == strcmp(variablelist->var.name, function) && JS_VALUE_TYPE_FUNCTION == variablelist->var.value.typ)
-			{
-				return variablelist->var.value.u.func;
-			}
-			variablelist = variablelist->next;
+			return var->value.u.func;
 		}
 		env = env->outter;
 	}
@@ -892,119 +1389,15 @@ INTERPRETER_search_func_from_env(ExecuteEnvironment *env, char *function)
 JsValue *
 INTERPRETE_search_variable_from_env(ExecuteEnvironment *env, char *variable)
 {
-	VariableList *list;
-	JsFunctionList *funclist;
+	Variable *var;
 	while (NULL != env)
 	{
-		list = env->vars;
-		while (NULL != list)
+		var = INTERPRETER_search_variable_in_env(env, variable);
+		if (NULL != var)
 		{
-			if (0 == strcmp(list->var.name, variable))
-			{
-				return &list->var.value;
-			}
-			list = list->next;
+			return &var->value;
 		}
 		env = env->outter;
 	}
 	return NULL;
 }
-
-JsFunction *INTERPRETE_create_function(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, int line)
-{
-	JsFunctionList *funclist = MEM_alloc(inter->execute_memory, sizeof(JsFunctionList), line);
-	if (NULL == funclist)
-	{
-		return NULL;
-	}
-	funclist->next = NULL;
-	funclist->func = *func;
-	if (NULL == env->funcs)
-	{
-		env->funcs = funclist;
-	}
-	else
-	{
-		funclist->next = env->funcs;
-		env->funcs = funclist;
-	}
-	return &funclist->func;
-}
-
-void INTERPRETER_check_return_value_free_env_or_push_in_envheap(
-	JsInterpreter *inter,
-	ExecuteEnvironment *env,
-	StatementResult *ret)
-{
-	if (STATEMENT_RESULT_TYPE_RETURN != ret->typ)
-	{
-		INTERPRETER_free_env(inter, env);
-		return;
-	}
-	JsValue value = peek_stack(&inter->stack, 0);
-	char is_object_embed_array = 0;
-	if (JS_VALUE_TYPE_ARRAY == value.typ)
-	{
-		int i = 0;
-		for (; i < value.u.array->length; i++)
-		{
-			if (JS_VALUE_TYPE_OBJECT == value.u.array->elements[i].typ)
-			{
-				is_object_embed_array = 1;
-				if (NULL == value.u.array->elements[i].u.object->env)
-				{
-					value.u.array->elements[i].u.object->env = env;
-				}
-			}
-		}
-	}
-	if (
-		is_object_embed_array == 0 /*no object in a array*/
-		&& JS_VALUE_TYPE_FUNCTION != value.typ && JS_VALUE_TYPE_OBJECT != value.typ)
-	{
-		INTERPRETER_free_env(inter, env);
-		return;
-	}
-	switch (value.typ)
-	{
-	case JS_VALUE_TYPE_FUNCTION:
-		if (NULL == value.u.func->env)
-		{
-			value.u.func->env = env;
-		}
-		break;
-	case JS_VALUE_TYPE_OBJECT:
-		if (NULL == value.u.object->env)
-		{
-			value.u.object->env = env;
-		}
-		break;
-	}
-	/*put env in heap*/
-	if (NULL == inter->heapenv)
-	{
-		inter->heapenv = env;
-	}
-	else
-	{
-		env->next = inter->heapenv;
-		inter->heapenv = env;
-	}
-}
-
-ExecuteEnvironment *
-get_last_not_null_outter_env(ExecuteEnvironment *env)
-{
-	while (NULL != env)
-	{
-		if (NULL == env->outter)
-		{
-			return env;
-		}
-		else
-		{
-			env = env->outter;
-		}
-	}
-	return NULL;
-}
@@ -4,6 +4,10 @@
 
 int INTERPRETE_interprete(JsInterpreter *inter);
 
+int INTERPRETE_execute(JsInterpreter *inter);
+
+void INTERPRETE_finish(JsInterpreter *inter);
+
 StatementResult INTERPRETER_execute_statement(JsInterpreter *inter, ExecuteEnvironment *env, Statement *s);
 
 StatementResult INTERPRETE_execute_statement_for(JsInterpreter *inter, ExecuteEnvironment *env, StatementFor *f, int line);
@@ -14,8 +18,6 @@ StatementResult INTERPRETE_execute_statement_while(JsInterpreter *inter, Execute
 
 StatementResult INTERPRETE_execute_statement_expression(JsInterpreter *inter, ExecuteEnvironment *env, Expression *e);
 
-JsFunction *INTERPRETE_create_function(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, int line);
-
 Variable *
 INTERPRETER_create_variable(
 	JsInterpreter *inter,
@@ -26,18 +28,29 @@ INTERPRETER_create_variable(
 
 void *INTERPRETER_create_heap(JsInterpreter *inter, JS_VALUE_TYPE typ, int size, int line);
 
+/*a heap string whose chars stay where they are,they must be a gc payload*/
+JsString *INTERPRETER_create_string_view(JsInterpreter *inter, char *s, int length, int line);
+
 JsFunction *
 INTERPRETE_search_func_from_function_list(JsFunctionList *list, char *function);
 
+JsValue INTERPRETER_object_keys(JsInterpreter *inter, JsObject *obj, int line);
+
 JsValue INTERPRETER_concat_string(JsInterpreter *inter, const JsValue *v1, const JsValue *v2, int line);
 
+/*free the lists of env,not env itself*/
 void INTERPRETER_free_env(JsInterpreter *inter, ExecuteEnvironment *env);
 
 JsValue *
 INTERPRETE_search_variable_from_env(ExecuteEnvironment *env, char *function);
 
+Variable *
+INTERPRETER_search_variable_in_env(ExecuteEnvironment *env, char *name);
+
 JsValue *INTERPRETE_search_field_from_object(JsObject *obj, const char *key);
 
+JsValue *INTERPRETER_search_field_from_object_include_prototype(JsObject *obj, const char *key);
+
 JsValue *INTERPRETE_create_object_field(JsInterpreter *inter, JsObject *obj, const char *key, JsValue *value, int line);
 
 JsFunction *
@@ -45,15 +58,39 @@ INTERPRETER_search_func_from_env(ExecuteEnvironment *env, char *function);
 
 void INTERPRETE_add_buildin(JsInterpreter *inter);
 
+ExecuteEnvironment *
+INTERPRETER_alloc_frame(JsInterpreter *inter, ExecuteEnvironment *outter, int slots, int line);
+
 ExecuteEnvironment *
 INTERPRETER_alloc_env(JsInterpreter *inter, ExecuteEnvironment *outter, int line);
 
-void INTERPRETE_check_return_value_free_or_push_in_envheap(
+Variable *
+INTERPRETER_bind_slot(ExecuteEnvironment *env, int slot, char *name, JsValue *v);
+
+ExecuteEnvironment *
+INTERPRETER_alloc_cell_env(JsInterpreter *inter, ExecuteEnvironment *outter, int line);
+
+ExecuteEnvironment *
+INTERPRETER_capture_env(ExecuteEnvironment *env);
+
+ExecuteEnvironment *
+INTERPRETER_declare_env(ExecuteEnvironment *env, char captured);
+
+void INTERPRETER_release_env(JsInterpreter *inter, ExecuteEnvironment *env);
+
+ExecuteEnvironment *
+INTERPRETER_alloc_block_env(JsInterpreter *inter, ExecuteEnvironment *outter, char need_env, char has_captured, int line);
+
+void INTERPRETER_leave_block_env(
 	JsInterpreter *inter,
-	ExecuteEnvironment *env,
-	StatementResult *ret);
+	ExecuteEnvironment *outter,
+	ExecuteEnvironment *env);
 
 ExecuteEnvironment *
-get_last_not_null_outter_env(ExecuteEnvironment *env);
+INTERPRETER_alloc_call_env(JsInterpreter *inter, ExecuteEnvironment *caller, JsFunction *func, int line);
+
+JsValue INTERPRETER_create_function_value(JsInterpreter *inter, ExecuteEnvironment *env, JsFunction *func, int line);
+
+StatementResult INTERPRETE_execute_block(JsInterpreter *inter, ExecuteEnvironment *env, Block *block, int line);
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef JS_H
 #define JS_H
 
+#include <ucontext.h>
 #include "memory.h"
 #include "string.h"
 
@@ -10,6 +11,35 @@
 #define BUILD_IN_FUNCTION_MAX_ARGS 10
 
 #define GC_SWEEP_TIMING (5000)
+#define FRAME_ARENA_SIZE (16 * 1024 * 1024)
+#define AST_CHUNK_SIZE (256 * 1024)
+/*address space heap cells are carved from,regions of it are used as needed*/
+#define GC_HEAP_RESERVE (16UL * 1024 * 1024 * 1024)
+#define GC_REGION_SIZE (256 * 1024)
+#define GC_REGION_CELLS (GC_REGION_SIZE / 32) /*no cell is smaller than 32 bytes*/
+#define GC_SPACE_COUNT 8
+#define GC_PAYLOAD_LARGE (GC_REGION_SIZE / 4) /*bigger payloads are malloced and never move*/
+#define GC_COMPACT_BYTES (4 * 1024 * 1024)    /*payload allocated before compacting is worth it*/
+#define GC_MARK_THREADS 8
+#define GC_PARALLEL_REGIONS 64 /*cell regions in use before marking takes more threads*/
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define OUTPUT_DIRECT_SIZE (4 * 1024) /*longer strings are written from where they are*/
+#define OUTPUT_FLOAT_SIZE 512
+#define READER_BLOCK_SIZE GC_PAYLOAD_LARGE /*the largest payload that stays in a region*/
+#define TYPED_ALIGN 64                     /*buffers start on a cache line,any vector load is aligned*/
+#define TYPED_GC_BYTES (16 * 1024 * 1024)  /*buffer bytes that count as a collection worth of allocation*/
+#define LOOP_EVENTS 64                     /*fd events taken from epoll at once*/
+#define LOOP_READ_SIZE (16 * 1024)         /*the most one readFd gives*/
+/*an async call runs on a mapping of its own,only the pages it touches are backed*/
+#define COROUTINE_STACK_SIZE (1024 * 1024) /*c stack*/
+#define COROUTINE_VALUES (32 * 1024)       /*value stack*/
+#define COROUTINE_ARENA_SIZE (512 * 1024)  /*frame arena*/
+#define COROUTINE_POOL 64                  /*finished mappings kept for the next calls*/
+/*a tree built at this fixed address can be written out and mapped back as is*/
+#define AST_IMAGE_BASE (0x3a0000000000UL)
+#define AST_IMAGE_SIZE (1024UL * 1024 * 1024)
+/*slots of a call frame besides the parameters: arguments and this*/
+#define CALL_FRAME_FIXED_SLOTS 2
 #define MAX_INT 2147483647
 
 typedef enum
@@ -29,11 +59,18 @@ typedef enum
     JS_VALUE_TYPE_NULL,
     JS_VALUE_TYPE_UNDEFINED,
     JS_VALUE_TYPE_OBJECT,
-    JS_VALUE_TYPE_STRING_LITERAL
+    JS_VALUE_TYPE_STRING_LITERAL,
+    JS_VALUE_TYPE_MAP, /*Map and Set*/
+    JS_VALUE_TYPE_BUFFER,
+    JS_VALUE_TYPE_TYPED_ARRAY,
+    JS_VALUE_TYPE_PROMISE,
+    JS_VALUE_TYPE_COROUTINE, /*an async call,only reactions hold it,or a generator*/
+    JS_VALUE_TYPE_REGEXP
 } JS_VALUE_TYPE;
 
 typedef struct JsFunction_tag JsFunction;
 typedef struct JsFunctionBuildin_tag JsFunctionBuildin;
+struct JsInterpreter_tag;
 
 typedef struct JsValue_tag JsValue;
 
@@ -43,6 +80,16 @@ typedef struct JsString_tag JsString;
 
 typedef struct JsObject_tag JsObject;
 
+typedef struct JsMap_tag JsMap;
+
+typedef struct JsBuffer_tag JsBuffer;
+typedef struct JsTypedArray_tag JsTypedArray;
+
+typedef struct JsPromise_tag JsPromise;
+typedef struct JsCoroutine_tag JsCoroutine;
+typedef struct JsRegExp_tag JsRegExp;
+typedef struct RegexProg_tag RegexProg; /*a compiled pattern,see regexp.c*/
+
 typedef struct JsKv_tag JsKv;
 typedef struct JsKvList_tag JsKvList;
 
@@ -61,6 +108,12 @@ struct JsValue_tag
         JsArray *array;
         JsString *string;
         JsObject *object;
+        JsMap *map;
+        JsBuffer *buffer;
+        JsTypedArray *typed;
+        JsPromise *promise;
+        JsCoroutine *coroutine;
+        JsRegExp *regexp;
         char *literal_string;
     } u;
 };
@@ -68,8 +121,13 @@ struct JsValue_tag
 struct JsFunctionBuildin_tag
 {
     int args_count;
+    char with_interpreter; /*gets the interpreter and the line,it may allocate*/
+    char with_function;    /*gets the function it was called as too,the env of a bound function holds its state*/
     union {
         JsValue (*func1)(const JsValue *); 
+        JsValue (*inter1)(struct JsInterpreter_tag *, const JsValue *, int);
+        JsValue (*inter2)(struct JsInterpreter_tag *, const JsValue *, const JsValue *, int);
+        JsValue (*bound1)(struct JsInterpreter_tag *, JsFunction *, const JsValue *, int);
     } u;
 };
 
@@ -93,11 +151,9 @@ typedef enum
 
 struct JsObject_tag
 {
-    char mark;
     JS_OBJECT_TYPE typ;
     JsKvList *eles;
     int line;
-    ExecuteEnvironment *env;
 };
 
 struct JsString_tag
@@ -105,7 +161,6 @@ struct JsString_tag
     char *s;
     int length;
     int alloc;
-    char mark;
     int line;
 };
 
@@ -114,7 +169,100 @@ struct JsArray_tag
     JsValue *elements;
     int length;
     int alloc;
-    char mark;
+    int line;
+};
+
+/*a deleted entry keeps its place with key typ 0*/
+typedef struct JsMapEntry_tag
+{
+    JsValue key;
+    JsValue value; /*unused in a set*/
+} JsMapEntry;
+
+/*open addressing over entries kept in insertion order*/
+struct JsMap_tag
+{
+    JsMapEntry *entries;
+    int *slots; /*entry index + 1,0 is empty,-1 was deleted*/
+    int size;   /*entries not deleted*/
+    int used;   /*entries taken,deleted ones too*/
+    int alloc;
+    int mask; /*slots - 1*/
+    char set;
+    int line;
+};
+
+/*bytes of an ArrayBuffer,gc does not look inside*/
+struct JsBuffer_tag
+{
+    char *data; /*TYPED_ALIGN aligned,malloced so it never moves*/
+    char *raw;  /*what was allocated*/
+    int length;
+    int line;
+};
+
+typedef enum
+{
+    JS_TYPED_FLOAT64 = 1,
+    JS_TYPED_INT32,
+    JS_TYPED_UINT8
+} JS_TYPED_TYPE;
+
+/*Float64Array,Int32Array and Uint8Array,a view of elements of a buffer*/
+struct JsTypedArray_tag
+{
+    JS_TYPED_TYPE kind;
+    JsBuffer *buffer;
+    char *data; /*buffer data + offset*/
+    int offset; /*bytes*/
+    int length; /*elements*/
+    int line;
+};
+
+typedef enum
+{
+    JS_PROMISE_PENDING = 0,
+    JS_PROMISE_FULFILLED,
+    JS_PROMISE_REJECTED
+} JS_PROMISE_STATE;
+
+/*what is done once a promise settles,run as a microtask*/
+typedef struct JsReaction_tag
+{
+    JsValue fulfilled; /*handlers,anything not a function passes the value on*/
+    JsValue rejected;
+    JsValue target; /*the promise the handler result settles,or the coroutine awaiting,typ 0 for none*/
+} JsReaction;
+
+struct JsPromise_tag
+{
+    JS_PROMISE_STATE state;
+    char handled; /*a reaction was added,its rejection is not reported*/
+    JsValue value;
+    JsReaction *reactions; /*payload,waiting while pending*/
+    int reaction_count;
+    int reaction_alloc;
+    int line;
+};
+
+/*where a suspended async call goes on,see coroutine.c*/
+typedef struct JsCoroutineState_tag JsCoroutineState;
+
+struct JsCoroutine_tag
+{
+    JsCoroutineState *state; /*NULL once the call ended*/
+    int line;
+};
+
+/*a regular expression,a literal shares the program compiled for its site*/
+struct JsRegExp_tag
+{
+    RegexProg *prog;    /*NULL until it is first matched after a restore*/
+    char *source;
+    char *flags;
+    char owned;         /*prog is freed with the cell*/
+    JsValue last_index; /*where exec and test go on with the g or y flag*/
+    int index;          /*byte offset of the last match*/
     int line;
 };
 
@@ -133,6 +281,7 @@ typedef struct VariableList_tag
 typedef struct IdentifierList_tag
 {
     char *identifier;
+    char captured; /*used by a nested function,set by resolve*/
     struct IdentifierList_tag *next;
 } IdentifierList;
 
@@ -164,6 +313,7 @@ typedef struct
 {
     char *identifier;
     Expression *expression;
+    char captured; /*used by a nested function,set by resolve*/
 } ExpressionCreateLocalVariable;
 
 typedef enum
@@ -201,6 +351,7 @@ typedef struct ExpressionFunctionCall_tag
     char *func;
     ArgumentList *args;
     Expression *e;
+    char tail; /*operand of a return that can reuse the frame,set by resolve*/
 } ExpressionFunctionCall;
 
 typedef struct ExpressionObjectKV_tag
@@ -218,6 +369,14 @@ typedef struct ExpressionObjectKVList_tag
     struct ExpressionObjectKVList_tag *next;
 } ExpressionObjectKVList;
 
+/*a regular expression literal,its program is compiled the first time it is evaluated*/
+typedef struct ExpressionRegExp_tag
+{
+    char *source;
+    char *flags;
+    RegexProg *prog;
+} ExpressionRegExp;
+
 typedef enum
 {
     EXPRESSION_TYPE_BOOL = 1,
@@ -262,7 +421,10 @@ typedef enum
     EXPRESSION_TYPE_NULL,
     EXPRESSION_TYPE_UNDEFINED,
     EXPRESSION_TYPE_NEW,
-    EXPRESSION_TYPE_CREATE_FUNCTION
+    EXPRESSION_TYPE_CREATE_FUNCTION,
+    EXPRESSION_TYPE_AWAIT,
+    EXPRESSION_TYPE_YIELD,
+    EXPRESSION_TYPE_REGEXP
 
 } EXPRESSION_TYPE;
 
@@ -286,6 +448,7 @@ struct Expression_tag
         ExpressionNew *new;
         ExpressionAssignFunction *assign_function;
         ExpressionObjectKVList *object_kv_list;
+        ExpressionRegExp *regexp;
         JsFunction *func;
     } u;
 };
@@ -344,6 +507,8 @@ typedef struct StatementForIn_tag
     char *identifer;
     Expression *target;
     Block *block;
+    char captured; /*loop variable used by a nested function,set by resolve*/
+    char of;       /*for of,the loop variable takes the values*/
 } StatementForIn;
 
 typedef struct
@@ -379,6 +544,7 @@ typedef struct StatementList_tag
 {
     Statement *statement;
     struct StatementList_tag *next;
+    struct StatementList_tag *last; /*tail of the list,kept on the first cell while parsing*/
 } StatementList;
 
 typedef struct StatementSwitchCaseList_tag
@@ -394,11 +560,15 @@ struct StatementSwitch_tag
     Expression *condition;
     StatementSwitchCaseList *list;
     StatementList *defaultpart;
+    char need_env;     /*cases declare something,set by resolve*/
+    char has_captured; /*something declared in cases is captured,set by resolve*/
 };
 
 struct Block_tag
 {
     StatementList *list;
+    char need_env;     /*body declares something or creates a closure,set by resolve*/
+    char has_captured; /*something declared in body is captured,set by resolve*/
 };
 
 typedef enum
@@ -410,11 +580,18 @@ typedef enum
 struct JsFunction_tag
 {
     JS_FUNCTION_TYPE typ;
+    char async; /*a call runs the body as a coroutine and gives a promise*/
+    char generator; /*a call gives a coroutine that runs the body from one next to the next yield*/
     char *name; /*function name*/
     Block *block;
     ParameterList *parameter_list;
     JsFunctionBuildin *buildin;
-    ExecuteEnvironment *env;
+    ExecuteEnvironment *env; /*captured envs of a closure,NULL for plain functions*/
+    char captures;           /*uses variables of enclosing functions,set by resolve*/
+    char name_captured;      /*declared name is used by a nested function,set by resolve*/
+    char uses_this;          /*body refers to this,set by resolve*/
+    char uses_arguments;     /*body refers to arguments,set by resolve*/
+    int parameter_count;     /*set by resolve,sizes the slots of the call frame*/
 };
 
 typedef struct JsFunctionList_tag
@@ -431,15 +608,64 @@ typedef struct Stack_tag
     int alloc; /*total length*/
 } Stack;
 
+/*envs that never escape are bump allocated here and released in bulk*/
+typedef struct FrameArena_tag
+{
+    char *base;
+    char *top;
+    char *limit;
+} FrameArena;
+
+/*
+ * an async call,at the top of its mapping above the c stack.
+ * stack,arena and frames are swapped with those of the interpreter when
+ * it is switched to and back,they hold its own while it is suspended and
+ * the ones of its resumer while it runs.
+ */
+struct JsCoroutineState_tag
+{
+    ucontext_t context; /*where it goes on*/
+    ucontext_t resumer; /*where it goes back to when it awaits or ends*/
+    JsCoroutine *back;  /*coroutine that resumed it,NULL for the program*/
+    Stack stack;
+    FrameArena arena;
+    ExecuteEnvironment *frames;
+    JsValue func; /*what it calls,with the receiver and args_count args on its stack*/
+    JsValue receiver;
+    int args_count;
+    JsValue promise;
+    JsValue value; /*sent in when resumed,the result once done*/
+    char rejected;
+    char done;
+    char *region; /*the mapping*/
+    JsCoroutineState *next; /*pooled*/
+    int line;
+};
+
+/*nodes of the tree are bump allocated from chunks and freed together*/
+typedef struct AstChunk_tag
+{
+    struct AstChunk_tag *next;
+    char *top;
+    char *limit;
+    unsigned long mapped; /*length of the mapping at AST_IMAGE_BASE,0 for chunks from MEM_alloc*/
+} AstChunk;
+
+/*a cell of a gc region*/
 struct Heap_tag
 {
-    struct Heap_tag *prev;
-    struct Heap_tag *next;
     JS_VALUE_TYPE typ;
     union {
         JsString string;
         JsObject object;
         JsArray array;
+        JsFunction function; /*closure*/
+        JsMap map;
+        JsBuffer buffer;
+        JsTypedArray typed;
+        JsPromise promise;
+        JsCoroutine coroutine;
+        JsRegExp regexp;
     } u;
     int line; /*alloc by which line*/
 };
@@ -448,11 +674,134 @@ struct ExecuteEnvironment_tag
 {
     JsFunctionList *funcs;
     VariableList *vars;
-    char mark;
-    struct ExecuteEnvironment_tag *next;   /*for manage in heap*/
-    struct ExecuteEnvironment_tag *outter; /*for js execute*/
+    char in_arena;                          /*lives on the frame arena*/
+    struct ExecuteEnvironment_tag *cells;   /*heap env for captured variables of this scope*/
+    struct ExecuteEnvironment_tag *lexical; /*call env only,where closures made in it continue*/
+    struct ExecuteEnvironment_tag *next;    /*previous frame on arena*/
+    struct ExecuteEnvironment_tag *outter;  /*for js execute*/
 };
 
+typedef enum
+{
+    GC_CLASS_OBJECT, /*Heap*/
+    GC_CLASS_ENV,     /*cell env*/
+    GC_CLASS_PAYLOAD, /*chars,elements and fields of objects,bump allocated*/
+    GC_CLASS_FREE,    /*pages given back,waiting for reuse*/
+    GC_CLASS_COUNT
+} GC_CLASS;
+
+/*cells of one size,their bits live here and not on the pages of the objects*/
+typedef struct GcRegion_tag
+{
+    GC_CLASS klass;
+    char frozen;   /*shared with the jobs of the fork server,never swept*/
+    char evacuate; /*payloads are copied out by the running collection*/
+    char pending;  /*marked but not swept yet*/
+    int cell_size;
+    int cells;
+    int used;   /*cells handed out from the start,the rest was never touched,bytes for payload*/
+    char *free; /*dead cells,chained through their first word*/
+    int next;   /*next free region*/
+    unsigned char live[GC_REGION_CELLS / 8];
+    unsigned char marks[GC_REGION_CELLS / 8];
+} GcRegion;
+
+/*memory with objects gc marks but never frees,a bit per 8 bytes*/
+typedef struct GcSpace_tag
+{
+    char *base;
+    char *limit;
+    unsigned char *marks;
+} GcSpace;
+
+typedef struct GcHeap_tag
+{
+    char *base; /*reserved range,regions follow each other from here*/
+    char *top;
+    char *limit;
+    GcRegion *regions; /*one per GC_REGION_SIZE from base*/
+    int region_alloc;
+    int current[GC_CLASS_COUNT]; /*regions before are full*/
+    int free_regions;            /*-1 for none*/
+    int payload;                 /*region payloads are bumped from,-1 for none*/
+    char compacting;
+    unsigned long payload_bytes; /*allocated since the last compaction*/
+    unsigned long payload_live;  /*left by the last compaction*/
+    unsigned long buffer_bytes;  /*malloced for buffers since they last asked for a collection*/
+    int threads;                 /*markers of a big heap*/
+    char parallel;               /*markers are running side by side*/
+    GcSpace spaces[GC_SPACE_COUNT];
+    int space_count;
+} GcHeap;
+
+/*console output waiting for one write*/
+typedef struct JsOutput_tag
+{
+    int fd;
+    char line_buffered; /*written at each line end,for a terminal*/
+    int length;
+    char buf[OUTPUT_BUFFER_SIZE];
+} JsOutput;
+
+/*a file read a block at a time,lines are handed out of the block*/
+typedef struct JsReader_tag
+{
+    int fd; /*-1 when closed*/
+    char eof;
+    char *block; /*lines handed out may point into it*/
+    int size;
+    int start; /*first byte not handed out*/
+    int end;
+    int scan; /*no line end between start and scan*/
+} JsReader;
+
+/*a setTimeout or setInterval,the timers are a heap on due time*/
+typedef struct JsTimer_tag
+{
+    long due; /*ms of the monotonic clock*/
+    long seq; /*timers due at once run in the order they were set*/
+    int id;
+    int interval; /*0 for a timeout*/
+    JsValue func;
+} JsTimer;
+
+/*a microtask,func(arg),or a reaction to a promise that settled with arg*/
+typedef struct JsJob_tag
+{
+    JsValue func;
+    JsValue arg;
+    JsValue target; /*typ 0 for a plain call,see JsReaction*/
+    char rejected;
+} JsJob;
+
+/*the callbacks waiting on a file descriptor,undefined when not waiting*/
+typedef struct JsWatch_tag
+{
+    int fd;
+    JsValue readable;
+    JsValue writable;
+} JsWatch;
+
+typedef struct JsLoop_tag
+{
+    JsTimer *timers;
+    int timer_count;
+    int timer_alloc;
+    int timer_id; /*the last id given out*/
+    long timer_seq;
+    JsJob *jobs; /*a ring*/
+    int job_head;
+    int job_count;
+    int job_alloc;
+    JsWatch *watches;
+    int watch_count;
+    int watch_alloc;
+    int epoll; /*-1 while nothing is watched*/
+    JsValue *rejections; /*promises rejected with no reaction,reported once the microtasks ran*/
+    int rejection_count;
+    int rejection_alloc;
+} JsLoop;
+
 /*runtime struct*/
 typedef struct JsInterpreter_tag
 {
@@ -462,8 +811,25 @@ typedef struct JsInterpreter_tag
     VariableList *vars;
     Stack stack;
     ExecuteEnvironment env;
-    Heap *heap; /*header heap is not use*/
-    ExecuteEnvironment *heapenv;
+    FrameArena arena;
+    ExecuteEnvironment *frames; /*innermost env on arena*/
+    JsFunction *tail_func;      /*pending tail call,callee and args are on the stack*/
+    int tail_argc;
+    AstChunk *ast; /*chunk nodes are allocated from,older chunks follow*/
+    GcHeap gc;
+    JsOutput output; /*console.log goes here*/
+    JsReader *readers; /*0 is stdin*/
+    int reader_count;
+    int reader_alloc;
+    JsValue typed_value;       /*stands in for a typed array element being assigned*/
+    JsTypedArray *typed_dest;  /*where typed_value goes*/
+    int typed_index;
+    JsLoop loop; /*timers,microtasks and fds run after the program*/
+    JsCoroutine *coroutine;          /*async call running,NULL for the program*/
+    JsCoroutineState *coroutine_pool; /*mappings of ended calls*/
+    int coroutine_pooled;
+    int coroutine_mapped; /*mappings there are,pooled ones too*/
+    int coroutine_taken;  /*mappings taken since gc was last asked for*/
 } JsInterpreter;
 
 typedef enum
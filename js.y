@@ -4,6 +4,8 @@
 #define YYDEBUG 1
 #include "message.h"
 #include "util.h"
+#include "create.h"
+#include "lex.h"
 %}
 %union {
     char                *identifier;
@@ -23,13 +25,14 @@
 %token <expression>     INT_LITERAL
 %token <expression>     DOUBLE_LITERAL
 %token <expression>     STRING_LITERAL
+%token <expression>     REGEXP_LITERAL
 %token <identifier>     IDENTIFIER
 %token FUNCTION IF ELSE ELSIF WHILE FOR RETURN_T BREAK CONTINUE NULL_T COLON NEW IN 
         PLUS_ASSIGN MINUS_ASSIGN   MUL_ASSIGN DIV_ASSIGN MOD_ASSIGN
         LOGICAL_OR TYPEOF DO NOT SWITCH CASE  DEFAULT
         LP RP LC RC LB RB SEMICOLON COMMA ASSIGN LOGICAL_AND 
         EQ NE GT GE LT LE ADD SUB MUL DIV MOD TRUE_T FALSE_T DOT VAR
-        INCREMENT DECREMENT
+        INCREMENT DECREMENT ASYNC AWAIT YIELD OF
 %type   <parameter_list> parameter_list
 %type   <argument_list> argument_list
 %type   <expression> expression expression_opt object_literal new_object
@@ -74,6 +77,30 @@ function_definition
            Expression* e = CREATE_function_expression($2, NULL, $5);
            $$ = CREATE_expression_statement(e);
         }
+        | ASYNC FUNCTION IDENTIFIER LP parameter_list RP block
+        {
+            Expression* e = CREATE_function_expression($3, $5, $7);
+            CREATE_async_function(e->u.func);
+            $$ = CREATE_expression_statement(e);
+        }
+        | ASYNC FUNCTION IDENTIFIER LP RP block
+        {
+            Expression* e = CREATE_function_expression($3, NULL, $6);
+            CREATE_async_function(e->u.func);
+            $$ = CREATE_expression_statement(e);
+        }
+        | FUNCTION MUL IDENTIFIER LP parameter_list RP block
+        {
+            Expression* e = CREATE_function_expression($3, $5, $7);
+            CREATE_generator_function(e->u.func);
+            $$ = CREATE_expression_statement(e);
+        }
+        | FUNCTION MUL IDENTIFIER LP RP block
+        {
+            Expression* e = CREATE_function_expression($3, NULL, $6);
+            CREATE_generator_function(e->u.func);
+            $$ = CREATE_expression_statement(e);
+        }
         ;
 
 function_noname_definition
@@ -85,6 +112,22 @@ function_noname_definition
     {
         $$ = CREATE_function(NULL, $3, $5);
     }
+    |ASYNC FUNCTION LP RP block
+    {
+        $$ = CREATE_async_function(CREATE_function(NULL, NULL, $5));
+    }
+    |ASYNC FUNCTION LP parameter_list RP block
+    {
+        $$ = CREATE_async_function(CREATE_function(NULL, $4, $6));
+    }
+    |FUNCTION MUL LP RP block
+    {
+        $$ = CREATE_generator_function(CREATE_function(NULL, NULL, $5));
+    }
+    |FUNCTION MUL LP parameter_list RP block
+    {
+        $$ = CREATE_generator_function(CREATE_function(NULL, $4, $6));
+    }
     ;
 
 parameter_list
@@ -114,6 +157,10 @@ statement
     {
         $$ = CREATE_expression_statement($1);
     }
+    |YIELD SEMICOLON
+    {
+        $$ = CREATE_expression_statement(CREATE_yield_expression(NULL));
+    }
     |postfix_expression ASSIGN function_noname_definition
     {
     	Expression* e = CREATE_assign_function_expression($1,NULL,$3);
@@ -233,6 +280,14 @@ for_statement
     {
 		$$ = CREATE_for_in_statement($3,$5,$7);
     }
+    | FOR LP VAR IDENTIFIER OF expression RP block_or_statement
+    {
+        $$ = CREATE_for_of_statement($4,$6,$8);
+    }
+    |FOR LP IDENTIFIER OF expression RP block_or_statement
+    {
+        $$ = CREATE_for_of_statement($3,$5,$7);
+    }
     ;
 return_statement
     :RETURN_T expression_opt SEMICOLON
@@ -288,6 +343,10 @@ expression_list
         ;
 expression
     :logical_or_expression
+    |YIELD expression
+    {
+        $$ = CREATE_yield_expression($2);
+    }
     |postfix_expression ASSIGN expression
     {
         $$ = CREATE_assign_expression($1, $3);
@@ -404,6 +463,10 @@ unary_expression
     {
 		$$ = CREATE_not_expression($2);
     }
+    | AWAIT unary_expression
+    {
+        $$ = CREATE_await_expression($2);
+    }
     ;
 postfix_expression
     :primary_expression
@@ -423,6 +486,14 @@ postfix_expression
     {
         $$ = CREATE_method_call_expression($1, $3, NULL);
     }
+    |postfix_expression DOT RETURN_T LP argument_list RP
+    {
+        $$ = CREATE_method_call_expression($1, CREATE_identifier("return"), $5);
+    }
+    |postfix_expression DOT RETURN_T LP RP
+    {
+        $$ = CREATE_method_call_expression($1, CREATE_identifier("return"), NULL);
+    }
     |postfix_expression INCREMENT
     {
         $$ = CREATE_incdec_expression($1, EXPRESSION_TYPE_INCREMENT);
@@ -471,6 +542,7 @@ primary_expression
         | INT_LITERAL
         | DOUBLE_LITERAL
         | STRING_LITERAL
+        | REGEXP_LITERAL
         | TRUE_T
         {
             $$ = CREATE_boolean_expression(JS_BOOL_TRUE);
@@ -489,7 +561,7 @@ primary_expression
         | TYPEOF expression
         {
         	ExpressionList* args = CREATE_argument_list($2);
-			$$ = CREATE_function_call_expression("typeof",NULL, args);
+			$$ = CREATE_function_call_expression(CREATE_identifier("typeof"),NULL, args);
         }
         | function_noname_definition
 	    {
@@ -4,6 +4,10 @@
 #include <stdarg.h>
 #include "interprete.h"
 #include "error.h"
+#include "output.h"
+#include "util.h"
+#include "typed.h"
+#include "regexp.h"
 #include <stdlib.h>
 
 JSBool is_js_value_true(const JsValue *v)
@@ -57,7 +61,9 @@ JSBool is_js_value_true(const JsValue *v)
 			return JS_BOOL_TRUE;
 		}
 	}
-	if (JS_VALUE_TYPE_OBJECT == v->typ)
+	if (JS_VALUE_TYPE_OBJECT == v->typ || JS_VALUE_TYPE_MAP == v->typ || JS_VALUE_TYPE_BUFFER == v->typ ||
+		JS_VALUE_TYPE_TYPED_ARRAY == v->typ || JS_VALUE_TYPE_PROMISE == v->typ || JS_VALUE_TYPE_COROUTINE == v->typ ||
+		JS_VALUE_TYPE_REGEXP == v->typ)
 	{
 		return JS_BOOL_TRUE;
 	}
@@ -206,6 +212,7 @@ JsValue js_to_string(JsInterpreter *inter, const JsValue *value, int line)
 	switch (value->typ)
 	{
 	case JS_VALUE_TYPE_BOOL:
+		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
 		if (JS_BOOL_TRUE == value->u.boolvalue)
 		{
 			v.u.literal_string = "true";
@@ -249,6 +256,29 @@ JsValue js_to_string(JsInterpreter *inter, const JsValue *value, int line)
 		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
 		v.u.literal_string = "object";
 		break;
+	case JS_VALUE_TYPE_MAP:
+		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
+		v.u.literal_string = 0 != value->u.map->set ? "set" : "map";
+		break;
+	case JS_VALUE_TYPE_BUFFER:
+		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
+		v.u.literal_string = "arraybuffer";
+		break;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
+		v.u.literal_string = "typedarray";
+		break;
+	case JS_VALUE_TYPE_PROMISE:
+		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
+		v.u.literal_string = "promise";
+		break;
+	case JS_VALUE_TYPE_COROUTINE: /*only generators are seen by the program*/
+		v.typ = JS_VALUE_TYPE_STRING_LITERAL;
+		v.u.literal_string = "generator";
+		break;
+	case JS_VALUE_TYPE_REGEXP:
+		v = REGEXP_to_string(inter, value->u.regexp, line);
+		break;
 	}
 	return v;
 }
@@ -395,6 +425,12 @@ double js_value_to_double(const JsValue *v)
 		d = 0.0;
 		break;
 	case JS_VALUE_TYPE_OBJECT:
+	case JS_VALUE_TYPE_MAP:
+	case JS_VALUE_TYPE_BUFFER:
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+	case JS_VALUE_TYPE_PROMISE:
+	case JS_VALUE_TYPE_COROUTINE:
+	case JS_VALUE_TYPE_REGEXP:
 		d = 1.0;
 		break;
 	case JS_VALUE_TYPE_STRING_LITERAL:
@@ -530,6 +566,34 @@ JSBool js_value_equal(const JsValue *v1, const JsValue *v2)
 		{
 			return JS_BOOL_FALSE;
 		}
+	case JS_VALUE_TYPE_MAP:
+		if (v1->u.map == v2->u.map)
+		{
+			return JS_BOOL_TRUE;
+		}
+		else
+		{
+			return JS_BOOL_FALSE;
+		}
+	case JS_VALUE_TYPE_BUFFER:
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+	case JS_VALUE_TYPE_PROMISE:
+	case JS_VALUE_TYPE_COROUTINE:
+	case JS_VALUE_TYPE_REGEXP:
+	case JS_VALUE_TYPE_FUNCTION:
+		if (v1->u.object == v2->u.object)
+		{
+			return JS_BOOL_TRUE;
+		}
+		else
+		{
+			return JS_BOOL_FALSE;
+		}
+	case JS_VALUE_TYPE_NULL:
+	case JS_VALUE_TYPE_UNDEFINED:
+		return JS_BOOL_TRUE;
+	case JS_VALUE_TYPE_STRING: /*compared as strings above*/
+	case JS_VALUE_TYPE_STRING_LITERAL:
 	default:
 		return JS_BOOL_FALSE;
 	}
@@ -687,97 +751,175 @@ JSBool js_value_greater_or_equal(const JsValue *v1, const JsValue *v2)
 	return JS_BOOL_FALSE;
 }
 
-void js_print_object(JsObject *object)
+void js_write_object(JsOutput *out, JsObject *object)
 {
-	printf("object:{");
+	OUTPUT_write(out, "object:{", 8);
 	JsKvList *eles = object->eles;
 	while (NULL != eles)
 	{
-		printf("%s:", eles->kv.key);
-		js_print(&eles->kv.value);
-		printf(" ");
+		OUTPUT_string(out, eles->kv.key);
+		OUTPUT_write(out, ":", 1);
+		js_write_value(out, &eles->kv.value);
+		OUTPUT_write(out, " ", 1);
 		eles = eles->next;
 	}
-	printf("}");
+	OUTPUT_write(out, "}", 1);
 }
 
-JsValue js_print(const JsValue *value)
+/*map:{key:value } and set:{value },in insertion order*/
+void js_write_map(JsOutput *out, JsMap *map)
+{
+	int i;
+	if (0 != map->set)
+	{
+		OUTPUT_write(out, "set:{", 5);
+	}
+	else
+	{
+		OUTPUT_write(out, "map:{", 5);
+	}
+	for (i = 0; i < map->used; i++)
+	{
+		if (0 == map->entries[i].key.typ)
+		{
+			continue;
+		}
+		js_write_value(out, &map->entries[i].key);
+		if (0 == map->set)
+		{
+			OUTPUT_write(out, ":", 1);
+			js_write_value(out, &map->entries[i].value);
+		}
+		OUTPUT_write(out, " ", 1);
+	}
+	OUTPUT_write(out, "}", 1);
+}
+
+/*like an array of its numbers*/
+void js_write_typed(JsOutput *out, JsTypedArray *typed)
+{
+	JsValue v;
+	int i;
+	if (0 == typed->length)
+	{
+		return;
+	}
+	OUTPUT_write(out, "[", 1);
+	for (i = 0; i < typed->length; i++)
+	{
+		TYPED_get(typed, i, &v);
+		js_write_value(out, &v);
+		if (i < typed->length - 1)
+		{
+			OUTPUT_write(out, ",", 1);
+		}
+	}
+	OUTPUT_write(out, "]", 1);
+}
+
+void js_write_value(JsOutput *out, const JsValue *value)
 {
-	JsValue v = *value;
 	switch (value->typ)
 	{
 	case JS_VALUE_TYPE_BOOL:
 		if (JS_BOOL_TRUE == value->u.boolvalue)
 		{
-			printf("true");
+			OUTPUT_write(out, "true", 4);
 		}
 		else
 		{
-			printf("false");
+			OUTPUT_write(out, "false", 5);
 		}
 		break;
 	case JS_VALUE_TYPE_INT:
-		printf("%d", value->u.intvalue);
+		OUTPUT_int(out, value->u.intvalue);
 		break;
 	case JS_VALUE_TYPE_FLOAT:
-		printf("%f", value->u.floatvalue);
+		OUTPUT_float(out, value->u.floatvalue);
 		break;
 	case JS_VALUE_TYPE_STRING:
-		printf("%s", value->u.string->s);
+		OUTPUT_string(out, value->u.string->s);
 		break;
 	case JS_VALUE_TYPE_NULL:
-		printf("null");
+		OUTPUT_write(out, "null", 4);
 		break;
 	case JS_VALUE_TYPE_UNDEFINED:
-		printf("undefined");
+		OUTPUT_write(out, "undefined", 9);
 		break;
 	case JS_VALUE_TYPE_ARRAY:
-		js_print_array(value->u.array);
+		js_write_array(out, value->u.array);
 		break;
 	case JS_VALUE_TYPE_FUNCTION:
 		if (NULL == value->u.func->name)
 		{
-			printf("function");
+			OUTPUT_write(out, "function", 8);
 		}
 		else
 		{
-			printf("function:%s", value->u.func->name);
+			OUTPUT_write(out, "function:", 9);
+			OUTPUT_string(out, value->u.func->name);
 		}
 		break;
 	case JS_VALUE_TYPE_OBJECT:
-		js_print_object(value->u.object);
+		js_write_object(out, value->u.object);
+		break;
+	case JS_VALUE_TYPE_MAP:
+		js_write_map(out, value->u.map);
+		break;
+	case JS_VALUE_TYPE_BUFFER:
+		OUTPUT_write(out, "arraybuffer:", 12);
+		OUTPUT_int(out, value->u.buffer->length);
+		break;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		js_write_typed(out, value->u.typed);
+		break;
+	case JS_VALUE_TYPE_PROMISE:
+		OUTPUT_write(out, "promise", 7);
+		break;
+	case JS_VALUE_TYPE_COROUTINE:
+		OUTPUT_write(out, "generator", 9);
+		break;
+	case JS_VALUE_TYPE_REGEXP:
+		OUTPUT_write(out, "/", 1);
+		OUTPUT_string(out, value->u.regexp->source);
+		OUTPUT_write(out, "/", 1);
+		OUTPUT_string(out, value->u.regexp->flags);
 		break;
 	case JS_VALUE_TYPE_STRING_LITERAL:
-		printf("%s", value->u.literal_string);
+		OUTPUT_string(out, value->u.literal_string);
 	}
-	return v;
 }
 
-void js_print_array(JsArray *array)
+void js_write_array(JsOutput *out, JsArray *array)
 {
 	if (NULL == array || 0 == array->length)
 	{
 		return;
 	}
 	int i;
-	printf("[");
+	OUTPUT_write(out, "[", 1);
 	for (i = 0; i < array->length; i++)
 	{
-		js_print(array->elements + i);
+		js_write_value(out, array->elements + i);
 		if (i < array->length - 1)
 		{
-			printf(",");
+			OUTPUT_write(out, ",", 1);
 		}
 	}
-	printf("]");
+	OUTPUT_write(out, "]", 1);
+}
+
+/*to the console of the running interpreter*/
+JsValue js_print(const JsValue *value)
+{
+	js_write_value(&current_interpreter->output, value);
+	return *value;
 }
 
 JsValue js_println(const JsValue *value)
 {
-	JsValue v;
-	v.typ = JS_VALUE_TYPE_NULL;
-	v = js_print(value);
-	printf("\n");
+	JsValue v = js_print(value);
+	OUTPUT_newline(&current_interpreter->output);
 	return v;
 }
 
@@ -814,6 +956,24 @@ JsValue js_typeof(const JsValue *value)
 	case JS_VALUE_TYPE_OBJECT:
 		v.u.literal_string = "object";
 		break;
+	case JS_VALUE_TYPE_MAP:
+		v.u.literal_string = 0 != value->u.map->set ? "set" : "map";
+		break;
+	case JS_VALUE_TYPE_BUFFER:
+		v.u.literal_string = "arraybuffer";
+		break;
+	case JS_VALUE_TYPE_TYPED_ARRAY:
+		v.u.literal_string = "typedarray";
+		break;
+	case JS_VALUE_TYPE_PROMISE:
+		v.u.literal_string = "promise";
+		break;
+	case JS_VALUE_TYPE_COROUTINE:
+		v.u.literal_string = "generator";
+		break;
+	case JS_VALUE_TYPE_REGEXP:
+		v.u.literal_string = "regexp";
+		break;
 	case JS_VALUE_TYPE_STRING_LITERAL:
 		v.u.literal_string = "string_literal";
 	}
@@ -20,6 +20,8 @@ JsValue js_value_div(const JsValue *v1, const JsValue *v2);
 
 JsValue js_value_sub(const JsValue *v1, const JsValue *v2);
 
+double js_value_to_double(const JsValue *v);
+
 JSBool js_value_equal(const JsValue *v1, const JsValue *v2);
 
 JSBool js_value_greater(const JsValue *v1, const JsValue *v2);
@@ -29,7 +31,8 @@ JSBool js_value_greater_or_equal(const JsValue *v1, const JsValue *v2);
 JsValue js_print(const JsValue *value);
 JsValue js_println(const JsValue *value);
 
-void js_print_array(JsArray *array);
+void js_write_value(JsOutput *out, const JsValue *value);
+void js_write_array(JsOutput *out, JsArray *array);
 
 JsValue js_to_string(JsInterpreter *inter, const JsValue *value, int line);
 
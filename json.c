@@ -0,0 +1,914 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "js.h"
+#include "error.h"
+#include "heap.h"
+#include "interprete.h"
+#include "json.h"
+#include "typed.h"
+
+/*
+ * JSON.parse and JSON.stringify.
+ * the parser builds strings,arrays and objects on the heap while it reads,
+ * there is no tree in between. most bytes of a document are in strings or
+ * in the white space between tokens,both are scanned 16 bytes at a time
+ * with sse2,a plain loop does the rest and machines without it.
+ * gc only runs between statements,what is built so far needs no roots.
+ * stringify appends to one growing buffer that ends up as a heap string.
+ */
+
+#define JSON_MAX_DEPTH 4096
+#define JSON_WHO_SIZE 64
+#define JSON_BUFFER_SIZE 4096
+
+JsFunctionBuildin json_parse_buildin;
+JsFunction json_parse_function;
+JsKvList json_parse;
+JsFunctionBuildin json_stringify_buildin;
+JsFunction json_stringify_function;
+JsKvList json_stringify;
+JsObject json_object;
+VariableList json_var_list;
+
+typedef struct
+{
+    JsInterpreter *inter;
+    const char *start;
+    const char *p;
+    const char *end;
+    int line;
+    int depth;
+    JsValue *values; /*elements of the arrays being read,nested ones above*/
+    int count;
+    int alloc;
+} JsonParser;
+
+typedef struct
+{
+    JsInterpreter *inter;
+    int line;
+    int depth;
+    char *buf;
+    int length;
+    int alloc;
+    JsKvList **fields; /*fields of the objects being written,newest first like in eles*/
+    int field_count;
+    int field_alloc;
+} JsonWriter;
+
+/*first byte from p that is a quote,a backslash or a control char,end when none*/
+const char *json_scan_string(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    __m128i v;
+    int mask;
+    while (end - p >= 16)
+    {
+        v = _mm_loadu_si128((const __m128i *)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                              _mm_cmpeq_epi8(_mm_min_epu8(v, control), v)));
+        if (0 != mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && '"' != *p && '\\' != *p && (unsigned char)*p >= 0x20)
+    {
+        p++;
+    }
+    return p;
+}
+
+int json_space(char c)
+{
+    return ' ' == c || '\n' == c || '\r' == c || '\t' == c;
+}
+
+/*usually no space or one,runs of indentation go by 16 at a time*/
+const char *json_skip_space(const char *p, const char *end)
+{
+#ifdef __SSE2__
+    __m128i v;
+    int mask;
+#endif
+    if (p == end || !json_space(*p))
+    {
+        return p;
+    }
+#ifdef __SSE2__
+    while (end - p >= 16)
+    {
+        v = _mm_loadu_si128((const __m128i *)p);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                                              _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')))));
+        if (0xffff != mask)
+        {
+            return p + __builtin_ctz(~mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && json_space(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+void json_error(JsonParser *parser, char *what)
+{
+    char who[JSON_WHO_SIZE];
+    snprintf(who, sizeof(who), "JSON.parse,%s at %d", what, (int)(parser->p - parser->start));
+    ERROR_runtime_error(RUNTIME_ERROR_INVALID_JSON, who, parser->line);
+}
+
+void json_enter(JsonParser *parser)
+{
+    if (++parser->depth > JSON_MAX_DEPTH)
+    {
+        json_error(parser, "too deep");
+    }
+}
+
+/*the closing quote of the string whose chars start at p,*escaped when it has escapes*/
+const char *json_string_end(JsonParser *parser, const char *p, int *escaped)
+{
+    *escaped = 0;
+    for (;;)
+    {
+        p = json_scan_string(p, parser->end);
+        if (p >= parser->end)
+        {
+            json_error(parser, "unterminated string");
+        }
+        if ('"' == *p)
+        {
+            return p;
+        }
+        if ('\\' != *p)
+        {
+            parser->p = p;
+            json_error(parser, "control char in string");
+        }
+        *escaped = 1;
+        p += 2; /*the escaped char is checked while decoding*/
+    }
+}
+
+unsigned int json_hex4(JsonParser *parser, const char *p, const char *close)
+{
+    unsigned int c = 0;
+    int i;
+    if (close - p < 4)
+    {
+        parser->p = p;
+        json_error(parser, "bad unicode escape");
+    }
+    for (i = 0; i < 4; i++)
+    {
+        c <<= 4;
+        if (p[i] >= '0' && p[i] <= '9')
+        {
+            c |= p[i] - '0';
+        }
+        else if ((p[i] | 0x20) >= 'a' && (p[i] | 0x20) <= 'f')
+        {
+            c |= (p[i] | 0x20) - 'a' + 10;
+        }
+        else
+        {
+            parser->p = p;
+            json_error(parser, "bad unicode escape");
+        }
+    }
+    return c;
+}
+
+int json_utf8(char *d, unsigned int c)
+{
+    if (c < 0x80)
+    {
+        d[0] = c;
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        d[0] = 0xc0 | c >> 6;
+        d[1] = 0x80 | (c & 0x3f);
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        d[0] = 0xe0 | c >> 12;
+        d[1] = 0x80 | (c >> 6 & 0x3f);
+        d[2] = 0x80 | (c & 0x3f);
+        return 3;
+    }
+    d[0] = 0xf0 | c >> 18;
+    d[1] = 0x80 | (c >> 12 & 0x3f);
+    d[2] = 0x80 | (c >> 6 & 0x3f);
+    d[3] = 0x80 | (c & 0x3f);
+    return 4;
+}
+
+/*chars from p to close with escapes undone,escapes never get longer*/
+int json_decode(JsonParser *parser, const char *p, const char *close, char *dest)
+{
+    char *d = dest;
+    const char *run;
+    unsigned int c;
+    unsigned int low;
+    while (p < close)
+    {
+        run = json_scan_string(p, close);
+        memcpy(d, p, run - p);
+        d += run - p;
+        if (run == close)
+        {
+            break;
+        }
+        p = run + 2;
+        switch (run[1])
+        {
+        case '"':
+        case '\\':
+        case '/':
+            *d++ = run[1];
+            break;
+        case 'b':
+            *d++ = '\b';
+            break;
+        case 'f':
+            *d++ = '\f';
+            break;
+        case 'n':
+            *d++ = '\n';
+            break;
+        case 'r':
+            *d++ = '\r';
+            break;
+        case 't':
+            *d++ = '\t';
+            break;
+        case 'u':
+            c = json_hex4(parser, p, close);
+            p += 4;
+            if (c >= 0xd800 && c < 0xdc00 && close - p >= 6 && '\\' == p[0] && 'u' == p[1])
+            { /*a surrogate pair is one char*/
+                low = json_hex4(parser, p + 2, close);
+                if (low >= 0xdc00 && low < 0xe000)
+                {
+                    c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+                    p += 6;
+                }
+            }
+            d += json_utf8(d, c);
+            break;
+        default:
+            parser->p = run;
+            json_error(parser, "bad escape");
+        }
+    }
+    return d - dest;
+}
+
+void json_read_value(JsonParser *parser, JsValue *v);
+
+void json_read_string(JsonParser *parser, JsValue *v)
+{
+    int escaped;
+    const char *close = json_string_end(parser, parser->p + 1, &escaped);
+    int length = close - parser->p - 1;
+    JsString *s = INTERPRETER_create_heap(parser->inter, JS_VALUE_TYPE_STRING, length + 1, parser->line);
+    if (0 != escaped)
+    {
+        length = json_decode(parser, parser->p + 1, close, s->s);
+    }
+    else
+    {
+        memcpy(s->s, parser->p + 1, length);
+    }
+    s->s[length] = 0;
+    s->length = length;
+    v->typ = JS_VALUE_TYPE_STRING;
+    v->u.string = s;
+    parser->p = close + 1;
+}
+
+void json_push(JsonParser *parser, JsValue *v)
+{
+    JsValue *values;
+    if (parser->count == parser->alloc)
+    {
+        values = (JsValue *)MEM_alloc(parser->inter->execute_memory, sizeof(JsValue) * (parser->alloc * 2 + 64), parser->line);
+        if (NULL == values)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "JSON.parse", parser->line);
+        }
+        if (NULL != parser->values)
+        {
+            memcpy(values, parser->values, sizeof(JsValue) * parser->count);
+            MEM_free(parser->inter->execute_memory, (char *)parser->values);
+        }
+        parser->values = values;
+        parser->alloc = parser->alloc * 2 + 64;
+    }
+    parser->values[parser->count++] = *v;
+}
+
+/*elements are gathered first,the array is made once at its size*/
+void json_read_array(JsonParser *parser, JsValue *v)
+{
+    int base = parser->count;
+    JsValue element;
+    JsArray *array;
+    json_enter(parser);
+    parser->p = json_skip_space(parser->p + 1, parser->end);
+    if (parser->p < parser->end && ']' == *parser->p)
+    {
+        parser->p++;
+    }
+    else
+    {
+        for (;;)
+        {
+            json_read_value(parser, &element);
+            json_push(parser, &element);
+            parser->p = json_skip_space(parser->p, parser->end);
+            if (parser->p < parser->end && ',' == *parser->p)
+            {
+                parser->p++;
+                continue;
+            }
+            if (parser->p < parser->end && ']' == *parser->p)
+            {
+                parser->p++;
+                break;
+            }
+            json_error(parser, "expected , or ]");
+        }
+    }
+    array = INTERPRETER_create_heap(parser->inter, JS_VALUE_TYPE_ARRAY, parser->count - base, parser->line);
+    if (parser->count > base)
+    {
+        memcpy(array->elements, parser->values + base, sizeof(JsValue) * (parser->count - base));
+    }
+    array->length = parser->count - base;
+    parser->count = base;
+    parser->depth--;
+    v->typ = JS_VALUE_TYPE_ARRAY;
+    v->u.array = array;
+}
+
+/*
+ * a field node is made with its key decoded behind it,as a script would set it.
+ * fields go in front like those set by a script,a repeated key keeps the
+ * field it had and takes the last value.
+ */
+void json_read_object(JsonParser *parser, JsValue *v)
+{
+    JsObject *object = INTERPRETER_create_heap(parser->inter, JS_VALUE_TYPE_OBJECT, 0, parser->line);
+    JsKvList *field;
+    JsKvList *same;
+    const char *close;
+    int escaped;
+    int length;
+    json_enter(parser);
+    object->typ = JS_OBJECT_TYPE_USER;
+    v->typ = JS_VALUE_TYPE_OBJECT;
+    v->u.object = object;
+    parser->p = json_skip_space(parser->p + 1, parser->end);
+    if (parser->p < parser->end && '}' == *parser->p)
+    {
+        parser->p++;
+        parser->depth--;
+        return;
+    }
+    for (;;)
+    {
+        if (parser->p == parser->end || '"' != *parser->p)
+        {
+            json_error(parser, "expected key");
+        }
+        close = json_string_end(parser, parser->p + 1, &escaped);
+        length = close - parser->p - 1;
+        field = (JsKvList *)gc_payload_alloc(parser->inter, sizeof(JsKvList) + length + 1, parser->line);
+        field->kv.key = (char *)(field + 1);
+        if (0 != escaped)
+        {
+            length = json_decode(parser, parser->p + 1, close, field->kv.key);
+        }
+        else
+        {
+            memcpy(field->kv.key, parser->p + 1, length);
+        }
+        field->kv.key[length] = 0;
+        parser->p = json_skip_space(close + 1, parser->end);
+        if (parser->p == parser->end || ':' != *parser->p)
+        {
+            json_error(parser, "expected :");
+        }
+        parser->p++;
+        json_read_value(parser, &field->kv.value);
+        for (same = object->eles; NULL != same; same = same->next)
+        {
+            if (0 == strcmp(same->kv.key, field->kv.key))
+            {
+                same->kv.value = field->kv.value;
+                break;
+            }
+        }
+        if (NULL == same)
+        {
+            field->next = object->eles;
+            object->eles = field;
+        }
+        parser->p = json_skip_space(parser->p, parser->end);
+        if (parser->p < parser->end && ',' == *parser->p)
+        {
+            parser->p = json_skip_space(parser->p + 1, parser->end);
+            continue;
+        }
+        if (parser->p < parser->end && '}' == *parser->p)
+        {
+            parser->p++;
+            break;
+        }
+        json_error(parser, "expected , or }");
+    }
+    parser->depth--;
+}
+
+const char *json_digits(const char *p, const char *end)
+{
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        p++;
+    }
+    return p;
+}
+
+/*an int when it is one and fits,else a float*/
+void json_read_number(JsonParser *parser, JsValue *v)
+{
+    const char *p = parser->p;
+    const char *digits;
+    const char *q;
+    long long value = 0;
+    char is_float = 0;
+    if (p < parser->end && '-' == *p)
+    {
+        p++;
+    }
+    digits = p;
+    p = json_digits(p, parser->end);
+    if (p == digits || ('0' == *digits && p - digits > 1))
+    {
+        json_error(parser, "bad number");
+    }
+    if (p < parser->end && '.' == *p)
+    {
+        q = json_digits(p + 1, parser->end);
+        if (q == p + 1)
+        {
+            json_error(parser, "bad number");
+        }
+        p = q;
+        is_float = 1;
+    }
+    if (p < parser->end && ('e' == *p || 'E' == *p))
+    {
+        p++;
+        if (p < parser->end && ('+' == *p || '-' == *p))
+        {
+            p++;
+        }
+        q = json_digits(p, parser->end);
+        if (q == p)
+        {
+            json_error(parser, "bad number");
+        }
+        p = q;
+        is_float = 1;
+    }
+    if (0 == is_float && p - digits <= 10)
+    {
+        for (q = digits; q < p; q++)
+        {
+            value = value * 10 + (*q - '0');
+        }
+        if (digits != parser->p)
+        {
+            value = -value;
+        }
+        if (value >= -MAX_INT - 1 && value <= MAX_INT)
+        {
+            v->typ = JS_VALUE_TYPE_INT;
+            v->u.intvalue = value;
+            parser->p = p;
+            return;
+        }
+    }
+    v->typ = JS_VALUE_TYPE_FLOAT;
+    v->u.floatvalue = strtod(parser->p, NULL); /*the text was checked,strtod stops where p is*/
+    parser->p = p;
+}
+
+void json_read_word(JsonParser *parser, const char *word, int length)
+{
+    if (parser->end - parser->p < length || 0 != memcmp(parser->p, word, length))
+    {
+        json_error(parser, "unexpected char");
+    }
+    parser->p += length;
+}
+
+void json_read_value(JsonParser *parser, JsValue *v)
+{
+    parser->p = json_skip_space(parser->p, parser->end);
+    if (parser->p == parser->end)
+    {
+        json_error(parser, "unexpected end");
+    }
+    switch (*parser->p)
+    {
+    case '{':
+        json_read_object(parser, v);
+        break;
+    case '[':
+        json_read_array(parser, v);
+        break;
+    case '"':
+        json_read_string(parser, v);
+        break;
+    case 't':
+        json_read_word(parser, "true", 4);
+        v->typ = JS_VALUE_TYPE_BOOL;
+        v->u.boolvalue = JS_BOOL_TRUE;
+        break;
+    case 'f':
+        json_read_word(parser, "false", 5);
+        v->typ = JS_VALUE_TYPE_BOOL;
+        v->u.boolvalue = JS_BOOL_FALSE;
+        break;
+    case 'n':
+        json_read_word(parser, "null", 4);
+        v->typ = JS_VALUE_TYPE_NULL;
+        break;
+    default:
+        json_read_number(parser, v);
+    }
+}
+
+JsValue JSON_parse(JsInterpreter *inter, const char *s, int length, int line)
+{
+    JsonParser parser;
+    JsValue v;
+    parser.inter = inter;
+    parser.start = s;
+    parser.p = s;
+    parser.end = s + length;
+    parser.line = line;
+    parser.depth = 0;
+    parser.values = NULL;
+    parser.count = 0;
+    parser.alloc = 0;
+    json_read_value(&parser, &v);
+    parser.p = json_skip_space(parser.p, parser.end);
+    if (parser.p != parser.end)
+    {
+        json_error(&parser, "unexpected char");
+    }
+    if (NULL != parser.values)
+    {
+        MEM_free(inter->execute_memory, (char *)parser.values);
+    }
+    return v;
+}
+
+void json_reserve(JsonWriter *w, int more)
+{
+    char *buf;
+    if (w->length + more <= w->alloc)
+    {
+        return;
+    }
+    buf = MEM_alloc(w->inter->execute_memory, (w->length + more) * 2 + JSON_BUFFER_SIZE, w->line);
+    if (NULL == buf)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "JSON.stringify", w->line);
+    }
+    if (NULL != w->buf)
+    {
+        memcpy(buf, w->buf, w->length);
+        MEM_free(w->inter->execute_memory, w->buf);
+    }
+    w->buf = buf;
+    w->alloc = (w->length + more) * 2 + JSON_BUFFER_SIZE;
+}
+
+void json_put(JsonWriter *w, const char *s, int length)
+{
+    json_reserve(w, length);
+    memcpy(w->buf + w->length, s, length);
+    w->length += length;
+}
+
+/*runs without anything to escape are copied whole*/
+void json_put_string(JsonWriter *w, const char *s)
+{
+    const char *end = s + strlen(s);
+    const char *run;
+    char escape[8];
+    json_put(w, "\"", 1);
+    while (s < end)
+    {
+        run = json_scan_string(s, end);
+        json_put(w, s, run - s);
+        if (run == end)
+        {
+            break;
+        }
+        switch (*run)
+        {
+        case '"':
+            json_put(w, "\\\"", 2);
+            break;
+        case '\\':
+            json_put(w, "\\\\", 2);
+            break;
+        case '\n':
+            json_put(w, "\\n", 2);
+            break;
+        case '\r':
+            json_put(w, "\\r", 2);
+            break;
+        case '\t':
+            json_put(w, "\\t", 2);
+            break;
+        case '\b':
+            json_put(w, "\\b", 2);
+            break;
+        case '\f':
+            json_put(w, "\\f", 2);
+            break;
+        default:
+            json_put(w, escape, snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*run));
+        }
+        s = run + 1;
+    }
+    json_put(w, "\"", 1);
+}
+
+/*the shortest text that reads back as the same double*/
+void json_put_float(JsonWriter *w, double value)
+{
+    char number[32];
+    int length;
+    if (!isfinite(value))
+    {
+        json_put(w, "null", 4);
+        return;
+    }
+    length = snprintf(number, sizeof(number), "%.15g", value);
+    if (strtod(number, NULL) != value)
+    {
+        length = snprintf(number, sizeof(number), "%.17g", value);
+    }
+    json_put(w, number, length);
+}
+
+void json_push_field(JsonWriter *w, JsKvList *field)
+{
+    JsKvList **fields;
+    if (w->field_count == w->field_alloc)
+    {
+        fields = (JsKvList **)MEM_alloc(w->inter->execute_memory, sizeof(JsKvList *) * (w->field_alloc * 2 + 64), w->line);
+        if (NULL == fields)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "JSON.stringify", w->line);
+        }
+        if (NULL != w->fields)
+        {
+            memcpy(fields, w->fields, sizeof(JsKvList *) * w->field_count);
+            MEM_free(w->inter->execute_memory, (char *)w->fields);
+        }
+        w->fields = fields;
+        w->field_alloc = w->field_alloc * 2 + 64;
+    }
+    w->fields[w->field_count++] = field;
+}
+
+int json_write(JsonWriter *w, const JsValue *v);
+
+/*in the order the fields were set,the reverse of eles*/
+void json_write_object(JsonWriter *w, JsObject *object)
+{
+    int base = w->field_count;
+    int first = 1;
+    int mark;
+    int i;
+    JsKvList *field;
+    for (field = object->eles; NULL != field; field = field->next)
+    {
+        json_push_field(w, field);
+    }
+    json_put(w, "{", 1);
+    for (i = w->field_count - 1; i >= base; i--)
+    {
+        field = w->fields[i];
+        mark = w->length;
+        if (0 == first)
+        {
+            json_put(w, ",", 1);
+        }
+        json_put_string(w, field->kv.key);
+        json_put(w, ":", 1);
+        if (0 == json_write(w, &field->kv.value))
+        { /*undefined and functions are left out*/
+            w->length = mark;
+            continue;
+        }
+        first = 0;
+    }
+    json_put(w, "}", 1);
+    w->field_count = base;
+}
+
+/*0 when v has no json text,undefined and functions*/
+int json_write(JsonWriter *w, const JsValue *v)
+{
+    char number[16];
+    JsValue element;
+    int i;
+    switch (v->typ)
+    {
+    case JS_VALUE_TYPE_BOOL:
+        if (JS_BOOL_TRUE == v->u.boolvalue)
+        {
+            json_put(w, "true", 4);
+        }
+        else
+        {
+            json_put(w, "false", 5);
+        }
+        break;
+    case JS_VALUE_TYPE_INT:
+        json_put(w, number, snprintf(number, sizeof(number), "%d", v->u.intvalue));
+        break;
+    case JS_VALUE_TYPE_FLOAT:
+        json_put_float(w, v->u.floatvalue);
+        break;
+    case JS_VALUE_TYPE_STRING:
+        json_put_string(w, v->u.string->s);
+        break;
+    case JS_VALUE_TYPE_STRING_LITERAL:
+        json_put_string(w, v->u.literal_string);
+        break;
+    case JS_VALUE_TYPE_NULL:
+        json_put(w, "null", 4);
+        break;
+    case JS_VALUE_TYPE_ARRAY:
+    case JS_VALUE_TYPE_OBJECT:
+        if (++w->depth > JSON_MAX_DEPTH)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_INVALID_JSON, "JSON.stringify,too deep or cyclic", w->line);
+        }
+        if (JS_VALUE_TYPE_OBJECT == v->typ)
+        {
+            json_write_object(w, v->u.object);
+        }
+        else
+        {
+            json_put(w, "[", 1);
+            for (i = 0; i < v->u.array->length; i++)
+            {
+                if (0 != i)
+                {
+                    json_put(w, ",", 1);
+                }
+                if (0 == json_write(w, v->u.array->elements + i))
+                {
+                    json_put(w, "null", 4);
+                }
+            }
+            json_put(w, "]", 1);
+        }
+        w->depth--;
+        break;
+    case JS_VALUE_TYPE_TYPED_ARRAY:
+        json_put(w, "[", 1);
+        for (i = 0; i < v->u.typed->length; i++)
+        {
+            if (0 != i)
+            {
+                json_put(w, ",", 1);
+            }
+            TYPED_get(v->u.typed, i, &element);
+            json_write(w, &element);
+        }
+        json_put(w, "]", 1);
+        break;
+    case JS_VALUE_TYPE_MAP: /*entries are no fields,like JSON.stringify(new Map()) in browsers*/
+    case JS_VALUE_TYPE_BUFFER:
+    case JS_VALUE_TYPE_PROMISE:
+    case JS_VALUE_TYPE_COROUTINE:
+    case JS_VALUE_TYPE_REGEXP:
+        json_put(w, "{}", 2);
+        break;
+    case JS_VALUE_TYPE_FUNCTION:
+    case JS_VALUE_TYPE_UNDEFINED:
+        return 0;
+    }
+    return 1;
+}
+
+JsValue JSON_stringify(JsInterpreter *inter, const JsValue *value, int line)
+{
+    JsonWriter w;
+    JsValue v;
+    JsString *s;
+    w.inter = inter;
+    w.line = line;
+    w.depth = 0;
+    w.buf = NULL;
+    w.length = 0;
+    w.alloc = 0;
+    w.fields = NULL;
+    w.field_count = 0;
+    w.field_alloc = 0;
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (0 != json_write(&w, value))
+    {
+        s = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, w.length + 1, line);
+        memcpy(s->s, w.buf, w.length);
+        s->s[w.length] = 0;
+        s->length = w.length;
+        v.typ = JS_VALUE_TYPE_STRING;
+        v.u.string = s;
+    }
+    if (NULL != w.buf)
+    {
+        MEM_free(inter->execute_memory, w.buf);
+    }
+    if (NULL != w.fields)
+    {
+        MEM_free(inter->execute_memory, (char *)w.fields);
+    }
+    return v;
+}
+
+JsValue json_parse_buildin_function(JsInterpreter *inter, const JsValue *value, int line)
+{
+    if (JS_VALUE_TYPE_STRING == value->typ)
+    {
+        return JSON_parse(inter, value->u.string->s, value->u.string->length, line);
+    }
+    if (JS_VALUE_TYPE_STRING_LITERAL == value->typ)
+    {
+        return JSON_parse(inter, value->u.literal_string, strlen(value->u.literal_string), line);
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "JSON.parse", line);
+    return *value;
+}
+
+void JSON_add_buildin(JsInterpreter *inter)
+{
+    json_parse_buildin.args_count = 1;
+    json_parse_buildin.with_interpreter = 1;
+    json_parse_buildin.u.inter1 = json_parse_buildin_function;
+    json_parse_function.typ = JS_FUNCTION_TYPE_BUILDIN;
+    json_parse_function.name = "parse";
+    json_parse_function.buildin = &json_parse_buildin;
+    json_parse.kv.key = "parse";
+    json_parse.kv.value.typ = JS_VALUE_TYPE_FUNCTION;
+    json_parse.kv.value.u.func = &json_parse_function;
+    json_parse.next = &json_stringify;
+    json_stringify_buildin.args_count = 1;
+    json_stringify_buildin.with_interpreter = 1;
+    json_stringify_buildin.u.inter1 = JSON_stringify;
+    json_stringify_function.typ = JS_FUNCTION_TYPE_BUILDIN;
+    json_stringify_function.name = "stringify";
+    json_stringify_function.buildin = &json_stringify_buildin;
+    json_stringify.kv.key = "stringify";
+    json_stringify.kv.value.typ = JS_VALUE_TYPE_FUNCTION;
+    json_stringify.kv.value.u.func = &json_stringify_function;
+    json_stringify.next = NULL;
+    json_object.typ = JS_OBJECT_TYPE_BUILDIN;
+    json_object.eles = &json_parse;
+    json_var_list.var.name = "JSON";
+    json_var_list.var.value.typ = JS_VALUE_TYPE_OBJECT;
+    json_var_list.var.value.u.object = &json_object;
+    json_var_list.next = inter->env.vars;
+    inter->env.vars = &json_var_list;
+}
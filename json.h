@@ -0,0 +1,14 @@
+#ifndef JSON_H
+#define JSON_H
+#include "js.h"
+
+/*the JSON global with parse and stringify*/
+void JSON_add_buildin(JsInterpreter *inter);
+
+/*the value of the document s,a runtime error when it is not json*/
+JsValue JSON_parse(JsInterpreter *inter, const char *s, int length, int line);
+
+/*a heap string,undefined for values json has no text for*/
+JsValue JSON_stringify(JsInterpreter *inter, const JsValue *value, int line);
+
+#endif
@@ -0,0 +1,798 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "js.h"
+#include "y.tab.h"
+#include "util.h"
+#include "create.h"
+#include "error.h"
+#include "memory.h"
+#include "lex.h"
+
+/*
+ * hand written scanner.
+ * the whole source is in memory and every token is cut out of it in one
+ * pass,identifiers and numbers by a byte class table,comments and string
+ * literals by memchr over the runs between quotes,escapes and newlines.
+ *
+ * a script file is mapped private and writable,so a string literal
+ * without escapes is used in place: its closing quote becomes the
+ * terminating 0 and the tree points into the mapping. identifiers can
+ * not be terminated in place,each distinct name is copied once and
+ * every later use shares that copy.
+ *
+ * a slash starts a regular expression literal unless the token before it
+ * ends a value,then it divides.
+ *
+ * async,await,yield and of are names except where they can only be
+ * keywords: async right before function,await in an async function body
+ * and before an operand at top level,yield in a function* body and of
+ * after the name in a for header. the scanner keeps which function the
+ * open braces belong to for that.
+ */
+
+#define LEX_CHAR_SPACE 1
+#define LEX_CHAR_IDENTIFIER_START 2
+#define LEX_CHAR_IDENTIFIER 4
+#define LEX_CHAR_DIGIT 8
+
+#define LEX_NUMBER_BUF_SIZE 128
+#define LEX_NAME_TABLE_SIZE 4096
+#define LEX_MAX_FUNCTIONS 256 /*open function bodies told apart,deeper ones count as plain*/
+
+#define LEX_BODY_TOP 0
+#define LEX_BODY_PLAIN 1
+#define LEX_BODY_ASYNC 2
+#define LEX_BODY_GENERATOR 3
+
+typedef struct LexName_tag
+{
+    char *name;
+    int length;
+    unsigned int hash;
+    struct LexName_tag *next;
+} LexName;
+
+typedef struct
+{
+    char *name;
+    int length;
+    int token;
+} LexKeyword;
+
+LexKeyword lex_keywords[] = {
+    {"function", 8, FUNCTION},
+    {"if", 2, IF},
+    {"else", 4, ELSE},
+    {"do", 2, DO},
+    {"while", 5, WHILE},
+    {"for", 3, FOR},
+    {"return", 6, RETURN_T},
+    {"break", 5, BREAK},
+    {"continue", 8, CONTINUE},
+    {"null", 4, NULL_T},
+    {"true", 4, TRUE_T},
+    {"false", 5, FALSE_T},
+    {"var", 3, VAR},
+    {"new", 3, NEW},
+    {"in", 2, IN},
+    {"typeof", 6, TYPEOF},
+    {"switch", 6, SWITCH},
+    {"case", 4, CASE},
+    {"default", 7, DEFAULT},
+    {NULL, 0, 0}};
+
+LexKeyword lex_contextual_keywords[] = {
+    {"async", 5, ASYNC},
+    {"await", 5, AWAIT},
+    {"yield", 5, YIELD},
+    {"of", 2, OF},
+    {NULL, 0, 0}};
+
+unsigned char lex_char_class[256];
+char *lex_current;
+char *lex_end;
+char *lex_buffer;          /*source read by LEX_open_file when it can not be mapped*/
+char *lex_mapping;         /*source mapped by LEX_open_file*/
+size_t lex_mapping_length;
+char lex_writable;         /*literals may be terminated in place*/
+int lex_last;              /*the token before,whether a slash divides*/
+int lex_for;               /*how much of for ( [var] name the tokens before are*/
+int lex_header;            /*the body kind of the function whose header is open,-1 for none*/
+int lex_braces;            /*open braces*/
+int lex_functions;         /*open function bodies*/
+int lex_body_braces[LEX_MAX_FUNCTIONS]; /*the open braces outside each of them*/
+char lex_body_kinds[LEX_MAX_FUNCTIONS];
+LexName *lex_names[LEX_NAME_TABLE_SIZE];
+
+void lex_init_char_class()
+{
+    int c;
+    for (c = 0; c < 256; c++)
+    {
+        lex_char_class[c] = 0;
+        if (' ' == c || '\t' == c || '\r' == c || '\n' == c)
+        {
+            lex_char_class[c] |= LEX_CHAR_SPACE;
+        }
+        if (isalpha(c) || '_' == c)
+        {
+            lex_char_class[c] |= LEX_CHAR_IDENTIFIER_START | LEX_CHAR_IDENTIFIER;
+        }
+        if (isdigit(c))
+        {
+            lex_char_class[c] |= LEX_CHAR_DIGIT | LEX_CHAR_IDENTIFIER;
+        }
+    }
+}
+
+void LEX_set_source(char *source, int length)
+{
+    lex_init_char_class();
+    memset(lex_names, 0, sizeof(lex_names));
+    lex_current = source;
+    lex_end = source + length;
+    lex_writable = 0;
+    lex_last = 0;
+    lex_for = 0;
+    lex_header = -1;
+    lex_braces = 0;
+    lex_functions = 0;
+}
+
+int LEX_open_file(FILE *fp)
+{
+    long length;
+    struct stat st;
+    if (0 == fstat(fileno(fp), &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+    { /*pages are copied only where a literal is terminated*/
+        lex_mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fp), 0);
+        if (MAP_FAILED != lex_mapping)
+        {
+            lex_mapping_length = st.st_size;
+            LEX_set_source(lex_mapping, st.st_size);
+            lex_writable = 1;
+            return 0;
+        }
+        lex_mapping = NULL;
+    }
+    if (0 != fseek(fp, 0, SEEK_END))
+    {
+        return -1;
+    }
+    length = ftell(fp);
+    rewind(fp);
+    if (length < 0)
+    {
+        return -1;
+    }
+    lex_buffer = MEM_alloc(current_interpreter->interpreter_memory, length + 1, 0);
+    if (NULL == lex_buffer)
+    {
+        return -1;
+    }
+    if (length != fread(lex_buffer, 1, length, fp))
+    {
+        return -1;
+    }
+    lex_buffer[length] = 0;
+    LEX_set_source(lex_buffer, length);
+    lex_writable = 1;
+    return 0;
+}
+
+void LEX_close()
+{
+    if (NULL != lex_buffer)
+    {
+        MEM_free(current_interpreter->interpreter_memory, lex_buffer);
+        lex_buffer = NULL;
+    }
+    if (NULL != lex_mapping)
+    {
+        munmap(lex_mapping, lex_mapping_length);
+        lex_mapping = NULL;
+    }
+    lex_current = NULL;
+    lex_end = NULL;
+}
+
+char *LEX_source(int *length)
+{
+    *length = lex_end - lex_current;
+    return lex_current;
+}
+
+void LEX_copy_literals()
+{
+    lex_writable = 0;
+}
+
+/*byte k places ahead,0 past the end*/
+char lex_peek(int k)
+{
+    if (lex_current + k < lex_end)
+    {
+        return lex_current[k];
+    }
+    return 0;
+}
+
+int lex_token(int length, int token)
+{
+    lex_current += length;
+    return token;
+}
+
+void lex_count_lines(char *from, char *to)
+{
+    while (NULL != (from = memchr(from, '\n', to - from)))
+    {
+        increment_line_number();
+        from++;
+    }
+}
+
+/*spaces and comments before the next token*/
+void lex_skip_blank()
+{
+    char *p;
+    for (;;)
+    {
+        while (lex_current < lex_end && (lex_char_class[(unsigned char)*lex_current] & LEX_CHAR_SPACE))
+        {
+            if ('\n' == *lex_current)
+            {
+                increment_line_number();
+            }
+            lex_current++;
+        }
+        if ('/' != lex_peek(0))
+        {
+            return;
+        }
+        if ('/' == lex_peek(1))
+        { /*line comment,its newline is counted as a space*/
+            p = memchr(lex_current, '\n', lex_end - lex_current);
+            lex_current = NULL != p ? p : lex_end;
+            continue;
+        }
+        if ('*' == lex_peek(1))
+        {
+            p = lex_current + 2;
+            while (NULL != (p = memchr(p, '*', lex_end - p)) && (p + 1 >= lex_end || '/' != p[1]))
+            {
+                p++;
+            }
+            p = NULL != p ? p + 2 : lex_end;
+            lex_count_lines(lex_current, p);
+            lex_current = p;
+            continue;
+        }
+        return;
+    }
+}
+
+/*one copy per distinct name,the tree compares names with strcmp so sharing is safe*/
+char *lex_intern(char *start, int length)
+{
+    unsigned int hash = 2166136261u;
+    int i;
+    LexName *n;
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)start[i]) * 16777619u;
+    }
+    for (n = lex_names[hash % LEX_NAME_TABLE_SIZE]; NULL != n; n = n->next)
+    {
+        if (n->hash == hash && n->length == length && 0 == memcmp(n->name, start, length))
+        {
+            return n->name;
+        }
+    }
+    n = CREATE_alloc_node(sizeof(LexName));
+    if (NULL == n)
+    {
+        return NULL;
+    }
+    n->name = CREATE_identifier_with_length(start, length);
+    n->length = length;
+    n->hash = hash;
+    n->next = lex_names[hash % LEX_NAME_TABLE_SIZE];
+    lex_names[hash % LEX_NAME_TABLE_SIZE] = n;
+    return n->name;
+}
+
+/*the kind of the innermost open function body*/
+int lex_body()
+{
+    if (0 == lex_functions)
+    {
+        return LEX_BODY_TOP;
+    }
+    if (lex_functions > LEX_MAX_FUNCTIONS)
+    {
+        return LEX_BODY_PLAIN;
+    }
+    return lex_body_kinds[lex_functions - 1];
+}
+
+/*the first byte after spaces and tabs from lex_current on,0 at the end*/
+char lex_next_char(char **at)
+{
+    char *p = lex_current;
+    while (p < lex_end && (' ' == *p || '\t' == *p))
+    {
+        p++;
+    }
+    *at = p;
+    return p < lex_end ? *p : 0;
+}
+
+/*whether await at top level comes before an operand,else it is a name*/
+char lex_await_operand()
+{
+    char *p;
+    char c = lex_next_char(&p);
+    if (lex_char_class[(unsigned char)c] & LEX_CHAR_IDENTIFIER)
+    {
+        return 1;
+    }
+    return '(' == c || '[' == c || '"' == c || '\'' == c || '!' == c;
+}
+
+/*the keyword a contextual word is where it stands,NULL for a name*/
+LexKeyword *lex_contextual(char *start, int length)
+{
+    LexKeyword *k;
+    char *p;
+    char found = 0;
+    for (k = lex_contextual_keywords; NULL != k->name; k++)
+    {
+        if (k->length == length && 0 == memcmp(k->name, start, length))
+        {
+            break;
+        }
+    }
+    if (NULL == k->name || DOT == lex_last || VAR == lex_last || FUNCTION == lex_last || ':' == lex_next_char(&p))
+    { /*a property,variable,function or field name*/
+        return NULL;
+    }
+    switch (k->token)
+    {
+    case ASYNC:
+        found = p + 8 <= lex_end && 0 == memcmp(p, "function", 8) && (p + 8 == lex_end || 0 == (lex_char_class[(unsigned char)p[8]] & LEX_CHAR_IDENTIFIER));
+        break;
+    case AWAIT:
+        found = LEX_BODY_ASYNC == lex_body() || (LEX_BODY_TOP == lex_body() && 0 != lex_await_operand());
+        break;
+    case YIELD:
+        found = LEX_BODY_GENERATOR == lex_body();
+        break;
+    case OF:
+        found = 4 == lex_for;
+        break;
+    }
+    return 0 != found ? k : NULL;
+}
+
+int lex_identifier()
+{
+    char *start = lex_current;
+    int length;
+    LexKeyword *k;
+    char *p;
+    while (lex_current < lex_end && (lex_char_class[(unsigned char)*lex_current] & LEX_CHAR_IDENTIFIER))
+    {
+        lex_current++;
+    }
+    length = lex_current - start;
+    if (4 == length && 0 == memcmp(start, "else", 4))
+    { /*else[ ]*if*/
+        for (p = lex_current; p < lex_end && ' ' == *p; p++)
+            ;
+        if (p + 1 < lex_end && 'i' == p[0] && 'f' == p[1])
+        {
+            lex_current = p + 2;
+            return ELSIF;
+        }
+    }
+    for (k = lex_keywords; NULL != k->name; k++)
+    {
+        if (k->length == length && k->name[0] == start[0] && 0 == memcmp(k->name, start, length))
+        {
+            return k->token;
+        }
+    }
+    k = lex_contextual(start, length);
+    if (NULL != k)
+    {
+        return k->token;
+    }
+    yylval.identifier = lex_intern(start, length);
+    return IDENTIFIER;
+}
+
+/*[0-9]+\.[0-9]+ is a double,0 or [1-9][0-9]* an int*/
+int lex_number()
+{
+    char *start = lex_current;
+    char buf[LEX_NUMBER_BUF_SIZE];
+    unsigned int value = 0;
+    int length;
+    Expression *expression;
+    while (lex_current < lex_end && (lex_char_class[(unsigned char)*lex_current] & LEX_CHAR_DIGIT))
+    {
+        lex_current++;
+    }
+    if ('.' == lex_peek(0) && (lex_char_class[(unsigned char)lex_peek(1)] & LEX_CHAR_DIGIT))
+    {
+        lex_current++;
+        while (lex_current < lex_end && (lex_char_class[(unsigned char)*lex_current] & LEX_CHAR_DIGIT))
+        {
+            lex_current++;
+        }
+        length = lex_current - start;
+        if (length >= LEX_NUMBER_BUF_SIZE)
+        { /*digits this far down do not change a double*/
+            length = LEX_NUMBER_BUF_SIZE - 1;
+        }
+        memcpy(buf, start, length);
+        buf[length] = 0;
+        expression = CREATE_alloc_expression(EXPRESSION_TYPE_FLOAT);
+        sscanf(buf, "%lf", &expression->u.double_value);
+        yylval.expression = expression;
+        return DOUBLE_LITERAL;
+    }
+    if ('0' == *start)
+    {
+        lex_current = start + 1;
+    }
+    for (; start < lex_current; start++)
+    {
+        value = value * 10 + (*start - '0');
+    }
+    expression = CREATE_alloc_expression(EXPRESSION_TYPE_INT);
+    expression->u.int_value = (int)value;
+    yylval.expression = expression;
+    return INT_LITERAL;
+}
+
+/*length of the escape at p,0 when the backslash stands for itself*/
+int lex_escape(char *p, char quote)
+{
+    if (p + 1 >= lex_end)
+    {
+        return 0;
+    }
+    if ('\'' == quote)
+    {
+        return '\'' == p[1] ? 2 : 0;
+    }
+    switch (p[1])
+    {
+    case '"':
+    case 'n':
+    case 't':
+    case '\\':
+        return 2;
+    }
+    return 0;
+}
+
+char lex_escape_char(char c)
+{
+    switch (c)
+    {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    }
+    return c;
+}
+
+int lex_string(char quote)
+{
+    char *start = lex_current + 1;
+    char *p = start;
+    char *q;
+    char *b;
+    char *s;
+    char escaped = 0;
+    int length;
+    Expression *expression;
+    for (;;)
+    { /*find the closing quote,skipping escaped ones*/
+        q = memchr(p, quote, lex_end - p);
+        if (NULL == q)
+        { /*no closing quote,the source ends inside the literal*/
+            lex_count_lines(start, lex_end);
+            lex_current = lex_end;
+            return 0;
+        }
+        b = memchr(p, '\\', q - p);
+        if (NULL == b)
+        {
+            break;
+        }
+        escaped = 1;
+        length = lex_escape(b, quote);
+        p = b + (0 != length ? length : 1);
+    }
+    if (0 == escaped && 0 != lex_writable)
+    { /*the closing quote is not needed any more*/
+        s = start;
+        length = q - start;
+    }
+    else if (0 == escaped)
+    {
+        s = CREATE_alloc_node(q - start + 1);
+        memcpy(s, start, q - start);
+        length = q - start;
+    }
+    else
+    {
+        s = CREATE_alloc_node(q - start + 1);
+        length = 0;
+        for (p = start; p < q;)
+        {
+            if ('\\' == *p && 0 != lex_escape(p, quote))
+            {
+                s[length++] = lex_escape_char(p[1]);
+                p += 2;
+            }
+            else
+            {
+                s[length++] = *p++;
+            }
+        }
+    }
+    s[length] = 0;
+    lex_count_lines(start, q);
+    lex_current = q + 1;
+    expression = CREATE_alloc_expression(EXPRESSION_TYPE_STRING);
+    expression->u.string = s;
+    yylval.expression = expression;
+    return STRING_LITERAL;
+}
+
+/*a slash after these divides what they end*/
+char lex_ends_value(int token)
+{
+    switch (token)
+    {
+    case IDENTIFIER:
+    case INT_LITERAL:
+    case DOUBLE_LITERAL:
+    case STRING_LITERAL:
+    case REGEXP_LITERAL:
+    case RP:
+    case RB:
+    case TRUE_T:
+    case FALSE_T:
+    case NULL_T:
+    case INCREMENT:
+    case DECREMENT:
+        return 1;
+    }
+    return 0;
+}
+
+/*the pattern is kept as written,regexp.c reads its escapes. a slash in a class does not end it*/
+int lex_regexp()
+{
+    char *start = lex_current + 1;
+    char *p = start;
+    char *flags;
+    char in_class = 0;
+    while (p < lex_end && '\n' != *p && ('/' != *p || 0 != in_class))
+    {
+        if ('\\' == *p && p + 1 < lex_end && '\n' != p[1])
+        {
+            p++;
+        }
+        else if ('[' == *p)
+        {
+            in_class = 1;
+        }
+        else if (']' == *p)
+        {
+            in_class = 0;
+        }
+        p++;
+    }
+    if (p >= lex_end || '\n' == *p)
+    {
+        ERROR_compile_error(REGEXP_UNTERMINATED_ERR, "/");
+        return 0;
+    }
+    flags = p + 1;
+    lex_current = flags;
+    while (lex_current < lex_end && (lex_char_class[(unsigned char)*lex_current] & LEX_CHAR_IDENTIFIER))
+    {
+        lex_current++;
+    }
+    yylval.expression = CREATE_regexp_expression(CREATE_identifier_with_length(start, p - start),
+                                                  CREATE_identifier_with_length(flags, lex_current - flags));
+    return REGEXP_LITERAL;
+}
+
+int lex_operator()
+{
+    char buf[LINE_BUF_SIZE];
+    char c = *lex_current;
+    char next = lex_peek(1);
+    switch (c)
+    {
+    case '(':
+        return lex_token(1, LP);
+    case ')':
+        return lex_token(1, RP);
+    case '{':
+        return lex_token(1, LC);
+    case '}':
+        return lex_token(1, RC);
+    case '[':
+        return lex_token(1, LB);
+    case ']':
+        return lex_token(1, RB);
+    case ';':
+        return lex_token(1, SEMICOLON);
+    case ',':
+        return lex_token(1, COMMA);
+    case '.':
+        return lex_token(1, DOT);
+    case ':':
+        return lex_token(1, COLON);
+    case '=':
+        if ('=' == next)
+        {
+            return lex_token('=' == lex_peek(2) ? 3 : 2, EQ);
+        }
+        return lex_token(1, ASSIGN);
+    case '!':
+        return '=' == next ? lex_token(2, NE) : lex_token(1, NOT);
+    case '>':
+        return '=' == next ? lex_token(2, GE) : lex_token(1, GT);
+    case '<':
+        return '=' == next ? lex_token(2, LE) : lex_token(1, LT);
+    case '+':
+        if ('+' == next)
+        {
+            return lex_token(2, INCREMENT);
+        }
+        return '=' == next ? lex_token(2, PLUS_ASSIGN) : lex_token(1, ADD);
+    case '-':
+        if ('-' == next)
+        {
+            return lex_token(2, DECREMENT);
+        }
+        return '=' == next ? lex_token(2, MINUS_ASSIGN) : lex_token(1, SUB);
+    case '*':
+        return '=' == next ? lex_token(2, MUL_ASSIGN) : lex_token(1, MUL);
+    case '/':
+        return '=' == next ? lex_token(2, DIV_ASSIGN) : lex_token(1, DIV);
+    case '%':
+        return '=' == next ? lex_token(2, MOD_ASSIGN) : lex_token(1, MOD);
+    case '&':
+        if ('&' == next)
+        {
+            return lex_token(2, LOGICAL_AND);
+        }
+        break;
+    case '|':
+        if ('|' == next)
+        {
+            return lex_token(2, LOGICAL_OR);
+        }
+        break;
+    }
+    if (isprint((unsigned char)c))
+    {
+        buf[0] = c;
+        buf[1] = '\0';
+    }
+    else
+    {
+        sprintf(buf, "0x%02x", (unsigned char)c);
+    }
+    ERROR_compile_error(CHARACTER_INVALID_ERR, buf);
+    return 0;
+}
+
+int lex_next()
+{
+    unsigned char c;
+    lex_skip_blank();
+    if (lex_current >= lex_end)
+    {
+        return 0;
+    }
+    c = *lex_current;
+    if (lex_char_class[c] & LEX_CHAR_IDENTIFIER_START)
+    {
+        return lex_identifier();
+    }
+    if (lex_char_class[c] & LEX_CHAR_DIGIT)
+    {
+        return lex_number();
+    }
+    if ('"' == c || '\'' == c)
+    {
+        return lex_string(c);
+    }
+    if ('/' == c && 0 == lex_ends_value(lex_last))
+    {
+        return lex_regexp();
+    }
+    return lex_operator();
+}
+
+/*where the tokens so far are in a for header and which function the braces belong to*/
+void lex_track(int token)
+{
+    switch (token)
+    {
+    case FOR:
+        lex_for = 1;
+        break;
+    case LP:
+        lex_for = 1 == lex_for ? 2 : 0;
+        break;
+    case VAR:
+        lex_for = 2 == lex_for ? 3 : 0;
+        break;
+    case IDENTIFIER:
+        lex_for = 2 == lex_for || 3 == lex_for ? 4 : 0;
+        break;
+    default:
+        lex_for = 0;
+        break;
+    }
+    switch (token)
+    {
+    case FUNCTION:
+        lex_header = ASYNC == lex_last ? LEX_BODY_ASYNC : LEX_BODY_PLAIN;
+        break;
+    case MUL:
+        if (FUNCTION == lex_last)
+        {
+            lex_header = LEX_BODY_GENERATOR;
+        }
+        break;
+    case LC:
+        if (lex_header >= 0)
+        { /*the first brace after a header opens its body*/
+            if (lex_functions < LEX_MAX_FUNCTIONS)
+            {
+                lex_body_braces[lex_functions] = lex_braces;
+                lex_body_kinds[lex_functions] = lex_header;
+            }
+            lex_functions++;
+            lex_header = -1;
+        }
+        lex_braces++;
+        break;
+    case RC:
+        if (lex_braces > 0)
+        {
+            lex_braces--;
+        }
+        if (lex_functions > 0 && (lex_functions > LEX_MAX_FUNCTIONS || lex_body_braces[lex_functions - 1] == lex_braces))
+        {
+            lex_functions--;
+        }
+        break;
+    }
+}
+
+int yylex(void)
+{
+    int token = lex_next();
+    lex_track(token);
+    lex_last = token;
+    return token;
+}
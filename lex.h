@@ -0,0 +1,24 @@
+#ifndef LEX_H
+#define LEX_H
+#include <stdio.h>
+
+/*scan tokens straight out of a source buffer owned by the caller*/
+void LEX_set_source(char *source, int length);
+
+/*read the whole file into memory and scan it,-1 when it can not be read*/
+int LEX_open_file(FILE *fp);
+
+/*free the source read by LEX_open_file,literals of the tree may point into it*/
+void LEX_close();
+
+/*bytes of the source being scanned*/
+char *LEX_source(int *length);
+
+/*copy every string literal into the tree instead of using it in place*/
+void LEX_copy_literals();
+
+int yylex(void);
+
+int yyerror(char *str);
+
+#endif
@@ -0,0 +1,707 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "js.h"
+#include "error.h"
+#include "interprete.h"
+#include "expression.h"
+#include "output.h"
+#include "promise.h"
+#include "loop.h"
+
+/*
+ * the event loop.
+ * the program runs first,then LOOP_run goes round: every queued microtask,
+ * the fds epoll says are ready,the timers that are due,with the microtasks
+ * queued by a callback run right after it. it ends when no microtask is
+ * queued,no timer is set and no fd is watched.
+ * promise reactions are microtasks with a target,see PROMISE_run_job,
+ * an await at top level runs the loop until its promise settles.
+ * waiting callbacks are gc roots,see gc_mark_roots.
+ * fds made here are non blocking,readFd and writeFd never wait,a script
+ * waits for an fd with watchReadable and watchWritable.
+ */
+
+JsFunctionList loop_functions[LOOP_BUILDIN_COUNT];
+JsFunctionBuildin loop_buildins[LOOP_BUILDIN_COUNT];
+
+void LOOP_open(JsLoop *loop)
+{
+    memset(loop, 0, sizeof(JsLoop));
+    loop->epoll = -1;
+}
+
+long loop_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/*a bigger copy of items,the first count are kept*/
+void *loop_grow(JsInterpreter *inter, char *items, int count, int *alloc, int size, int line)
+{
+    char *more = MEM_alloc(inter->execute_memory, size * (*alloc * 2 + 8), line);
+    if (NULL == more)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "event loop", line);
+    }
+    if (NULL != items)
+    {
+        memcpy(more, items, size * count);
+        MEM_free(inter->execute_memory, items);
+    }
+    *alloc = *alloc * 2 + 8;
+    return more;
+}
+
+int loop_before(const JsTimer *a, const JsTimer *b)
+{
+    return a->due < b->due || (a->due == b->due && a->seq < b->seq);
+}
+
+void loop_timer_up(JsLoop *loop, int i)
+{
+    JsTimer t = loop->timers[i];
+    while (i > 0 && loop_before(&t, loop->timers + (i - 1) / 2))
+    {
+        loop->timers[i] = loop->timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    loop->timers[i] = t;
+}
+
+void loop_timer_down(JsLoop *loop, int i)
+{
+    JsTimer t = loop->timers[i];
+    int child;
+    while ((child = i * 2 + 1) < loop->timer_count)
+    {
+        if (child + 1 < loop->timer_count && loop_before(loop->timers + child + 1, loop->timers + child))
+        {
+            child++;
+        }
+        if (!loop_before(loop->timers + child, &t))
+        {
+            break;
+        }
+        loop->timers[i] = loop->timers[child];
+        i = child;
+    }
+    loop->timers[i] = t;
+}
+
+void loop_timer_remove(JsLoop *loop, int i)
+{
+    loop->timers[i] = loop->timers[--loop->timer_count];
+    if (i < loop->timer_count)
+    {
+        loop_timer_down(loop, i);
+        loop_timer_up(loop, i);
+    }
+}
+
+JsJob *loop_push_job(JsInterpreter *inter, int line)
+{
+    JsLoop *loop = &inter->loop;
+    JsJob *jobs;
+    JsJob *job;
+    int i;
+    if (loop->job_count == loop->job_alloc)
+    { /*the ring unrolled into a bigger one*/
+        jobs = (JsJob *)MEM_alloc(inter->execute_memory, sizeof(JsJob) * (loop->job_alloc * 2 + 8), line);
+        if (NULL == jobs)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "event loop", line);
+        }
+        for (i = 0; i < loop->job_count; i++)
+        {
+            jobs[i] = loop->jobs[(loop->job_head + i) % loop->job_alloc];
+        }
+        if (NULL != loop->jobs)
+        {
+            MEM_free(inter->execute_memory, (char *)loop->jobs);
+        }
+        loop->jobs = jobs;
+        loop->job_head = 0;
+        loop->job_alloc = loop->job_alloc * 2 + 8;
+    }
+    job = loop->jobs + (loop->job_head + loop->job_count) % loop->job_alloc;
+    job->target.typ = 0; /*a plain call*/
+    job->rejected = 0;
+    loop->job_count++;
+    return job;
+}
+
+void LOOP_queue_job(JsInterpreter *inter, const JsValue *func, const JsValue *arg, int line)
+{
+    JsJob *job = loop_push_job(inter, line);
+    job->func = *func;
+    job->arg.typ = 0; /*called without arguments*/
+    if (NULL != arg)
+    {
+        job->arg = *arg;
+    }
+}
+
+void LOOP_queue_reaction(JsInterpreter *inter, const JsValue *handler, const JsValue *value, const JsValue *target, char rejected, int line)
+{
+    JsJob *job = loop_push_job(inter, line);
+    job->func = *handler;
+    job->arg = *value;
+    job->target = *target;
+    job->rejected = rejected;
+    if (0 == job->target.typ)
+    { /*the result goes nowhere,still not a plain call*/
+        job->target.typ = JS_VALUE_TYPE_UNDEFINED;
+    }
+}
+
+void LOOP_track_rejection(JsInterpreter *inter, JsPromise *p, int line)
+{
+    JsLoop *loop = &inter->loop;
+    if (loop->rejection_count == loop->rejection_alloc)
+    {
+        loop->rejections = loop_grow(inter, (char *)loop->rejections, loop->rejection_count, &loop->rejection_alloc, sizeof(JsValue), line);
+    }
+    loop->rejections[loop->rejection_count].typ = JS_VALUE_TYPE_PROMISE;
+    loop->rejections[loop->rejection_count].u.promise = p;
+    loop->rejection_count++;
+}
+
+/*rejections that got no reaction while the microtasks ran*/
+void loop_check_rejections(JsInterpreter *inter)
+{
+    JsLoop *loop = &inter->loop;
+    int i;
+    for (i = 0; i < loop->rejection_count; i++)
+    {
+        if (0 == loop->rejections[i].u.promise->handled)
+        {
+            PROMISE_fail(inter, loop->rejections[i].u.promise, 0);
+        }
+    }
+    loop->rejection_count = 0;
+}
+
+/*until the queue is empty,jobs queued meanwhile included*/
+void loop_run_jobs(JsInterpreter *inter)
+{
+    JsLoop *loop = &inter->loop;
+    JsJob job;
+    while (loop->job_count > 0)
+    {
+        job = loop->jobs[loop->job_head];
+        loop->job_head = (loop->job_head + 1) % loop->job_alloc;
+        loop->job_count--;
+        if (0 != job.target.typ)
+        {
+            PROMISE_run_job(inter, &job);
+        }
+        else
+        {
+            eval_call_value(inter, &job.func, &job.arg, 0 != job.arg.typ, 0);
+        }
+    }
+    loop_check_rejections(inter);
+}
+
+/*timers set by the callbacks run here wait for the next round*/
+void loop_run_timers(JsInterpreter *inter)
+{
+    JsLoop *loop = &inter->loop;
+    long now = loop_now();
+    long seq = loop->timer_seq;
+    JsTimer t;
+    while (loop->timer_count > 0 && loop->timers[0].due <= now && loop->timers[0].seq < seq)
+    {
+        t = loop->timers[0];
+        if (0 != t.interval)
+        { /*set again before the call,so the callback can clear it*/
+            loop->timers[0].due = t.due + t.interval > now ? t.due + t.interval : now + t.interval;
+            loop->timers[0].seq = loop->timer_seq++;
+            loop_timer_down(loop, 0);
+        }
+        else
+        {
+            loop_timer_remove(loop, 0);
+        }
+        eval_call_value(inter, &t.func, NULL, 0, 0);
+        loop_run_jobs(inter);
+    }
+}
+
+JsWatch *loop_watch(JsLoop *loop, int fd)
+{
+    int i;
+    for (i = 0; i < loop->watch_count; i++)
+    {
+        if (loop->watches[i].fd == fd)
+        {
+            return loop->watches + i;
+        }
+    }
+    return NULL;
+}
+
+void loop_unwatch(JsLoop *loop, JsWatch *w)
+{
+    epoll_ctl(loop->epoll, EPOLL_CTL_DEL, w->fd, NULL);
+    *w = loop->watches[--loop->watch_count];
+}
+
+/*fd callbacks,waiting at most wait ms,-1 for as long as it takes*/
+void loop_run_fds(JsInterpreter *inter, int wait)
+{
+    JsLoop *loop = &inter->loop;
+    struct epoll_event events[LOOP_EVENTS];
+    JsWatch *w;
+    JsValue fd;
+    JsValue func;
+    int n;
+    int i;
+    do
+    {
+        n = epoll_wait(loop->epoll, events, LOOP_EVENTS, wait);
+    } while (n < 0 && EINTR == errno);
+    fd.typ = JS_VALUE_TYPE_INT;
+    for (i = 0; i < n; i++)
+    { /*a callback may change the watches,the fd is looked up again each time*/
+        fd.u.intvalue = events[i].data.fd;
+        w = loop_watch(loop, fd.u.intvalue);
+        if (NULL != w && JS_VALUE_TYPE_UNDEFINED != w->readable.typ && 0 != (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+        {
+            func = w->readable;
+            eval_call_value(inter, &func, &fd, 1, 0);
+            loop_run_jobs(inter);
+        }
+        w = loop_watch(loop, fd.u.intvalue);
+        if (NULL != w && JS_VALUE_TYPE_UNDEFINED != w->writable.typ && 0 != (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)))
+        {
+            func = w->writable;
+            eval_call_value(inter, &func, &fd, 1, 0);
+            loop_run_jobs(inter);
+        }
+    }
+}
+
+/*until nothing is left,or until settles*/
+void loop_run(JsInterpreter *inter, JsPromise *until)
+{
+    JsLoop *loop = &inter->loop;
+    long wait;
+    for (;;)
+    {
+        loop_run_jobs(inter);
+        if ((0 == loop->timer_count && 0 == loop->watch_count) || (NULL != until && JS_PROMISE_PENDING != until->state))
+        {
+            break;
+        }
+        wait = -1;
+        if (loop->timer_count > 0)
+        {
+            wait = loop->timers[0].due - loop_now();
+            wait = wait < 0 ? 0 : wait > MAX_INT ? MAX_INT : wait;
+        }
+        if (0 != wait)
+        { /*what was written shows up before the wait*/
+            OUTPUT_flush(&inter->output);
+        }
+        if (loop->watch_count > 0)
+        {
+            loop_run_fds(inter, (int)wait);
+        }
+        else if (wait > 0)
+        {
+            poll(NULL, 0, (int)wait);
+        }
+        loop_run_timers(inter);
+    }
+}
+
+void LOOP_run_until(JsInterpreter *inter, JsPromise *p)
+{
+    loop_run(inter, p);
+}
+
+void LOOP_run(JsInterpreter *inter)
+{
+    JsLoop *loop = &inter->loop;
+    loop_run(inter, NULL);
+    if (loop->epoll >= 0)
+    { /*a job forked later must not share it*/
+        close(loop->epoll);
+        loop->epoll = -1;
+    }
+}
+
+JsValue loop_set_timer(JsInterpreter *inter, const JsValue *func, const JsValue *ms, char interval, char *who, int line)
+{
+    JsLoop *loop = &inter->loop;
+    JsTimer *t;
+    JsValue v;
+    int delay = 0;
+    if (JS_VALUE_TYPE_FUNCTION != func->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    if (JS_VALUE_TYPE_INT == ms->typ)
+    {
+        delay = ms->u.intvalue;
+    }
+    else if (JS_VALUE_TYPE_FLOAT == ms->typ)
+    { /*NaN is 0*/
+        delay = ms->u.floatvalue > 0 ? (ms->u.floatvalue < MAX_INT ? (int)ms->u.floatvalue : MAX_INT) : 0;
+    }
+    else if (JS_VALUE_TYPE_UNDEFINED != ms->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    if (delay < 0)
+    {
+        delay = 0;
+    }
+    if (0 != interval && delay < 1)
+    { /*an interval of 0 would never let the loop wait*/
+        delay = 1;
+    }
+    if (loop->timer_count == loop->timer_alloc)
+    {
+        loop->timers = loop_grow(inter, (char *)loop->timers, loop->timer_count, &loop->timer_alloc, sizeof(JsTimer), line);
+    }
+    t = loop->timers + loop->timer_count++;
+    t->due = loop_now() + delay;
+    t->seq = loop->timer_seq++;
+    t->id = ++loop->timer_id;
+    t->interval = 0 != interval ? delay : 0;
+    t->func = *func;
+    v.typ = JS_VALUE_TYPE_INT;
+    v.u.intvalue = t->id;
+    loop_timer_up(loop, loop->timer_count - 1);
+    return v;
+}
+
+JsValue loop_set_timeout_function(JsInterpreter *inter, const JsValue *func, const JsValue *ms, int line)
+{
+    return loop_set_timer(inter, func, ms, 0, "setTimeout", line);
+}
+
+JsValue loop_set_interval_function(JsInterpreter *inter, const JsValue *func, const JsValue *ms, int line)
+{
+    return loop_set_timer(inter, func, ms, 1, "setInterval", line);
+}
+
+/*clearTimeout and clearInterval,an id that is gone is no error*/
+JsValue loop_clear_timer_function(JsInterpreter *inter, const JsValue *id, int line)
+{
+    JsLoop *loop = &inter->loop;
+    JsValue v;
+    int i;
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (JS_VALUE_TYPE_INT != id->typ)
+    {
+        return v;
+    }
+    for (i = 0; i < loop->timer_count; i++)
+    {
+        if (loop->timers[i].id == id->u.intvalue)
+        {
+            loop_timer_remove(loop, i);
+            break;
+        }
+    }
+    return v;
+}
+
+JsValue loop_queue_microtask_function(JsInterpreter *inter, const JsValue *func, int line)
+{
+    JsValue v;
+    if (JS_VALUE_TYPE_FUNCTION != func->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "queueMicrotask", line);
+    }
+    LOOP_queue_job(inter, func, NULL, line);
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+int loop_fd(const JsValue *v, char *who, int line)
+{
+    if (JS_VALUE_TYPE_INT != v->typ || v->u.intvalue < 0)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    return v->u.intvalue;
+}
+
+/*func(fd) each time fd is ready,null or undefined stops waiting for that*/
+JsValue loop_watch_fd(JsInterpreter *inter, const JsValue *fd, const JsValue *func, char writable, char *who, int line)
+{
+    JsLoop *loop = &inter->loop;
+    struct epoll_event ev;
+    JsWatch *w;
+    JsValue v;
+    int op = EPOLL_CTL_MOD;
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (JS_VALUE_TYPE_FUNCTION != func->typ && JS_VALUE_TYPE_NULL != func->typ && JS_VALUE_TYPE_UNDEFINED != func->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    w = loop_watch(loop, loop_fd(fd, who, line));
+    if (NULL == w)
+    {
+        if (JS_VALUE_TYPE_FUNCTION != func->typ)
+        {
+            return v;
+        }
+        if (loop->epoll < 0)
+        {
+            loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+            if (loop->epoll < 0)
+            {
+                ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, who, line);
+            }
+        }
+        if (loop->watch_count == loop->watch_alloc)
+        {
+            loop->watches = loop_grow(inter, (char *)loop->watches, loop->watch_count, &loop->watch_alloc, sizeof(JsWatch), line);
+        }
+        w = loop->watches + loop->watch_count++;
+        w->fd = fd->u.intvalue;
+        w->readable.typ = JS_VALUE_TYPE_UNDEFINED;
+        w->writable.typ = JS_VALUE_TYPE_UNDEFINED;
+        op = EPOLL_CTL_ADD;
+    }
+    if (0 != writable)
+    {
+        w->writable = *func;
+        w->writable.typ = JS_VALUE_TYPE_FUNCTION == func->typ ? func->typ : JS_VALUE_TYPE_UNDEFINED;
+    }
+    else
+    {
+        w->readable = *func;
+        w->readable.typ = JS_VALUE_TYPE_FUNCTION == func->typ ? func->typ : JS_VALUE_TYPE_UNDEFINED;
+    }
+    if (JS_VALUE_TYPE_UNDEFINED == w->readable.typ && JS_VALUE_TYPE_UNDEFINED == w->writable.typ)
+    {
+        loop_unwatch(loop, w);
+        return v;
+    }
+    ev.events = (JS_VALUE_TYPE_UNDEFINED != w->readable.typ ? EPOLLIN : 0) | (JS_VALUE_TYPE_UNDEFINED != w->writable.typ ? EPOLLOUT : 0);
+    ev.data.u64 = 0;
+    ev.data.fd = w->fd;
+    if (0 != epoll_ctl(loop->epoll, op, w->fd, &ev))
+    { /*a regular file is always ready,epoll takes no such fd*/
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    return v;
+}
+
+JsValue loop_watch_readable_function(JsInterpreter *inter, const JsValue *fd, const JsValue *func, int line)
+{
+    return loop_watch_fd(inter, fd, func, 0, "watchReadable", line);
+}
+
+JsValue loop_watch_writable_function(JsInterpreter *inter, const JsValue *fd, const JsValue *func, int line)
+{
+    return loop_watch_fd(inter, fd, func, 1, "watchWritable", line);
+}
+
+JsValue loop_unwatch_function(JsInterpreter *inter, const JsValue *fd, int line)
+{
+    JsWatch *w = loop_watch(&inter->loop, loop_fd(fd, "unwatch", line));
+    JsValue v;
+    if (NULL != w)
+    {
+        loop_unwatch(&inter->loop, w);
+    }
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+/*a unix stream socket connected to path*/
+JsValue loop_connect_socket_function(JsInterpreter *inter, const JsValue *path, int line)
+{
+    struct sockaddr_un addr;
+    char *s = NULL;
+    JsValue v;
+    int fd;
+    if (JS_VALUE_TYPE_STRING == path->typ)
+    {
+        s = path->u.string->s;
+    }
+    else if (JS_VALUE_TYPE_STRING_LITERAL == path->typ)
+    {
+        s = path->u.literal_string;
+    }
+    if (NULL == s || strlen(s) >= sizeof(addr.sun_path))
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "connectSocket", line);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, s);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || (0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr)) && EINPROGRESS != errno && EAGAIN != errno))
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CAN_NOT_OPEN_FILE, s, line);
+    }
+    v.typ = JS_VALUE_TYPE_INT;
+    v.u.intvalue = fd;
+    return v;
+}
+
+/*[read end,write end]*/
+JsValue loop_pipe_function(JsInterpreter *inter, const JsValue *unused, int line)
+{
+    int fds[2];
+    JsValue v;
+    if (0 != pipe(fds))
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CAN_NOT_OPEN_FILE, "pipe", line);
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    v.typ = JS_VALUE_TYPE_ARRAY;
+    v.u.array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, 2, line);
+    v.u.array->elements[0].typ = JS_VALUE_TYPE_INT;
+    v.u.array->elements[0].u.intvalue = fds[0];
+    v.u.array->elements[1].typ = JS_VALUE_TYPE_INT;
+    v.u.array->elements[1].u.intvalue = fds[1];
+    v.u.array->length = 2;
+    return v;
+}
+
+/*what can be read now,"" when nothing is there yet,null at the end*/
+JsValue loop_read_fd_function(JsInterpreter *inter, const JsValue *fd, int line)
+{
+    char buf[LOOP_READ_SIZE];
+    int f = loop_fd(fd, "readFd", line);
+    ssize_t n;
+    JsValue v;
+    do
+    {
+        n = read(f, buf, sizeof(buf));
+    } while (n < 0 && EINTR == errno);
+    if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+    {
+        v.typ = JS_VALUE_TYPE_STRING_LITERAL;
+        v.u.literal_string = "";
+        return v;
+    }
+    if (n <= 0)
+    {
+        v.typ = JS_VALUE_TYPE_NULL;
+        return v;
+    }
+    v.typ = JS_VALUE_TYPE_STRING;
+    v.u.string = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, n + 1, line);
+    memcpy(v.u.string->s, buf, n);
+    v.u.string->s[n] = 0;
+    v.u.string->length = n;
+    return v;
+}
+
+/*the bytes written,0 when the fd is full,-1 when it is broken*/
+JsValue loop_write_fd_function(JsInterpreter *inter, const JsValue *fd, const JsValue *data, int line)
+{
+    int f = loop_fd(fd, "writeFd", line);
+    char *s;
+    int length;
+    ssize_t n;
+    JsValue v;
+    if (JS_VALUE_TYPE_STRING == data->typ)
+    {
+        s = data->u.string->s;
+        length = data->u.string->length;
+    }
+    else if (JS_VALUE_TYPE_STRING_LITERAL == data->typ)
+    {
+        s = data->u.literal_string;
+        length = strlen(s);
+    }
+    else
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "writeFd", line);
+        return *data;
+    }
+    do
+    { /*no SIGPIPE from a socket whose peer is gone*/
+        n = send(f, s, length, MSG_NOSIGNAL);
+        if (n < 0 && ENOTSOCK == errno)
+        {
+            n = write(f, s, length);
+        }
+    } while (n < 0 && EINTR == errno);
+    if (n < 0)
+    {
+        n = EAGAIN == errno || EWOULDBLOCK == errno ? 0 : -1;
+    }
+    v.typ = JS_VALUE_TYPE_INT;
+    v.u.intvalue = n;
+    return v;
+}
+
+JsValue loop_close_fd_function(JsInterpreter *inter, const JsValue *fd, int line)
+{
+    int f = loop_fd(fd, "closeFd", line);
+    JsWatch *w = loop_watch(&inter->loop, f);
+    JsValue v;
+    if (NULL != w)
+    {
+        loop_unwatch(&inter->loop, w);
+    }
+    close(f);
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+void loop_add(JsInterpreter *inter, int i, char *name,
+              JsValue (*f1)(JsInterpreter *, const JsValue *, int),
+              JsValue (*f2)(JsInterpreter *, const JsValue *, const JsValue *, int))
+{
+    JsFunctionBuildin *buildin = loop_buildins + i;
+    JsFunctionList *func = loop_functions + i;
+    buildin->with_interpreter = 1;
+    if (NULL != f2)
+    {
+        buildin->args_count = 2;
+        buildin->u.inter2 = f2;
+    }
+    else
+    {
+        buildin->args_count = 1;
+        buildin->u.inter1 = f1;
+    }
+    func->func.typ = JS_FUNCTION_TYPE_BUILDIN;
+    func->func.buildin = buildin;
+    func->func.name = name;
+    func->next = inter->env.funcs;
+    inter->env.funcs = func;
+}
+
+void LOOP_add_buildin(JsInterpreter *inter)
+{
+    loop_add(inter, 0, "setTimeout", NULL, loop_set_timeout_function);
+    loop_add(inter, 1, "setInterval", NULL, loop_set_interval_function);
+    loop_add(inter, 2, "clearTimeout", loop_clear_timer_function, NULL);
+    loop_add(inter, 3, "clearInterval", loop_clear_timer_function, NULL);
+    loop_add(inter, 4, "queueMicrotask", loop_queue_microtask_function, NULL);
+    loop_add(inter, 5, "watchReadable", NULL, loop_watch_readable_function);
+    loop_add(inter, 6, "watchWritable", NULL, loop_watch_writable_function);
+    loop_add(inter, 7, "unwatch", loop_unwatch_function, NULL);
+    loop_add(inter, 8, "connectSocket", loop_connect_socket_function, NULL);
+    loop_add(inter, 9, "pipe", loop_pipe_function, NULL);
+    loop_add(inter, 10, "readFd", loop_read_fd_function, NULL);
+    loop_add(inter, 11, "writeFd", NULL, loop_write_fd_function);
+    loop_add(inter, 12, "closeFd", loop_close_fd_function, NULL);
+}
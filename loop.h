@@ -0,0 +1,26 @@
+#ifndef LOOP_H
+#define LOOP_H
+#include "js.h"
+
+#define LOOP_BUILDIN_COUNT 13
+
+void LOOP_open(JsLoop *loop);
+
+/*func(arg) after the running code and the microtasks queued before it*/
+void LOOP_queue_job(JsInterpreter *inter, const JsValue *func, const JsValue *arg, int line);
+
+/*a job that hands value to handler,what it gives settles target,see PROMISE_run_job*/
+void LOOP_queue_reaction(JsInterpreter *inter, const JsValue *handler, const JsValue *value, const JsValue *target, char rejected, int line);
+
+/*p was rejected with no reaction,an error unless one is added before the microtasks ran*/
+void LOOP_track_rejection(JsInterpreter *inter, JsPromise *p, int line);
+
+/*runs microtasks,timers and fd callbacks until none is left*/
+void LOOP_run(JsInterpreter *inter);
+
+/*the same until p settles,what is left runs later*/
+void LOOP_run_until(JsInterpreter *inter, JsPromise *p);
+
+void LOOP_add_buildin(JsInterpreter *inter);
+
+#endif
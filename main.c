@@ -1,9 +1,17 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "js.h"
 #include "create.h"
 #include "util.h"
 #include <unistd.h>
 #include "interprete.h"
+#include "resolve.h"
+#include "lex.h"
+#include "cache.h"
+#include "snapshot.h"
+#include "server.h"
+#include "output.h"
 
 int yyerror(char *str)
 {
@@ -14,15 +22,36 @@ int yyerror(char *str)
 int main(int argc, char **argv)
 {
     FILE *fp;
-    if (argc != 2)
+    char *filename;
+    char *write_snapshot = NULL; /*run the file as a prelude and save its globals*/
+    char *read_snapshot = NULL;  /*start from the globals of a prelude*/
+    char fork_server = 0;        /*run the file,then fork a child per job*/
+    char *server_socket = NULL;
+    filename = argv[argc - 1];
+    if (argc == 4 && 0 == strcmp(argv[1], "-s"))
     {
-        fprintf(stderr, "Usage:%s filename\n", argv[0]);
+        write_snapshot = argv[2];
+    }
+    else if (argc == 4 && 0 == strcmp(argv[1], "-r"))
+    {
+        read_snapshot = argv[2];
+    }
+    else if ((argc == 3 || argc == 4) && 0 == strcmp(argv[1], "--fork-server"))
+    {
+        fork_server = 1;
+        filename = argv[2];
+        server_socket = argc == 4 ? argv[3] : NULL;
+    }
+    else if (argc != 2)
+    {
+        fprintf(stderr, "Usage:%s [-s snapshot | -r snapshot] filename\n", argv[0]);
+        fprintf(stderr, "      %s --fork-server filename [socket]\n", argv[0]);
         _exit(1);
     }
-    fp = fopen(argv[1], "r");
+    fp = fopen(filename, "r");
     if (fp == NULL)
     {
-        fprintf(stderr, "%s not found.\n", argv[1]);
+        fprintf(stderr, "%s not found.\n", filename);
         exit(1);
     }
 
@@ -36,17 +65,65 @@ int main(int argc, char **argv)
 
     INTERPRETE_add_buildin(interpreter);
     current_interpreter = interpreter;
+    if (NULL != read_snapshot && 0 != SNAPSHOT_restore(interpreter, read_snapshot))
+    {
+        fprintf(stderr, "%s is not a snapshot of this build.\n", read_snapshot);
+        _exit(1);
+    }
     extern int yyparse(void);
-    extern FILE *yyin;
 
-    yyin = fp;
-    if (yyparse())
+    if (0 != LEX_open_file(fp))
     {
-        fprintf(stderr, "Error ! Error ! Error !\n");
-        _exit(4);
+        fprintf(stderr, "%s can not be read.\n", filename);
+        _exit(1);
     }
-
-    INTERPRETE_interprete(interpreter);
+    fclose(fp);
+    int length;
+    char *source = LEX_source(&length);
+    if (NULL == CACHE_directory() || 0 != CACHE_load(interpreter, source, length))
+    {
+        if (NULL != CACHE_directory() && 0 == CREATE_open_ast_image(interpreter))
+        { /*a cached tree must not point into the source*/
+            LEX_copy_literals();
+        }
+        if (yyparse())
+        {
+            fprintf(stderr, "Error ! Error ! Error !\n");
+            _exit(4);
+        }
+        RESOLVE_program(interpreter);
+        if (NULL != CACHE_directory())
+        {
+            CACHE_store(interpreter, source, length);
+        }
+    }
+    if (0 != fork_server)
+    {
+        if (0 != SERVER_run(interpreter, server_socket))
+        {
+            OUTPUT_flush(&interpreter->output);
+            _exit(1);
+        }
+        INTERPRETE_finish(interpreter);
+    }
+    else if (NULL != write_snapshot)
+    {
+        INTERPRETE_execute(interpreter);
+        if (0 != SNAPSHOT_write(interpreter, write_snapshot))
+        {
+            OUTPUT_flush(&interpreter->output);
+            fprintf(stderr, "%s can not be written.\n", write_snapshot);
+            _exit(1);
+        }
+        INTERPRETE_finish(interpreter);
+    }
+    else
+    {
+        INTERPRETE_interprete(interpreter);
+    }
+    CREATE_free_ast(interpreter);
+    LEX_close(); /*string literals of the tree may point into the source*/
+    SNAPSHOT_close();
 
     return 0;
 }
\ No newline at end of file
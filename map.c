@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <string.h>
+#include "js.h"
+#include "error.h"
+#include "heap.h"
+#include "interprete.h"
+#include "map.h"
+
+/*
+ * Map and Set.
+ * entries sit in one array in insertion order,a delete leaves a hole.
+ * slots is a power of two table of entry indexes,probed linearly from the
+ * hash of the key and never more than half full,so a lookup touches a few
+ * ints next to each other. holes are squeezed out when the entries are full,
+ * the table only grows when most entries are live.
+ * keys are compared like === except that NaN is NaN,and 1.0 is stored as 1.
+ */
+
+#define MAP_MIN_ALLOC 8
+
+/*the bits of x spread over all of the result*/
+unsigned int map_mix(unsigned long x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdUL;
+    x ^= x >> 33;
+    return (unsigned int)x;
+}
+
+char *map_chars(const JsValue *v, int *length)
+{
+    if (JS_VALUE_TYPE_STRING == v->typ)
+    {
+        *length = v->u.string->length;
+        return v->u.string->s;
+    }
+    *length = strlen(v->u.literal_string);
+    return v->u.literal_string;
+}
+
+/*a float with an int value is the int,so 1 and 1.0 find the same entry*/
+void map_key(const JsValue *key, JsValue *k)
+{
+    *k = *key;
+    if (JS_VALUE_TYPE_FLOAT == key->typ && key->u.floatvalue >= -MAX_INT && key->u.floatvalue <= MAX_INT &&
+        (double)(int)key->u.floatvalue == key->u.floatvalue)
+    {
+        k->typ = JS_VALUE_TYPE_INT;
+        k->u.intvalue = (int)key->u.floatvalue;
+    }
+}
+
+unsigned int map_hash(const JsValue *k)
+{
+    unsigned int h = 2166136261U;
+    unsigned long bits;
+    char *s;
+    int length;
+    int i;
+    switch (k->typ)
+    {
+    case JS_VALUE_TYPE_STRING:
+    case JS_VALUE_TYPE_STRING_LITERAL:
+        s = map_chars(k, &length);
+        for (i = 0; i < length; i++)
+        { /*fnv-1a*/
+            h = (h ^ (unsigned char)s[i]) * 16777619U;
+        }
+        return h;
+    case JS_VALUE_TYPE_INT:
+        return map_mix((unsigned int)k->u.intvalue);
+    case JS_VALUE_TYPE_FLOAT:
+        if (k->u.floatvalue != k->u.floatvalue)
+        { /*every NaN is the same key*/
+            return 0;
+        }
+        memcpy(&bits, &k->u.floatvalue, sizeof(bits));
+        return map_mix(bits);
+    case JS_VALUE_TYPE_BOOL:
+        return k->u.boolvalue;
+    case JS_VALUE_TYPE_ARRAY:
+    case JS_VALUE_TYPE_OBJECT:
+    case JS_VALUE_TYPE_FUNCTION:
+    case JS_VALUE_TYPE_MAP:
+    case JS_VALUE_TYPE_BUFFER:
+    case JS_VALUE_TYPE_TYPED_ARRAY:
+    case JS_VALUE_TYPE_PROMISE:
+    case JS_VALUE_TYPE_COROUTINE:
+    case JS_VALUE_TYPE_REGEXP:
+        return map_mix((unsigned long)k->u.object); /*heap cells do not move*/
+    case JS_VALUE_TYPE_NULL:
+    case JS_VALUE_TYPE_UNDEFINED:
+        return k->typ;
+    }
+    return 0;
+}
+
+int map_same(const JsValue *a, const JsValue *b)
+{
+    char *s1;
+    char *s2;
+    int length1;
+    int length2;
+    if ((JS_VALUE_TYPE_STRING == a->typ || JS_VALUE_TYPE_STRING_LITERAL == a->typ) &&
+        (JS_VALUE_TYPE_STRING == b->typ || JS_VALUE_TYPE_STRING_LITERAL == b->typ))
+    {
+        s1 = map_chars(a, &length1);
+        s2 = map_chars(b, &length2);
+        return length1 == length2 && 0 == memcmp(s1, s2, length1);
+    }
+    if (a->typ != b->typ)
+    {
+        return 0;
+    }
+    switch (a->typ)
+    {
+    case JS_VALUE_TYPE_INT:
+        return a->u.intvalue == b->u.intvalue;
+    case JS_VALUE_TYPE_FLOAT:
+        return a->u.floatvalue == b->u.floatvalue || (a->u.floatvalue != a->u.floatvalue && b->u.floatvalue != b->u.floatvalue);
+    case JS_VALUE_TYPE_BOOL:
+        return a->u.boolvalue == b->u.boolvalue;
+    case JS_VALUE_TYPE_NULL:
+    case JS_VALUE_TYPE_UNDEFINED:
+        return 1;
+    case JS_VALUE_TYPE_ARRAY:
+    case JS_VALUE_TYPE_OBJECT:
+    case JS_VALUE_TYPE_FUNCTION:
+    case JS_VALUE_TYPE_MAP:
+    case JS_VALUE_TYPE_BUFFER:
+    case JS_VALUE_TYPE_TYPED_ARRAY:
+    case JS_VALUE_TYPE_PROMISE:
+    case JS_VALUE_TYPE_COROUTINE:
+    case JS_VALUE_TYPE_REGEXP:
+    case JS_VALUE_TYPE_STRING: /*strings were compared above*/
+    case JS_VALUE_TYPE_STRING_LITERAL:
+        break;
+    }
+    return a->u.object == b->u.object;
+}
+
+/*the slot holding k,else the empty slot that ends its probe*/
+int map_probe(JsMap *map, const JsValue *k, unsigned int hash)
+{
+    int i = hash & map->mask;
+    int slot;
+    for (;; i = (i + 1) & map->mask)
+    {
+        slot = map->slots[i];
+        if (0 == slot)
+        {
+            return i;
+        }
+        if (slot > 0 && map_same(&map->entries[slot - 1].key, k))
+        {
+            return i;
+        }
+    }
+}
+
+/*room for alloc entries,the live ones move to the front in their order*/
+void map_rebuild(JsInterpreter *inter, JsMap *map, int alloc, int line)
+{
+    JsMapEntry *entries = gc_payload_alloc(inter, sizeof(JsMapEntry) * alloc, line);
+    int count = MAP_MIN_ALLOC * 2;
+    int *slots;
+    int used = 0;
+    int i;
+    while (count < alloc * 2)
+    {
+        count *= 2;
+    }
+    slots = gc_payload_alloc(inter, sizeof(int) * count, line);
+    if (NULL == entries || NULL == slots)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "map", line);
+    }
+    memset(slots, 0, sizeof(int) * count);
+    for (i = 0; i < map->used; i++)
+    {
+        if (0 != map->entries[i].key.typ)
+        {
+            entries[used++] = map->entries[i];
+        }
+    }
+    gc_payload_free(inter, map->entries);
+    gc_payload_free(inter, map->slots);
+    map->entries = entries;
+    map->slots = slots;
+    map->used = used;
+    map->alloc = alloc;
+    map->mask = count - 1;
+    for (i = 0; i < used; i++)
+    {
+        slots[map_probe(map, &entries[i].key, map_hash(&entries[i].key))] = i + 1;
+    }
+}
+
+/*a map restored from a snapshot has its entries but no table yet*/
+void map_table(JsInterpreter *inter, JsMap *map, int line)
+{
+    if (NULL == map->slots && 0 != map->used)
+    {
+        map_rebuild(inter, map, map->used, line);
+    }
+}
+
+JsValue MAP_create(JsInterpreter *inter, char set, int line)
+{
+    JsValue v;
+    v.typ = JS_VALUE_TYPE_MAP;
+    v.u.map = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_MAP, 0, line);
+    v.u.map->set = set;
+    return v;
+}
+
+JsMapEntry *MAP_find(JsInterpreter *inter, JsMap *map, const JsValue *key, int line)
+{
+    JsValue k;
+    int slot;
+    if (0 == map->size)
+    {
+        return NULL;
+    }
+    map_table(inter, map, line);
+    map_key(key, &k);
+    slot = map->slots[map_probe(map, &k, map_hash(&k))];
+    return 0 == slot ? NULL : map->entries + slot - 1;
+}
+
+void MAP_set(JsInterpreter *inter, JsMap *map, const JsValue *key, const JsValue *value, int line)
+{
+    JsValue k;
+    unsigned int hash;
+    int alloc;
+    int i;
+    map_table(inter, map, line);
+    map_key(key, &k);
+    hash = map_hash(&k);
+    if (NULL != map->slots)
+    {
+        i = map_probe(map, &k, hash);
+        if (0 != map->slots[i])
+        {
+            map->entries[map->slots[i] - 1].value = *value;
+            return;
+        }
+    }
+    if (map->used == map->alloc)
+    { /*squeeze out the holes,grow when that would not free half*/
+        alloc = map->size >= map->alloc / 2 ? map->alloc * 2 : map->alloc;
+        map_rebuild(inter, map, alloc < MAP_MIN_ALLOC ? MAP_MIN_ALLOC : alloc, line);
+    }
+    i = map_probe(map, &k, hash);
+    map->entries[map->used].key = k;
+    map->entries[map->used].value = *value;
+    map->slots[i] = ++map->used;
+    map->size++;
+}
+
+/*
+ * the slot is left as -1 so probes go on past it,rebuild clears those.
+ * a map emptied by deletes starts over from the front of its entries.
+ */
+int MAP_delete(JsInterpreter *inter, JsMap *map, const JsValue *key, int line)
+{
+    JsValue k;
+    int i;
+    if (0 == map->size)
+    {
+        return 0;
+    }
+    map_table(inter, map, line);
+    map_key(key, &k);
+    i = map_probe(map, &k, map_hash(&k));
+    if (0 == map->slots[i])
+    {
+        return 0;
+    }
+    map->entries[map->slots[i] - 1].key.typ = 0;
+    map->entries[map->slots[i] - 1].value.typ = 0;
+    map->slots[i] = -1;
+    if (0 == --map->size)
+    {
+        MAP_clear(map);
+    }
+    return 1;
+}
+
+void MAP_clear(JsMap *map)
+{
+    if (NULL != map->slots)
+    {
+        memset(map->slots, 0, sizeof(int) * (map->mask + 1));
+    }
+    map->size = 0;
+    map->used = 0;
+}
+
+JsValue MAP_items(JsInterpreter *inter, JsMap *map, MAP_ITEM item, int line)
+{
+    JsValue items;
+    JsValue *v;
+    JsArray *pair;
+    int i;
+    items.typ = JS_VALUE_TYPE_ARRAY;
+    items.u.array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, map->size, line);
+    for (i = 0; i < map->used; i++)
+    {
+        if (0 == map->entries[i].key.typ)
+        {
+            continue;
+        }
+        v = items.u.array->elements + items.u.array->length++;
+        if (MAP_ITEM_KEYS == item)
+        {
+            *v = map->entries[i].key;
+        }
+        else if (MAP_ITEM_VALUES == item)
+        {
+            *v = map->entries[i].value;
+        }
+        else
+        {
+            pair = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, 2, line);
+            pair->elements[0] = map->entries[i].key;
+            pair->elements[1] = map->entries[i].value;
+            pair->length = 2;
+            v->typ = JS_VALUE_TYPE_ARRAY;
+            v->u.array = pair;
+        }
+    }
+    return items;
+}
@@ -0,0 +1,27 @@
+#ifndef MAP_H
+#define MAP_H
+#include "js.h"
+
+/*an empty Map,or a Set when set is 1*/
+JsValue MAP_create(JsInterpreter *inter, char set, int line);
+
+/*the entry of key,NULL when there is none*/
+JsMapEntry *MAP_find(JsInterpreter *inter, JsMap *map, const JsValue *key, int line);
+
+void MAP_set(JsInterpreter *inter, JsMap *map, const JsValue *key, const JsValue *value, int line);
+
+/*1 when key was there*/
+int MAP_delete(JsInterpreter *inter, JsMap *map, const JsValue *key, int line);
+
+void MAP_clear(JsMap *map);
+
+/*keys,values or [key,value] pairs in insertion order as a new array*/
+typedef enum
+{
+    MAP_ITEM_KEYS,
+    MAP_ITEM_VALUES,
+    MAP_ITEM_ENTRIES
+} MAP_ITEM;
+JsValue MAP_items(JsInterpreter *inter, JsMap *map, MAP_ITEM item, int line);
+
+#endif
@@ -183,6 +183,8 @@ void mem_binary_tree_delete(MemoryBinaryTree *head, char *p)
 		}
 		successor->left = position->left;
 		successor->right = position->right;
+		successor->left->parent = successor;
+		successor->right->parent = successor;
 		free(position);
 		return;
 	}
@@ -200,6 +202,8 @@ void mem_binary_tree_delete(MemoryBinaryTree *head, char *p)
 	}
 	successor->left = position->left;
 	successor->right = position->right;
+	successor->left->parent = successor;
+	successor->right->parent = successor;
 	free(position);
 }
 
@@ -213,7 +217,7 @@ Memory *MEM_open_storage()
 	int i = 0;
 	for (; i < MOD_NUMBER; i++)
 	{
-		m->table[i] = (MemoryBinaryTree *)malloc(sizeof(MemoryBinaryTree));
+		m->table[i] = m->heads + i;
 		m->table[i]->parent = NULL;
 		m->table[i]->pointer = NULL;
 		m->table[i]->left = NULL;
@@ -232,7 +236,8 @@ void MEM_close_storage(Memory *m)
 	int i = 0;
 	for (; i < MOD_NUMBER; i++)
 	{
-		mem_binary_tree_delete_tree(m->table[i]);
+		mem_binary_tree_delete_tree(m->table[i]->left);
+		mem_binary_tree_delete_tree(m->table[i]->right);
 	}
 	free(m);
 }
@@ -18,6 +18,7 @@ typedef struct MemoryBinaryTree_s
 typedef struct Memory_s
 {
 	MemoryBinaryTree *table[MOD_NUMBER];
+	MemoryBinaryTree heads[MOD_NUMBER]; /*one block,a new storage does not fill holes of the old heap*/
 } Memory;
 
 char *MEM_alloc(Memory *m, int size, int line);
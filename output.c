@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "js.h"
+#include "output.h"
+
+/*
+ * console output.
+ * a printf per value and per separator made a call into stdio for every
+ * array element and every key,now they are appended to one buffer and a
+ * full buffer is a single writev. a string too long to be worth copying
+ * goes out in the same writev as the buffer in front of it.
+ * a terminal gets every line as it ends,JS_LINE_BUFFERED=1 or 0 overrides.
+ */
+
+/*writev until every byte is out,partial writes go on from where they stopped*/
+void output_writev(int fd, struct iovec *iov, int count)
+{
+    ssize_t n;
+    while (count > 0)
+    {
+        n = writev(fd, iov, count);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return; /*nobody reads the output any more*/
+        }
+        while (count > 0 && n >= (ssize_t)iov->iov_len)
+        {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+void OUTPUT_open(JsOutput *out, int fd)
+{
+    char *env = getenv("JS_LINE_BUFFERED");
+    out->fd = fd;
+    out->length = 0;
+    if (NULL != env && 0 != env[0])
+    {
+        out->line_buffered = 0 != atoi(env);
+    }
+    else
+    {
+        out->line_buffered = isatty(fd);
+    }
+}
+
+void OUTPUT_flush(JsOutput *out)
+{
+    struct iovec iov;
+    if (0 == out->length)
+    {
+        return;
+    }
+    iov.iov_base = out->buf;
+    iov.iov_len = out->length;
+    output_writev(out->fd, &iov, 1);
+    out->length = 0;
+}
+
+void OUTPUT_write(JsOutput *out, const char *s, int length)
+{
+    struct iovec iov[2];
+    if (length >= OUTPUT_DIRECT_SIZE)
+    { /*the buffer and s in one call,s is not copied*/
+        iov[0].iov_base = out->buf;
+        iov[0].iov_len = out->length;
+        iov[1].iov_base = (char *)s;
+        iov[1].iov_len = length;
+        output_writev(out->fd, iov, 2);
+        out->length = 0;
+        return;
+    }
+    if (out->length + length > OUTPUT_BUFFER_SIZE)
+    {
+        OUTPUT_flush(out);
+    }
+    memcpy(out->buf + out->length, s, length);
+    out->length += length;
+}
+
+void OUTPUT_string(JsOutput *out, const char *s)
+{
+    OUTPUT_write(out, s, strlen(s));
+}
+
+/*digits from the end of a small buffer,no format string to parse*/
+void OUTPUT_int(JsOutput *out, int value)
+{
+    char digits[16];
+    char *p = digits + sizeof(digits);
+    unsigned int u = value < 0 ? 0U - (unsigned int)value : (unsigned int)value;
+    do
+    {
+        *--p = '0' + u % 10;
+        u /= 10;
+    } while (0 != u);
+    if (value < 0)
+    {
+        *--p = '-';
+    }
+    OUTPUT_write(out, p, digits + sizeof(digits) - p);
+}
+
+/*printed in place,%f of the largest double is a little over 300 chars*/
+void OUTPUT_float(JsOutput *out, double value)
+{
+    if (out->length + OUTPUT_FLOAT_SIZE > OUTPUT_BUFFER_SIZE)
+    {
+        OUTPUT_flush(out);
+    }
+    out->length += snprintf(out->buf + out->length, OUTPUT_FLOAT_SIZE, "%f", value);
+}
+
+void OUTPUT_newline(JsOutput *out)
+{
+    OUTPUT_write(out, "\n", 1);
+    if (0 != out->line_buffered)
+    {
+        OUTPUT_flush(out);
+    }
+}
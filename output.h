@@ -0,0 +1,19 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+#include "js.h"
+
+/*
+ * buffered console output.
+ * values are formatted straight into the buffer of the interpreter,
+ * it goes out in one system call when full,at a line end in line mode,
+ * or when flushed. output written to fd any other way must flush first.
+ */
+void OUTPUT_open(JsOutput *out, int fd);
+void OUTPUT_write(JsOutput *out, const char *s, int length);
+void OUTPUT_string(JsOutput *out, const char *s);
+void OUTPUT_int(JsOutput *out, int value);
+void OUTPUT_float(JsOutput *out, double value);
+void OUTPUT_newline(JsOutput *out);
+void OUTPUT_flush(JsOutput *out);
+
+#endif
@@ -0,0 +1,416 @@
+#include <string.h>
+#include "js.h"
+#include "error.h"
+#include "heap.h"
+#include "stack.h"
+#include "interprete.h"
+#include "expression.h"
+#include "js_value.h"
+#include "loop.h"
+#include "coroutine.h"
+#include "promise.h"
+
+/*
+ * promises.
+ * a pending promise keeps its reactions,a payload like the elements of an
+ * array. settling queues each of them as a microtask on the event loop,a
+ * reaction added later is queued at once. resolve and reject handed to an
+ * executor are builtins bound to a cell env holding the promise,the first
+ * call takes it out so later ones do nothing.
+ * a rejection that still has no reaction once the microtasks ran is a
+ * runtime error,like one nothing catches.
+ */
+
+JsFunctionBuildin promise_buildins[PROMISE_BUILDIN_COUNT];
+JsFunction promise_functions[PROMISE_BUILDIN_COUNT];
+JsKvList promise_fields[PROMISE_BUILDIN_COUNT];
+JsObject promise_object;
+VariableList promise_var_list;
+
+JsFunctionBuildin promise_resolve_buildin;
+JsFunctionBuildin promise_reject_buildin;
+JsFunctionBuildin promise_all_element_buildin;
+
+JsValue PROMISE_create(JsInterpreter *inter, int line)
+{
+    JsValue v;
+    v.typ = JS_VALUE_TYPE_PROMISE;
+    v.u.promise = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_PROMISE, 0, line);
+    return v;
+}
+
+void promise_settle(JsInterpreter *inter, JsPromise *p, const JsValue *v, JS_PROMISE_STATE state, int line)
+{
+    JsReaction *r;
+    int i;
+    p->state = state;
+    p->value = *v;
+    for (i = 0; i < p->reaction_count; i++)
+    {
+        r = p->reactions + i;
+        LOOP_queue_reaction(inter, JS_PROMISE_FULFILLED == state ? &r->fulfilled : &r->rejected, v, &r->target, JS_PROMISE_REJECTED == state, line);
+    }
+    gc_payload_free(inter, p->reactions);
+    p->reactions = NULL;
+    p->reaction_count = 0;
+    p->reaction_alloc = 0;
+    if (JS_PROMISE_REJECTED == state && 0 == p->handled)
+    {
+        LOOP_track_rejection(inter, p, line);
+    }
+}
+
+void PROMISE_resolve(JsInterpreter *inter, JsPromise *p, const JsValue *v, int line)
+{
+    JsValue target;
+    JsValue none;
+    if (JS_PROMISE_PENDING != p->state)
+    {
+        return;
+    }
+    if (JS_VALUE_TYPE_PROMISE != v->typ)
+    {
+        promise_settle(inter, p, v, JS_PROMISE_FULFILLED, line);
+        return;
+    }
+    if (v->u.promise == p)
+    { /*it would wait for itself forever*/
+        none.typ = JS_VALUE_TYPE_STRING_LITERAL;
+        none.u.literal_string = "promise resolved with itself";
+        promise_settle(inter, p, &none, JS_PROMISE_REJECTED, line);
+        return;
+    }
+    target.typ = JS_VALUE_TYPE_PROMISE;
+    target.u.promise = p;
+    none.typ = JS_VALUE_TYPE_UNDEFINED;
+    PROMISE_react(inter, v->u.promise, &none, &none, &target, line);
+}
+
+void PROMISE_reject(JsInterpreter *inter, JsPromise *p, const JsValue *reason, int line)
+{
+    if (JS_PROMISE_PENDING == p->state)
+    {
+        promise_settle(inter, p, reason, JS_PROMISE_REJECTED, line);
+    }
+}
+
+void PROMISE_react(JsInterpreter *inter, JsPromise *p, const JsValue *fulfilled, const JsValue *rejected, const JsValue *target, int line)
+{
+    JsReaction *reactions;
+    JsReaction *r;
+    p->handled = 1;
+    if (JS_PROMISE_PENDING != p->state)
+    {
+        LOOP_queue_reaction(inter, JS_PROMISE_FULFILLED == p->state ? fulfilled : rejected, &p->value, target, JS_PROMISE_REJECTED == p->state, line);
+        return;
+    }
+    if (p->reaction_count == p->reaction_alloc)
+    {
+        reactions = gc_payload_alloc(inter, sizeof(JsReaction) * (p->reaction_alloc * 2 + 2), line);
+        if (NULL == reactions)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "promise", line);
+            return;
+        }
+        if (0 != p->reaction_count)
+        {
+            memcpy(reactions, p->reactions, sizeof(JsReaction) * p->reaction_count);
+        }
+        gc_payload_free(inter, p->reactions);
+        p->reactions = reactions;
+        p->reaction_alloc = p->reaction_alloc * 2 + 2;
+    }
+    r = p->reactions + p->reaction_count++;
+    r->fulfilled = *fulfilled;
+    r->rejected = *rejected;
+    r->target = *target;
+}
+
+JsValue PROMISE_then(JsInterpreter *inter, JsPromise *p, const JsValue *fulfilled, const JsValue *rejected, int line)
+{
+    JsValue q = PROMISE_create(inter, line);
+    PROMISE_react(inter, p, fulfilled, rejected, &q, line);
+    return q;
+}
+
+void PROMISE_run_job(JsInterpreter *inter, JsJob *job)
+{
+    JsValue v = job->arg;
+    char rejected = job->rejected;
+    if (JS_VALUE_TYPE_COROUTINE == job->target.typ)
+    {
+        COROUTINE_resume(inter, job->target.u.coroutine, &v, rejected);
+        return;
+    }
+    if (JS_VALUE_TYPE_FUNCTION == job->func.typ)
+    { /*a handler that returns has handled the rejection*/
+        push_stack(&inter->stack, &job->target);
+        v = eval_call_value(inter, &job->func, &v, 1, 0);
+        job->target = pop_stack(&inter->stack);
+        rejected = 0;
+    }
+    if (JS_VALUE_TYPE_PROMISE != job->target.typ)
+    {
+        return;
+    }
+    if (0 != rejected)
+    {
+        PROMISE_reject(inter, job->target.u.promise, &v, 0);
+    }
+    else
+    {
+        PROMISE_resolve(inter, job->target.u.promise, &v, 0);
+    }
+}
+
+void PROMISE_fail(JsInterpreter *inter, JsPromise *p, int line)
+{
+    JsValue reason = p->value;
+    if (JS_VALUE_TYPE_BOOL == reason.typ)
+    {
+        reason.typ = JS_VALUE_TYPE_STRING_LITERAL;
+        reason.u.literal_string = JS_BOOL_TRUE == p->value.u.boolvalue ? "true" : "false";
+    }
+    else
+    {
+        reason = js_to_string(inter, &reason, line);
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_PROMISE_REJECTED,
+                        JS_VALUE_TYPE_STRING == reason.typ ? reason.u.string->s : reason.u.literal_string,
+                        0 != line ? line : p->line);
+}
+
+/*a builtin that keeps its state in env*/
+JsValue promise_bind(JsInterpreter *inter, JsFunctionBuildin *buildin, ExecuteEnvironment *env, int line)
+{
+    JsValue v;
+    v.typ = JS_VALUE_TYPE_FUNCTION;
+    v.u.func = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_FUNCTION, 0, line);
+    memset(v.u.func, 0, sizeof(JsFunction));
+    v.u.func->typ = JS_FUNCTION_TYPE_BUILDIN;
+    v.u.func->name = "";
+    v.u.func->buildin = buildin;
+    v.u.func->env = env;
+    return v;
+}
+
+/*resolve and reject of promise share one env*/
+void promise_bind_pair(JsInterpreter *inter, JsValue *promise, JsValue *resolve, JsValue *reject, int line)
+{
+    ExecuteEnvironment *env = INTERPRETER_alloc_cell_env(inter, NULL, line);
+    INTERPRETER_create_variable(inter, env, "promise", promise, line);
+    *resolve = promise_bind(inter, &promise_resolve_buildin, env, line);
+    *reject = promise_bind(inter, &promise_reject_buildin, env, line);
+}
+
+JsValue promise_settle_function(JsInterpreter *inter, JsFunction *func, const JsValue *v, char rejected, int line)
+{
+    JsValue *promise = INTERPRETE_search_variable_from_env(func->env, "promise");
+    JsValue none;
+    JsPromise *p;
+    none.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (NULL == promise || JS_VALUE_TYPE_PROMISE != promise->typ)
+    { /*settled by an earlier call*/
+        return none;
+    }
+    p = promise->u.promise;
+    *promise = none;
+    if (0 != rejected)
+    {
+        PROMISE_reject(inter, p, v, line);
+    }
+    else
+    {
+        PROMISE_resolve(inter, p, v, line);
+    }
+    return none;
+}
+
+JsValue promise_resolve_function(JsInterpreter *inter, JsFunction *func, const JsValue *v, int line)
+{
+    return promise_settle_function(inter, func, v, 0, line);
+}
+
+JsValue promise_reject_function(JsInterpreter *inter, JsFunction *func, const JsValue *v, int line)
+{
+    return promise_settle_function(inter, func, v, 1, line);
+}
+
+JsValue PROMISE_construct(JsInterpreter *inter, const JsValue *executor, int line)
+{
+    JsValue promise = PROMISE_create(inter, line);
+    JsValue args[2];
+    push_stack(&inter->stack, &promise); /*the executor runs code*/
+    promise_bind_pair(inter, &promise, args, args + 1, line);
+    eval_call_value(inter, executor, args, 2, line);
+    return pop_stack(&inter->stack);
+}
+
+/*values[index] of Promise.all,the last one resolves its promise*/
+JsValue promise_all_element_function(JsInterpreter *inter, JsFunction *func, const JsValue *v, int line)
+{
+    Variable *index = INTERPRETER_search_variable_in_env(func->env, "index");
+    JsValue *promise = INTERPRETE_search_variable_from_env(func->env, "promise");
+    JsValue *values = INTERPRETE_search_variable_from_env(func->env, "values");
+    JsValue *remaining = INTERPRETE_search_variable_from_env(func->env, "remaining");
+    JsValue none;
+    JsPromise *p;
+    none.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (JS_VALUE_TYPE_INT != index->value.typ || JS_VALUE_TYPE_PROMISE != promise->typ)
+    { /*called before,or another element was rejected*/
+        return none;
+    }
+    values->u.array->elements[index->value.u.intvalue] = *v;
+    index->value = none;
+    if (0 == --remaining->u.intvalue)
+    {
+        p = promise->u.promise;
+        *promise = none;
+        PROMISE_resolve(inter, p, values, line);
+    }
+    return none;
+}
+
+JsValue promise_all_function(JsInterpreter *inter, const JsValue *items, int line)
+{
+    JsValue promise = PROMISE_create(inter, line);
+    JsValue values;
+    JsValue element;
+    JsValue resolve;
+    JsValue reject;
+    JsValue none;
+    JsArray *array;
+    ExecuteEnvironment *env;
+    ExecuteEnvironment *element_env;
+    Variable *remaining;
+    int i;
+    if (JS_VALUE_TYPE_ARRAY != items->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "Promise.all", line);
+        return promise;
+    }
+    array = items->u.array;
+    values.typ = JS_VALUE_TYPE_ARRAY;
+    values.u.array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, array->length, line);
+    values.u.array->length = array->length;
+    none.typ = JS_VALUE_TYPE_INT;
+    none.u.intvalue = 0;
+    env = INTERPRETER_alloc_cell_env(inter, NULL, line);
+    INTERPRETER_create_variable(inter, env, "promise", &promise, line);
+    INTERPRETER_create_variable(inter, env, "values", &values, line);
+    remaining = INTERPRETER_create_variable(inter, env, "remaining", &none, line);
+    reject = promise_bind(inter, &promise_reject_buildin, env, line);
+    none.typ = 0; /*no target,what the handlers give is dropped*/
+    for (i = 0; i < array->length; i++)
+    {
+        element = array->elements[i];
+        if (JS_VALUE_TYPE_PROMISE != element.typ)
+        {
+            values.u.array->elements[i] = element;
+            continue;
+        }
+        values.u.array->elements[i].typ = JS_VALUE_TYPE_UNDEFINED;
+        element_env = INTERPRETER_alloc_cell_env(inter, env, line);
+        resolve.typ = JS_VALUE_TYPE_INT;
+        resolve.u.intvalue = i;
+        INTERPRETER_create_variable(inter, element_env, "index", &resolve, line);
+        resolve = promise_bind(inter, &promise_all_element_buildin, element_env, line);
+        PROMISE_react(inter, element.u.promise, &resolve, &reject, &none, line);
+        remaining->value.u.intvalue++;
+    }
+    if (0 == remaining->value.u.intvalue)
+    {
+        PROMISE_resolve(inter, promise.u.promise, &values, line);
+    }
+    return promise;
+}
+
+/*settles as the first element that settles*/
+JsValue promise_race_function(JsInterpreter *inter, const JsValue *items, int line)
+{
+    JsValue promise = PROMISE_create(inter, line);
+    JsValue resolve;
+    JsValue reject;
+    JsValue none;
+    JsArray *array;
+    int i;
+    if (JS_VALUE_TYPE_ARRAY != items->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "Promise.race", line);
+        return promise;
+    }
+    array = items->u.array;
+    promise_bind_pair(inter, &promise, &resolve, &reject, line);
+    none.typ = 0;
+    for (i = 0; i < array->length; i++)
+    {
+        if (JS_VALUE_TYPE_PROMISE == array->elements[i].typ)
+        {
+            PROMISE_react(inter, array->elements[i].u.promise, &resolve, &reject, &none, line);
+        }
+        else
+        {
+            promise_resolve_function(inter, resolve.u.func, array->elements + i, line);
+        }
+    }
+    return promise;
+}
+
+JsValue promise_resolved_function(JsInterpreter *inter, const JsValue *v, int line)
+{
+    JsValue promise;
+    if (JS_VALUE_TYPE_PROMISE == v->typ)
+    {
+        return *v;
+    }
+    promise = PROMISE_create(inter, line);
+    PROMISE_resolve(inter, promise.u.promise, v, line);
+    return promise;
+}
+
+JsValue promise_rejected_function(JsInterpreter *inter, const JsValue *v, int line)
+{
+    JsValue promise = PROMISE_create(inter, line);
+    PROMISE_reject(inter, promise.u.promise, v, line);
+    return promise;
+}
+
+void promise_add(int i, char *name, JsValue (*f)(JsInterpreter *, const JsValue *, int))
+{
+    promise_buildins[i].args_count = 1;
+    promise_buildins[i].with_interpreter = 1;
+    promise_buildins[i].u.inter1 = f;
+    promise_functions[i].typ = JS_FUNCTION_TYPE_BUILDIN;
+    promise_functions[i].name = name;
+    promise_functions[i].buildin = promise_buildins + i;
+    promise_fields[i].kv.key = name;
+    promise_fields[i].kv.value.typ = JS_VALUE_TYPE_FUNCTION;
+    promise_fields[i].kv.value.u.func = promise_functions + i;
+    promise_fields[i].next = i + 1 < PROMISE_BUILDIN_COUNT ? promise_fields + i + 1 : NULL;
+}
+
+void promise_add_bound(JsFunctionBuildin *buildin, JsValue (*f)(JsInterpreter *, JsFunction *, const JsValue *, int))
+{
+    buildin->args_count = 1;
+    buildin->with_interpreter = 1;
+    buildin->with_function = 1;
+    buildin->u.bound1 = f;
+}
+
+void PROMISE_add_buildin(JsInterpreter *inter)
+{
+    promise_add(0, "resolve", promise_resolved_function);
+    promise_add(1, "reject", promise_rejected_function);
+    promise_add(2, "all", promise_all_function);
+    promise_add(3, "race", promise_race_function);
+    promise_add_bound(&promise_resolve_buildin, promise_resolve_function);
+    promise_add_bound(&promise_reject_buildin, promise_reject_function);
+    promise_add_bound(&promise_all_element_buildin, promise_all_element_function);
+    promise_object.typ = JS_OBJECT_TYPE_BUILDIN;
+    promise_object.eles = promise_fields;
+    promise_var_list.var.name = "Promise";
+    promise_var_list.var.value.typ = JS_VALUE_TYPE_OBJECT;
+    promise_var_list.var.value.u.object = &promise_object;
+    promise_var_list.next = inter->env.vars;
+    inter->env.vars = &promise_var_list;
+}
@@ -0,0 +1,37 @@
+#ifndef PROMISE_H
+#define PROMISE_H
+#include "js.h"
+
+#define PROMISE_BUILDIN_COUNT 4
+
+/*a pending promise*/
+JsValue PROMISE_create(JsInterpreter *inter, int line);
+
+/*fulfills p with v,or makes p follow v when v is a promise,a settled p stays as it is*/
+void PROMISE_resolve(JsInterpreter *inter, JsPromise *p, const JsValue *v, int line);
+
+void PROMISE_reject(JsInterpreter *inter, JsPromise *p, const JsValue *reason, int line);
+
+/*
+ * the handler for how p settles is called with its value as a microtask,
+ * its result settles target,a promise,or resumes target,a coroutine.
+ * handlers that are no function pass the value on.
+ */
+void PROMISE_react(JsInterpreter *inter, JsPromise *p, const JsValue *fulfilled, const JsValue *rejected, const JsValue *target, int line);
+
+/*p.then(fulfilled,rejected),a new promise*/
+JsValue PROMISE_then(JsInterpreter *inter, JsPromise *p, const JsValue *fulfilled, const JsValue *rejected, int line);
+
+/*new Promise(executor)*/
+JsValue PROMISE_construct(JsInterpreter *inter, const JsValue *executor, int line);
+
+/*a job queued by a reaction,see LOOP_queue_reaction*/
+void PROMISE_run_job(JsInterpreter *inter, JsJob *job);
+
+/*the runtime error for a rejection nothing handles*/
+void PROMISE_fail(JsInterpreter *inter, JsPromise *p, int line);
+
+/*the Promise global with resolve,reject,all and race*/
+void PROMISE_add_buildin(JsInterpreter *inter);
+
+#endif
@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "js.h"
+#include "error.h"
+#include "heap.h"
+#include "interprete.h"
+#include "reader.h"
+
+/*
+ * line readers.
+ * a reader reads its file a block at a time and hands out the lines of the
+ * block. a block of READER_BLOCK_SIZE is a payload of the gc heap,a line
+ * taken from it is a string over the chars where they are,its line end
+ * turned into the terminating 0. the block is not written again once a
+ * line of it is out,later reads go behind it or into a new block,and gc
+ * compaction copies out the lines still alive and gives the rest back,
+ * so a file of any size is read in the memory of the lines kept.
+ * a line longer than half a block goes into a bigger block,malloced and
+ * never shared: its lines are copied and it is reused in place.
+ * reader 0 is stdin.
+ */
+
+JsFunctionList reader_read_line;
+JsFunctionBuildin reader_read_line_buildin;
+JsFunctionList reader_read_file;
+JsFunctionBuildin reader_read_file_buildin;
+JsFunctionList reader_open_file;
+JsFunctionBuildin reader_open_file_buildin;
+JsFunctionList reader_close_file;
+JsFunctionBuildin reader_close_file_buildin;
+
+/*a free slot of the reader table,the table grows when there is none*/
+int reader_slot(JsInterpreter *inter, int line)
+{
+    JsReader *readers;
+    int i;
+    for (i = 1; i < inter->reader_count; i++)
+    {
+        if (inter->readers[i].fd < 0)
+        {
+            return i;
+        }
+    }
+    if (inter->reader_count == inter->reader_alloc)
+    {
+        readers = (JsReader *)MEM_alloc(inter->execute_memory, sizeof(JsReader) * (inter->reader_alloc * 2 + 4), line);
+        if (NULL == readers)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "reader", line);
+        }
+        if (NULL != inter->readers)
+        {
+            memcpy(readers, inter->readers, sizeof(JsReader) * inter->reader_count);
+            MEM_free(inter->execute_memory, (char *)inter->readers);
+        }
+        inter->readers = readers;
+        inter->reader_alloc = inter->reader_alloc * 2 + 4;
+    }
+    return inter->reader_count++;
+}
+
+void reader_open(JsReader *r, int fd)
+{
+    r->fd = fd;
+    r->eof = 0;
+    r->block = NULL;
+    r->size = 0;
+    r->start = 0;
+    r->scan = 0;
+    r->end = 0;
+}
+
+/*stdin is opened the first time it is read*/
+JsReader *reader_get(JsInterpreter *inter, int reader, char *who, int line)
+{
+    if (0 == reader && 0 == inter->reader_count)
+    {
+        reader_slot(inter, line);
+        reader_open(inter->readers, 0);
+    }
+    if (reader < 0 || reader >= inter->reader_count || inter->readers[reader].fd < 0)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    return inter->readers + reader;
+}
+
+/*more bytes behind the ones not handed out,in a new block when the old one is full*/
+void reader_fill(JsInterpreter *inter, JsReader *r, int line)
+{
+    int rest = r->end - r->start;
+    int size = READER_BLOCK_SIZE;
+    char *block;
+    ssize_t n;
+    if (NULL == r->block || r->end == r->size - 1)
+    {
+        while (rest >= size / 2)
+        { /*a long line,room for it and some more*/
+            size *= 2;
+        }
+        if (size > READER_BLOCK_SIZE && size <= r->size)
+        { /*nothing points into a big block,it is moved in place*/
+            memmove(r->block, r->block + r->start, rest);
+        }
+        else
+        {
+            block = gc_payload_alloc(inter, size, line);
+            if (NULL == block)
+            {
+                ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "reader", line);
+            }
+            if (rest > 0)
+            {
+                memcpy(block, r->block + r->start, rest);
+            }
+            if (READER_BLOCK_SIZE != r->size)
+            { /*a shared block stays for its lines,gc takes it*/
+                gc_payload_free(inter, r->block);
+            }
+            r->block = block;
+            r->size = size;
+        }
+        r->scan -= r->start;
+        r->start = 0;
+        r->end = rest;
+    }
+    do
+    { /*the last byte stays free for the 0 behind a last line without line end*/
+        n = read(r->fd, r->block + r->end, r->size - 1 - r->end);
+    } while (n < 0 && EINTR == errno);
+    if (n <= 0)
+    {
+        r->eof = 1;
+        return;
+    }
+    r->end += n;
+}
+
+/*the line from start to stop,stop is its line end or the end of the file*/
+JsValue reader_take(JsInterpreter *inter, JsReader *r, char *stop, int line)
+{
+    char *s = r->block + r->start;
+    int length = stop - s;
+    JsValue v;
+    r->start = stop - r->block + (stop < r->block + r->end);
+    r->scan = r->start;
+    if (length > 0 && '\r' == s[length - 1])
+    {
+        length--;
+    }
+    v.typ = JS_VALUE_TYPE_STRING;
+    if (READER_BLOCK_SIZE == r->size)
+    {
+        s[length] = 0;
+        v.u.string = INTERPRETER_create_string_view(inter, s, length, line);
+        return v;
+    }
+    v.u.string = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, length + 1, line);
+    memcpy(v.u.string->s, s, length);
+    v.u.string->s[length] = 0;
+    v.u.string->length = length;
+    return v;
+}
+
+JsValue READER_read_line(JsInterpreter *inter, int reader, int line)
+{
+    JsReader *r = reader_get(inter, reader, "readLine", line);
+    char *newline;
+    JsValue v;
+    for (;;)
+    {
+        newline = r->scan < r->end ? memchr(r->block + r->scan, '\n', r->end - r->scan) : NULL;
+        if (NULL != newline)
+        {
+            return reader_take(inter, r, newline, line);
+        }
+        r->scan = r->end; /*a long line is not searched again from its start*/
+        if (0 != r->eof)
+        {
+            break;
+        }
+        reader_fill(inter, r, line);
+    }
+    if (r->start < r->end)
+    {
+        return reader_take(inter, r, r->block + r->end, line);
+    }
+    v.typ = JS_VALUE_TYPE_NULL;
+    return v;
+}
+
+/*a path argument as a c string*/
+char *reader_path(const JsValue *value, char *who, int line)
+{
+    if (JS_VALUE_TYPE_STRING == value->typ)
+    {
+        return value->u.string->s;
+    }
+    if (JS_VALUE_TYPE_STRING_LITERAL == value->typ)
+    {
+        return value->u.literal_string;
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    return NULL;
+}
+
+JsValue READER_read_file(JsInterpreter *inter, char *path, int line)
+{
+    char *buf;
+    char *more;
+    int alloc = READER_BLOCK_SIZE;
+    int length = 0;
+    ssize_t n;
+    int fd = open(path, O_RDONLY);
+    JsValue v;
+    if (fd < 0)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CAN_NOT_OPEN_FILE, path, line);
+    }
+    buf = MEM_alloc(inter->execute_memory, alloc, line);
+    for (;;)
+    {
+        if (NULL == buf)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, path, line);
+        }
+        n = read(fd, buf + length, alloc - length);
+        if (n < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        length += n;
+        if (length == alloc)
+        {
+            more = MEM_alloc(inter->execute_memory, alloc * 2, line);
+            if (NULL != more)
+            {
+                memcpy(more, buf, length);
+                alloc *= 2;
+            }
+            MEM_free(inter->execute_memory, buf);
+            buf = more;
+        }
+    }
+    close(fd);
+    v.typ = JS_VALUE_TYPE_STRING;
+    v.u.string = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, length + 1, line);
+    memcpy(v.u.string->s, buf, length);
+    v.u.string->s[length] = 0;
+    v.u.string->length = length;
+    MEM_free(inter->execute_memory, buf);
+    return v;
+}
+
+/*readLine() reads stdin,readLine(reader) a file opened by openFile*/
+JsValue reader_read_line_function(JsInterpreter *inter, const JsValue *value, int line)
+{
+    if (JS_VALUE_TYPE_UNDEFINED == value->typ)
+    {
+        return READER_read_line(inter, 0, line);
+    }
+    if (JS_VALUE_TYPE_INT != value->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "readLine", line);
+    }
+    return READER_read_line(inter, value->u.intvalue, line);
+}
+
+JsValue reader_read_file_function(JsInterpreter *inter, const JsValue *value, int line)
+{
+    return READER_read_file(inter, reader_path(value, "readFile", line), line);
+}
+
+JsValue reader_open_file_function(JsInterpreter *inter, const JsValue *value, int line)
+{
+    char *path = reader_path(value, "openFile", line);
+    int fd = open(path, O_RDONLY);
+    JsValue v;
+    if (fd < 0)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CAN_NOT_OPEN_FILE, path, line);
+    }
+    reader_get(inter, 0, "openFile", line); /*0 is taken by stdin*/
+    v.typ = JS_VALUE_TYPE_INT;
+    v.u.intvalue = reader_slot(inter, line);
+    reader_open(inter->readers + v.u.intvalue, fd);
+    return v;
+}
+
+JsValue reader_close_file_function(JsInterpreter *inter, const JsValue *value, int line)
+{
+    JsReader *r;
+    JsValue v;
+    if (JS_VALUE_TYPE_INT != value->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "closeFile", line);
+    }
+    r = reader_get(inter, value->u.intvalue, "closeFile", line);
+    if (r->fd > 0)
+    {
+        close(r->fd);
+    }
+    if (READER_BLOCK_SIZE != r->size)
+    {
+        gc_payload_free(inter, r->block);
+    }
+    reader_open(r, -1);
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+void reader_add(JsInterpreter *inter, JsFunctionList *func, JsFunctionBuildin *buildin, char *name,
+                JsValue (*f)(JsInterpreter *, const JsValue *, int))
+{
+    buildin->args_count = 1;
+    buildin->with_interpreter = 1;
+    buildin->u.inter1 = f;
+    func->func.typ = JS_FUNCTION_TYPE_BUILDIN;
+    func->func.buildin = buildin;
+    func->func.name = name;
+    func->next = inter->env.funcs;
+    inter->env.funcs = func;
+}
+
+void READER_add_buildin(JsInterpreter *inter)
+{
+    reader_add(inter, &reader_read_line, &reader_read_line_buildin, "readLine", reader_read_line_function);
+    reader_add(inter, &reader_read_file, &reader_read_file_buildin, "readFile", reader_read_file_function);
+    reader_add(inter, &reader_open_file, &reader_open_file_buildin, "openFile", reader_open_file_function);
+    reader_add(inter, &reader_close_file, &reader_close_file_buildin, "closeFile", reader_close_file_function);
+}
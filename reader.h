@@ -0,0 +1,14 @@
+#ifndef READER_H
+#define READER_H
+#include "js.h"
+
+/*readLine,readFile,openFile and closeFile*/
+void READER_add_buildin(JsInterpreter *inter);
+
+/*the next line of the reader without its line end,null at the end*/
+JsValue READER_read_line(JsInterpreter *inter, int reader, int line);
+
+/*the whole file as one string*/
+JsValue READER_read_file(JsInterpreter *inter, char *path, int line);
+
+#endif
@@ -0,0 +1,3061 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include "js.h"
+#include "error.h"
+#include "memory.h"
+#include "interprete.h"
+#include "expression.h"
+#include "js_value.h"
+#include "regexp.h"
+
+/*
+ * regular expressions.
+ * a pattern is parsed into a tree and compiled to a program over bytes,
+ * utf-8 text is matched as it is stored and a class of code points is a
+ * choice of byte sequences. a program runs one of two ways:
+ * a lazy dfa builds its states out of the program as the text asks for
+ * them,then takes one table step per byte. the program finds where the
+ * leftmost match ends,the same pattern compiled backwards runs from there
+ * to where it starts. states are cached per program,a full cache starts
+ * over.
+ * a backtracking vm runs what a dfa can not: backreferences,lookaheads,
+ * word boundaries and anchors at lines. it also fills in the groups of a
+ * match the dfa found,started right where the match starts.
+ * a literal compiles once per site,all its evaluations share the program.
+ * indices are byte offsets into the utf-8 text.
+ */
+
+#define REGEXP_MAX_INSTS (1024 * 1024)  /*the budget of one program,a pattern past it is too big*/
+#define REGEXP_MAX_REPEAT REGEXP_MAX_INSTS /*a count of {n,m} reads up to here,a bigger one can not fit*/
+#define REGEXP_MAX_DEPTH 200            /*groups nested deeper are an error,the parser recurses*/
+#define REGEXP_DFA_INSTS 8192           /*bigger programs are only backtracked*/
+#define REGEXP_DFA_STATES 4096          /*states cached before the cache starts over*/
+#define REGEXP_DFA_CHUNK (256 * 1024)   /*states are cut from chunks,one state always fits*/
+#define REGEXP_DFA_CHUNKS 32
+#define REGEXP_DFA_BUCKETS 1024
+#define REGEXP_DFA_MARKS 16             /*loops that may match empty a dfa keeps apart,see regexp_dfa_closure*/
+#define REGEXP_DFA_MASKED 1024          /*threads of one closure inside such loops*/
+#define REGEXP_THREAD_BITS 14           /*a thread is a pc and the loops it entered without reading a byte*/
+#define REGEXP_THREAD_PC(t) ((t) & ((1 << REGEXP_THREAD_BITS) - 1))
+#define REGEXP_MEMO_BITS (2 * 1024 * 1024) /*pc and position pairs a backtracking run remembers as failed*/
+#define REGEXP_CODE_POINT_MAX 0x10FFFF
+
+#define REGEXP_FLAG_GLOBAL 1
+#define REGEXP_FLAG_IGNORE_CASE 2
+#define REGEXP_FLAG_MULTILINE 4
+#define REGEXP_FLAG_DOTALL 8
+#define REGEXP_FLAG_STICKY 16
+
+#define REGEXP_AT_BEGIN 1
+#define REGEXP_AT_END 2
+
+typedef enum
+{
+    REGEXP_OP_BYTE = 1,
+    REGEXP_OP_SET,     /*a byte of set x*/
+    REGEXP_OP_SPLIT,   /*x first,then y*/
+    REGEXP_OP_JMP,
+    REGEXP_OP_SAVE,    /*the position goes to slot x*/
+    REGEXP_OP_MARK,    /*slot x holds where an iteration that may be empty started*/
+    REGEXP_OP_CHECK,   /*fails when the iteration did not move on from slot x*/
+    REGEXP_OP_RESET,   /*groups x to y took no part yet,each iteration starts them over*/
+    REGEXP_OP_BOL,
+    REGEXP_OP_EOL,
+    REGEXP_OP_WORDB,
+    REGEXP_OP_NWORDB,
+    REGEXP_OP_BACKREF, /*what group x matched*/
+    REGEXP_OP_LOOK,    /*the lookahead up to its LOOKEND,x is after it,y negates*/
+    REGEXP_OP_LOOKEND,
+    REGEXP_OP_MATCH
+} REGEXP_OP;
+
+typedef struct
+{
+    int op; /*a REGEXP_OP*/
+    int x;
+    int y;
+} RegexInst;
+
+typedef enum
+{
+    REGEXP_NODE_EMPTY = 1,
+    REGEXP_NODE_SET,     /*one byte out of set x*/
+    REGEXP_NODE_CAT,     /*children from left to right*/
+    REGEXP_NODE_ALT,
+    REGEXP_NODE_REPEAT,  /*left x to y times,y -1 for no limit*/
+    REGEXP_NODE_GROUP,   /*capturing group x*/
+    REGEXP_NODE_ASSERT,  /*x is the op*/
+    REGEXP_NODE_BACKREF,
+    REGEXP_NODE_LOOK     /*x negates*/
+} REGEXP_NODE;
+
+typedef struct
+{
+    int typ;   /*a REGEXP_NODE*/
+    int left;  /*the child,the first one of a list*/
+    int right; /*the last one of a list*/
+    int next;  /*siblings in the list of the parent*/
+    int prev;
+    int x;
+    int y;
+    char greedy;
+} RegexNode;
+
+/*a set of program threads in priority order,reached after some text*/
+typedef struct RegexState_tag RegexState;
+struct RegexState_tag
+{
+    RegexState *chain; /*next in its bucket*/
+    unsigned int hash;
+    int count;         /*0 for the dead state*/
+    char match;
+    int *threads;
+    RegexState *next[1]; /*per byte class,NULL until taken*/
+};
+
+typedef struct RegexChunk_tag
+{
+    struct RegexChunk_tag *next;
+} RegexChunk;
+
+typedef struct
+{
+    RegexInst *code;
+    int length;
+    char longest;              /*the backward dfa looks for the earliest start,not the first choice*/
+    RegexState *starts[2];     /*at the beginning of the text or not*/
+    RegexState *buckets[REGEXP_DFA_BUCKETS];
+    RegexChunk *chunks;        /*kept when the cache starts over*/
+    RegexChunk *chunk;
+    int chunk_count;
+    char *top;
+    char *limit;
+    int states;
+    char flushed;              /*states taken before are gone*/
+    int *list;                 /*threads of the state being built*/
+    int *stack;
+    int *seen;                 /*pcs the closure went through with no loop entered*/
+    int *listed;               /*pcs on the list*/
+    int *masked;               /*threads the closure went through inside loops*/
+    int masked_count;
+    int mark_base;             /*the slot of the first loop mark*/
+    char overflow;             /*too many masked threads,the program is backtracked from now on*/
+    int generation;
+} RegexDfa;
+
+/*a branch to try later,or a slot to restore when pc is negative*/
+typedef struct
+{
+    int pc;
+    int pos;
+} RegexBranch;
+
+struct RegexProg_tag
+{
+    Memory *memory;
+    char *source;
+    char *flags;
+    int flag_bits;
+    int line;
+    RegexInst *code;
+    int length;
+    int start;                 /*the match itself,before it is the loop of the unanchored dfa*/
+    RegexInst *reverse;        /*the pattern backwards,NULL when no dfa runs it*/
+    int reverse_length;
+    unsigned char (*sets)[32];
+    int set_count;
+    int set_alloc;
+    unsigned char classes[256]; /*bytes no set tells apart share a class*/
+    int class_count;
+    int groups;                /*the match is group 0*/
+    int slot_count;            /*start and end of each group,then the loop marks*/
+    int *slots;
+    char dfa;
+    char memo_ok;              /*a failed pc and position fails again*/
+    char has_first;
+    unsigned char first[32];   /*bytes a match starts with*/
+    RegexDfa *forward;
+    RegexDfa *backward;
+    RegexBranch *stack;
+    int stack_alloc;
+    unsigned char *memo;
+    int memo_positions;
+    int memo_from;
+    int memo_used;
+};
+
+typedef struct
+{
+    RegexProg *prog;
+    const unsigned char *p;
+    const unsigned char *end;
+    RegexNode *nodes;
+    int node_count;
+    int node_alloc;
+    int *ranges; /*lo and hi of the class being read*/
+    int range_count;
+    int range_alloc;
+    int groups;
+    int group_total; /*counted before,a backreference may come before its group*/
+    int counters;
+    RegexInst *code;
+    int code_length;
+    int code_alloc;
+    char backrefs;
+    char looks;
+    char words;
+    char anchors;
+    int line;
+} RegexParser;
+
+/*text built while replacing*/
+typedef struct
+{
+    Memory *memory;
+    char *s;
+    int length;
+    int alloc;
+    int line;
+} RegexText;
+
+int regexp_digit_ranges[] = {'0', '9', -1};
+int regexp_word_ranges[] = {'0', '9', 'A', 'Z', '_', '_', 'a', 'z', -1};
+int regexp_space_ranges[] = {9, 13, 32, 32, 0xA0, 0xA0, 0x1680, 0x1680, 0x2000, 0x200A, 0x2028, 0x2029,
+                             0x202F, 0x202F, 0x205F, 0x205F, 0x3000, 0x3000, 0xFEFF, 0xFEFF, -1};
+int regexp_line_ranges[] = {'\n', '\n', '\r', '\r', 0x2028, 0x2029, -1};
+int regexp_all_ranges[] = {0, REGEXP_CODE_POINT_MAX, -1};
+
+void *regexp_alloc(Memory *memory, int size, int line)
+{
+    void *p = MEM_alloc(memory, size, line);
+    if (NULL == p)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "regexp", line);
+    }
+    return p;
+}
+
+/*p with room for more than count elements*/
+void *regexp_grow(Memory *memory, void *p, int *alloc, int count, int size, int line)
+{
+    void *q;
+    int n;
+    if (count < *alloc)
+    {
+        return p;
+    }
+    n = 0 == *alloc ? 16 : *alloc * 2;
+    while (n <= count)
+    {
+        n *= 2;
+    }
+    q = regexp_alloc(memory, n * size, line);
+    if (NULL != p)
+    {
+        memcpy(q, p, (long)*alloc * size);
+        MEM_free(memory, p);
+    }
+    *alloc = n;
+    return q;
+}
+
+void regexp_fail(RegexParser *parser, char *message)
+{
+    ERROR_runtime_error(RUNTIME_ERROR_INVALID_REGEXP, message, parser->line);
+}
+
+void regexp_set_add(unsigned char *set, int lo, int hi)
+{
+    int b;
+    for (b = lo; b <= hi; b++)
+    {
+        set[b >> 3] |= 1 << (b & 7);
+    }
+}
+
+int regexp_set_has(const unsigned char *set, int b)
+{
+    return set[b >> 3] & (1 << (b & 7));
+}
+
+/*the only byte of set,-1 when it has more or none*/
+int regexp_set_single(const unsigned char *set)
+{
+    int i;
+    int b;
+    int found = -1;
+    for (i = 0; i < 32; i++)
+    { /*a pattern is emitted once per copy of a repeat,skip the empty bytes of the set*/
+        if (0 == set[i])
+        {
+            continue;
+        }
+        if (found >= 0 || 0 != (set[i] & (set[i] - 1)))
+        {
+            return -1;
+        }
+        b = 0;
+        while (0 == (set[i] & (1 << b)))
+        {
+            b++;
+        }
+        found = i * 8 + b;
+    }
+    return found;
+}
+
+int regexp_new_set(RegexParser *parser)
+{
+    RegexProg *prog = parser->prog;
+    prog->sets = regexp_grow(prog->memory, prog->sets, &prog->set_alloc, prog->set_count, 32, parser->line);
+    memset(prog->sets[prog->set_count], 0, 32);
+    return prog->set_count++;
+}
+
+int regexp_node(RegexParser *parser, REGEXP_NODE typ, int left, int x, int y)
+{
+    RegexNode *node;
+    parser->nodes = regexp_grow(parser->prog->memory, parser->nodes, &parser->node_alloc, parser->node_count, sizeof(RegexNode), parser->line);
+    node = parser->nodes + parser->node_count;
+    node->typ = typ;
+    node->left = left;
+    node->right = -1;
+    node->next = -1;
+    node->prev = -1;
+    node->x = x;
+    node->y = y;
+    node->greedy = 1;
+    return parser->node_count++;
+}
+
+/*child appended to the CAT or ALT list,a new list when list is -1*/
+int regexp_append(RegexParser *parser, REGEXP_NODE typ, int list, int child)
+{
+    int last;
+    if (list < 0)
+    {
+        list = regexp_node(parser, typ, child, 0, 0);
+        parser->nodes[list].right = child;
+        return list;
+    }
+    last = parser->nodes[list].right;
+    parser->nodes[last].next = child;
+    parser->nodes[child].prev = last;
+    parser->nodes[list].right = child;
+    return list;
+}
+
+/*a list of one is its child*/
+int regexp_unwrap(RegexParser *parser, int list)
+{
+    if (parser->nodes[list].left == parser->nodes[list].right)
+    {
+        return parser->nodes[list].left;
+    }
+    return list;
+}
+
+void regexp_add_range(RegexParser *parser, int lo, int hi)
+{
+    parser->ranges = regexp_grow(parser->prog->memory, parser->ranges, &parser->range_alloc, parser->range_count * 2 + 1, sizeof(int), parser->line);
+    parser->ranges[parser->range_count * 2] = lo;
+    parser->ranges[parser->range_count * 2 + 1] = hi;
+    parser->range_count++;
+}
+
+/*sorted ranges ended by -1,or what they leave out*/
+void regexp_add_ranges(RegexParser *parser, const int *ranges, char negate)
+{
+    int lo = 0;
+    for (; ranges[0] >= 0; ranges += 2)
+    {
+        if (0 == negate)
+        {
+            regexp_add_range(parser, ranges[0], ranges[1]);
+            continue;
+        }
+        if (ranges[0] > lo)
+        {
+            regexp_add_range(parser, lo, ranges[0] - 1);
+        }
+        lo = ranges[1] + 1;
+    }
+    if (0 != negate && lo <= REGEXP_CODE_POINT_MAX)
+    {
+        regexp_add_range(parser, lo, REGEXP_CODE_POINT_MAX);
+    }
+}
+
+int regexp_range_compare(const void *a, const void *b)
+{
+    return ((const int *)a)[0] - ((const int *)b)[0];
+}
+
+int regexp_utf8_encode(int c, unsigned char *b)
+{
+    if (c < 0x80)
+    {
+        b[0] = c;
+        return 1;
+    }
+    if (c < 0x800)
+    {
+        b[0] = 0xC0 | (c >> 6);
+        b[1] = 0x80 | (c & 0x3F);
+        return 2;
+    }
+    if (c < 0x10000)
+    {
+        b[0] = 0xE0 | (c >> 12);
+        b[1] = 0x80 | ((c >> 6) & 0x3F);
+        b[2] = 0x80 | (c & 0x3F);
+        return 3;
+    }
+    b[0] = 0xF0 | (c >> 18);
+    b[1] = 0x80 | ((c >> 12) & 0x3F);
+    b[2] = 0x80 | ((c >> 6) & 0x3F);
+    b[3] = 0x80 | (c & 0x3F);
+    return 4;
+}
+
+/*
+ * code points lo to hi of one encoded length as byte sequences,each byte
+ * of a sequence out of a range of its own. split where that does not hold.
+ */
+void regexp_utf8_node(RegexParser *parser, int lo, int hi, int *alt)
+{
+    int bounds[3] = {0x7F, 0x7FF, 0xFFFF};
+    unsigned char a[4];
+    unsigned char b[4];
+    int i;
+    int m;
+    int n;
+    int set;
+    int seq = -1;
+    for (i = 0; i < 3; i++)
+    {
+        if (lo <= bounds[i] && hi > bounds[i])
+        {
+            regexp_utf8_node(parser, lo, bounds[i], alt);
+            regexp_utf8_node(parser, bounds[i] + 1, hi, alt);
+            return;
+        }
+    }
+    for (i = 1; i < 4; i++)
+    {
+        m = (1 << (6 * i)) - 1;
+        if ((lo & ~m) == (hi & ~m))
+        {
+            continue;
+        }
+        if (0 != (lo & m))
+        {
+            regexp_utf8_node(parser, lo, lo | m, alt);
+            regexp_utf8_node(parser, (lo | m) + 1, hi, alt);
+            return;
+        }
+        if (m != (hi & m))
+        {
+            regexp_utf8_node(parser, lo, (hi & ~m) - 1, alt);
+            regexp_utf8_node(parser, hi & ~m, hi, alt);
+            return;
+        }
+    }
+    n = regexp_utf8_encode(lo, a);
+    regexp_utf8_encode(hi, b);
+    for (i = 0; i < n; i++)
+    {
+        set = regexp_new_set(parser);
+        regexp_set_add(parser->prog->sets[set], a[i], b[i]);
+        seq = regexp_append(parser, REGEXP_NODE_CAT, seq, regexp_node(parser, REGEXP_NODE_SET, -1, set, 0));
+    }
+    *alt = regexp_append(parser, REGEXP_NODE_ALT, *alt, regexp_unwrap(parser, seq));
+}
+
+/*the ranges read so far as a node for one char,folded and negated as asked*/
+int regexp_class_node(RegexParser *parser, char negate)
+{
+    int count = parser->range_count;
+    int *r;
+    int i;
+    int n = 0;
+    int lo;
+    int set;
+    int alt;
+    if (0 != (parser->prog->flag_bits & REGEXP_FLAG_IGNORE_CASE))
+    { /*ascii letters only*/
+        for (i = 0; i < count; i++)
+        {
+            r = parser->ranges + 2 * i;
+            if (r[0] <= 'z' && r[1] >= 'a')
+            {
+                regexp_add_range(parser, (r[0] > 'a' ? r[0] : 'a') - 32, (r[1] < 'z' ? r[1] : 'z') - 32);
+            }
+            r = parser->ranges + 2 * i;
+            if (r[0] <= 'Z' && r[1] >= 'A')
+            {
+                regexp_add_range(parser, (r[0] > 'A' ? r[0] : 'A') + 32, (r[1] < 'Z' ? r[1] : 'Z') + 32);
+            }
+        }
+    }
+    qsort(parser->ranges, parser->range_count, 2 * sizeof(int), regexp_range_compare);
+    for (i = 0; i < parser->range_count; i++)
+    {
+        r = parser->ranges;
+        if (n > 0 && r[2 * i] <= r[2 * n - 1] + 1)
+        {
+            r[2 * n - 1] = r[2 * i + 1] > r[2 * n - 1] ? r[2 * i + 1] : r[2 * n - 1];
+            continue;
+        }
+        r[2 * n] = r[2 * i];
+        r[2 * n + 1] = r[2 * i + 1];
+        n++;
+    }
+    parser->range_count = n;
+    if (0 != negate)
+    { /*what is left out goes behind,then takes the place of the ranges*/
+        lo = 0;
+        for (i = 0; i < n; i++)
+        {
+            if (parser->ranges[2 * i] > lo)
+            {
+                regexp_add_range(parser, lo, parser->ranges[2 * i] - 1);
+            }
+            lo = parser->ranges[2 * i + 1] + 1;
+        }
+        if (lo <= REGEXP_CODE_POINT_MAX)
+        {
+            regexp_add_range(parser, lo, REGEXP_CODE_POINT_MAX);
+        }
+        memmove(parser->ranges, parser->ranges + 2 * n, sizeof(int) * 2 * (parser->range_count - n));
+        parser->range_count -= n;
+    }
+    set = regexp_new_set(parser);
+    alt = regexp_append(parser, REGEXP_NODE_ALT, -1, regexp_node(parser, REGEXP_NODE_SET, -1, set, 0));
+    for (i = 0; i < parser->range_count; i++)
+    {
+        r = parser->ranges + 2 * i;
+        if (r[0] < 0x80)
+        {
+            regexp_set_add(parser->prog->sets[set], r[0], r[1] < 0x7F ? r[1] : 0x7F);
+        }
+        r = parser->ranges + 2 * i;
+        if (r[1] >= 0x80)
+        {
+            regexp_utf8_node(parser, r[0] > 0x80 ? r[0] : 0x80, r[1], &alt);
+        }
+    }
+    parser->range_count = 0;
+    return regexp_unwrap(parser, alt);
+}
+
+int regexp_char_node(RegexParser *parser, int c)
+{
+    int set;
+    if (c < 0x80 && (0 == (parser->prog->flag_bits & REGEXP_FLAG_IGNORE_CASE) || !((c | 32) >= 'a' && (c | 32) <= 'z')))
+    {
+        set = regexp_new_set(parser);
+        regexp_set_add(parser->prog->sets[set], c, c);
+        return regexp_node(parser, REGEXP_NODE_SET, -1, set, 0);
+    }
+    regexp_add_range(parser, c, c);
+    return regexp_class_node(parser, 0);
+}
+
+/*one utf-8 char of the pattern,a byte that starts none stands for itself*/
+int regexp_next_char(RegexParser *parser)
+{
+    const unsigned char *p = parser->p;
+    int c = p[0];
+    int n = 0;
+    int i;
+    if (c >= 0xF0 && c < 0xF8)
+    {
+        n = 3;
+        c &= 7;
+    }
+    else if (c >= 0xE0 && c < 0xF0)
+    {
+        n = 2;
+        c &= 15;
+    }
+    else if (c >= 0xC0 && c < 0xE0)
+    {
+        n = 1;
+        c &= 31;
+    }
+    if (p + n >= parser->end)
+    {
+        n = 0;
+        c = p[0];
+    }
+    for (i = 1; i <= n; i++)
+    {
+        if (0x80 != (p[i] & 0xC0))
+        {
+            n = 0;
+            c = p[0];
+            break;
+        }
+        c = (c << 6) | (p[i] & 0x3F);
+    }
+    parser->p += n + 1;
+    return c;
+}
+
+int regexp_hex(int c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    c |= 32;
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/*digits hex digits at p,or {hex} when digits is 0. -1 when they are not there*/
+int regexp_hex_escape(RegexParser *parser, int digits)
+{
+    const unsigned char *p = parser->p;
+    int value = 0;
+    int d;
+    int i;
+    if (0 == digits)
+    {
+        if (p >= parser->end || '{' != *p)
+        {
+            return -1;
+        }
+        for (p++; p < parser->end && (d = regexp_hex(*p)) >= 0 && value <= REGEXP_CODE_POINT_MAX; p++)
+        {
+            value = value * 16 + d;
+        }
+        if (p >= parser->end || '}' != *p || p == parser->p + 1 || value > REGEXP_CODE_POINT_MAX)
+        {
+            return -1;
+        }
+        parser->p = p + 1;
+        return value;
+    }
+    for (i = 0; i < digits; i++)
+    {
+        if (p + i >= parser->end || (d = regexp_hex(p[i])) < 0)
+        {
+            return -1;
+        }
+        value = value * 16 + d;
+    }
+    parser->p += digits;
+    return value;
+}
+
+/*
+ * the char of the escape after the backslash. \d,\w,\s and their negations
+ * add their ranges and give -1.
+ */
+int regexp_char_escape(RegexParser *parser)
+{
+    int c;
+    int value;
+    if (parser->p >= parser->end)
+    {
+        regexp_fail(parser, "\\ at end of pattern");
+        return -1;
+    }
+    c = *parser->p;
+    switch (c)
+    {
+    case 'd':
+    case 'D':
+        parser->p++;
+        regexp_add_ranges(parser, regexp_digit_ranges, 'D' == c);
+        return -1;
+    case 'w':
+    case 'W':
+        parser->p++;
+        regexp_add_ranges(parser, regexp_word_ranges, 'W' == c);
+        return -1;
+    case 's':
+    case 'S':
+        parser->p++;
+        regexp_add_ranges(parser, regexp_space_ranges, 'S' == c);
+        return -1;
+    case 't':
+        parser->p++;
+        return '\t';
+    case 'n':
+        parser->p++;
+        return '\n';
+    case 'v':
+        parser->p++;
+        return '\v';
+    case 'f':
+        parser->p++;
+        return '\f';
+    case 'r':
+        parser->p++;
+        return '\r';
+    case 'c':
+        if (parser->p + 1 < parser->end && ((parser->p[1] | 32) >= 'a' && (parser->p[1] | 32) <= 'z'))
+        {
+            parser->p += 2;
+            return parser->p[-1] % 32;
+        }
+        return '\\'; /*the c is read as itself*/
+    case 'x':
+        parser->p++;
+        value = regexp_hex_escape(parser, 2);
+        return value >= 0 ? value : 'x';
+    case 'u':
+        parser->p++;
+        value = regexp_hex_escape(parser, 4);
+        if (value < 0)
+        {
+            value = regexp_hex_escape(parser, 0);
+        }
+        return value >= 0 ? value : 'u';
+    }
+    if (c >= '0' && c <= '7')
+    { /*a legacy octal escape,\0 alone is nul*/
+        value = 0;
+        for (; parser->p < parser->end && *parser->p >= '0' && *parser->p <= '7' && value * 8 + (*parser->p - '0') <= 0377; parser->p++)
+        {
+            value = value * 8 + (*parser->p - '0');
+        }
+        return value;
+    }
+    return regexp_next_char(parser);
+}
+
+/*a backslash outside a class: assertions,backreferences and escapes*/
+int regexp_parse_escape(RegexParser *parser)
+{
+    const unsigned char *p;
+    int n = 0;
+    int c;
+    parser->p++;
+    if (parser->p < parser->end && ('b' == *parser->p || 'B' == *parser->p))
+    {
+        parser->words = 1;
+        return regexp_node(parser, REGEXP_NODE_ASSERT, -1, 'b' == *parser->p++ ? REGEXP_OP_WORDB : REGEXP_OP_NWORDB, 0);
+    }
+    if (parser->p < parser->end && *parser->p >= '1' && *parser->p <= '9')
+    {
+        for (p = parser->p; p < parser->end && *p >= '0' && *p <= '9' && n <= parser->group_total; p++)
+        {
+            n = n * 10 + (*p - '0');
+        }
+        if (n <= parser->group_total)
+        {
+            parser->p = p;
+            parser->backrefs = 1;
+            return regexp_node(parser, REGEXP_NODE_BACKREF, -1, n, 0);
+        }
+    }
+    c = regexp_char_escape(parser);
+    if (c < 0)
+    {
+        return regexp_class_node(parser, 0);
+    }
+    return regexp_char_node(parser, c);
+}
+
+/*a char of a class,-1 for a class escape that added its ranges*/
+int regexp_class_atom(RegexParser *parser)
+{
+    if ('\\' != *parser->p)
+    {
+        return regexp_next_char(parser);
+    }
+    parser->p++;
+    if (parser->p < parser->end && 'b' == *parser->p)
+    {
+        parser->p++;
+        return '\b';
+    }
+    if (parser->p < parser->end && '-' == *parser->p)
+    {
+        parser->p++;
+        return '-';
+    }
+    return regexp_char_escape(parser);
+}
+
+int regexp_parse_class(RegexParser *parser)
+{
+    char negate = 0;
+    int lo;
+    int hi;
+    parser->p++;
+    if (parser->p < parser->end && '^' == *parser->p)
+    {
+        negate = 1;
+        parser->p++;
+    }
+    parser->range_count = 0;
+    while (parser->p < parser->end && ']' != *parser->p)
+    {
+        lo = regexp_class_atom(parser);
+        if (lo < 0)
+        {
+            continue;
+        }
+        if (parser->p + 1 < parser->end && '-' == parser->p[0] && ']' != parser->p[1])
+        {
+            parser->p++;
+            hi = regexp_class_atom(parser);
+            if (hi < 0)
+            { /*[a-\d] is a,- and the digits*/
+                regexp_add_range(parser, lo, lo);
+                regexp_add_range(parser, '-', '-');
+                continue;
+            }
+            if (hi < lo)
+            {
+                regexp_fail(parser, "range out of order in character class");
+                return -1;
+            }
+            regexp_add_range(parser, lo, hi);
+            continue;
+        }
+        regexp_add_range(parser, lo, lo);
+    }
+    if (parser->p >= parser->end)
+    {
+        regexp_fail(parser, "missing ]");
+        return -1;
+    }
+    parser->p++;
+    return regexp_class_node(parser, negate);
+}
+
+/*{n},{n,} or {n,m} at p,0 when it is none and p stays*/
+char regexp_parse_braces(RegexParser *parser, int *min, int *max)
+{
+    const unsigned char *p = parser->p + 1;
+    int n = 0;
+    int m;
+    if (p >= parser->end || *p < '0' || *p > '9')
+    {
+        return 0;
+    }
+    for (; p < parser->end && *p >= '0' && *p <= '9'; p++)
+    {
+        n = n <= REGEXP_MAX_REPEAT ? n * 10 + (*p - '0') : n;
+    }
+    m = n;
+    if (p < parser->end && ',' == *p)
+    {
+        p++;
+        m = -1;
+        if (p < parser->end && *p >= '0' && *p <= '9')
+        {
+            for (m = 0; p < parser->end && *p >= '0' && *p <= '9'; p++)
+            {
+                m = m <= REGEXP_MAX_REPEAT ? m * 10 + (*p - '0') : m;
+            }
+        }
+    }
+    if (p >= parser->end || '}' != *p)
+    {
+        return 0;
+    }
+    parser->p = p + 1;
+    *min = n;
+    *max = m;
+    return 1;
+}
+
+int regexp_parse_quantifier(RegexParser *parser, int node)
+{
+    int min;
+    int max;
+    int repeat;
+    if (parser->p >= parser->end)
+    {
+        return node;
+    }
+    switch (*parser->p)
+    {
+    case '*':
+        min = 0;
+        max = -1;
+        parser->p++;
+        break;
+    case '+':
+        min = 1;
+        max = -1;
+        parser->p++;
+        break;
+    case '?':
+        min = 0;
+        max = 1;
+        parser->p++;
+        break;
+    case '{':
+        if (0 == regexp_parse_braces(parser, &min, &max))
+        {
+            return node;
+        }
+        break;
+    default:
+        return node;
+    }
+    if (max >= 0 && min > max)
+    {
+        regexp_fail(parser, "numbers out of order in {} quantifier");
+        return -1;
+    }
+    repeat = regexp_node(parser, REGEXP_NODE_REPEAT, node, min, max);
+    if (parser->p < parser->end && '?' == *parser->p)
+    {
+        parser->p++;
+        parser->nodes[repeat].greedy = 0;
+    }
+    if (parser->p < parser->end && ('*' == *parser->p || '+' == *parser->p || '?' == *parser->p))
+    {
+        regexp_fail(parser, "nothing to repeat");
+        return -1;
+    }
+    return repeat;
+}
+
+int regexp_parse_alternation(RegexParser *parser, int depth);
+
+int regexp_parse_group(RegexParser *parser, int depth)
+{
+    int node;
+    int index = 0;
+    char look = 0;
+    char negate = 0;
+    if (depth >= REGEXP_MAX_DEPTH)
+    {
+        regexp_fail(parser, "groups nested too deep");
+        return -1;
+    }
+    parser->p++;
+    if (parser->p < parser->end && '?' == *parser->p)
+    {
+        if (parser->p + 1 < parser->end && ':' == parser->p[1])
+        {
+            parser->p += 2;
+        }
+        else if (parser->p + 1 < parser->end && ('=' == parser->p[1] || '!' == parser->p[1]))
+        {
+            look = 1;
+            negate = '!' == parser->p[1];
+            parser->looks = 1;
+            parser->p += 2;
+        }
+        else
+        {
+            regexp_fail(parser, "invalid group,only (?:) (?=) and (?!)");
+            return -1;
+        }
+    }
+    else
+    {
+        index = ++parser->groups;
+    }
+    node = regexp_parse_alternation(parser, depth + 1);
+    if (parser->p >= parser->end || ')' != *parser->p)
+    {
+        regexp_fail(parser, "missing )");
+        return -1;
+    }
+    parser->p++;
+    if (0 != look)
+    {
+        return regexp_node(parser, REGEXP_NODE_LOOK, node, negate, 0);
+    }
+    if (0 != index)
+    {
+        return regexp_node(parser, REGEXP_NODE_GROUP, node, index, 0);
+    }
+    return node;
+}
+
+int regexp_parse_term(RegexParser *parser, int depth)
+{
+    const unsigned char *p = parser->p;
+    int min;
+    int max;
+    int node;
+    switch (*p)
+    {
+    case '^':
+    case '$':
+        parser->p++;
+        parser->anchors = 1;
+        return regexp_node(parser, REGEXP_NODE_ASSERT, -1, '^' == *p ? REGEXP_OP_BOL : REGEXP_OP_EOL, 0);
+    case '(':
+        node = regexp_parse_group(parser, depth);
+        break;
+    case '[':
+        node = regexp_parse_class(parser);
+        break;
+    case '.':
+        parser->p++;
+        if (0 != (parser->prog->flag_bits & REGEXP_FLAG_DOTALL))
+        {
+            regexp_add_ranges(parser, regexp_all_ranges, 0);
+        }
+        else
+        {
+            regexp_add_ranges(parser, regexp_line_ranges, 1);
+        }
+        node = regexp_class_node(parser, 0);
+        break;
+    case '\\':
+        node = regexp_parse_escape(parser);
+        if (REGEXP_NODE_ASSERT == parser->nodes[node].typ)
+        {
+            return node;
+        }
+        break;
+    case '*':
+    case '+':
+    case '?':
+        regexp_fail(parser, "nothing to repeat");
+        return -1;
+    case '{':
+        if (0 != regexp_parse_braces(parser, &min, &max))
+        {
+            regexp_fail(parser, "nothing to repeat");
+            return -1;
+        }
+        node = regexp_char_node(parser, regexp_next_char(parser));
+        break;
+    default:
+        node = regexp_char_node(parser, regexp_next_char(parser));
+        break;
+    }
+    return regexp_parse_quantifier(parser, node);
+}
+
+int regexp_parse_sequence(RegexParser *parser, int depth)
+{
+    int cat = -1;
+    while (parser->p < parser->end && '|' != *parser->p && ')' != *parser->p)
+    {
+        cat = regexp_append(parser, REGEXP_NODE_CAT, cat, regexp_parse_term(parser, depth));
+    }
+    if (cat < 0)
+    {
+        return regexp_node(parser, REGEXP_NODE_EMPTY, -1, 0, 0);
+    }
+    return regexp_unwrap(parser, cat);
+}
+
+int regexp_parse_alternation(RegexParser *parser, int depth)
+{
+    int alt = -1;
+    int node = regexp_parse_sequence(parser, depth);
+    while (parser->p < parser->end && '|' == *parser->p)
+    {
+        parser->p++;
+        if (alt < 0)
+        {
+            alt = regexp_append(parser, REGEXP_NODE_ALT, -1, node);
+        }
+        alt = regexp_append(parser, REGEXP_NODE_ALT, alt, regexp_parse_sequence(parser, depth));
+    }
+    return alt < 0 ? node : alt;
+}
+
+/*capturing groups of the pattern,a backreference may come before its group*/
+int regexp_count_groups(const unsigned char *p, const unsigned char *end)
+{
+    int count = 0;
+    char in_class = 0;
+    for (; p < end; p++)
+    {
+        if ('\\' == *p)
+        {
+            p++;
+        }
+        else if ('[' == *p)
+        {
+            in_class = 1;
+        }
+        else if (']' == *p)
+        {
+            in_class = 0;
+        }
+        else if ('(' == *p && 0 == in_class && (p + 1 >= end || '?' != p[1]))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int regexp_emit(RegexParser *parser, REGEXP_OP op, int x, int y)
+{
+    RegexInst *inst;
+    if (parser->code_length >= REGEXP_MAX_INSTS)
+    {
+        regexp_fail(parser, "regular expression too big");
+        return -1;
+    }
+    parser->code = regexp_grow(parser->prog->memory, parser->code, &parser->code_alloc, parser->code_length, sizeof(RegexInst), parser->line);
+    inst = parser->code + parser->code_length;
+    inst->op = op;
+    inst->x = x;
+    inst->y = y;
+    return parser->code_length++;
+}
+
+char regexp_nullable(RegexParser *parser, int n)
+{
+    RegexNode *node = parser->nodes + n;
+    int i;
+    switch (node->typ)
+    {
+    case REGEXP_NODE_SET:
+        return 0;
+    case REGEXP_NODE_CAT:
+        for (i = node->left; i >= 0; i = parser->nodes[i].next)
+        {
+            if (0 == regexp_nullable(parser, i))
+            {
+                return 0;
+            }
+        }
+        return 1;
+    case REGEXP_NODE_ALT:
+        for (i = node->left; i >= 0; i = parser->nodes[i].next)
+        {
+            if (0 != regexp_nullable(parser, i))
+            {
+                return 1;
+            }
+        }
+        return 0;
+    case REGEXP_NODE_REPEAT:
+        return 0 == node->x || 0 != regexp_nullable(parser, node->left);
+    case REGEXP_NODE_GROUP:
+        return regexp_nullable(parser, node->left);
+    default:
+        return 1;
+    }
+}
+
+void regexp_split_to(RegexParser *parser, int split, char greedy, int body, int out)
+{
+    parser->code[split].x = 0 != greedy ? body : out;
+    parser->code[split].y = 0 != greedy ? out : body;
+}
+
+void regexp_emit_node(RegexParser *parser, int n, char reverse);
+
+/*the first and last group inside node n,first is more than last when there is none*/
+void regexp_group_range(RegexParser *parser, int n, int *first, int *last)
+{
+    RegexNode *node = parser->nodes + n;
+    int i;
+    if (REGEXP_NODE_GROUP == node->typ)
+    {
+        *first = node->x < *first ? node->x : *first;
+        *last = node->x > *last ? node->x : *last;
+    }
+    if (REGEXP_NODE_CAT == node->typ || REGEXP_NODE_ALT == node->typ)
+    {
+        for (i = node->left; i >= 0; i = parser->nodes[i].next)
+        {
+            regexp_group_range(parser, i, first, last);
+        }
+    }
+    else if (node->left >= 0)
+    {
+        regexp_group_range(parser, node->left, first, last);
+    }
+}
+
+/*one iteration,it forgets the groups of the one before and may not match empty when mark is a slot*/
+void regexp_emit_iteration(RegexParser *parser, RegexNode *node, char reverse, int mark, int first, int last)
+{
+    if (mark >= 0)
+    {
+        regexp_emit(parser, REGEXP_OP_MARK, mark, 0);
+    }
+    if (first <= last)
+    {
+        regexp_emit(parser, REGEXP_OP_RESET, first, last);
+    }
+    regexp_emit_node(parser, node->left, reverse);
+    if (mark >= 0)
+    {
+        regexp_emit(parser, REGEXP_OP_CHECK, mark, 0);
+    }
+}
+
+/*0 when count more copies of what was emitted from start would not fit the budget*/
+char regexp_copies_fit(RegexParser *parser, int start, int count)
+{
+    if ((long)(parser->code_length - start) * count > REGEXP_MAX_INSTS - parser->code_length)
+    {
+        regexp_fail(parser, "regular expression too big");
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * the child min times,then a loop or max - min optional copies.
+ * an optional iteration that matches nothing fails,the way it does in js.
+ * the first copy tells what all of them take,a count that can not fit
+ * fails before the rest are emitted.
+ */
+void regexp_emit_repeat(RegexParser *parser, RegexNode *node, char reverse)
+{
+    int i;
+    int loop;
+    int mark = -1;
+    int chain = -1;
+    int next;
+    int first = MAX_INT;
+    int last = 0;
+    int start = parser->code_length;
+    int copies = node->y < 0 ? node->x : node->y;
+    regexp_group_range(parser, node->left, &first, &last);
+    for (i = 0; i < node->x; i++)
+    {
+        regexp_emit_iteration(parser, node, reverse, -1, first, last);
+        if (0 == i && 0 == regexp_copies_fit(parser, start, copies - 1))
+        {
+            return;
+        }
+    }
+    if (node->y == node->x)
+    {
+        return;
+    }
+    if (0 != regexp_nullable(parser, node->left))
+    {
+        mark = 2 * (parser->group_total + 1) + parser->counters++;
+    }
+    if (node->y < 0)
+    {
+        loop = regexp_emit(parser, REGEXP_OP_SPLIT, 0, 0);
+        regexp_emit_iteration(parser, node, reverse, mark, first, last);
+        regexp_emit(parser, REGEXP_OP_JMP, loop, 0);
+        regexp_split_to(parser, loop, node->greedy, loop + 1, parser->code_length);
+        return;
+    }
+    for (i = node->x; i < node->y; i++)
+    { /*the splits chain through x until they know where the copies end*/
+        chain = regexp_emit(parser, REGEXP_OP_SPLIT, chain, 0);
+        regexp_emit_iteration(parser, node, reverse, mark, first, last);
+        if (0 == i && 0 == regexp_copies_fit(parser, start, copies - 1))
+        {
+            return;
+        }
+    }
+    while (chain >= 0)
+    {
+        next = parser->code[chain].x;
+        regexp_split_to(parser, chain, node->greedy, chain + 1, parser->code_length);
+        chain = next;
+    }
+}
+
+/*reverse emits the pattern backwards for the backward dfa,lines swap ends*/
+void regexp_emit_node(RegexParser *parser, int n, char reverse)
+{
+    RegexNode *node = parser->nodes + n;
+    int i;
+    int split;
+    int chain = -1;
+    int next;
+    int byte;
+    REGEXP_OP op;
+    switch (node->typ)
+    {
+    case REGEXP_NODE_EMPTY:
+        break;
+    case REGEXP_NODE_SET:
+        byte = regexp_set_single(parser->prog->sets[node->x]);
+        if (byte >= 0)
+        {
+            regexp_emit(parser, REGEXP_OP_BYTE, byte, 0);
+        }
+        else
+        {
+            regexp_emit(parser, REGEXP_OP_SET, node->x, 0);
+        }
+        break;
+    case REGEXP_NODE_CAT:
+        for (i = 0 != reverse ? node->right : node->left; i >= 0; i = 0 != reverse ? parser->nodes[i].prev : parser->nodes[i].next)
+        {
+            regexp_emit_node(parser, i, reverse);
+        }
+        break;
+    case REGEXP_NODE_ALT:
+        for (i = node->left; i >= 0; i = parser->nodes[i].next)
+        {
+            if (parser->nodes[i].next < 0)
+            {
+                regexp_emit_node(parser, i, reverse);
+                break;
+            }
+            split = regexp_emit(parser, REGEXP_OP_SPLIT, parser->code_length + 1, 0);
+            regexp_emit_node(parser, i, reverse);
+            chain = regexp_emit(parser, REGEXP_OP_JMP, chain, 0);
+            parser->code[split].y = parser->code_length;
+        }
+        while (chain >= 0)
+        {
+            next = parser->code[chain].x;
+            parser->code[chain].x = parser->code_length;
+            chain = next;
+        }
+        break;
+    case REGEXP_NODE_GROUP:
+        regexp_emit(parser, REGEXP_OP_SAVE, 2 * node->x + (0 != reverse), 0);
+        regexp_emit_node(parser, node->left, reverse);
+        regexp_emit(parser, REGEXP_OP_SAVE, 2 * node->x + (0 == reverse), 0);
+        break;
+    case REGEXP_NODE_REPEAT:
+        regexp_emit_repeat(parser, node, reverse);
+        break;
+    case REGEXP_NODE_ASSERT:
+        op = node->x;
+        if (0 != reverse && (REGEXP_OP_BOL == op || REGEXP_OP_EOL == op))
+        {
+            op = REGEXP_OP_BOL == op ? REGEXP_OP_EOL : REGEXP_OP_BOL;
+        }
+        regexp_emit(parser, op, 0, 0);
+        break;
+    case REGEXP_NODE_BACKREF:
+        regexp_emit(parser, REGEXP_OP_BACKREF, node->x, 0);
+        break;
+    case REGEXP_NODE_LOOK:
+        split = regexp_emit(parser, REGEXP_OP_LOOK, 0, node->x);
+        regexp_emit_node(parser, node->left, 0);
+        regexp_emit(parser, REGEXP_OP_LOOKEND, 0, 0);
+        parser->code[split].x = parser->code_length;
+        break;
+    }
+}
+
+/*bytes no set of the program tells apart go to the same class*/
+void regexp_byte_classes(RegexProg *prog)
+{
+    unsigned char single[32];
+    unsigned char next[256];
+    short map[512];
+    const unsigned char *set;
+    int count = 1;
+    int n;
+    int i;
+    int b;
+    int k;
+    memset(prog->classes, 0, sizeof(prog->classes));
+    for (i = 0; i < prog->length; i++)
+    {
+        if (REGEXP_OP_BYTE == prog->code[i].op)
+        {
+            memset(single, 0, sizeof(single));
+            regexp_set_add(single, prog->code[i].x, prog->code[i].x);
+            set = single;
+        }
+        else if (REGEXP_OP_SET == prog->code[i].op)
+        {
+            set = prog->sets[prog->code[i].x];
+        }
+        else
+        {
+            continue;
+        }
+        for (k = 0; k < 2 * count; k++)
+        {
+            map[k] = -1;
+        }
+        n = 0;
+        for (b = 0; b < 256; b++)
+        {
+            k = prog->classes[b] * 2 + (0 != regexp_set_has(set, b));
+            if (map[k] < 0)
+            {
+                map[k] = n++;
+            }
+            next[b] = map[k];
+        }
+        memcpy(prog->classes, next, sizeof(next));
+        count = n;
+    }
+    prog->class_count = count;
+}
+
+/*the bytes a match starts with,none when it may be empty or starts with an assertion*/
+void regexp_first_bytes(RegexProg *prog)
+{
+    int *stack = regexp_alloc(prog->memory, sizeof(int) * (2 * prog->length + 2), prog->line);
+    char *seen = regexp_alloc(prog->memory, prog->length, prog->line);
+    RegexInst *inst;
+    int sp = 0;
+    int pc;
+    memset(seen, 0, prog->length);
+    memset(prog->first, 0, sizeof(prog->first));
+    prog->has_first = 1;
+    stack[sp++] = prog->start;
+    while (sp > 0 && 0 != prog->has_first)
+    {
+        pc = stack[--sp];
+        if (0 != seen[pc])
+        {
+            continue;
+        }
+        seen[pc] = 1;
+        inst = prog->code + pc;
+        switch (inst->op)
+        {
+        case REGEXP_OP_BYTE:
+            regexp_set_add(prog->first, inst->x, inst->x);
+            break;
+        case REGEXP_OP_SET:
+            for (pc = 0; pc < 32; pc++)
+            {
+                prog->first[pc] |= prog->sets[inst->x][pc];
+            }
+            break;
+        case REGEXP_OP_SPLIT:
+            stack[sp++] = inst->y;
+            stack[sp++] = inst->x;
+            break;
+        case REGEXP_OP_JMP:
+            stack[sp++] = inst->x;
+            break;
+        case REGEXP_OP_SAVE:
+        case REGEXP_OP_MARK:
+        case REGEXP_OP_CHECK:
+        case REGEXP_OP_RESET:
+            stack[sp++] = pc + 1;
+            break;
+        default:
+            prog->has_first = 0;
+            break;
+        }
+    }
+    MEM_free(prog->memory, (char *)stack);
+    MEM_free(prog->memory, seen);
+}
+
+void regexp_parse_flags(RegexParser *parser, char *flags)
+{
+    char *all = "gimsy";
+    char *f;
+    int bit;
+    for (; 0 != *flags; flags++)
+    {
+        f = strchr(all, *flags);
+        bit = NULL != f ? 1 << (f - all) : 0;
+        if (0 == bit || 0 != (parser->prog->flag_bits & bit))
+        {
+            regexp_fail(parser, "invalid flags");
+            return;
+        }
+        parser->prog->flag_bits |= bit;
+    }
+}
+
+char *regexp_copy(Memory *memory, const char *s, int line)
+{
+    int length = strlen(s);
+    char *copy = regexp_alloc(memory, length + 1, line);
+    memcpy(copy, s, length + 1);
+    return copy;
+}
+
+RegexProg *REGEXP_compile(Memory *memory, char *source, char *flags, int line)
+{
+    RegexParser parser;
+    RegexProg *prog = regexp_alloc(memory, sizeof(RegexProg), line);
+    int root;
+    int all;
+    int counters;
+    memset(prog, 0, sizeof(RegexProg));
+    memset(&parser, 0, sizeof(parser));
+    prog->memory = memory;
+    prog->line = line;
+    prog->source = regexp_copy(memory, source, line);
+    prog->flags = regexp_copy(memory, flags, line);
+    parser.prog = prog;
+    parser.line = line;
+    parser.p = (const unsigned char *)prog->source;
+    parser.end = parser.p + strlen(prog->source);
+    regexp_parse_flags(&parser, flags);
+    parser.group_total = regexp_count_groups(parser.p, parser.end);
+    root = regexp_parse_alternation(&parser, 0);
+    if (parser.p < parser.end)
+    {
+        regexp_fail(&parser, "unmatched )");
+    }
+    all = regexp_new_set(&parser);
+    regexp_set_add(prog->sets[all], 0, 255);
+    /*the unanchored search loops over any byte before trying the match*/
+    regexp_emit(&parser, REGEXP_OP_SPLIT, 3, 1);
+    regexp_emit(&parser, REGEXP_OP_SET, all, 0);
+    regexp_emit(&parser, REGEXP_OP_JMP, 0, 0);
+    regexp_emit(&parser, REGEXP_OP_SAVE, 0, 0);
+    regexp_emit_node(&parser, root, 0);
+    regexp_emit(&parser, REGEXP_OP_SAVE, 1, 0);
+    regexp_emit(&parser, REGEXP_OP_MATCH, 0, 0);
+    prog->code = parser.code;
+    prog->length = parser.code_length;
+    prog->start = 3;
+    prog->dfa = 0 == parser.backrefs && 0 == parser.looks && 0 == parser.words && prog->length <= REGEXP_DFA_INSTS &&
+                parser.counters <= REGEXP_DFA_MARKS && (0 == parser.anchors || 0 == (prog->flag_bits & REGEXP_FLAG_MULTILINE));
+    if (0 != prog->dfa)
+    { /*the reverse copy takes the same marks*/
+        counters = parser.counters;
+        parser.counters = 0;
+        parser.code = NULL;
+        parser.code_length = 0;
+        parser.code_alloc = 0;
+        regexp_emit_node(&parser, root, 1);
+        parser.counters = counters;
+        regexp_emit(&parser, REGEXP_OP_MATCH, 0, 0);
+        prog->reverse = parser.code;
+        prog->reverse_length = parser.code_length;
+    }
+    prog->groups = parser.group_total + 1;
+    prog->slot_count = 2 * prog->groups + parser.counters;
+    prog->slots = regexp_alloc(memory, sizeof(int) * prog->slot_count, line);
+    prog->memo_ok = 0 == parser.backrefs && 0 == parser.looks && 0 == parser.counters;
+    if (0 != prog->dfa)
+    { /*only the dfa steps by class*/
+        regexp_byte_classes(prog);
+    }
+    regexp_first_bytes(prog);
+    if (NULL != parser.nodes)
+    {
+        MEM_free(memory, (char *)parser.nodes);
+    }
+    if (NULL != parser.ranges)
+    {
+        MEM_free(memory, (char *)parser.ranges);
+    }
+    return prog;
+}
+
+void regexp_free_dfa(RegexProg *prog, RegexDfa *dfa)
+{
+    RegexChunk *chunk;
+    RegexChunk *next;
+    if (NULL == dfa)
+    {
+        return;
+    }
+    for (chunk = dfa->chunks; NULL != chunk; chunk = next)
+    {
+        next = chunk->next;
+        MEM_free(prog->memory, (char *)chunk);
+    }
+    MEM_free(prog->memory, (char *)dfa->list);
+    MEM_free(prog->memory, (char *)dfa->stack);
+    MEM_free(prog->memory, (char *)dfa->seen);
+    MEM_free(prog->memory, (char *)dfa->listed);
+    MEM_free(prog->memory, (char *)dfa->masked);
+    MEM_free(prog->memory, (char *)dfa);
+}
+
+void REGEXP_free(RegexProg *prog)
+{
+    if (NULL == prog)
+    {
+        return;
+    }
+    regexp_free_dfa(prog, prog->forward);
+    regexp_free_dfa(prog, prog->backward);
+    MEM_free(prog->memory, (char *)prog->code);
+    if (NULL != prog->reverse)
+    {
+        MEM_free(prog->memory, (char *)prog->reverse);
+    }
+    MEM_free(prog->memory, (char *)prog->sets);
+    MEM_free(prog->memory, (char *)prog->slots);
+    if (NULL != prog->stack)
+    {
+        MEM_free(prog->memory, (char *)prog->stack);
+    }
+    if (NULL != prog->memo)
+    {
+        MEM_free(prog->memory, (char *)prog->memo);
+    }
+    MEM_free(prog->memory, prog->source);
+    MEM_free(prog->memory, prog->flags);
+    MEM_free(prog->memory, (char *)prog);
+}
+
+RegexDfa *regexp_dfa(RegexProg *prog, char backward)
+{
+    RegexDfa *dfa = 0 != backward ? prog->backward : prog->forward;
+    if (NULL != dfa)
+    {
+        return dfa;
+    }
+    dfa = regexp_alloc(prog->memory, sizeof(RegexDfa), prog->line);
+    memset(dfa, 0, sizeof(RegexDfa));
+    dfa->code = 0 != backward ? prog->reverse : prog->code;
+    dfa->length = 0 != backward ? prog->reverse_length : prog->length;
+    dfa->longest = backward;
+    dfa->mark_base = 2 * prog->groups;
+    dfa->list = regexp_alloc(prog->memory, sizeof(int) * (dfa->length + REGEXP_DFA_MASKED), prog->line);
+    dfa->stack = regexp_alloc(prog->memory, sizeof(int) * (2 * (dfa->length + REGEXP_DFA_MASKED) + 2), prog->line);
+    dfa->seen = regexp_alloc(prog->memory, sizeof(int) * dfa->length, prog->line);
+    dfa->listed = regexp_alloc(prog->memory, sizeof(int) * dfa->length, prog->line);
+    dfa->masked = regexp_alloc(prog->memory, sizeof(int) * REGEXP_DFA_MASKED, prog->line);
+    memset(dfa->seen, 0, sizeof(int) * dfa->length);
+    memset(dfa->listed, 0, sizeof(int) * dfa->length);
+    if (0 != backward)
+    {
+        prog->backward = dfa;
+    }
+    else
+    {
+        prog->forward = dfa;
+    }
+    return dfa;
+}
+
+void regexp_dfa_flush(RegexDfa *dfa)
+{
+    memset(dfa->buckets, 0, sizeof(dfa->buckets));
+    dfa->starts[0] = NULL;
+    dfa->starts[1] = NULL;
+    dfa->states = 0;
+    dfa->chunk = dfa->chunks;
+    dfa->top = NULL != dfa->chunk ? (char *)(dfa->chunk + 1) : NULL;
+    dfa->limit = NULL != dfa->chunk ? dfa->top + REGEXP_DFA_CHUNK : NULL;
+    dfa->flushed = 1;
+}
+
+void *regexp_dfa_alloc(RegexProg *prog, RegexDfa *dfa, int size)
+{
+    RegexChunk *chunk;
+    char *p;
+    size = (size + 7) & ~7;
+    if (dfa->states >= REGEXP_DFA_STATES)
+    {
+        regexp_dfa_flush(dfa);
+    }
+    if (NULL == dfa->top || dfa->top + size > dfa->limit)
+    {
+        chunk = NULL != dfa->chunk ? dfa->chunk->next : dfa->chunks;
+        if (NULL == chunk && dfa->chunk_count >= REGEXP_DFA_CHUNKS)
+        {
+            regexp_dfa_flush(dfa);
+            chunk = dfa->chunks;
+        }
+        else if (NULL == chunk)
+        {
+            chunk = regexp_alloc(prog->memory, sizeof(RegexChunk) + REGEXP_DFA_CHUNK, prog->line);
+            chunk->next = NULL;
+            if (NULL != dfa->chunk)
+            {
+                dfa->chunk->next = chunk;
+            }
+            else
+            {
+                dfa->chunks = chunk;
+            }
+            dfa->chunk_count++;
+        }
+        dfa->chunk = chunk;
+        dfa->top = (char *)(chunk + 1);
+        dfa->limit = dfa->top + REGEXP_DFA_CHUNK;
+    }
+    p = dfa->top;
+    dfa->top += size;
+    dfa->states++;
+    return p;
+}
+
+void regexp_dfa_generation(RegexDfa *dfa)
+{
+    if (++dfa->generation == MAX_INT)
+    {
+        memset(dfa->seen, 0, sizeof(int) * dfa->length);
+        memset(dfa->listed, 0, sizeof(int) * dfa->length);
+        dfa->generation = 1;
+    }
+    dfa->masked_count = 0;
+}
+
+/*
+ * a thread that went through a loop mark and comes to its check without
+ * having read a byte matched an empty iteration,it fails like it does in
+ * the backtracker. a closure follows each pc once for each set of marks.
+ * a pc seen with fewer marks may still be on the way there,what it reaches
+ * from here comes first.
+ */
+char regexp_dfa_visit(RegexDfa *dfa, int t)
+{
+    int i;
+    if (t == REGEXP_THREAD_PC(t))
+    {
+        if (dfa->seen[t] == dfa->generation)
+        {
+            return 0;
+        }
+        dfa->seen[t] = dfa->generation;
+        return 1;
+    }
+    for (i = 0; i < dfa->masked_count; i++)
+    {
+        if (dfa->masked[i] == t)
+        {
+            return 0;
+        }
+    }
+    if (dfa->masked_count >= REGEXP_DFA_MASKED)
+    {
+        dfa->overflow = 1;
+        return 0;
+    }
+    dfa->masked[dfa->masked_count++] = t;
+    return 1;
+}
+
+/*
+ * threads reached from thread t without reading a byte,appended to the
+ * list in priority order. the first choice to match cuts off the ones
+ * after it. a thread waiting for the end keeps its marks.
+ */
+int regexp_dfa_closure(RegexDfa *dfa, int t, int at, int count)
+{
+    RegexInst *inst;
+    int sp = 0;
+    int pc;
+    int mask;
+    dfa->stack[sp++] = t;
+    while (sp > 0)
+    {
+        t = dfa->stack[--sp];
+        if (0 == regexp_dfa_visit(dfa, t))
+        {
+            continue;
+        }
+        pc = REGEXP_THREAD_PC(t);
+        mask = t & ~((1 << REGEXP_THREAD_BITS) - 1);
+        inst = dfa->code + pc;
+        switch (inst->op)
+        {
+        case REGEXP_OP_JMP:
+            dfa->stack[sp++] = inst->x | mask;
+            break;
+        case REGEXP_OP_SPLIT:
+            dfa->stack[sp++] = inst->y | mask;
+            dfa->stack[sp++] = inst->x | mask;
+            break;
+        case REGEXP_OP_MARK:
+            dfa->stack[sp++] = (pc + 1) | mask | (1 << (REGEXP_THREAD_BITS + inst->x - dfa->mark_base));
+            break;
+        case REGEXP_OP_CHECK:
+            if (0 == (mask & (1 << (REGEXP_THREAD_BITS + inst->x - dfa->mark_base))))
+            {
+                dfa->stack[sp++] = (pc + 1) | mask;
+            }
+            break;
+        case REGEXP_OP_SAVE:
+        case REGEXP_OP_RESET:
+            dfa->stack[sp++] = (pc + 1) | mask;
+            break;
+        case REGEXP_OP_BOL:
+            if (0 != (at & REGEXP_AT_BEGIN))
+            {
+                dfa->stack[sp++] = (pc + 1) | mask;
+            }
+            break;
+        case REGEXP_OP_EOL: /*waits for the end of the text*/
+            if (0 != (at & REGEXP_AT_END))
+            {
+                dfa->stack[sp++] = (pc + 1) | mask;
+                break;
+            }
+            dfa->list[count++] = t;
+            break;
+        case REGEXP_OP_MATCH:
+            if (dfa->listed[pc] == dfa->generation)
+            {
+                break;
+            }
+            dfa->listed[pc] = dfa->generation;
+            dfa->list[count++] = pc;
+            if (0 == dfa->longest)
+            {
+                return -count - 1;
+            }
+            break;
+        default: /*a byte read ends every iteration it is in,the marks are done with*/
+            if (dfa->listed[pc] != dfa->generation)
+            {
+                dfa->listed[pc] = dfa->generation;
+                dfa->list[count++] = pc;
+            }
+            break;
+        }
+    }
+    return count;
+}
+
+RegexState *regexp_dfa_state(RegexProg *prog, RegexDfa *dfa, int count)
+{
+    unsigned int hash = 2166136261u;
+    RegexState *state;
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        hash = (hash ^ (unsigned int)dfa->list[i]) * 16777619u;
+    }
+    for (state = dfa->buckets[hash % REGEXP_DFA_BUCKETS]; NULL != state; state = state->chain)
+    {
+        if (state->hash == hash && state->count == count && 0 == memcmp(state->threads, dfa->list, sizeof(int) * count))
+        {
+            return state;
+        }
+    }
+    state = regexp_dfa_alloc(prog, dfa, offsetof(RegexState, next) + sizeof(RegexState *) * prog->class_count + sizeof(int) * count);
+    state->hash = hash;
+    state->count = count;
+    state->match = 0;
+    state->threads = (int *)(state->next + prog->class_count);
+    memset(state->next, 0, sizeof(RegexState *) * prog->class_count);
+    memcpy(state->threads, dfa->list, sizeof(int) * count);
+    for (i = 0; i < count; i++)
+    {
+        if (REGEXP_OP_MATCH == dfa->code[REGEXP_THREAD_PC(dfa->list[i])].op)
+        {
+            state->match = 1;
+        }
+    }
+    state->chain = dfa->buckets[hash % REGEXP_DFA_BUCKETS];
+    dfa->buckets[hash % REGEXP_DFA_BUCKETS] = state;
+    return state;
+}
+
+RegexState *regexp_dfa_start(RegexProg *prog, RegexDfa *dfa, char at_begin)
+{
+    RegexState *state = dfa->starts[0 != at_begin];
+    int count;
+    if (NULL != state)
+    {
+        return state;
+    }
+    regexp_dfa_generation(dfa);
+    count = regexp_dfa_closure(dfa, 0, 0 != at_begin ? REGEXP_AT_BEGIN : 0, 0);
+    state = regexp_dfa_state(prog, dfa, count < 0 ? -count - 1 : count);
+    dfa->starts[0 != at_begin] = state;
+    return state;
+}
+
+/*the state after byte b,built and remembered the first time*/
+RegexState *regexp_dfa_step(RegexProg *prog, RegexDfa *dfa, RegexState *state, int b)
+{
+    RegexInst *inst;
+    RegexState *next;
+    int count = 0;
+    int i;
+    regexp_dfa_generation(dfa);
+    for (i = 0; i < state->count && count >= 0; i++)
+    {
+        inst = dfa->code + REGEXP_THREAD_PC(state->threads[i]);
+        if ((REGEXP_OP_BYTE == inst->op && inst->x == b) || (REGEXP_OP_SET == inst->op && 0 != regexp_set_has(prog->sets[inst->x], b)))
+        {
+            count = regexp_dfa_closure(dfa, state->threads[i] + 1, 0, count);
+        }
+    }
+    dfa->flushed = 0;
+    next = regexp_dfa_state(prog, dfa, count < 0 ? -count - 1 : count);
+    if (0 == dfa->flushed)
+    { /*else state went with the cache*/
+        state->next[prog->classes[b]] = next;
+    }
+    return next;
+}
+
+/*whether the threads waiting at the end of the text match there*/
+char regexp_dfa_end(RegexDfa *dfa, RegexState *state, char at_begin)
+{
+    int count;
+    int i;
+    int j;
+    regexp_dfa_generation(dfa);
+    for (i = 0; i < state->count; i++)
+    {
+        if (REGEXP_OP_MATCH == dfa->code[REGEXP_THREAD_PC(state->threads[i])].op)
+        {
+            return 1;
+        }
+        if (REGEXP_OP_EOL != dfa->code[REGEXP_THREAD_PC(state->threads[i])].op)
+        {
+            continue;
+        }
+        count = regexp_dfa_closure(dfa, state->threads[i] + 1, REGEXP_AT_END | (0 != at_begin ? REGEXP_AT_BEGIN : 0), 0);
+        count = count < 0 ? -count - 1 : count;
+        for (j = 0; j < count; j++)
+        {
+            if (REGEXP_OP_MATCH == dfa->code[REGEXP_THREAD_PC(dfa->list[j])].op)
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*a dfa that lost threads of a closure is wrong,the program is only backtracked from now on*/
+char regexp_dfa_lost(RegexProg *prog, RegexDfa *dfa)
+{
+    if (0 == dfa->overflow)
+    {
+        return 0;
+    }
+    prog->dfa = 0;
+    return 1;
+}
+
+/*
+ * where the leftmost match from from on ends,-1 for none,-2 when the dfa gave
+ * up. earliest stops at the first end seen.
+ */
+int regexp_dfa_forward(RegexProg *prog, const unsigned char *s, int length, int from, char earliest)
+{
+    RegexDfa *dfa = regexp_dfa(prog, 0);
+    RegexState *state = regexp_dfa_start(prog, dfa, 0 == from);
+    RegexState *next;
+    int end = -1;
+    int p = from;
+    if (0 != regexp_dfa_lost(prog, dfa))
+    {
+        return -2;
+    }
+    if (0 != state->match)
+    {
+        end = from;
+        if (0 != earliest)
+        {
+            return end;
+        }
+    }
+    while (p < length && 0 != state->count)
+    {
+        next = state->next[prog->classes[s[p]]];
+        if (NULL == next)
+        {
+            next = regexp_dfa_step(prog, dfa, state, s[p]);
+            if (0 != regexp_dfa_lost(prog, dfa))
+            {
+                return -2;
+            }
+        }
+        state = next;
+        p++;
+        if (0 != state->match)
+        {
+            end = p;
+            if (0 != earliest)
+            {
+                return end;
+            }
+        }
+    }
+    if (p == length && 0 != state->count && 0 != regexp_dfa_end(dfa, state, 0 == length))
+    {
+        end = length;
+    }
+    return 0 != regexp_dfa_lost(prog, dfa) ? -2 : end;
+}
+
+/*where the match ending at end starts,the earliest start not before from,-2 when the dfa gave up*/
+int regexp_dfa_backward(RegexProg *prog, const unsigned char *s, int length, int end, int from)
+{
+    RegexDfa *dfa = regexp_dfa(prog, 1);
+    RegexState *state = regexp_dfa_start(prog, dfa, end == length);
+    RegexState *next;
+    int start = 0 != state->match ? end : -1;
+    int p = end;
+    if (0 != regexp_dfa_lost(prog, dfa))
+    {
+        return -2;
+    }
+    while (p > from && 0 != state->count)
+    {
+        next = state->next[prog->classes[s[p - 1]]];
+        if (NULL == next)
+        {
+            next = regexp_dfa_step(prog, dfa, state, s[p - 1]);
+            if (0 != regexp_dfa_lost(prog, dfa))
+            {
+                return -2;
+            }
+        }
+        state = next;
+        p--;
+        if (0 != state->match)
+        {
+            start = p;
+        }
+    }
+    if (0 == p && 0 != state->count && 0 != regexp_dfa_end(dfa, state, 0 == length))
+    {
+        start = 0;
+    }
+    return 0 != regexp_dfa_lost(prog, dfa) ? -2 : start;
+}
+
+int regexp_push(RegexProg *prog, int sp, int pc, int pos)
+{
+    if (sp >= prog->stack_alloc)
+    {
+        prog->stack = regexp_grow(prog->memory, prog->stack, &prog->stack_alloc, sp, sizeof(RegexBranch), prog->line);
+    }
+    prog->stack[sp].pc = pc;
+    prog->stack[sp].pos = pos;
+    return sp + 1;
+}
+
+/*1 when pc at pos was tried before in this run,then it failed*/
+char regexp_visited(RegexProg *prog, int pc, int pos)
+{
+    int offset = pos - prog->memo_from;
+    long bit;
+    if (offset >= prog->memo_positions)
+    {
+        return 0;
+    }
+    bit = (long)offset * prog->length + pc;
+    if (0 != (prog->memo[bit >> 3] & (1 << (bit & 7))))
+    {
+        return 1;
+    }
+    prog->memo[bit >> 3] |= 1 << (bit & 7);
+    if (offset >= prog->memo_used)
+    {
+        prog->memo_used = offset + 1;
+    }
+    return 0;
+}
+
+/*positions are the major index,what a run used is a prefix*/
+void regexp_memo_begin(RegexProg *prog, int from)
+{
+    int bytes;
+    if (0 == prog->memo_ok)
+    {
+        return;
+    }
+    if (NULL == prog->memo)
+    {
+        prog->memo_positions = REGEXP_MEMO_BITS / prog->length;
+        bytes = (int)(((long)prog->memo_positions * prog->length + 7) / 8);
+        prog->memo = regexp_alloc(prog->memory, bytes, prog->line);
+        memset(prog->memo, 0, bytes);
+    }
+    prog->memo_from = from;
+    prog->memo_used = 0;
+}
+
+void regexp_memo_end(RegexProg *prog)
+{
+    if (0 != prog->memo_ok)
+    {
+        memset(prog->memo, 0, ((long)prog->memo_used * prog->length + 7) / 8);
+    }
+}
+
+char regexp_line_break_before(const unsigned char *s, int pos)
+{
+    return '\n' == s[pos - 1] || '\r' == s[pos - 1] ||
+           (pos >= 3 && 0xE2 == s[pos - 3] && 0x80 == s[pos - 2] && (0xA8 == s[pos - 1] || 0xA9 == s[pos - 1]));
+}
+
+char regexp_line_break_at(const unsigned char *s, int length, int pos)
+{
+    return '\n' == s[pos] || '\r' == s[pos] ||
+           (pos + 2 < length && 0xE2 == s[pos] && 0x80 == s[pos + 1] && (0xA8 == s[pos + 2] || 0xA9 == s[pos + 2]));
+}
+
+char regexp_word(int c)
+{
+    return (c >= '0' && c <= '9') || ((c | 32) >= 'a' && (c | 32) <= 'z') || '_' == c;
+}
+
+char regexp_same(const unsigned char *a, const unsigned char *b, int n, char fold)
+{
+    int i;
+    if (0 == fold)
+    {
+        return 0 == memcmp(a, b, n);
+    }
+    for (i = 0; i < n; i++)
+    {
+        if (a[i] != b[i] && !((a[i] | 32) == (b[i] | 32) && (a[i] | 32) >= 'a' && (a[i] | 32) <= 'z'))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * runs the program from pc at pos,depth first in priority order. 1 when it
+ * reaches MATCH or the LOOKEND of the lookahead being run,*top is where its
+ * branches end then. slots changed on the way are restored by the entries
+ * it leaves on the stack.
+ */
+char regexp_backtrack(RegexProg *prog, const unsigned char *s, int length, int pc, int pos, int base, int *top)
+{
+    RegexInst *inst;
+    char multiline = 0 != (prog->flag_bits & REGEXP_FLAG_MULTILINE);
+    char found;
+    int sp;
+    int sub;
+    int start;
+    int n;
+    int k;
+    sp = regexp_push(prog, base, pc, pos);
+    while (sp > base)
+    {
+        sp--;
+        pc = prog->stack[sp].pc;
+        pos = prog->stack[sp].pos;
+        if (pc < 0)
+        {
+            prog->slots[-1 - pc] = pos;
+            continue;
+        }
+        for (;;)
+        {
+            if (0 != prog->memo_ok && 0 != regexp_visited(prog, pc, pos))
+            {
+                break;
+            }
+            inst = prog->code + pc;
+            switch (inst->op)
+            {
+            case REGEXP_OP_BYTE:
+                if (pos < length && s[pos] == inst->x)
+                {
+                    pc++;
+                    pos++;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_SET:
+                if (pos < length && 0 != regexp_set_has(prog->sets[inst->x], s[pos]))
+                {
+                    pc++;
+                    pos++;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_SPLIT:
+                sp = regexp_push(prog, sp, inst->y, pos);
+                pc = inst->x;
+                continue;
+            case REGEXP_OP_JMP:
+                pc = inst->x;
+                continue;
+            case REGEXP_OP_SAVE:
+            case REGEXP_OP_MARK:
+                sp = regexp_push(prog, sp, -1 - inst->x, prog->slots[inst->x]);
+                prog->slots[inst->x] = pos;
+                pc++;
+                continue;
+            case REGEXP_OP_CHECK:
+                if (prog->slots[inst->x] != pos)
+                {
+                    pc++;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_RESET:
+                for (k = 2 * inst->x; k <= 2 * inst->y + 1; k++)
+                {
+                    sp = regexp_push(prog, sp, -1 - k, prog->slots[k]);
+                    prog->slots[k] = -1;
+                }
+                pc++;
+                continue;
+            case REGEXP_OP_BOL:
+                if (0 == pos || (0 != multiline && 0 != regexp_line_break_before(s, pos)))
+                {
+                    pc++;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_EOL:
+                if (length == pos || (0 != multiline && 0 != regexp_line_break_at(s, length, pos)))
+                {
+                    pc++;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_WORDB:
+            case REGEXP_OP_NWORDB:
+                n = (pos > 0 && 0 != regexp_word(s[pos - 1])) != (pos < length && 0 != regexp_word(s[pos]));
+                if (n == (REGEXP_OP_WORDB == inst->op))
+                {
+                    pc++;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_BACKREF: /*a group that took no part matches nothing*/
+                start = prog->slots[2 * inst->x];
+                n = prog->slots[2 * inst->x + 1] - start;
+                if (start < 0 || prog->slots[2 * inst->x + 1] < 0)
+                {
+                    pc++;
+                    continue;
+                }
+                if (pos + n <= length && 0 != regexp_same(s + start, s + pos, n, 0 != (prog->flag_bits & REGEXP_FLAG_IGNORE_CASE)))
+                {
+                    pc++;
+                    pos += n;
+                    continue;
+                }
+                break;
+            case REGEXP_OP_LOOK:
+                found = regexp_backtrack(prog, s, length, pc + 1, pos, sp, &sub);
+                if (found != inst->y)
+                { /*groups of a lookahead that held stay,their restores are kept*/
+                    for (k = sp, n = sp; k < sub && 0 != found; k++)
+                    {
+                        if (prog->stack[k].pc < 0)
+                        {
+                            prog->stack[n++] = prog->stack[k];
+                        }
+                    }
+                    sp = 0 != found ? n : sp;
+                    pc = inst->x;
+                    continue;
+                }
+                for (k = sub - 1; k >= sp && 0 != found; k--)
+                { /*a negative lookahead that matched gives its groups back*/
+                    if (prog->stack[k].pc < 0)
+                    {
+                        prog->slots[-1 - prog->stack[k].pc] = prog->stack[k].pos;
+                    }
+                }
+                break;
+            case REGEXP_OP_LOOKEND:
+            case REGEXP_OP_MATCH:
+                *top = sp;
+                return 1;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+void regexp_clear_slots(RegexProg *prog)
+{
+    int i;
+    for (i = 0; i < prog->slot_count; i++)
+    {
+        prog->slots[i] = -1;
+    }
+}
+
+/*tries each start from from on,or only from with sticky*/
+char regexp_search_backtrack(RegexProg *prog, const unsigned char *s, int length, int from, char sticky)
+{
+    const unsigned char *p;
+    int single = 0 != prog->has_first ? regexp_set_single(prog->first) : -1;
+    int start;
+    int top;
+    char found = 0;
+    regexp_memo_begin(prog, from);
+    for (start = from; start <= length; start++)
+    {
+        if (0 == sticky && single >= 0)
+        {
+            p = memchr(s + start, single, length - start);
+            if (NULL == p)
+            {
+                break;
+            }
+            start = p - s;
+        }
+        else if (0 == sticky && 0 != prog->has_first)
+        {
+            while (start < length && 0 == regexp_set_has(prog->first, s[start]))
+            {
+                start++;
+            }
+            if (start == length)
+            {
+                break;
+            }
+        }
+        regexp_clear_slots(prog);
+        if (0 != regexp_backtrack(prog, s, length, prog->start, start, 0, &top))
+        {
+            found = 1;
+            break;
+        }
+        if (0 != sticky)
+        {
+            break;
+        }
+    }
+    regexp_memo_end(prog);
+    return found;
+}
+
+/*
+ * the leftmost match at from or later,at from only when sticky. 1 when there
+ * is one,the slots hold where it and,with groups,each group starts and ends.
+ */
+char regexp_match(RegexProg *prog, const char *text, int length, int from, char groups, char sticky)
+{
+    const unsigned char *s = (const unsigned char *)text;
+    int start;
+    int end;
+    int top;
+    char found;
+    if (from < 0 || from > length)
+    {
+        return 0;
+    }
+    if (0 != prog->dfa && 0 == sticky)
+    {
+        end = regexp_dfa_forward(prog, s, length, from, 0);
+        if (-1 == end)
+        {
+            return 0;
+        }
+        start = end < 0 ? -2 : regexp_dfa_backward(prog, s, length, end, from);
+        if (start >= 0 && (0 == groups || 1 == prog->groups))
+        {
+            regexp_clear_slots(prog);
+            prog->slots[0] = start;
+            prog->slots[1] = end;
+            return 1;
+        }
+        if (start >= 0)
+        { /*the groups come from a run started right there*/
+            regexp_clear_slots(prog);
+            regexp_memo_begin(prog, start);
+            found = regexp_backtrack(prog, s, length, prog->start, start, 0, &top);
+            regexp_memo_end(prog);
+            if (0 != found)
+            {
+                return 1;
+            }
+        }
+    }
+    return regexp_search_backtrack(prog, s, length, from, sticky);
+}
+
+/*is there any match,the dfa stops at the first end it sees*/
+char regexp_test(RegexProg *prog, const char *text, int length)
+{
+    int end = -2;
+    if (0 != prog->dfa)
+    {
+        end = regexp_dfa_forward(prog, (const unsigned char *)text, length, 0, 1);
+    }
+    if (end > -2)
+    {
+        return end >= 0;
+    }
+    return regexp_match(prog, text, length, 0, 0, 0);
+}
+
+/*the chars and byte length of a string value,NULL for any other value*/
+char *regexp_chars(const JsValue *v, int *length)
+{
+    if (JS_VALUE_TYPE_STRING == v->typ)
+    {
+        *length = v->u.string->length;
+        return v->u.string->s;
+    }
+    if (JS_VALUE_TYPE_STRING_LITERAL == v->typ)
+    {
+        *length = strlen(v->u.literal_string);
+        return v->u.literal_string;
+    }
+    return NULL;
+}
+
+/*v as a string,NULL reads as undefined*/
+JsValue regexp_string_of(JsInterpreter *inter, const JsValue *v, int line)
+{
+    JsValue s;
+    s.typ = JS_VALUE_TYPE_STRING_LITERAL;
+    if (NULL == v || JS_VALUE_TYPE_UNDEFINED == v->typ)
+    {
+        s.u.literal_string = "undefined";
+        return s;
+    }
+    if (JS_VALUE_TYPE_BOOL == v->typ)
+    {
+        s.u.literal_string = JS_BOOL_TRUE == v->u.boolvalue ? "true" : "false";
+        return s;
+    }
+    if (JS_VALUE_TYPE_STRING == v->typ || JS_VALUE_TYPE_STRING_LITERAL == v->typ)
+    {
+        return *v;
+    }
+    return js_to_string(inter, v, line);
+}
+
+JsValue regexp_new_string(JsInterpreter *inter, const char *s, int length, int line)
+{
+    JsValue v;
+    v.typ = JS_VALUE_TYPE_STRING;
+    v.u.string = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_STRING, length + 1, line);
+    if (NULL != s)
+    {
+        memcpy(v.u.string->s, s, length);
+    }
+    v.u.string->s[length] = 0;
+    v.u.string->length = length;
+    return v;
+}
+
+/*bytes start to end of string,undefined for a group that took no part*/
+JsValue regexp_substring(JsInterpreter *inter, const JsValue *string, int start, int end, int line)
+{
+    JsValue v;
+    int length;
+    if (start < 0 || end < 0)
+    {
+        v.typ = JS_VALUE_TYPE_UNDEFINED;
+        return v;
+    }
+    v = regexp_new_string(inter, NULL, end - start, line);
+    memcpy(v.u.string->s, regexp_chars(string, &length) + start, end - start);
+    return v;
+}
+
+/*where a search goes on after the match start to end,past one char when it was empty*/
+int regexp_advance(const char *s, int length, int start, int end)
+{
+    int c;
+    if (end > start || end >= length)
+    {
+        return end > start ? end : length + 1;
+    }
+    c = (unsigned char)s[end];
+    if (c >= 0xF0)
+    {
+        c = 4;
+    }
+    else if (c >= 0xE0)
+    {
+        c = 3;
+    }
+    else if (c >= 0xC0)
+    {
+        c = 2;
+    }
+    else
+    {
+        c = 1;
+    }
+    return end + c < length ? end + c : length;
+}
+
+int regexp_int(const JsValue *v)
+{
+    if (JS_VALUE_TYPE_INT == v->typ)
+    {
+        return v->u.intvalue;
+    }
+    if (JS_VALUE_TYPE_FLOAT == v->typ)
+    {
+        return (int)v->u.floatvalue;
+    }
+    return 0;
+}
+
+JsValue regexp_value(JsInterpreter *inter, RegexProg *prog, char *source, char *flags, char owned, int line)
+{
+    JsValue v;
+    JsRegExp *regexp = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_REGEXP, 0, line);
+    regexp->prog = prog;
+    regexp->source = source;
+    regexp->flags = flags;
+    regexp->owned = owned;
+    v.typ = JS_VALUE_TYPE_REGEXP;
+    v.u.regexp = regexp;
+    return v;
+}
+
+RegexProg *regexp_prog(JsInterpreter *inter, JsRegExp *regexp, int line)
+{
+    if (NULL == regexp->prog)
+    { /*restored from a snapshot,it compiles again*/
+        regexp->prog = REGEXP_compile(inter->execute_memory, regexp->source, regexp->flags, line);
+        regexp->owned = 1;
+    }
+    return regexp->prog;
+}
+
+JsValue REGEXP_literal(JsInterpreter *inter, ExpressionRegExp *site, int line)
+{
+    if (NULL == site->prog)
+    {
+        site->prog = REGEXP_compile(inter->interpreter_memory, site->source, site->flags, line);
+    }
+    return regexp_value(inter, site->prog, site->source, site->flags, 0, line);
+}
+
+JsValue REGEXP_construct(JsInterpreter *inter, const JsValue *args, int count, int line)
+{
+    JsValue source;
+    JsValue flags;
+    char *s = "(?:)";
+    char *f = "";
+    int length;
+    RegexProg *prog;
+    if (count > 0 && JS_VALUE_TYPE_REGEXP == args[0].typ)
+    {
+        s = args[0].u.regexp->source;
+        f = args[0].u.regexp->flags;
+    }
+    else if (count > 0 && JS_VALUE_TYPE_UNDEFINED != args[0].typ)
+    {
+        source = regexp_string_of(inter, args, line);
+        s = regexp_chars(&source, &length);
+        s = 0 != length ? s : "(?:)";
+    }
+    if (count > 1 && JS_VALUE_TYPE_UNDEFINED != args[1].typ)
+    {
+        flags = regexp_string_of(inter, args + 1, line);
+        f = regexp_chars(&flags, &length);
+    }
+    prog = REGEXP_compile(inter->execute_memory, s, f, line);
+    return regexp_value(inter, prog, prog->source, prog->flags, 1, line);
+}
+
+/*exec without the array: from lastIndex with g or y,which moves on to the end of the match*/
+char regexp_exec(JsRegExp *regexp, RegexProg *prog, const char *s, int length, char groups)
+{
+    char keep = 0 != (prog->flag_bits & (REGEXP_FLAG_GLOBAL | REGEXP_FLAG_STICKY));
+    int from = 0 != keep ? regexp_int(&regexp->last_index) : 0;
+    char found = regexp_match(prog, s, length, from, groups, 0 != (prog->flag_bits & REGEXP_FLAG_STICKY));
+    if (0 != keep)
+    {
+        regexp->last_index.typ = JS_VALUE_TYPE_INT;
+        regexp->last_index.u.intvalue = 0 != found ? prog->slots[1] : 0;
+    }
+    if (0 != found)
+    {
+        regexp->index = prog->slots[0];
+    }
+    return found;
+}
+
+/*[match,group 1,...] of the last match*/
+JsValue regexp_groups(JsInterpreter *inter, RegexProg *prog, const JsValue *string, int line)
+{
+    JsValue v;
+    int i;
+    v.typ = JS_VALUE_TYPE_ARRAY;
+    v.u.array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, prog->groups, line);
+    for (i = 0; i < prog->groups; i++)
+    {
+        v.u.array->elements[i] = regexp_substring(inter, string, prog->slots[2 * i], prog->slots[2 * i + 1], line);
+    }
+    v.u.array->length = prog->groups;
+    return v;
+}
+
+JsValue REGEXP_call(JsInterpreter *inter, JsRegExp *regexp, char *method, const JsValue *args, int count, int line)
+{
+    RegexProg *prog = regexp_prog(inter, regexp, line);
+    JsValue string = regexp_string_of(inter, count > 0 ? args : NULL, line);
+    JsValue v;
+    int length;
+    char *s = regexp_chars(&string, &length);
+    if (0 == strcmp("test", method))
+    {
+        v.typ = JS_VALUE_TYPE_BOOL;
+        if (0 == (prog->flag_bits & (REGEXP_FLAG_GLOBAL | REGEXP_FLAG_STICKY)))
+        {
+            v.u.boolvalue = 0 != regexp_test(prog, s, length) ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+        }
+        else
+        {
+            v.u.boolvalue = 0 != regexp_exec(regexp, prog, s, length, 0) ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+        }
+        return v;
+    }
+    if (0 == strcmp("exec", method))
+    {
+        if (0 == regexp_exec(regexp, prog, s, length, 1))
+        {
+            v.typ = JS_VALUE_TYPE_NULL;
+            return v;
+        }
+        return regexp_groups(inter, prog, &string, line);
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_METHOD_NOT_FOUND, method, line);
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+/*pattern as a RegExp,a string is compiled as one*/
+JsRegExp *regexp_pattern(JsInterpreter *inter, const JsValue *args, int count, int line)
+{
+    if (count > 0 && JS_VALUE_TYPE_REGEXP == args[0].typ)
+    {
+        return args[0].u.regexp;
+    }
+    return REGEXP_construct(inter, args, count > 0 ? 1 : 0, line).u.regexp;
+}
+
+/*an array of the bytes between each pair of offsets,-1 for undefined*/
+JsValue regexp_pieces(JsInterpreter *inter, const JsValue *string, const int *pieces, int count, int line)
+{
+    JsValue v;
+    int i;
+    v.typ = JS_VALUE_TYPE_ARRAY;
+    v.u.array = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_ARRAY, count > 0 ? count : 1, line);
+    for (i = 0; i < count; i++)
+    {
+        v.u.array->elements[i] = regexp_substring(inter, string, pieces[2 * i], pieces[2 * i + 1], line);
+    }
+    v.u.array->length = count;
+    return v;
+}
+
+int *regexp_add_piece(JsInterpreter *inter, int *pieces, int *alloc, int *count, int start, int end, int line)
+{
+    pieces = regexp_grow(inter->execute_memory, pieces, alloc, 2 * *count + 1, sizeof(int), line);
+    pieces[2 * *count] = start;
+    pieces[2 * *count + 1] = end;
+    (*count)++;
+    return pieces;
+}
+
+JsValue regexp_string_match(JsInterpreter *inter, const JsValue *string, const JsValue *args, int count, int line)
+{
+    JsRegExp *regexp = regexp_pattern(inter, args, count, line);
+    RegexProg *prog = regexp_prog(inter, regexp, line);
+    JsValue v;
+    int *pieces = NULL;
+    int alloc = 0;
+    int found = 0;
+    int length;
+    int from = 0;
+    char *s = regexp_chars(string, &length);
+    v.typ = JS_VALUE_TYPE_NULL;
+    if (0 == (prog->flag_bits & REGEXP_FLAG_GLOBAL))
+    {
+        if (0 == regexp_exec(regexp, prog, s, length, 1))
+        {
+            return v;
+        }
+        return regexp_groups(inter, prog, string, line);
+    }
+    while (0 != regexp_match(prog, s, length, from, 0, 0 != (prog->flag_bits & REGEXP_FLAG_STICKY)))
+    {
+        pieces = regexp_add_piece(inter, pieces, &alloc, &found, prog->slots[0], prog->slots[1], line);
+        from = regexp_advance(s, length, prog->slots[0], prog->slots[1]);
+    }
+    regexp->last_index.typ = JS_VALUE_TYPE_INT;
+    regexp->last_index.u.intvalue = 0;
+    if (0 != found)
+    {
+        v = regexp_pieces(inter, string, pieces, found, line);
+    }
+    if (NULL != pieces)
+    {
+        MEM_free(inter->execute_memory, (char *)pieces);
+    }
+    return v;
+}
+
+void regexp_text_append(RegexText *text, const char *s, int length)
+{
+    text->s = regexp_grow(text->memory, text->s, &text->alloc, text->length + length, 1, text->line);
+    memcpy(text->s + text->length, s, length);
+    text->length += length;
+}
+
+/*$$,$&,$`,$' and $n of the replacement template with*/
+void regexp_expand(RegexText *out, const char *with, int with_length, const char *s, int length, const int *groups, int group_count)
+{
+    const char *p;
+    int i = 0;
+    int n;
+    int k;
+    char c;
+    while (i < with_length)
+    {
+        p = memchr(with + i, '$', with_length - i);
+        if (NULL == p)
+        {
+            regexp_text_append(out, with + i, with_length - i);
+            return;
+        }
+        regexp_text_append(out, with + i, p - with - i);
+        i = p - with;
+        c = i + 1 < with_length ? with[i + 1] : 0;
+        k = 2;
+        if ('$' == c)
+        {
+            regexp_text_append(out, "$", 1);
+        }
+        else if ('&' == c)
+        {
+            regexp_text_append(out, s + groups[0], groups[1] - groups[0]);
+        }
+        else if ('`' == c)
+        {
+            regexp_text_append(out, s, groups[0]);
+        }
+        else if ('\'' == c)
+        {
+            regexp_text_append(out, s + groups[1], length - groups[1]);
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            n = c - '0';
+            if (i + 2 < with_length && with[i + 2] >= '0' && with[i + 2] <= '9' && n * 10 + (with[i + 2] - '0') < group_count)
+            {
+                n = n * 10 + (with[i + 2] - '0');
+                k = 3;
+            }
+            if (n < 1 || n >= group_count)
+            {
+                regexp_text_append(out, "$", 1);
+                k = 1;
+            }
+            else if (groups[2 * n] >= 0)
+            {
+                regexp_text_append(out, s + groups[2 * n], groups[2 * n + 1] - groups[2 * n]);
+            }
+        }
+        else
+        {
+            regexp_text_append(out, "$", 1);
+            k = 1;
+        }
+        i += k;
+    }
+}
+
+/*replacement(match,groups...,offset,string),what it gives goes to out*/
+void regexp_replace_call(JsInterpreter *inter, const JsValue *func, const JsValue *string, const int *groups, int group_count, RegexText *out, int line)
+{
+    JsValue *args = regexp_alloc(inter->execute_memory, sizeof(JsValue) * (group_count + 2), line);
+    JsValue v;
+    char *s;
+    int length;
+    int i;
+    for (i = 0; i < group_count; i++)
+    {
+        args[i] = regexp_substring(inter, string, groups[2 * i], groups[2 * i + 1], line);
+    }
+    args[group_count].typ = JS_VALUE_TYPE_INT;
+    args[group_count].u.intvalue = groups[0];
+    args[group_count + 1] = *string;
+    v = eval_call_value(inter, func, args, group_count + 2, line);
+    MEM_free(inter->execute_memory, (char *)args);
+    v = regexp_string_of(inter, &v, line);
+    s = regexp_chars(&v, &length);
+    regexp_text_append(out, s, length);
+}
+
+/*the first place needle is in s from from on,-1 for none*/
+int regexp_find(const char *s, int length, int from, const char *needle, int n)
+{
+    const char *p = s + from;
+    if (0 == n)
+    {
+        return from <= length ? from : -1;
+    }
+    while (length - (p - s) >= n && NULL != (p = memchr(p, needle[0], length - (p - s) - n + 1)))
+    {
+        if (0 == memcmp(p, needle, n))
+        {
+            return p - s;
+        }
+        p++;
+    }
+    return -1;
+}
+
+JsValue regexp_string_replace(JsInterpreter *inter, const JsValue *string, const JsValue *args, int count, int line)
+{
+    JsValue pattern;
+    JsValue replacement;
+    JsValue v;
+    JsRegExp *regexp = NULL;
+    RegexProg *prog = NULL;
+    RegexText out;
+    char *s;
+    char *with = NULL;
+    char *needle = NULL;
+    char global = 0;
+    int *groups;
+    int group_count = 1;
+    int length;
+    int with_length = 0;
+    int needle_length = 0;
+    int from = 0;
+    int last = 0;
+    int at;
+    pattern.typ = JS_VALUE_TYPE_UNDEFINED;
+    replacement.typ = JS_VALUE_TYPE_UNDEFINED;
+    if (count > 0)
+    {
+        pattern = args[0];
+    }
+    if (count > 1)
+    {
+        replacement = args[1];
+    }
+    if (JS_VALUE_TYPE_FUNCTION != replacement.typ)
+    {
+        replacement = regexp_string_of(inter, &replacement, line);
+        with = regexp_chars(&replacement, &with_length);
+    }
+    if (JS_VALUE_TYPE_REGEXP == pattern.typ)
+    {
+        regexp = pattern.u.regexp;
+        prog = regexp_prog(inter, regexp, line);
+        global = 0 != (prog->flag_bits & REGEXP_FLAG_GLOBAL);
+        group_count = prog->groups;
+    }
+    else
+    {
+        pattern = regexp_string_of(inter, &pattern, line);
+        needle = regexp_chars(&pattern, &needle_length);
+    }
+    groups = regexp_alloc(inter->execute_memory, sizeof(int) * 2 * group_count, line);
+    out.memory = inter->execute_memory;
+    out.s = NULL;
+    out.length = 0;
+    out.alloc = 0;
+    out.line = line;
+    s = regexp_chars(string, &length);
+    for (;;)
+    {
+        if (NULL == regexp)
+        {
+            at = regexp_find(s, length, 0, needle, needle_length);
+            if (at < 0)
+            {
+                break;
+            }
+            groups[0] = at;
+            groups[1] = at + needle_length;
+        }
+        else if (0 != global ? 0 == regexp_match(prog, s, length, from, 1, 0 != (prog->flag_bits & REGEXP_FLAG_STICKY))
+                             : 0 == regexp_exec(regexp, prog, s, length, 1))
+        {
+            break;
+        }
+        else
+        { /*a replacement function may match with the same program*/
+            memcpy(groups, prog->slots, sizeof(int) * 2 * group_count);
+        }
+        regexp_text_append(&out, s + last, groups[0] - last);
+        if (JS_VALUE_TYPE_FUNCTION == replacement.typ)
+        {
+            regexp_replace_call(inter, &replacement, string, groups, group_count, &out, line);
+            s = regexp_chars(string, &length); /*gc may have moved the chars*/
+        }
+        else
+        {
+            regexp_expand(&out, with, with_length, s, length, groups, group_count);
+        }
+        last = groups[1];
+        if (0 == global)
+        {
+            break;
+        }
+        from = regexp_advance(s, length, groups[0], groups[1]);
+    }
+    if (0 != global)
+    {
+        regexp->last_index.typ = JS_VALUE_TYPE_INT;
+        regexp->last_index.u.intvalue = 0;
+    }
+    regexp_text_append(&out, s + last, length - last);
+    MEM_free(inter->execute_memory, (char *)groups);
+    v = regexp_new_string(inter, out.s, out.length, line);
+    if (NULL != out.s)
+    {
+        MEM_free(inter->execute_memory, out.s);
+    }
+    return v;
+}
+
+/*the pieces between matches of prog,with the groups of each match between them*/
+int *regexp_split_pieces(JsInterpreter *inter, RegexProg *prog, const char *s, int length, int limit, int *alloc, int *count, int line)
+{
+    int *pieces = NULL;
+    int p = 0;
+    int q = 0;
+    int i;
+    if (0 == length)
+    {
+        if (0 == regexp_match(prog, s, 0, 0, 0, 0))
+        {
+            pieces = regexp_add_piece(inter, pieces, alloc, count, 0, 0, line);
+        }
+        return pieces;
+    }
+    while (q < length && *count < limit && 0 != regexp_match(prog, s, length, q, 1, 0) && prog->slots[0] < length)
+    {
+        if (prog->slots[1] == p)
+        { /*empty right where the last piece ended,the next try starts a char later*/
+            q = regexp_advance(s, length, p, p);
+            continue;
+        }
+        pieces = regexp_add_piece(inter, pieces, alloc, count, p, prog->slots[0], line);
+        for (i = 1; i < prog->groups && *count < limit; i++)
+        {
+            pieces = regexp_add_piece(inter, pieces, alloc, count, prog->slots[2 * i], prog->slots[2 * i + 1], line);
+        }
+        p = prog->slots[1];
+        q = p;
+    }
+    if (*count < limit)
+    {
+        pieces = regexp_add_piece(inter, pieces, alloc, count, p, length, line);
+    }
+    return pieces;
+}
+
+JsValue regexp_string_split(JsInterpreter *inter, const JsValue *string, const JsValue *args, int count, int line)
+{
+    JsValue separator;
+    JsValue v;
+    int *pieces = NULL;
+    int alloc = 0;
+    int found = 0;
+    int limit = MAX_INT;
+    int length;
+    int n;
+    int p;
+    int at;
+    char *s = regexp_chars(string, &length);
+    char *sep;
+    if (count > 1 && JS_VALUE_TYPE_UNDEFINED != args[1].typ)
+    {
+        limit = regexp_int(args + 1) >= 0 ? regexp_int(args + 1) : MAX_INT;
+    }
+    if (0 == limit)
+    {
+    }
+    else if (0 == count || JS_VALUE_TYPE_UNDEFINED == args[0].typ)
+    {
+        pieces = regexp_add_piece(inter, pieces, &alloc, &found, 0, length, line);
+    }
+    else if (JS_VALUE_TYPE_REGEXP == args[0].typ)
+    {
+        pieces = regexp_split_pieces(inter, regexp_prog(inter, args[0].u.regexp, line), s, length, limit, &alloc, &found, line);
+    }
+    else
+    {
+        separator = regexp_string_of(inter, args, line);
+        sep = regexp_chars(&separator, &n);
+        for (p = 0; found < limit && p < length && 0 == n; p = at)
+        { /*one utf-8 char each*/
+            at = regexp_advance(s, length, p, p);
+            pieces = regexp_add_piece(inter, pieces, &alloc, &found, p, at, line);
+        }
+        for (p = 0; found < limit && 0 != n; p = at + n)
+        {
+            at = regexp_find(s, length, p, sep, n);
+            pieces = regexp_add_piece(inter, pieces, &alloc, &found, p, at >= 0 ? at : length, line);
+            if (at < 0)
+            {
+                break;
+            }
+        }
+    }
+    v = regexp_pieces(inter, string, pieces, found, line);
+    if (NULL != pieces)
+    {
+        MEM_free(inter->execute_memory, (char *)pieces);
+    }
+    return v;
+}
+
+JsValue REGEXP_string_call(JsInterpreter *inter, const JsValue *string, char *method, const JsValue *args, int count, int line)
+{
+    JsValue v;
+    if (0 == strcmp("match", method))
+    {
+        return regexp_string_match(inter, string, args, count, line);
+    }
+    if (0 == strcmp("replace", method))
+    {
+        return regexp_string_replace(inter, string, args, count, line);
+    }
+    if (0 == strcmp("split", method))
+    {
+        return regexp_string_split(inter, string, args, count, line);
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_METHOD_NOT_FOUND, method, line);
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+JsValue REGEXP_field(JsInterpreter *inter, JsRegExp *regexp, char *name, int line)
+{
+    char *flags = "gimy";
+    char *names[] = {"global", "ignoreCase", "multiline", "sticky"};
+    JsValue v;
+    int i;
+    if (0 == strcmp("lastIndex", name))
+    {
+        return regexp->last_index;
+    }
+    if (0 == strcmp("index", name))
+    {
+        v.typ = JS_VALUE_TYPE_INT;
+        v.u.intvalue = regexp->index;
+        return v;
+    }
+    if (0 == strcmp("source", name))
+    {
+        return regexp_new_string(inter, regexp->source, strlen(regexp->source), line);
+    }
+    if (0 == strcmp("flags", name))
+    {
+        return regexp_new_string(inter, regexp->flags, strlen(regexp->flags), line);
+    }
+    for (i = 0; i < 4; i++)
+    {
+        if (0 == strcmp(names[i], name))
+        {
+            v.typ = JS_VALUE_TYPE_BOOL;
+            v.u.boolvalue = NULL != strchr(regexp->flags, flags[i]) ? JS_BOOL_TRUE : JS_BOOL_FALSE;
+            return v;
+        }
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_FIELD_NOT_DEFINED, name, line);
+    v.typ = JS_VALUE_TYPE_UNDEFINED;
+    return v;
+}
+
+JsValue REGEXP_to_string(JsInterpreter *inter, JsRegExp *regexp, int line)
+{
+    int source = strlen(regexp->source);
+    int flags = strlen(regexp->flags);
+    JsValue v = regexp_new_string(inter, NULL, source + flags + 2, line);
+    v.u.string->s[0] = '/';
+    memcpy(v.u.string->s + 1, regexp->source, source);
+    v.u.string->s[source + 1] = '/';
+    memcpy(v.u.string->s + source + 2, regexp->flags, flags);
+    return v;
+}
@@ -0,0 +1,31 @@
+#ifndef REGEXP_H
+#define REGEXP_H
+#include "js.h"
+
+/*source with flags out of g,i,m,s and y,an invalid pattern is a runtime error*/
+RegexProg *REGEXP_compile(Memory *memory, char *source, char *flags, int line);
+
+void REGEXP_free(RegexProg *prog);
+
+/*a new RegExp for the literal,the program is compiled once per site and shared*/
+JsValue REGEXP_literal(JsInterpreter *inter, ExpressionRegExp *site, int line);
+
+/*new RegExp(pattern,flags),pattern a string or a RegExp*/
+JsValue REGEXP_construct(JsInterpreter *inter, const JsValue *args, int count, int line);
+
+/*re.test(s) and re.exec(s),exec gives [match,groups...] or null*/
+JsValue REGEXP_call(JsInterpreter *inter, JsRegExp *regexp, char *method, const JsValue *args, int count, int line);
+
+/*
+ * s.match(pattern),s.replace(pattern,replacement) and s.split(separator,limit).
+ * a replacement function may run gc,string and args must stay on the stack.
+ */
+JsValue REGEXP_string_call(JsInterpreter *inter, const JsValue *string, char *method, const JsValue *args, int count, int line);
+
+/*re.lastIndex,re.source,re.flags,re.global,re.ignoreCase,re.multiline,re.sticky and re.index*/
+JsValue REGEXP_field(JsInterpreter *inter, JsRegExp *regexp, char *name, int line);
+
+/*"/source/flags"*/
+JsValue REGEXP_to_string(JsInterpreter *inter, JsRegExp *regexp, int line);
+
+#endif
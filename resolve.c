@@ -0,0 +1,493 @@
+#include <string.h>
+#include "js.h"
+#include "memory.h"
+#include "error.h"
+#include "resolve.h"
+
+/*
+ * scope analysis.
+ * every if/for/while/switch body used to get its own ExecuteEnvironment,
+ * but most bodies never put anything in it. a body only needs one when
+ * something is declared in it (var or function declaration) or a closure
+ * is created in it, otherwise it runs in the enclosing env.
+ *
+ * capture analysis.
+ * a name declared in a function and used by a function nested in it is
+ * captured. only captured names go into a heap cell env that may outlive
+ * the call, everything else lives on the frame arena and is released when
+ * the scope is left. a function that uses names of enclosing functions
+ * is a closure and gets its own copy with the cell envs when evaluated.
+ */
+
+typedef struct ResolveName_tag
+{
+	char *name;
+	char *captured; /*flag in the tree,NULL for this and arguments*/
+	struct ResolveName_tag *next;
+} ResolveName;
+
+typedef struct ResolveScope_tag
+{
+	char declares;     /*var or function declaration evaluated in this env*/
+	char closure;      /*function literal created in this env*/
+	char has_captured; /*a name declared here is used by a nested function*/
+	char is_global;    /*top level statements,names there live in the global env*/
+	char keeps_value;  /*for in and switch keep a value on the stack while the body runs*/
+	JsFunction *func;  /*function this scope belongs to,NULL at top level*/
+	ResolveName *names;
+	struct ResolveScope_tag *outter;
+} ResolveScope;
+
+/*pass values,declarations of a scope are collected before its names are resolved*/
+#define RESOLVE_PASS_COLLECT 1
+#define RESOLVE_PASS_WALK 0
+
+Memory *resolve_memory;
+
+void resolve_expression(Expression *e, ResolveScope *scope, char pass);
+void resolve_statement_list(StatementList *list, ResolveScope *scope, char pass);
+void resolve_function(JsFunction *func, ResolveScope *outter);
+
+void resolve_open_scope(ResolveScope *scope, ResolveScope *outter, JsFunction *func)
+{
+	scope->declares = 0;
+	scope->closure = 0;
+	scope->has_captured = 0;
+	scope->is_global = 0;
+	scope->keeps_value = 0;
+	scope->func = func;
+	scope->names = NULL;
+	scope->outter = outter;
+}
+
+void resolve_close_scope(ResolveScope *scope)
+{
+	ResolveName *next;
+	while (NULL != scope->names)
+	{
+		next = scope->names->next;
+		MEM_free(resolve_memory, (char *)scope->names);
+		scope->names = next;
+	}
+}
+
+void resolve_declare(ResolveScope *scope, char *name, char *captured)
+{
+	ResolveName *n = (ResolveName *)MEM_alloc(resolve_memory, sizeof(ResolveName), 0);
+	n->name = name;
+	n->captured = captured;
+	n->next = scope->names;
+	scope->names = n;
+}
+
+void resolve_reference(ResolveScope *scope, char *name)
+{
+	ResolveScope *s;
+	ResolveScope *t;
+	ResolveName *n = NULL;
+	for (s = scope; NULL != s; s = s->outter)
+	{
+		for (n = s->names; NULL != n; n = n->next)
+		{
+			if (0 == strcmp(n->name, name))
+			{
+				break;
+			}
+		}
+		if (NULL != n)
+		{
+			break;
+		}
+	}
+	if (NULL != s && NULL == n->captured && NULL != s->func)
+	{ /*the call binds this and arguments only for functions that read them*/
+		if (0 == strcmp(name, "this"))
+		{
+			s->func->uses_this = 1;
+		}
+		else
+		{
+			s->func->uses_arguments = 1;
+		}
+	}
+	/*not declared anywhere (global or dynamic),top level names or same function*/
+	if (NULL == s || 1 == s->is_global || s->func == scope->func || NULL == n->captured)
+	{
+		return;
+	}
+	/*a name may be declared more than once in a scope,all of them go to the cell env*/
+	for (n = s->names; NULL != n; n = n->next)
+	{
+		if (NULL != n->captured && 0 == strcmp(n->name, name))
+		{
+			*n->captured = 1;
+		}
+	}
+	s->has_captured = 1;
+	/*every function between the use and the declaration needs the cell envs*/
+	for (t = scope; t != s; t = t->outter)
+	{
+		if (t->func != t->outter->func)
+		{
+			t->func->captures = 1;
+		}
+	}
+}
+
+void resolve_expression_list(ExpressionList *list, ResolveScope *scope, char pass)
+{
+	while (NULL != list)
+	{
+		resolve_expression(list->expression, scope, pass);
+		list = list->next;
+	}
+}
+
+void resolve_function_literal(JsFunction *func, ResolveScope *scope, char pass)
+{
+	if (RESOLVE_PASS_WALK == pass)
+	{
+		scope->closure = 1;
+		resolve_function(func, scope);
+	}
+}
+
+void resolve_expression(Expression *e, ResolveScope *scope, char pass)
+{
+	ExpressionObjectKVList *kvs;
+	if (NULL == e)
+	{
+		return;
+	}
+	switch (e->typ)
+	{
+	case EXPRESSION_TYPE_BOOL:
+	case EXPRESSION_TYPE_INT:
+	case EXPRESSION_TYPE_FLOAT:
+	case EXPRESSION_TYPE_STRING:
+	case EXPRESSION_TYPE_NULL:
+	case EXPRESSION_TYPE_UNDEFINED:
+	case EXPRESSION_TYPE_REGEXP:
+		break;
+	case EXPRESSION_TYPE_IDENTIFIER:
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_reference(scope, e->u.identifier);
+		}
+		break;
+	case EXPRESSION_TYPE_ARRAY:
+		resolve_expression_list(e->u.expression_list, scope, pass);
+		break;
+	case EXPRESSION_TYPE_OBJECT:
+		for (kvs = e->u.object_kv_list; NULL != kvs; kvs = kvs->next)
+		{
+			resolve_expression(kvs->kv->expression_key, scope, pass);
+			resolve_expression(kvs->kv->value, scope, pass);
+			if (NULL != kvs->kv->func)
+			{
+				resolve_function_literal(kvs->kv->func, scope, pass);
+			}
+		}
+		break;
+	case EXPRESSION_TYPE_LOGICAL_OR:
+	case EXPRESSION_TYPE_LOGICAL_AND:
+	case EXPRESSION_TYPE_ASSIGN:
+	case EXPRESSION_TYPE_PLUS_ASSIGN:
+	case EXPRESSION_TYPE_MINUS_ASSIGN:
+	case EXPRESSION_TYPE_MUL_ASSIGN:
+	case EXPRESSION_TYPE_DIV_ASSIGN:
+	case EXPRESSION_TYPE_MOD_ASSIGN:
+	case EXPRESSION_TYPE_EQ:
+	case EXPRESSION_TYPE_NE:
+	case EXPRESSION_TYPE_GE:
+	case EXPRESSION_TYPE_GT:
+	case EXPRESSION_TYPE_LE:
+	case EXPRESSION_TYPE_LT:
+	case EXPRESSION_TYPE_ADD:
+	case EXPRESSION_TYPE_SUB:
+	case EXPRESSION_TYPE_MUL:
+	case EXPRESSION_TYPE_DIV:
+	case EXPRESSION_TYPE_MOD:
+		resolve_expression(e->u.binary->left, scope, pass);
+		resolve_expression(e->u.binary->right, scope, pass);
+		break;
+	case EXPRESSION_TYPE_ASSIGN_FUNCTION:
+		if (NULL == e->u.assign_function->dest && RESOLVE_PASS_WALK == pass)
+		{
+			resolve_reference(scope, e->u.assign_function->identifier);
+		}
+		resolve_expression(e->u.assign_function->dest, scope, pass);
+		resolve_function_literal(e->u.assign_function->func, scope, pass);
+		break;
+	case EXPRESSION_TYPE_FUNCTION:
+		resolve_function_literal(e->u.func, scope, pass);
+		break;
+	case EXPRESSION_TYPE_CREATE_FUNCTION:
+		if (RESOLVE_PASS_COLLECT == pass)
+		{
+			resolve_declare(scope, e->u.func->name, &e->u.func->name_captured);
+		}
+		scope->declares = 1;
+		resolve_function_literal(e->u.func, scope, pass);
+		break;
+	case EXPRESSION_TYPE_INDEX:
+		resolve_expression(e->u.index->e, scope, pass);
+		resolve_expression(e->u.index->index, scope, pass);
+		break;
+	case EXPRESSION_TYPE_METHOD_CALL:
+		resolve_expression(e->u.method_call->e, scope, pass);
+		resolve_expression_list(e->u.method_call->args, scope, pass);
+		break;
+	case EXPRESSION_TYPE_FUNCTION_CALL:
+	case EXPRESSION_TYPE_EXPRESSION_FUNCTION_CALL:
+		if (NULL != e->u.function_call->func && RESOLVE_PASS_WALK == pass)
+		{
+			resolve_reference(scope, e->u.function_call->func);
+		}
+		resolve_expression(e->u.function_call->e, scope, pass);
+		resolve_expression_list(e->u.function_call->args, scope, pass);
+		break;
+	case EXPRESSION_TYPE_INCREMENT:
+	case EXPRESSION_TYPE_PRE_INCREMENT:
+	case EXPRESSION_TYPE_PRE_DECREMENT:
+	case EXPRESSION_TYPE_DECREMENT:
+	case EXPRESSION_TYPE_NEGATIVE:
+	case EXPRESSION_TYPE_NOT:
+		resolve_expression(e->u.unary, scope, pass);
+		break;
+	case EXPRESSION_TYPE_AWAIT:
+		/*an async body suspends,the top level runs the event loop until the promise settles*/
+		if (NULL != scope->func && 0 == scope->func->async)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_AWAIT_OUTSIDE_ASYNC, "await", e->line);
+		}
+		resolve_expression(e->u.unary, scope, pass);
+		break;
+	case EXPRESSION_TYPE_YIELD:
+		/*suspends the generator body,a nested function is no generator of its own*/
+		if (NULL == scope->func || 0 == scope->func->generator)
+		{
+			ERROR_runtime_error(RUNTIME_ERROR_YIELD_OUTSIDE_GENERATOR, "yield", e->line);
+		}
+		resolve_expression(e->u.unary, scope, pass);
+		break;
+	case EXPRESSION_TYPE_CREATE_LOCAL_VARIABLE:
+		if (RESOLVE_PASS_COLLECT == pass)
+		{
+			resolve_declare(scope, e->u.create_var->identifier, &e->u.create_var->captured);
+		}
+		scope->declares = 1;
+		resolve_expression(e->u.create_var->expression, scope, pass);
+		break;
+	case EXPRESSION_TYPE_NEW:
+		resolve_expression_list(e->u.new->args, scope, pass);
+		break;
+	}
+}
+
+/*statements and heads evaluated in one env,declarations are collected first*/
+void resolve_scope_body(
+	ResolveScope *scope,
+	Expression *head1,
+	Expression *head2,
+	Expression *head3,
+	StatementList *list)
+{
+	char pass;
+	for (pass = RESOLVE_PASS_COLLECT; pass >= RESOLVE_PASS_WALK; pass--)
+	{
+		resolve_expression(head1, scope, pass);
+		resolve_expression(head2, scope, pass);
+		resolve_expression(head3, scope, pass);
+		resolve_statement_list(list, scope, pass);
+	}
+}
+
+/*resolve a body that gets its own env,heads are expressions evaluated in that same env*/
+void resolve_block(Block *block, ResolveScope *outter, Expression *head1, Expression *head2, Expression *head3)
+{
+	ResolveScope scope;
+	if (NULL == block)
+	{
+		return;
+	}
+	resolve_open_scope(&scope, outter, outter->func);
+	resolve_scope_body(&scope, head1, head2, head3, block->list);
+	block->need_env = scope.declares || scope.closure;
+	block->has_captured = scope.has_captured;
+	resolve_close_scope(&scope);
+}
+
+void resolve_statement_for_in(StatementForIn *in, ResolveScope *outter)
+{
+	ResolveScope scope;
+	resolve_open_scope(&scope, outter, outter->func);
+	scope.keeps_value = 1;
+	resolve_declare(&scope, in->identifer, &in->captured);
+	resolve_scope_body(&scope, NULL, NULL, NULL, in->block->list);
+	in->block->need_env = 1; /*loop variable always lives in the for in env*/
+	in->block->has_captured = scope.has_captured;
+	resolve_close_scope(&scope);
+}
+
+void resolve_statement_switch(StatementSwitch *s, ResolveScope *outter)
+{
+	ResolveScope scope;
+	StatementSwitchCaseList *list;
+	char pass;
+	resolve_open_scope(&scope, outter, outter->func);
+	scope.keeps_value = 1;
+	for (pass = RESOLVE_PASS_COLLECT; pass >= RESOLVE_PASS_WALK; pass--)
+	{
+		for (list = s->list; NULL != list; list = list->next)
+		{
+			resolve_expression(list->match, &scope, pass);
+			resolve_statement_list(list->list, &scope, pass);
+		}
+		resolve_statement_list(s->defaultpart, &scope, pass);
+	}
+	s->need_env = scope.declares || scope.closure;
+	s->has_captured = scope.has_captured;
+	resolve_close_scope(&scope);
+}
+
+/*
+ * return f(...) in a function can run f in place of the current call,
+ * unless a for in or switch of the same function still keeps a value
+ * on the stack under the return value.
+ */
+void resolve_tail_call(Expression *e, ResolveScope *scope)
+{
+	ResolveScope *s;
+	if (NULL == e || NULL == scope->func)
+	{
+		return;
+	}
+	if (EXPRESSION_TYPE_FUNCTION_CALL != e->typ && EXPRESSION_TYPE_EXPRESSION_FUNCTION_CALL != e->typ)
+	{
+		return;
+	}
+	for (s = scope; NULL != s && s->func == scope->func; s = s->outter)
+	{
+		if (0 != s->keeps_value)
+		{
+			return;
+		}
+	}
+	e->u.function_call->tail = 1;
+}
+
+/*nested bodies are only entered on walk,their declarations are their own*/
+void resolve_statement(Statement *s, ResolveScope *scope, char pass)
+{
+	StatementElsifList *elsif;
+	if (NULL == s)
+	{
+		return;
+	}
+	switch (s->typ)
+	{
+	case STATEMENT_TYPE_EXPRESSION:
+		resolve_expression(s->u.expression_statement, scope, pass);
+		break;
+	case STATEMENT_TYPE_IF:
+		/*condition runs in the env of then part,else if conditions run outside*/
+		for (elsif = s->u.if_statement->elseIfList; NULL != elsif; elsif = elsif->next)
+		{
+			resolve_expression(elsif->elsif.condition, scope, pass);
+		}
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_block(s->u.if_statement->then, scope, s->u.if_statement->condition, NULL, NULL);
+			for (elsif = s->u.if_statement->elseIfList; NULL != elsif; elsif = elsif->next)
+			{
+				resolve_block(elsif->elsif.block, scope, NULL, NULL, NULL);
+			}
+			resolve_block(s->u.if_statement->els, scope, NULL, NULL, NULL);
+		}
+		break;
+	case STATEMENT_TYPE_FOR:
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_block(s->u.for_statement->block,
+						  scope,
+						  s->u.for_statement->init,
+						  s->u.for_statement->condition,
+						  s->u.for_statement->afterblock);
+		}
+		break;
+	case STATEMENT_TYPE_FOR_IN:
+		resolve_expression(s->u.forin_statement->target, scope, pass); /*target is evaluated outside*/
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_statement_for_in(s->u.forin_statement, scope);
+		}
+		break;
+	case STATEMENT_TYPE_WHILE:
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_block(s->u.while_statement->block, scope, s->u.while_statement->condition, NULL, NULL);
+		}
+		break;
+	case STATEMENT_TYPE_RETURN:
+		resolve_expression(s->u.return_expression, scope, pass);
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_tail_call(s->u.return_expression, scope);
+		}
+		break;
+	case STATEMENT_TYPE_SWITCH:
+		resolve_expression(s->u.switch_statement->condition, scope, pass); /*condition is evaluated outside*/
+		if (RESOLVE_PASS_WALK == pass)
+		{
+			resolve_statement_switch(s->u.switch_statement, scope);
+		}
+		break;
+	case STATEMENT_TYPE_CONTINUE:
+	case STATEMENT_TYPE_BREAK:
+		break;
+	}
+}
+
+void resolve_statement_list(StatementList *list, ResolveScope *scope, char pass)
+{
+	while (NULL != list)
+	{
+		resolve_statement(list->statement, scope, pass);
+		list = list->next;
+	}
+}
+
+void resolve_function(JsFunction *func, ResolveScope *outter)
+{
+	ResolveScope scope;
+	ParameterList *para;
+	if (NULL == func || NULL == func->block)
+	{
+		return;
+	}
+	/*function body always runs in the call env*/
+	resolve_open_scope(&scope, outter, func);
+	resolve_declare(&scope, "this", NULL);
+	resolve_declare(&scope, "arguments", NULL);
+	func->parameter_count = 0;
+	for (para = func->parameter_list; NULL != para; para = para->next)
+	{
+		resolve_declare(&scope, para->identifier, &para->captured);
+		func->parameter_count++;
+	}
+	resolve_scope_body(&scope, NULL, NULL, NULL, func->block->list);
+	func->block->need_env = 1;
+	func->block->has_captured = scope.has_captured;
+	resolve_close_scope(&scope);
+}
+
+void RESOLVE_program(JsInterpreter *inter)
+{
+	ResolveScope scope;
+	resolve_memory = inter->interpreter_memory;
+	resolve_open_scope(&scope, NULL, NULL);
+	scope.is_global = 1;
+	resolve_scope_body(&scope, NULL, NULL, NULL, inter->statement_list);
+	resolve_close_scope(&scope);
+}
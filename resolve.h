@@ -0,0 +1,8 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+#include "js.h"
+
+/*walk the whole program once after parse and annotate the tree for the interpreter*/
+void RESOLVE_program(JsInterpreter *inter);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "js.h"
+#include "util.h"
+#include "heap.h"
+#include "interprete.h"
+#include "resolve.h"
+#include "lex.h"
+#include "output.h"
+#include "server.h"
+
+/*
+ * fork server.
+ * the init script runs once,then every job runs in a child forked from the
+ * warm interpreter. the child shares the heap with the server copy on write,
+ * gc marks the shared objects in a side bitmap so collecting keeps them shared.
+ * the child parses and runs its script and exits without freeing anything.
+ */
+
+#define SERVER_LINE_SIZE 4096
+#define SERVER_STACK_SIZE (64 * 1024 * 1024)
+
+void server_exit(int code)
+{
+    OUTPUT_flush(&current_interpreter->output);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(code); /*exit would also rewind the stdin the server reads jobs from*/
+}
+
+/*runs on its own thread,see server_job*/
+void *server_job_thread(void *arg)
+{
+    extern int yyparse(void);
+    JsInterpreter *inter = current_interpreter;
+    char *path = arg;
+    FILE *fp = fopen(path, "r");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "%s not found.\n", path);
+        server_exit(1);
+    }
+    if (0 != LEX_open_file(fp))
+    {
+        fprintf(stderr, "%s can not be read.\n", path);
+        server_exit(1);
+    }
+    fclose(fp);
+    reset_line_number();
+    inter->statement_list = NULL; /*the init script is done,its tree stays for its functions*/
+    if (yyparse())
+    {
+        fprintf(stderr, "Error ! Error ! Error !\n");
+        server_exit(4);
+    }
+    RESOLVE_program(inter);
+    INTERPRETE_execute(inter);
+    server_exit(0);
+    return NULL;
+}
+
+/*
+ * the job keeps off the pages it shares with the server:
+ * its allocations go to trees of its own,inserting into the inherited ones
+ * would write a node on some shared page each time,and it runs on a new
+ * thread,which malloc gives a new arena instead of the holes of the old heap.
+ * whatever the server allocated is unknown to MEM_free and stays.
+ */
+void server_job(JsInterpreter *inter, char *path)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    struct rlimit limit;
+    inter->interpreter_memory = MEM_open_storage();
+    inter->execute_memory = MEM_open_storage();
+    if (NULL == inter->interpreter_memory || NULL == inter->execute_memory)
+    {
+        fprintf(stderr, "create interpreter failed...\n");
+        server_exit(1);
+    }
+    pthread_attr_init(&attr);
+    if (0 == getrlimit(RLIMIT_STACK, &limit) && RLIM_INFINITY != limit.rlim_cur)
+    { /*as deep as the main thread could recurse*/
+        pthread_attr_setstacksize(&attr, limit.rlim_cur);
+    }
+    else
+    {
+        pthread_attr_setstacksize(&attr, SERVER_STACK_SIZE);
+    }
+    if (0 != pthread_create(&thread, &attr, server_job_thread, path))
+    {
+        server_job_thread(path);
+    }
+    pthread_join(thread, NULL);
+}
+
+/*cut the line end off,0 for a blank line*/
+int server_line(char *line)
+{
+    int length = strlen(line);
+    while (length > 0 && ('\n' == line[length - 1] || '\r' == line[length - 1]))
+    {
+        line[--length] = 0;
+    }
+    return length;
+}
+
+/*jobs one after another,so outputs do not mix*/
+int server_stdin(JsInterpreter *inter)
+{
+    char line[SERVER_LINE_SIZE];
+    pid_t pid;
+    int status;
+    while (NULL != fgets(line, sizeof(line), stdin))
+    {
+        if (0 == server_line(line))
+        {
+            continue;
+        }
+        OUTPUT_flush(&inter->output); /*else every child writes it again*/
+        fflush(stdout);
+        fflush(stderr);
+        pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            return -1;
+        }
+        if (0 == pid)
+        {
+            server_job(inter, line);
+        }
+        waitpid(pid, &status, 0);
+    }
+    return 0;
+}
+
+/*the child reads the job line and answers on the connection*/
+void server_connection(JsInterpreter *inter, int conn)
+{
+    char line[SERVER_LINE_SIZE];
+    int length = 0;
+    int n;
+    while (length < SERVER_LINE_SIZE - 1)
+    {
+        n = read(conn, line + length, 1);
+        if (n <= 0 || '\n' == line[length])
+        {
+            break;
+        }
+        length++;
+    }
+    line[length] = 0;
+    dup2(conn, 1);
+    dup2(conn, 2);
+    close(conn);
+    if (0 == server_line(line))
+    {
+        server_exit(1);
+    }
+    server_job(inter, line);
+}
+
+/*jobs run side by side,one per connection*/
+int server_socket(JsInterpreter *inter, char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+    int conn;
+    pid_t pid;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "socket path %s is too long.\n", path);
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || 0 != listen(fd, 64))
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    signal(SIGCHLD, SIG_IGN); /*nobody waits for the children*/
+    for (;;)
+    {
+        conn = accept(fd, NULL, NULL);
+        if (conn < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            perror("accept");
+            close(fd);
+            return -1;
+        }
+        OUTPUT_flush(&inter->output);
+        fflush(stdout);
+        fflush(stderr);
+        pid = fork();
+        if (0 == pid)
+        {
+            close(fd);
+            server_connection(inter, conn);
+        }
+        if (pid < 0)
+        {
+            perror("fork");
+        }
+        close(conn);
+    }
+}
+
+int SERVER_run(JsInterpreter *inter, char *socket_path)
+{
+    INTERPRETE_execute(inter);
+    gc_freeze(inter);
+    malloc_trim(0); /*free pages go back,a job filling them gets new pages instead of copies*/
+    if (NULL == socket_path)
+    {
+        return server_stdin(inter);
+    }
+    return server_socket(inter, socket_path);
+}
@@ -0,0 +1,12 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include "js.h"
+
+/*
+ * run the parsed init script,then fork a child per job.
+ * a job is a line naming a script,read from stdin when socket_path is NULL,
+ * else one per connection to the unix socket. returns when stdin ends.
+ */
+int SERVER_run(JsInterpreter *inter, char *socket_path);
+
+#endif
@@ -0,0 +1,529 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_AVX2 __attribute__((target("avx2")))
+#endif
+#include "simd.h"
+
+/*
+ * the kernels behind the bulk methods of typed arrays.
+ * each comes as plain c,as sse2 and as avx2,the wide ones do whole vectors
+ * and leave the rest to the plain one. sse2 is there on every x86-64,avx2
+ * is compiled for that cpu alone and only picked when cpuid has it.
+ * sums and dots add in several lanes at once,so a float result may differ
+ * in its last bits from adding one by one.
+ */
+
+void simd_add_f64(double *a, const double *b, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        a[i] += b[i];
+    }
+}
+
+void simd_mul_f64(double *a, const double *b, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        a[i] *= b[i];
+    }
+}
+
+void simd_scale_f64(double *a, double k, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        a[i] *= k;
+    }
+}
+
+void simd_fill_f64(double *a, double v, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        a[i] = v;
+    }
+}
+
+/*from the sum s of what came before*/
+void simd_prefix_f64_from(double *a, double s, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        s += a[i];
+        a[i] = s;
+    }
+}
+
+void simd_prefix_f64(double *a, int n)
+{
+    simd_prefix_f64_from(a, 0, n);
+}
+
+double simd_sum_f64(const double *a, int n)
+{
+    double s = 0;
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        s += a[i];
+    }
+    return s;
+}
+
+double simd_dot_f64(const double *a, const double *b, int n)
+{
+    double s = 0;
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        s += a[i] * b[i];
+    }
+    return s;
+}
+
+/*m is the min so far,it is NaN once a NaN was seen*/
+double simd_min_f64_from(const double *a, double m, int n)
+{
+    int i;
+    for (i = 0; i < n && m == m; i++)
+    {
+        if (a[i] < m || a[i] != a[i])
+        {
+            m = a[i];
+        }
+    }
+    return m;
+}
+
+double simd_max_f64_from(const double *a, double m, int n)
+{
+    int i;
+    for (i = 0; i < n && m == m; i++)
+    {
+        if (a[i] > m || a[i] != a[i])
+        {
+            m = a[i];
+        }
+    }
+    return m;
+}
+
+double simd_min_f64(const double *a, int n)
+{
+    return simd_min_f64_from(a + 1, a[0], n - 1);
+}
+
+double simd_max_f64(const double *a, int n)
+{
+    return simd_max_f64_from(a + 1, a[0], n - 1);
+}
+
+void simd_add_i32(int *a, const int *b, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        a[i] = (int)((unsigned int)a[i] + (unsigned int)b[i]);
+    }
+}
+
+void simd_mul_i32(int *a, const int *b, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        a[i] = (int)((unsigned int)a[i] * (unsigned int)b[i]);
+    }
+}
+
+#ifdef __SSE2__
+void simd_add_f64_sse2(double *a, const double *b, int n)
+{
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    simd_add_f64(a + i, b + i, n - i);
+}
+
+void simd_mul_f64_sse2(double *a, const double *b, int n)
+{
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    simd_mul_f64(a + i, b + i, n - i);
+}
+
+void simd_scale_f64_sse2(double *a, double k, int n)
+{
+    __m128d vk = _mm_set1_pd(k);
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, _mm_mul_pd(_mm_loadu_pd(a + i), vk));
+    }
+    simd_scale_f64(a + i, k, n - i);
+}
+
+void simd_fill_f64_sse2(double *a, double v, int n)
+{
+    __m128d vv = _mm_set1_pd(v);
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(a + i, vv);
+    }
+    simd_fill_f64(a + i, v, n - i);
+}
+
+/*[x0,x1] becomes [x0,x0+x1],then the sum of the pairs before is added*/
+void simd_prefix_f64_sse2(double *a, int n)
+{
+    __m128d zero = _mm_setzero_pd();
+    __m128d carry = zero;
+    __m128d x;
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        x = _mm_loadu_pd(a + i);
+        x = _mm_add_pd(x, _mm_unpacklo_pd(zero, x));
+        x = _mm_add_pd(x, carry);
+        _mm_storeu_pd(a + i, x);
+        carry = _mm_unpackhi_pd(x, x);
+    }
+    simd_prefix_f64_from(a + i, _mm_cvtsd_f64(carry), n - i);
+}
+
+double simd_sum_f64_sse2(const double *a, int n)
+{
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    { /*two sums so one add need not wait for the one before*/
+        s0 = _mm_add_pd(s0, _mm_loadu_pd(a + i));
+        s1 = _mm_add_pd(s1, _mm_loadu_pd(a + i + 2));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    s0 = _mm_add_sd(s0, _mm_unpackhi_pd(s0, s0));
+    return _mm_cvtsd_f64(s0) + simd_sum_f64(a + i, n - i);
+}
+
+double simd_dot_f64_sse2(const double *a, const double *b, int n)
+{
+    __m128d s0 = _mm_setzero_pd();
+    __m128d s1 = _mm_setzero_pd();
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    s0 = _mm_add_pd(s0, s1);
+    s0 = _mm_add_sd(s0, _mm_unpackhi_pd(s0, s0));
+    return _mm_cvtsd_f64(s0) + simd_dot_f64(a + i, b + i, n - i);
+}
+
+/*minpd drops a NaN,so NaNs are looked for on the side*/
+double simd_min_f64_sse2(const double *a, int n)
+{
+    __m128d m = _mm_set1_pd(a[0]);
+    __m128d nan = _mm_setzero_pd();
+    __m128d x;
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        x = _mm_loadu_pd(a + i);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(x, x));
+        m = _mm_min_pd(m, x);
+    }
+    if (0 != _mm_movemask_pd(nan))
+    {
+        return simd_min_f64(a, n); /*the NaN itself*/
+    }
+    m = _mm_min_sd(m, _mm_unpackhi_pd(m, m));
+    return simd_min_f64_from(a + i, _mm_cvtsd_f64(m), n - i);
+}
+
+double simd_max_f64_sse2(const double *a, int n)
+{
+    __m128d m = _mm_set1_pd(a[0]);
+    __m128d nan = _mm_setzero_pd();
+    __m128d x;
+    int i;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        x = _mm_loadu_pd(a + i);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(x, x));
+        m = _mm_max_pd(m, x);
+    }
+    if (0 != _mm_movemask_pd(nan))
+    {
+        return simd_max_f64(a, n); /*the NaN itself*/
+    }
+    m = _mm_max_sd(m, _mm_unpackhi_pd(m, m));
+    return simd_max_f64_from(a + i, _mm_cvtsd_f64(m), n - i);
+}
+
+void simd_add_i32_sse2(int *a, const int *b, int n)
+{
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_si128((__m128i *)(a + i),
+                         _mm_add_epi32(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i))));
+    }
+    simd_add_i32(a + i, b + i, n - i);
+}
+#endif
+
+#ifdef SIMD_AVX2
+SIMD_AVX2 void simd_add_f64_avx2(double *a, const double *b, int n)
+{
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    simd_add_f64(a + i, b + i, n - i);
+}
+
+SIMD_AVX2 void simd_mul_f64_avx2(double *a, const double *b, int n)
+{
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    simd_mul_f64(a + i, b + i, n - i);
+}
+
+SIMD_AVX2 void simd_scale_f64_avx2(double *a, double k, int n)
+{
+    __m256d vk = _mm256_set1_pd(k);
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), vk));
+    }
+    simd_scale_f64(a + i, k, n - i);
+}
+
+SIMD_AVX2 void simd_fill_f64_avx2(double *a, double v, int n)
+{
+    __m256d vv = _mm256_set1_pd(v);
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(a + i, vv);
+    }
+    simd_fill_f64(a + i, v, n - i);
+}
+
+/*each lane gets the one before it added,then the two before,then the carry*/
+SIMD_AVX2 void simd_prefix_f64_avx2(double *a, int n)
+{
+    __m256d zero = _mm256_setzero_pd();
+    __m256d carry = zero;
+    __m256d x;
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        x = _mm256_loadu_pd(a + i);
+        x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, 0x90), zero, 0x1));
+        x = _mm256_add_pd(x, _mm256_blend_pd(_mm256_permute4x64_pd(x, 0x40), zero, 0x3));
+        x = _mm256_add_pd(x, carry);
+        _mm256_storeu_pd(a + i, x);
+        carry = _mm256_permute4x64_pd(x, 0xff);
+    }
+    simd_prefix_f64_from(a + i, _mm_cvtsd_f64(_mm256_castpd256_pd128(carry)), n - i);
+}
+
+SIMD_AVX2 double simd_lanes_avx2(__m256d s)
+{
+    __m128d x = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+}
+
+SIMD_AVX2 double simd_sum_f64_avx2(const double *a, int n)
+{
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    int i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a + i + 4));
+    }
+    return simd_lanes_avx2(_mm256_add_pd(s0, s1)) + simd_sum_f64(a + i, n - i);
+}
+
+SIMD_AVX2 double simd_dot_f64_avx2(const double *a, const double *b, int n)
+{
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    int i;
+    for (i = 0; i + 8 <= n; i += 8)
+    { /*no fma,the products round the way the other kernels round them*/
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    return simd_lanes_avx2(_mm256_add_pd(s0, s1)) + simd_dot_f64(a + i, b + i, n - i);
+}
+
+SIMD_AVX2 double simd_min_f64_avx2(const double *a, int n)
+{
+    __m256d m = _mm256_set1_pd(a[0]);
+    __m256d nan = _mm256_setzero_pd();
+    __m256d x;
+    __m128d h;
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        x = _mm256_loadu_pd(a + i);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+        m = _mm256_min_pd(m, x);
+    }
+    if (0 != _mm256_movemask_pd(nan))
+    {
+        return simd_min_f64(a, n); /*the NaN itself*/
+    }
+    h = _mm_min_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+    h = _mm_min_sd(h, _mm_unpackhi_pd(h, h));
+    return simd_min_f64_from(a + i, _mm_cvtsd_f64(h), n - i);
+}
+
+SIMD_AVX2 double simd_max_f64_avx2(const double *a, int n)
+{
+    __m256d m = _mm256_set1_pd(a[0]);
+    __m256d nan = _mm256_setzero_pd();
+    __m256d x;
+    __m128d h;
+    int i;
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        x = _mm256_loadu_pd(a + i);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+        m = _mm256_max_pd(m, x);
+    }
+    if (0 != _mm256_movemask_pd(nan))
+    {
+        return simd_max_f64(a, n); /*the NaN itself*/
+    }
+    h = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+    h = _mm_max_sd(h, _mm_unpackhi_pd(h, h));
+    return simd_max_f64_from(a + i, _mm_cvtsd_f64(h), n - i);
+}
+
+SIMD_AVX2 void simd_add_i32_avx2(int *a, const int *b, int n)
+{
+    int i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_si256((__m256i *)(a + i),
+                            _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+    }
+    simd_add_i32(a + i, b + i, n - i);
+}
+
+SIMD_AVX2 void simd_mul_i32_avx2(int *a, const int *b, int n)
+{
+    int i;
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_si256((__m256i *)(a + i),
+                            _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i))));
+    }
+    simd_mul_i32(a + i, b + i, n - i);
+}
+#endif
+
+SimdKernels simd_scalar = {
+    "scalar",
+    simd_add_f64,
+    simd_mul_f64,
+    simd_scale_f64,
+    simd_fill_f64,
+    simd_prefix_f64,
+    simd_sum_f64,
+    simd_dot_f64,
+    simd_min_f64,
+    simd_max_f64,
+    simd_add_i32,
+    simd_mul_i32,
+};
+
+#ifdef __SSE2__
+SimdKernels simd_sse2 = {
+    "sse2",
+    simd_add_f64_sse2,
+    simd_mul_f64_sse2,
+    simd_scale_f64_sse2,
+    simd_fill_f64_sse2,
+    simd_prefix_f64_sse2,
+    simd_sum_f64_sse2,
+    simd_dot_f64_sse2,
+    simd_min_f64_sse2,
+    simd_max_f64_sse2,
+    simd_add_i32_sse2,
+    simd_mul_i32, /*pmulld came with sse4.1*/
+};
+#endif
+
+#ifdef SIMD_AVX2
+SimdKernels simd_avx2 = {
+    "avx2",
+    simd_add_f64_avx2,
+    simd_mul_f64_avx2,
+    simd_scale_f64_avx2,
+    simd_fill_f64_avx2,
+    simd_prefix_f64_avx2,
+    simd_sum_f64_avx2,
+    simd_dot_f64_avx2,
+    simd_min_f64_avx2,
+    simd_max_f64_avx2,
+    simd_add_i32_avx2,
+    simd_mul_i32_avx2,
+};
+#endif
+
+SimdKernels *simd_kernels = NULL;
+
+SimdKernels *SIMD_kernels(void)
+{
+    char *cap;
+    if (NULL != simd_kernels)
+    {
+        return simd_kernels;
+    }
+    cap = getenv("JS_SIMD");
+    simd_kernels = &simd_scalar;
+#ifdef __SSE2__
+    if (NULL == cap || 0 != strcmp(cap, "scalar"))
+    {
+        simd_kernels = &simd_sse2;
+    }
+#endif
+#ifdef SIMD_AVX2
+    if ((NULL == cap || 0 == strcmp(cap, "avx2")) && __builtin_cpu_supports("avx2"))
+    {
+        simd_kernels = &simd_avx2;
+    }
+#endif
+    return simd_kernels;
+}
@@ -0,0 +1,28 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/*
+ * bulk kernels over plain number arrays,one table per instruction set.
+ * ints wrap like Math.imul,min and max of anything with a NaN is NaN,
+ * min and max must be given at least one number.
+ */
+typedef struct SimdKernels_tag
+{
+    char *name;
+    void (*add_f64)(double *a, const double *b, int n);
+    void (*mul_f64)(double *a, const double *b, int n);
+    void (*scale_f64)(double *a, double k, int n);
+    void (*fill_f64)(double *a, double v, int n);
+    void (*prefix_f64)(double *a, int n);
+    double (*sum_f64)(const double *a, int n);
+    double (*dot_f64)(const double *a, const double *b, int n);
+    double (*min_f64)(const double *a, int n);
+    double (*max_f64)(const double *a, int n);
+    void (*add_i32)(int *a, const int *b, int n);
+    void (*mul_i32)(int *a, const int *b, int n);
+} SimdKernels;
+
+/*the best table the cpu runs,picked on the first call,JS_SIMD=scalar or sse2 caps it*/
+SimdKernels *SIMD_kernels(void);
+
+#endif
@@ -0,0 +1,971 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "js.h"
+#include "error.h"
+#include "heap.h"
+#include "interprete.h"
+#include "cache.h"
+#include "snapshot.h"
+#include "loop.h"
+#include "promise.h"
+
+/*
+ * heap snapshot.
+ * after a prelude has run,everything reachable from the global env is
+ * copied into one image: variables,heap objects,cell envs,and the parts
+ * of the tree functions point into. a pointer in the image holds the
+ * offset of its target and is listed in a relocation table,a pointer to
+ * a builtin is listed with the index of the builtin. restoring maps the
+ * file once,adds the address it landed at to the listed pointers and
+ * hands the image to gc as a space,the prelude is neither parsed nor run.
+ */
+
+#define SNAPSHOT_MAGIC "JSSNAP01"
+#define SNAPSHOT_HEADER_SIZE 4096
+#define SNAPSHOT_SYMBOL_COUNT (18 + LOOP_BUILDIN_COUNT + 2 * PROMISE_BUILDIN_COUNT)
+
+typedef enum
+{
+    SNAPSHOT_TYPE_STRING = 1,
+    SNAPSHOT_TYPE_HEAP,
+    SNAPSHOT_TYPE_VALUES,
+    SNAPSHOT_TYPE_KV_LIST,
+    SNAPSHOT_TYPE_ENV,
+    SNAPSHOT_TYPE_VARIABLE_LIST,
+    SNAPSHOT_TYPE_FUNCTION_LIST,
+    SNAPSHOT_TYPE_FUNCTION,
+    SNAPSHOT_TYPE_IDENTIFIER_LIST,
+    SNAPSHOT_TYPE_BLOCK,
+    SNAPSHOT_TYPE_STATEMENT_LIST,
+    SNAPSHOT_TYPE_STATEMENT,
+    SNAPSHOT_TYPE_IF,
+    SNAPSHOT_TYPE_ELSIF_LIST,
+    SNAPSHOT_TYPE_FOR,
+    SNAPSHOT_TYPE_FOR_IN,
+    SNAPSHOT_TYPE_WHILE,
+    SNAPSHOT_TYPE_SWITCH,
+    SNAPSHOT_TYPE_CASE_LIST,
+    SNAPSHOT_TYPE_EXPRESSION,
+    SNAPSHOT_TYPE_EXPRESSION_LIST,
+    SNAPSHOT_TYPE_BINARY,
+    SNAPSHOT_TYPE_INDEX,
+    SNAPSHOT_TYPE_FUNCTION_CALL,
+    SNAPSHOT_TYPE_METHOD_CALL,
+    SNAPSHOT_TYPE_CREATE_VARIABLE,
+    SNAPSHOT_TYPE_NEW,
+    SNAPSHOT_TYPE_ASSIGN_FUNCTION,
+    SNAPSHOT_TYPE_OBJECT_KV_LIST,
+    SNAPSHOT_TYPE_OBJECT_KV,
+    SNAPSHOT_TYPE_REGEXP,
+    SNAPSHOT_TYPE_BYTES /*numbers of a buffer,aligned like the original*/
+} SNAPSHOT_TYPE;
+
+typedef struct
+{
+    char magic[8];
+    unsigned long long key;
+    unsigned long length;       /*bytes of the image,a multiple of 8*/
+    unsigned long reloc_count;  /*pointers to fix up by the address of the image*/
+    unsigned long symbol_count; /*pointers to set to a builtin*/
+} SnapshotHeader;
+
+/*first thing in the image*/
+typedef struct
+{
+    VariableList *vars;
+    JsFunctionList *funcs;
+    ExecuteEnvironment *cells;
+} SnapshotRoot;
+
+typedef struct
+{
+    unsigned long field;
+    unsigned long symbol;
+} SnapshotSymbol;
+
+/*an object already in the image*/
+typedef struct
+{
+    void *p;
+    SNAPSHOT_TYPE typ;
+    unsigned long offset;
+} SnapshotCopy;
+
+/*a copy whose pointers still point to the originals*/
+typedef struct
+{
+    unsigned long offset;
+    void *p;
+    SNAPSHOT_TYPE typ;
+    int count; /*values of a value array*/
+} SnapshotWork;
+
+typedef struct
+{
+    JsInterpreter *inter;
+    void *symbols[SNAPSHOT_SYMBOL_COUNT];
+    char *image;
+    unsigned long length;
+    unsigned long alloc;
+    SnapshotCopy *copies; /*open addressing by address*/
+    unsigned long copy_count;
+    unsigned long copy_alloc;
+    unsigned long *relocs;
+    unsigned long reloc_count;
+    unsigned long reloc_alloc;
+    SnapshotSymbol *fixes;
+    unsigned long fix_count;
+    unsigned long fix_alloc;
+    SnapshotWork *work;
+    unsigned long work_count;
+    unsigned long work_alloc;
+} Snapshot;
+
+char *snapshot_map = NULL;
+unsigned long snapshot_map_length = 0;
+
+/*what a snapshot may point to outside itself,the same set in every run*/
+void snapshot_symbols(JsInterpreter *inter, void **symbols)
+{
+    extern JsFunction console_log_function;
+    extern JsKvList console_log;
+    extern JsObject console_object;
+    extern VariableList console_var_list;
+    extern JsFunctionList js_type_of;
+    extern JsObject json_object;
+    extern JsKvList json_parse;
+    extern JsFunction json_parse_function;
+    extern JsKvList json_stringify;
+    extern JsFunction json_stringify_function;
+    extern VariableList json_var_list;
+    extern JsFunctionList reader_read_line;
+    extern JsFunctionList reader_read_file;
+    extern JsFunctionList reader_open_file;
+    extern JsFunctionList reader_close_file;
+    extern JsFunctionList loop_functions[];
+    extern JsObject promise_object;
+    extern VariableList promise_var_list;
+    extern JsKvList promise_fields[];
+    extern JsFunction promise_functions[];
+    int i;
+    symbols[0] = &inter->env;
+    symbols[1] = &console_object;
+    symbols[2] = &console_log_function;
+    symbols[3] = &console_log;
+    symbols[4] = &console_var_list;
+    symbols[5] = &js_type_of;
+    symbols[6] = &json_object;
+    symbols[7] = &json_parse;
+    symbols[8] = &json_parse_function;
+    symbols[9] = &json_stringify;
+    symbols[10] = &json_stringify_function;
+    symbols[11] = &json_var_list;
+    symbols[12] = &reader_read_line;
+    symbols[13] = &reader_read_file;
+    symbols[14] = &reader_open_file;
+    symbols[15] = &reader_close_file;
+    for (i = 0; i < LOOP_BUILDIN_COUNT; i++)
+    {
+        symbols[16 + i] = loop_functions + i;
+    }
+    symbols[16 + LOOP_BUILDIN_COUNT] = &promise_object;
+    symbols[17 + LOOP_BUILDIN_COUNT] = &promise_var_list;
+    for (i = 0; i < PROMISE_BUILDIN_COUNT; i++)
+    {
+        symbols[18 + LOOP_BUILDIN_COUNT + 2 * i] = promise_fields + i;
+        symbols[19 + LOOP_BUILDIN_COUNT + 2 * i] = promise_functions + i;
+    }
+}
+
+void *snapshot_array(Snapshot *s, void *p, unsigned long *alloc, unsigned long count, int size)
+{
+    char *new;
+    if (count < *alloc)
+    {
+        return p;
+    }
+    new = MEM_alloc(s->inter->interpreter_memory, size * *alloc * 2, 0);
+    if (NULL == new)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "snapshot", 0);
+        return NULL;
+    }
+    memcpy(new, p, size * *alloc);
+    MEM_free(s->inter->interpreter_memory, p);
+    *alloc *= 2;
+    return new;
+}
+
+void *snapshot_at(Snapshot *s, unsigned long offset)
+{
+    return s->image + offset;
+}
+
+/*room for size bytes at the end of the image*/
+unsigned long snapshot_reserve(Snapshot *s, int size)
+{
+    unsigned long offset = s->length;
+    size = (size + 7) & ~7;
+    while (s->length + size > s->alloc)
+    {
+        s->image = snapshot_array(s, s->image, &s->alloc, s->alloc, 1);
+    }
+    memset(s->image + offset, 0, size);
+    s->length += size;
+    return offset;
+}
+
+unsigned long snapshot_copy_slot(Snapshot *s, void *p, SNAPSHOT_TYPE typ)
+{
+    unsigned long i = ((unsigned long)p >> 3) * 0x9e3779b97f4a7c15UL;
+    i = (i ^ typ) & (s->copy_alloc - 1);
+    while (NULL != s->copies[i].p && (s->copies[i].p != p || s->copies[i].typ != typ))
+    {
+        i = (i + 1) & (s->copy_alloc - 1);
+    }
+    return i;
+}
+
+void snapshot_remember(Snapshot *s, void *p, SNAPSHOT_TYPE typ, unsigned long offset)
+{
+    SnapshotCopy *old = s->copies;
+    unsigned long old_alloc = s->copy_alloc;
+    unsigned long i;
+    if (2 * (s->copy_count + 1) > s->copy_alloc)
+    { /*keep the table half empty*/
+        s->copy_alloc *= 2;
+        s->copies = (SnapshotCopy *)MEM_alloc(s->inter->interpreter_memory, sizeof(SnapshotCopy) * s->copy_alloc, 0);
+        if (NULL == s->copies)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "snapshot", 0);
+            return;
+        }
+        memset(s->copies, 0, sizeof(SnapshotCopy) * s->copy_alloc);
+        for (i = 0; i < old_alloc; i++)
+        {
+            if (NULL != old[i].p)
+            {
+                s->copies[snapshot_copy_slot(s, old[i].p, old[i].typ)] = old[i];
+            }
+        }
+        MEM_free(s->inter->interpreter_memory, (char *)old);
+    }
+    i = snapshot_copy_slot(s, p, typ);
+    s->copies[i].p = p;
+    s->copies[i].typ = typ;
+    s->copies[i].offset = offset;
+    s->copy_count++;
+}
+
+/*offset of the copy of p,made and queued the first time p is seen*/
+unsigned long snapshot_copy(Snapshot *s, void *p, SNAPSHOT_TYPE typ, int size, int count)
+{
+    unsigned long i = snapshot_copy_slot(s, p, typ);
+    unsigned long offset;
+    if (NULL != s->copies[i].p)
+    {
+        return s->copies[i].offset;
+    }
+    if (SNAPSHOT_TYPE_BYTES == typ)
+    { /*the image starts on a page,an aligned offset is an aligned address*/
+        snapshot_reserve(s, (TYPED_ALIGN - s->length % TYPED_ALIGN) % TYPED_ALIGN);
+    }
+    offset = snapshot_reserve(s, size);
+    memcpy(s->image + offset, p, size);
+    snapshot_remember(s, p, typ, offset);
+    if (SNAPSHOT_TYPE_STRING != typ && SNAPSHOT_TYPE_BYTES != typ)
+    {
+        s->work = snapshot_array(s, s->work, &s->work_alloc, s->work_count, sizeof(SnapshotWork));
+        s->work[s->work_count].offset = offset;
+        s->work[s->work_count].p = p;
+        s->work[s->work_count].typ = typ;
+        s->work[s->work_count].count = count;
+        s->work_count++;
+    }
+    return offset;
+}
+
+/*the pointer at field points to target in the image*/
+void snapshot_pointer(Snapshot *s, unsigned long field, unsigned long target)
+{
+    *(unsigned long *)(s->image + field) = target;
+    s->relocs = snapshot_array(s, s->relocs, &s->reloc_alloc, s->reloc_count, sizeof(unsigned long));
+    s->relocs[s->reloc_count++] = field;
+}
+
+/*pointers to builtins are set when restoring,returns -1 when p is none*/
+int snapshot_symbol(Snapshot *s, unsigned long field, void *p)
+{
+    int i;
+    for (i = 0; i < SNAPSHOT_SYMBOL_COUNT; i++)
+    {
+        if (s->symbols[i] == p)
+        {
+            *(unsigned long *)(s->image + field) = 0;
+            s->fixes = snapshot_array(s, s->fixes, &s->fix_alloc, s->fix_count, sizeof(SnapshotSymbol));
+            s->fixes[s->fix_count].field = field;
+            s->fixes[s->fix_count].symbol = i;
+            s->fix_count++;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*the pointer at field is p of typ,a copy of size bytes goes into the image*/
+void snapshot_ref(Snapshot *s, unsigned long field, void *p, SNAPSHOT_TYPE typ, int size)
+{
+    if (NULL == p || 0 == snapshot_symbol(s, field, p))
+    {
+        return;
+    }
+    snapshot_pointer(s, field, snapshot_copy(s, p, typ, size, 0));
+}
+
+void snapshot_ref_string(Snapshot *s, unsigned long field, char *p)
+{
+    if (NULL != p)
+    {
+        snapshot_ref(s, field, p, SNAPSHOT_TYPE_STRING, strlen(p) + 1);
+    }
+}
+
+/*strings,arrays,objects and closures live inside a heap header*/
+void snapshot_ref_heap(Snapshot *s, unsigned long field, void *p)
+{
+    if (NULL == p || 0 == snapshot_symbol(s, field, p))
+    {
+        return;
+    }
+    p = (char *)p - offsetof(Heap, u);
+    snapshot_pointer(s, field, snapshot_copy(s, p, SNAPSHOT_TYPE_HEAP, sizeof(Heap), 0) + offsetof(Heap, u));
+}
+
+void snapshot_value(Snapshot *s, unsigned long offset)
+{
+    JsValue *v = snapshot_at(s, offset);
+    unsigned long field = offset + offsetof(JsValue, u);
+    switch (v->typ)
+    {
+    case JS_VALUE_TYPE_STRING:
+    case JS_VALUE_TYPE_ARRAY:
+    case JS_VALUE_TYPE_OBJECT:
+    case JS_VALUE_TYPE_MAP:
+    case JS_VALUE_TYPE_BUFFER:
+    case JS_VALUE_TYPE_TYPED_ARRAY:
+    case JS_VALUE_TYPE_REGEXP:
+        snapshot_ref_heap(s, field, v->u.string);
+        break;
+    case JS_VALUE_TYPE_PROMISE: /*its reactions are code waiting to run,a snapshot holds none*/
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "snapshot of a promise", 0);
+        break;
+    case JS_VALUE_TYPE_COROUTINE: /*c frames on a stack of its own*/
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "snapshot of a generator", 0);
+        break;
+    case JS_VALUE_TYPE_FUNCTION:
+        if (JS_FUNCTION_TYPE_BUILDIN == v->u.func->typ && NULL != v->u.func->env)
+        { /*resolve or reject of a promise*/
+            ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "snapshot of a promise", 0);
+        }
+        if (NULL != v->u.func->env)
+        { /*closure*/
+            snapshot_ref_heap(s, field, v->u.func);
+        }
+        else
+        {
+            snapshot_ref(s, field, v->u.func, SNAPSHOT_TYPE_FUNCTION, sizeof(JsFunction));
+        }
+        break;
+    case JS_VALUE_TYPE_STRING_LITERAL:
+        snapshot_ref_string(s, field, v->u.literal_string);
+        break;
+    case JS_VALUE_TYPE_BOOL: /*held in the value itself*/
+    case JS_VALUE_TYPE_INT:
+    case JS_VALUE_TYPE_FLOAT:
+    case JS_VALUE_TYPE_NULL:
+    case JS_VALUE_TYPE_UNDEFINED:
+    default:
+        break;
+    }
+}
+
+void snapshot_function(Snapshot *s, unsigned long offset)
+{
+    JsFunction *f = snapshot_at(s, offset);
+    snapshot_ref_string(s, offset + offsetof(JsFunction, name), f->name);
+    f = snapshot_at(s, offset);
+    snapshot_ref(s, offset + offsetof(JsFunction, block), f->block, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+    f = snapshot_at(s, offset);
+    snapshot_ref(s, offset + offsetof(JsFunction, parameter_list), f->parameter_list, SNAPSHOT_TYPE_IDENTIFIER_LIST, sizeof(IdentifierList));
+    f = snapshot_at(s, offset);
+    f->buildin = NULL; /*builtins are only reached as symbols*/
+    snapshot_ref(s, offset + offsetof(JsFunction, env), f->env, SNAPSHOT_TYPE_ENV, sizeof(ExecuteEnvironment));
+}
+
+void snapshot_heap(Snapshot *s, unsigned long offset)
+{
+    Heap *h = snapshot_at(s, offset);
+    JsBuffer *buffer;
+    unsigned long bytes;
+    int count;
+    switch (h->typ)
+    {
+    case JS_VALUE_TYPE_STRING:
+        snapshot_ref(s, offset + offsetof(Heap, u.string.s), h->u.string.s, SNAPSHOT_TYPE_STRING, h->u.string.alloc);
+        break;
+    case JS_VALUE_TYPE_ARRAY:
+        count = h->u.array.length;
+        if (NULL != h->u.array.elements)
+        {
+            snapshot_pointer(s,
+                             offset + offsetof(Heap, u.array.elements),
+                             snapshot_copy(s, h->u.array.elements, SNAPSHOT_TYPE_VALUES, sizeof(JsValue) * count, count));
+            h = snapshot_at(s, offset);
+            h->u.array.alloc = count; /*the copy holds no room to grow*/
+        }
+        break;
+    case JS_VALUE_TYPE_OBJECT:
+        snapshot_ref(s, offset + offsetof(Heap, u.object.eles), h->u.object.eles, SNAPSHOT_TYPE_KV_LIST, sizeof(JsKvList));
+        break;
+    case JS_VALUE_TYPE_FUNCTION:
+        snapshot_function(s, offset + offsetof(Heap, u.function));
+        break;
+    case JS_VALUE_TYPE_MAP:
+        count = h->u.map.used;
+        if (NULL != h->u.map.entries)
+        { /*an entry is a key value and a value value*/
+            snapshot_pointer(s,
+                             offset + offsetof(Heap, u.map.entries),
+                             snapshot_copy(s, h->u.map.entries, SNAPSHOT_TYPE_VALUES, sizeof(JsMapEntry) * count, count * 2));
+            h = snapshot_at(s, offset);
+            h->u.map.alloc = count;
+        }
+        h->u.map.slots = NULL; /*keys hashed by address are somewhere else after a restore,the table is built again*/
+        break;
+    case JS_VALUE_TYPE_BUFFER: /*raw is never freed,cells of the image are not swept*/
+        if (NULL != h->u.buffer.data)
+        {
+            bytes = snapshot_copy(s, h->u.buffer.data, SNAPSHOT_TYPE_BYTES, h->u.buffer.length, 0);
+            snapshot_pointer(s, offset + offsetof(Heap, u.buffer.data), bytes);
+            snapshot_pointer(s, offset + offsetof(Heap, u.buffer.raw), bytes);
+        }
+        break;
+    case JS_VALUE_TYPE_TYPED_ARRAY: /*data points into the copy of the bytes of its buffer*/
+        buffer = h->u.typed.buffer;
+        count = h->u.typed.offset; /*h moves when the image grows*/
+        bytes = snapshot_copy(s, buffer->data, SNAPSHOT_TYPE_BYTES, buffer->length, 0) + count;
+        snapshot_ref_heap(s, offset + offsetof(Heap, u.typed.buffer), buffer);
+        snapshot_pointer(s, offset + offsetof(Heap, u.typed.data), bytes);
+        break;
+    case JS_VALUE_TYPE_REGEXP: /*the program is compiled again when it is first matched*/
+        h->u.regexp.prog = NULL;
+        h->u.regexp.owned = 0;
+        snapshot_ref_string(s, offset + offsetof(Heap, u.regexp.source), h->u.regexp.source);
+        h = snapshot_at(s, offset);
+        snapshot_ref_string(s, offset + offsetof(Heap, u.regexp.flags), h->u.regexp.flags);
+        snapshot_value(s, offset + offsetof(Heap, u.regexp.last_index));
+        break;
+    case JS_VALUE_TYPE_PROMISE: /*snapshot_value refuses these before their cells are reached*/
+    case JS_VALUE_TYPE_COROUTINE:
+    case JS_VALUE_TYPE_BOOL: /*never a cell*/
+    case JS_VALUE_TYPE_INT:
+    case JS_VALUE_TYPE_FLOAT:
+    case JS_VALUE_TYPE_NULL:
+    case JS_VALUE_TYPE_UNDEFINED:
+    case JS_VALUE_TYPE_STRING_LITERAL:
+    default:
+        break;
+    }
+}
+
+void snapshot_expression(Snapshot *s, unsigned long offset)
+{
+    Expression *e = snapshot_at(s, offset);
+    unsigned long field = offset + offsetof(Expression, u);
+    switch (e->typ)
+    {
+    case EXPRESSION_TYPE_BOOL:
+    case EXPRESSION_TYPE_INT:
+    case EXPRESSION_TYPE_FLOAT:
+    case EXPRESSION_TYPE_NULL:
+    case EXPRESSION_TYPE_UNDEFINED:
+        break;
+    case EXPRESSION_TYPE_STRING:
+    case EXPRESSION_TYPE_IDENTIFIER:
+        snapshot_ref_string(s, field, e->u.string);
+        break;
+    case EXPRESSION_TYPE_ARRAY:
+        snapshot_ref(s, field, e->u.expression_list, SNAPSHOT_TYPE_EXPRESSION_LIST, sizeof(ExpressionList));
+        break;
+    case EXPRESSION_TYPE_OBJECT:
+        snapshot_ref(s, field, e->u.object_kv_list, SNAPSHOT_TYPE_OBJECT_KV_LIST, sizeof(ExpressionObjectKVList));
+        break;
+    case EXPRESSION_TYPE_LOGICAL_OR:
+    case EXPRESSION_TYPE_LOGICAL_AND:
+    case EXPRESSION_TYPE_ASSIGN:
+    case EXPRESSION_TYPE_PLUS_ASSIGN:
+    case EXPRESSION_TYPE_MINUS_ASSIGN:
+    case EXPRESSION_TYPE_MUL_ASSIGN:
+    case EXPRESSION_TYPE_DIV_ASSIGN:
+    case EXPRESSION_TYPE_MOD_ASSIGN:
+    case EXPRESSION_TYPE_EQ:
+    case EXPRESSION_TYPE_NE:
+    case EXPRESSION_TYPE_GE:
+    case EXPRESSION_TYPE_GT:
+    case EXPRESSION_TYPE_LE:
+    case EXPRESSION_TYPE_LT:
+    case EXPRESSION_TYPE_ADD:
+    case EXPRESSION_TYPE_SUB:
+    case EXPRESSION_TYPE_MUL:
+    case EXPRESSION_TYPE_DIV:
+    case EXPRESSION_TYPE_MOD:
+        snapshot_ref(s, field, e->u.binary, SNAPSHOT_TYPE_BINARY, sizeof(ExpressionBinary));
+        break;
+    case EXPRESSION_TYPE_ASSIGN_FUNCTION:
+        snapshot_ref(s, field, e->u.assign_function, SNAPSHOT_TYPE_ASSIGN_FUNCTION, sizeof(ExpressionAssignFunction));
+        break;
+    case EXPRESSION_TYPE_FUNCTION:
+    case EXPRESSION_TYPE_CREATE_FUNCTION:
+        snapshot_ref(s, field, e->u.func, SNAPSHOT_TYPE_FUNCTION, sizeof(JsFunction));
+        break;
+    case EXPRESSION_TYPE_INDEX:
+        snapshot_ref(s, field, e->u.index, SNAPSHOT_TYPE_INDEX, sizeof(ExpressionIndex));
+        break;
+    case EXPRESSION_TYPE_METHOD_CALL:
+        snapshot_ref(s, field, e->u.method_call, SNAPSHOT_TYPE_METHOD_CALL, sizeof(ExpressionMethodCall));
+        break;
+    case EXPRESSION_TYPE_FUNCTION_CALL:
+    case EXPRESSION_TYPE_EXPRESSION_FUNCTION_CALL:
+        snapshot_ref(s, field, e->u.function_call, SNAPSHOT_TYPE_FUNCTION_CALL, sizeof(ExpressionFunctionCall));
+        break;
+    case EXPRESSION_TYPE_INCREMENT:
+    case EXPRESSION_TYPE_PRE_INCREMENT:
+    case EXPRESSION_TYPE_PRE_DECREMENT:
+    case EXPRESSION_TYPE_DECREMENT:
+    case EXPRESSION_TYPE_NEGATIVE:
+    case EXPRESSION_TYPE_NOT:
+    case EXPRESSION_TYPE_AWAIT:
+    case EXPRESSION_TYPE_YIELD: /*NULL for a bare yield*/
+        snapshot_ref(s, field, e->u.unary, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        break;
+    case EXPRESSION_TYPE_CREATE_LOCAL_VARIABLE:
+        snapshot_ref(s, field, e->u.create_var, SNAPSHOT_TYPE_CREATE_VARIABLE, sizeof(ExpressionCreateLocalVariable));
+        break;
+    case EXPRESSION_TYPE_NEW:
+        snapshot_ref(s, field, e->u.new, SNAPSHOT_TYPE_NEW, sizeof(ExpressionNew));
+        break;
+    case EXPRESSION_TYPE_REGEXP:
+        snapshot_ref(s, field, e->u.regexp, SNAPSHOT_TYPE_REGEXP, sizeof(ExpressionRegExp));
+        break;
+    }
+}
+
+void snapshot_statement(Snapshot *s, unsigned long offset)
+{
+    Statement *st = snapshot_at(s, offset);
+    unsigned long field = offset + offsetof(Statement, u);
+    switch (st->typ)
+    {
+    case STATEMENT_TYPE_EXPRESSION:
+    case STATEMENT_TYPE_RETURN:
+        snapshot_ref(s, field, st->u.expression_statement, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        break;
+    case STATEMENT_TYPE_IF:
+        snapshot_ref(s, field, st->u.if_statement, SNAPSHOT_TYPE_IF, sizeof(StatementIf));
+        break;
+    case STATEMENT_TYPE_FOR:
+        snapshot_ref(s, field, st->u.for_statement, SNAPSHOT_TYPE_FOR, sizeof(StatementFor));
+        break;
+    case STATEMENT_TYPE_FOR_IN:
+        snapshot_ref(s, field, st->u.forin_statement, SNAPSHOT_TYPE_FOR_IN, sizeof(StatementForIn));
+        break;
+    case STATEMENT_TYPE_WHILE:
+        snapshot_ref(s, field, st->u.while_statement, SNAPSHOT_TYPE_WHILE, sizeof(StatementWhile));
+        break;
+    case STATEMENT_TYPE_SWITCH:
+        snapshot_ref(s, field, st->u.switch_statement, SNAPSHOT_TYPE_SWITCH, sizeof(StatementSwitch));
+        break;
+    case STATEMENT_TYPE_CONTINUE:
+    case STATEMENT_TYPE_BREAK:
+        break;
+    }
+}
+
+/*make the pointers of one copy point into the image,queuing what they point to*/
+void snapshot_fix(Snapshot *s, SnapshotWork *w)
+{
+    unsigned long o = w->offset;
+    int i;
+    switch (w->typ)
+    {
+    case SNAPSHOT_TYPE_STRING:
+    case SNAPSHOT_TYPE_BYTES:
+        break;
+    case SNAPSHOT_TYPE_HEAP:
+        snapshot_heap(s, o);
+        break;
+    case SNAPSHOT_TYPE_VALUES:
+        for (i = 0; i < w->count; i++)
+        {
+            snapshot_value(s, o + sizeof(JsValue) * i);
+        }
+        break;
+    case SNAPSHOT_TYPE_KV_LIST:
+    {
+        JsKvList *old = w->p;
+        snapshot_ref_string(s, o + offsetof(JsKvList, kv.key), old->kv.key);
+        snapshot_value(s, o + offsetof(JsKvList, kv.value));
+        snapshot_ref(s, o + offsetof(JsKvList, next), old->next, SNAPSHOT_TYPE_KV_LIST, sizeof(JsKvList));
+        break;
+    }
+    case SNAPSHOT_TYPE_ENV:
+    {
+        ExecuteEnvironment *old = w->p;
+        ExecuteEnvironment *env = snapshot_at(s, o);
+        env->next = NULL;
+        snapshot_ref(s, o + offsetof(ExecuteEnvironment, funcs), old->funcs, SNAPSHOT_TYPE_FUNCTION_LIST, sizeof(JsFunctionList));
+        snapshot_ref(s, o + offsetof(ExecuteEnvironment, vars), old->vars, SNAPSHOT_TYPE_VARIABLE_LIST, sizeof(VariableList));
+        snapshot_ref(s, o + offsetof(ExecuteEnvironment, cells), old->cells, SNAPSHOT_TYPE_ENV, sizeof(ExecuteEnvironment));
+        snapshot_ref(s, o + offsetof(ExecuteEnvironment, lexical), old->lexical, SNAPSHOT_TYPE_ENV, sizeof(ExecuteEnvironment));
+        snapshot_ref(s, o + offsetof(ExecuteEnvironment, outter), old->outter, SNAPSHOT_TYPE_ENV, sizeof(ExecuteEnvironment));
+        break;
+    }
+    case SNAPSHOT_TYPE_VARIABLE_LIST:
+    {
+        VariableList *old = w->p;
+        snapshot_ref_string(s, o + offsetof(VariableList, var.name), old->var.name);
+        snapshot_value(s, o + offsetof(VariableList, var.value));
+        snapshot_ref(s, o + offsetof(VariableList, next), old->next, SNAPSHOT_TYPE_VARIABLE_LIST, sizeof(VariableList));
+        break;
+    }
+    case SNAPSHOT_TYPE_FUNCTION_LIST:
+    {
+        JsFunctionList *old = w->p;
+        snapshot_function(s, o + offsetof(JsFunctionList, func));
+        snapshot_ref(s, o + offsetof(JsFunctionList, next), old->next, SNAPSHOT_TYPE_FUNCTION_LIST, sizeof(JsFunctionList));
+        break;
+    }
+    case SNAPSHOT_TYPE_FUNCTION:
+        snapshot_function(s, o);
+        break;
+    case SNAPSHOT_TYPE_IDENTIFIER_LIST:
+    {
+        IdentifierList *old = w->p;
+        snapshot_ref_string(s, o + offsetof(IdentifierList, identifier), old->identifier);
+        snapshot_ref(s, o + offsetof(IdentifierList, next), old->next, SNAPSHOT_TYPE_IDENTIFIER_LIST, sizeof(IdentifierList));
+        break;
+    }
+    case SNAPSHOT_TYPE_REGEXP:
+    {
+        ExpressionRegExp *old = w->p;
+        ExpressionRegExp *regexp = snapshot_at(s, o);
+        regexp->prog = NULL; /*compiled again by the first evaluation after a restore*/
+        snapshot_ref_string(s, o + offsetof(ExpressionRegExp, source), old->source);
+        snapshot_ref_string(s, o + offsetof(ExpressionRegExp, flags), old->flags);
+        break;
+    }
+    case SNAPSHOT_TYPE_BLOCK:
+        snapshot_ref(s, o + offsetof(Block, list), ((Block *)w->p)->list, SNAPSHOT_TYPE_STATEMENT_LIST, sizeof(StatementList));
+        break;
+    case SNAPSHOT_TYPE_STATEMENT_LIST:
+    {
+        StatementList *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementList, statement), old->statement, SNAPSHOT_TYPE_STATEMENT, sizeof(Statement));
+        snapshot_ref(s, o + offsetof(StatementList, next), old->next, SNAPSHOT_TYPE_STATEMENT_LIST, sizeof(StatementList));
+        snapshot_ref(s, o + offsetof(StatementList, last), old->last, SNAPSHOT_TYPE_STATEMENT_LIST, sizeof(StatementList));
+        break;
+    }
+    case SNAPSHOT_TYPE_STATEMENT:
+        snapshot_statement(s, o);
+        break;
+    case SNAPSHOT_TYPE_IF:
+    {
+        StatementIf *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementIf, condition), old->condition, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementIf, then), old->then, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+        snapshot_ref(s, o + offsetof(StatementIf, elseIfList), old->elseIfList, SNAPSHOT_TYPE_ELSIF_LIST, sizeof(StatementElsifList));
+        snapshot_ref(s, o + offsetof(StatementIf, els), old->els, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+        break;
+    }
+    case SNAPSHOT_TYPE_ELSIF_LIST:
+    {
+        StatementElsifList *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementElsifList, elsif.block), old->elsif.block, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+        snapshot_ref(s, o + offsetof(StatementElsifList, elsif.condition), old->elsif.condition, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementElsifList, next), old->next, SNAPSHOT_TYPE_ELSIF_LIST, sizeof(StatementElsifList));
+        break;
+    }
+    case SNAPSHOT_TYPE_FOR:
+    {
+        StatementFor *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementFor, block), old->block, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+        snapshot_ref(s, o + offsetof(StatementFor, init), old->init, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementFor, condition), old->condition, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementFor, afterblock), old->afterblock, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        break;
+    }
+    case SNAPSHOT_TYPE_FOR_IN:
+    {
+        StatementForIn *old = w->p;
+        snapshot_ref_string(s, o + offsetof(StatementForIn, identifer), old->identifer);
+        snapshot_ref(s, o + offsetof(StatementForIn, target), old->target, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementForIn, block), old->block, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+        break;
+    }
+    case SNAPSHOT_TYPE_WHILE:
+    {
+        StatementWhile *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementWhile, condition), old->condition, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementWhile, block), old->block, SNAPSHOT_TYPE_BLOCK, sizeof(Block));
+        break;
+    }
+    case SNAPSHOT_TYPE_SWITCH:
+    {
+        StatementSwitch *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementSwitch, condition), old->condition, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementSwitch, list), old->list, SNAPSHOT_TYPE_CASE_LIST, sizeof(StatementSwitchCaseList));
+        snapshot_ref(s, o + offsetof(StatementSwitch, defaultpart), old->defaultpart, SNAPSHOT_TYPE_STATEMENT_LIST, sizeof(StatementList));
+        break;
+    }
+    case SNAPSHOT_TYPE_CASE_LIST:
+    {
+        StatementSwitchCaseList *old = w->p;
+        snapshot_ref(s, o + offsetof(StatementSwitchCaseList, match), old->match, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(StatementSwitchCaseList, list), old->list, SNAPSHOT_TYPE_STATEMENT_LIST, sizeof(StatementList));
+        snapshot_ref(s, o + offsetof(StatementSwitchCaseList, next), old->next, SNAPSHOT_TYPE_CASE_LIST, sizeof(StatementSwitchCaseList));
+        break;
+    }
+    case SNAPSHOT_TYPE_EXPRESSION:
+        snapshot_expression(s, o);
+        break;
+    case SNAPSHOT_TYPE_EXPRESSION_LIST:
+    {
+        ExpressionList *old = w->p;
+        snapshot_ref(s, o + offsetof(ExpressionList, expression), old->expression, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(ExpressionList, next), old->next, SNAPSHOT_TYPE_EXPRESSION_LIST, sizeof(ExpressionList));
+        break;
+    }
+    case SNAPSHOT_TYPE_BINARY:
+    {
+        ExpressionBinary *old = w->p;
+        snapshot_ref(s, o + offsetof(ExpressionBinary, left), old->left, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(ExpressionBinary, right), old->right, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        break;
+    }
+    case SNAPSHOT_TYPE_INDEX:
+    {
+        ExpressionIndex *old = w->p;
+        snapshot_ref(s, o + offsetof(ExpressionIndex, e), old->e, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(ExpressionIndex, index), old->index, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref_string(s, o + offsetof(ExpressionIndex, identifier), old->identifier);
+        break;
+    }
+    case SNAPSHOT_TYPE_FUNCTION_CALL:
+    {
+        ExpressionFunctionCall *old = w->p;
+        snapshot_ref_string(s, o + offsetof(ExpressionFunctionCall, func), old->func);
+        snapshot_ref(s, o + offsetof(ExpressionFunctionCall, args), old->args, SNAPSHOT_TYPE_EXPRESSION_LIST, sizeof(ExpressionList));
+        snapshot_ref(s, o + offsetof(ExpressionFunctionCall, e), old->e, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        break;
+    }
+    case SNAPSHOT_TYPE_METHOD_CALL:
+    {
+        ExpressionMethodCall *old = w->p;
+        snapshot_ref(s, o + offsetof(ExpressionMethodCall, e), old->e, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref_string(s, o + offsetof(ExpressionMethodCall, method), old->method);
+        snapshot_ref(s, o + offsetof(ExpressionMethodCall, args), old->args, SNAPSHOT_TYPE_EXPRESSION_LIST, sizeof(ExpressionList));
+        break;
+    }
+    case SNAPSHOT_TYPE_CREATE_VARIABLE:
+    {
+        ExpressionCreateLocalVariable *old = w->p;
+        snapshot_ref_string(s, o + offsetof(ExpressionCreateLocalVariable, identifier), old->identifier);
+        snapshot_ref(s, o + offsetof(ExpressionCreateLocalVariable, expression), old->expression, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        break;
+    }
+    case SNAPSHOT_TYPE_NEW:
+    {
+        ExpressionNew *old = w->p;
+        snapshot_ref_string(s, o + offsetof(ExpressionNew, identifier), old->identifier);
+        snapshot_ref(s, o + offsetof(ExpressionNew, args), old->args, SNAPSHOT_TYPE_EXPRESSION_LIST, sizeof(ExpressionList));
+        break;
+    }
+    case SNAPSHOT_TYPE_ASSIGN_FUNCTION:
+    {
+        ExpressionAssignFunction *old = w->p;
+        snapshot_ref_string(s, o + offsetof(ExpressionAssignFunction, identifier), old->identifier);
+        snapshot_ref(s, o + offsetof(ExpressionAssignFunction, dest), old->dest, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(ExpressionAssignFunction, func), old->func, SNAPSHOT_TYPE_FUNCTION, sizeof(JsFunction));
+        break;
+    }
+    case SNAPSHOT_TYPE_OBJECT_KV_LIST:
+    {
+        ExpressionObjectKVList *old = w->p;
+        snapshot_ref(s, o + offsetof(ExpressionObjectKVList, kv), old->kv, SNAPSHOT_TYPE_OBJECT_KV, sizeof(ExpressionObjectKV));
+        snapshot_ref(s, o + offsetof(ExpressionObjectKVList, next), old->next, SNAPSHOT_TYPE_OBJECT_KV_LIST, sizeof(ExpressionObjectKVList));
+        break;
+    }
+    case SNAPSHOT_TYPE_OBJECT_KV:
+    {
+        ExpressionObjectKV *old = w->p;
+        snapshot_ref_string(s, o + offsetof(ExpressionObjectKV, identifier_key), old->identifier_key);
+        snapshot_ref(s, o + offsetof(ExpressionObjectKV, expression_key), old->expression_key, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(ExpressionObjectKV, value), old->value, SNAPSHOT_TYPE_EXPRESSION, sizeof(Expression));
+        snapshot_ref(s, o + offsetof(ExpressionObjectKV, func), old->func, SNAPSHOT_TYPE_FUNCTION, sizeof(JsFunction));
+        break;
+    }
+    }
+}
+
+void *snapshot_alloc(Snapshot *s, unsigned long *alloc, unsigned long count, int size)
+{
+    void *p = MEM_alloc(s->inter->interpreter_memory, size * count, 0);
+    if (NULL == p)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "snapshot", 0);
+        return NULL;
+    }
+    *alloc = count;
+    return p;
+}
+
+int SNAPSHOT_write(JsInterpreter *inter, char *path)
+{
+    Snapshot snapshot;
+    Snapshot *s = &snapshot;
+    SnapshotHeader header;
+    SnapshotWork w;
+    char pad[SNAPSHOT_HEADER_SIZE];
+    char tmp[4096 + 32];
+    int fd;
+    int ok;
+    memset(s, 0, sizeof(Snapshot));
+    s->inter = inter;
+    snapshot_symbols(inter, s->symbols);
+    s->image = snapshot_alloc(s, &s->alloc, 64 * 1024, 1);
+    s->copies = snapshot_alloc(s, &s->copy_alloc, 1024, sizeof(SnapshotCopy));
+    memset(s->copies, 0, sizeof(SnapshotCopy) * s->copy_alloc);
+    s->relocs = snapshot_alloc(s, &s->reloc_alloc, 1024, sizeof(unsigned long));
+    s->fixes = snapshot_alloc(s, &s->fix_alloc, 16, sizeof(SnapshotSymbol));
+    s->work = snapshot_alloc(s, &s->work_alloc, 1024, sizeof(SnapshotWork));
+
+    /*the globals are the roots,whatever a copy points to is copied in turn*/
+    snapshot_reserve(s, sizeof(SnapshotRoot));
+    snapshot_ref(s, offsetof(SnapshotRoot, vars), inter->env.vars, SNAPSHOT_TYPE_VARIABLE_LIST, sizeof(VariableList));
+    snapshot_ref(s, offsetof(SnapshotRoot, funcs), inter->env.funcs, SNAPSHOT_TYPE_FUNCTION_LIST, sizeof(JsFunctionList));
+    snapshot_ref(s, offsetof(SnapshotRoot, cells), inter->env.cells, SNAPSHOT_TYPE_ENV, sizeof(ExecuteEnvironment));
+    while (0 != s->work_count)
+    {
+        w = s->work[--s->work_count];
+        snapshot_fix(s, &w);
+    }
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.key = CACHE_build_key();
+    header.length = s->length;
+    header.reloc_count = s->reloc_count;
+    header.symbol_count = s->fix_count;
+    memset(pad, 0, sizeof(pad));
+    memcpy(pad, &header, sizeof(header));
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ok = fd >= 0 &&
+         SNAPSHOT_HEADER_SIZE == write(fd, pad, SNAPSHOT_HEADER_SIZE) &&
+         s->length == write(fd, s->image, s->length) &&
+         sizeof(unsigned long) * s->reloc_count == write(fd, s->relocs, sizeof(unsigned long) * s->reloc_count) &&
+         sizeof(SnapshotSymbol) * s->fix_count == write(fd, s->fixes, sizeof(SnapshotSymbol) * s->fix_count);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    MEM_free(inter->interpreter_memory, s->image);
+    MEM_free(inter->interpreter_memory, (char *)s->copies);
+    MEM_free(inter->interpreter_memory, (char *)s->relocs);
+    MEM_free(inter->interpreter_memory, (char *)s->fixes);
+    MEM_free(inter->interpreter_memory, (char *)s->work);
+    if (!ok || 0 != rename(tmp, path))
+    {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int SNAPSHOT_restore(JsInterpreter *inter, char *path)
+{
+    SnapshotHeader *header;
+    SnapshotRoot *root;
+    SnapshotSymbol *fixes;
+    unsigned long *relocs;
+    void *symbols[SNAPSHOT_SYMBOL_COUNT];
+    struct stat st;
+    char *image;
+    unsigned long i;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (0 != fstat(fd, &st) || st.st_size < SNAPSHOT_HEADER_SIZE + sizeof(SnapshotRoot))
+    {
+        close(fd);
+        return -1;
+    }
+    snapshot_map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == snapshot_map)
+    {
+        snapshot_map = NULL;
+        return -1;
+    }
+    snapshot_map_length = st.st_size;
+    header = (SnapshotHeader *)snapshot_map;
+    if (0 != memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) ||
+        CACHE_build_key() != header->key ||
+        st.st_size != SNAPSHOT_HEADER_SIZE + header->length +
+                          sizeof(unsigned long) * header->reloc_count +
+                          sizeof(SnapshotSymbol) * header->symbol_count)
+    {
+        SNAPSHOT_close();
+        return -1;
+    }
+    image = snapshot_map + SNAPSHOT_HEADER_SIZE;
+    relocs = (unsigned long *)(image + header->length);
+    fixes = (SnapshotSymbol *)(relocs + header->reloc_count);
+    for (i = 0; i < header->reloc_count; i++)
+    {
+        *(unsigned long *)(image + relocs[i]) += (unsigned long)image;
+    }
+    snapshot_symbols(inter, symbols);
+    for (i = 0; i < header->symbol_count; i++)
+    {
+        *(void **)(image + fixes[i].field) = symbols[fixes[i].symbol];
+    }
+
+    if (0 != gc_add_space(inter, image, header->length))
+    { /*gc marks the objects of the image beside it,they are never freed*/
+        SNAPSHOT_close();
+        return -1;
+    }
+
+    /*the globals of the prelude replace the builtins they end with*/
+    root = (SnapshotRoot *)image;
+    inter->env.vars = root->vars;
+    inter->env.funcs = root->funcs;
+    inter->env.cells = root->cells;
+    return 0;
+}
+
+void SNAPSHOT_close()
+{
+    if (NULL != snapshot_map)
+    {
+        munmap(snapshot_map, snapshot_map_length);
+        snapshot_map = NULL;
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+#include "js.h"
+
+/*write everything reachable from the global env to path,-1 on failure*/
+int SNAPSHOT_write(JsInterpreter *inter, char *path);
+
+/*map a snapshot and make its globals the globals of inter,-1 when it does not fit*/
+int SNAPSHOT_restore(JsInterpreter *inter, char *path);
+
+/*unmap the restored snapshot,nothing may point into it any more*/
+void SNAPSHOT_close();
+
+#endif
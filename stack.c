@@ -2,13 +2,17 @@
 #include "js_value.h"
 #include "util.h"
 #include <stdio.h>
+#include <unistd.h>
+#include "output.h"
 #include "stack.h"
 
 void push_stack(Stack *s, const JsValue *v)
 {
 	if (s->sp >= s->alloc - 1)
 	{ /*TODO:: alloc more memory*/
+		OUTPUT_flush(&current_interpreter->output);
 		printf("stack overflow\n");
+		fflush(stdout);
 		_exit(3);
 	}
 	s->vs[s->sp] = *v;
@@ -27,6 +31,36 @@ JsValue peek_stack(Stack *s, int index)
 	return s->vs[offset];
 }
 
+/*remove the value index below the top,values above it move down*/
+void remove_stack(Stack *s, int index)
+{
+	int offset = s->sp - index - 1;
+	for (; offset < s->sp - 1; offset++)
+	{
+		s->vs[offset] = s->vs[offset + 1];
+	}
+	s->sp--;
+}
+
+/*bump allocate,return NULL when the arena is used up*/
+void *alloc_arena(FrameArena *a, int size)
+{
+	char *p = a->top;
+	size = (size + 7) & ~7;
+	if (a->limit - p < size)
+	{
+		return NULL;
+	}
+	a->top = p + size;
+	return p;
+}
+
+/*free everything allocated after top in one go*/
+void release_arena(FrameArena *a, void *top)
+{
+	a->top = (char *)top;
+}
+
 /*
 int main(){
 	Stack s;
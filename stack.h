@@ -9,4 +9,10 @@ JsValue pop_stack(Stack *s);
 
 JsValue peek_stack(Stack *s, int index);
 
+void remove_stack(Stack *s, int index);
+
+void *alloc_arena(FrameArena *a, int size);
+
+void release_arena(FrameArena *a, void *top);
+
 #endif
@@ -0,0 +1,508 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "js.h"
+#include "error.h"
+#include "js_value.h"
+#include "interprete.h"
+#include "typed.h"
+#include "simd.h"
+
+/*
+ * ArrayBuffer and the typed arrays over it.
+ * the bytes of a buffer are malloced beside the gc heap,aligned to
+ * TYPED_ALIGN and never moved,so a typed array keeps a plain pointer to
+ * its first element and gc only marks the buffer cell,it never reads the
+ * numbers. a buffer is freed with its cell.
+ * big buffers make no cells to speak of,their bytes ask for a collection
+ * every TYPED_GC_BYTES instead.
+ */
+
+extern char gc_sweep_should_executing;
+
+int TYPED_element_size(JS_TYPED_TYPE kind)
+{
+    switch (kind)
+    {
+    case JS_TYPED_FLOAT64:
+        return sizeof(double);
+    case JS_TYPED_INT32:
+        return sizeof(int);
+    case JS_TYPED_UINT8:
+        return 1;
+    }
+    return 1;
+}
+
+char *typed_name(JS_TYPED_TYPE kind)
+{
+    switch (kind)
+    {
+    case JS_TYPED_FLOAT64:
+        return "Float64Array";
+    case JS_TYPED_INT32:
+        return "Int32Array";
+    case JS_TYPED_UINT8:
+        return "Uint8Array";
+    }
+    return "";
+}
+
+/*modulo 2^32 like js ToInt32,NaN and infinities are 0*/
+int typed_to_int(double d)
+{
+    if (d != d || d - d != 0)
+    {
+        return 0;
+    }
+    d = fmod(trunc(d), 4294967296.0);
+    if (d < 0)
+    {
+        d += 4294967296.0;
+    }
+    return (int)(unsigned int)d;
+}
+
+JsValue TYPED_create_buffer(JsInterpreter *inter, int length, int line)
+{
+    JsValue v;
+    JsBuffer *buffer;
+    if (length < 0 || length > MAX_INT - TYPED_ALIGN)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, "ArrayBuffer", line);
+    }
+    v.typ = JS_VALUE_TYPE_BUFFER;
+    v.u.buffer = buffer = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_BUFFER, 0, line);
+    buffer->raw = MEM_alloc(inter->execute_memory, length + TYPED_ALIGN - 1, line);
+    if (NULL == buffer->raw)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_CANNOT_ALLOC_MEMORY, "ArrayBuffer", line);
+    }
+    buffer->data = (char *)(((unsigned long)buffer->raw + TYPED_ALIGN - 1) & ~(unsigned long)(TYPED_ALIGN - 1));
+    buffer->length = length;
+    memset(buffer->data, 0, length);
+    inter->gc.buffer_bytes += length;
+    if (inter->gc.buffer_bytes >= TYPED_GC_BYTES)
+    {
+        inter->gc.buffer_bytes = 0;
+        gc_sweep_should_executing = 1;
+    }
+    return v;
+}
+
+/*an int argument,who names the constructor in the error*/
+int typed_int(const JsValue *v, char *who, int line)
+{
+    if (JS_VALUE_TYPE_INT != v->typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+    }
+    return v->u.intvalue;
+}
+
+JsValue TYPED_create(JsInterpreter *inter, JS_TYPED_TYPE kind, const JsValue *args, int count, int line)
+{
+    char *who = typed_name(kind);
+    int size = TYPED_element_size(kind);
+    const JsValue *from = count > 0 ? args : NULL;
+    JsTypedArray *typed;
+    JsValue buffer;
+    JsValue element;
+    JsValue v;
+    int offset = 0;
+    int length = 0;
+    int i;
+    if (NULL != from && JS_VALUE_TYPE_BUFFER == from->typ)
+    { /*a view,the bytes are shared*/
+        buffer = *from;
+        if (count > 1 && JS_VALUE_TYPE_UNDEFINED != args[1].typ)
+        {
+            offset = typed_int(args + 1, who, line);
+        }
+        if (offset < 0 || offset > buffer.u.buffer->length || 0 != offset % size)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, who, line);
+        }
+        if (count > 2 && JS_VALUE_TYPE_UNDEFINED != args[2].typ)
+        {
+            length = typed_int(args + 2, who, line);
+        }
+        else if (0 == (buffer.u.buffer->length - offset) % size)
+        {
+            length = (buffer.u.buffer->length - offset) / size;
+        }
+        else
+        {
+            length = -1;
+        }
+        if (length < 0 || length > (buffer.u.buffer->length - offset) / size)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, who, line);
+        }
+    }
+    else
+    {
+        if (NULL == from || JS_VALUE_TYPE_UNDEFINED == from->typ)
+        {
+            length = 0;
+        }
+        else if (JS_VALUE_TYPE_INT == from->typ)
+        {
+            length = from->u.intvalue;
+        }
+        else if (JS_VALUE_TYPE_ARRAY == from->typ)
+        {
+            length = from->u.array->length;
+        }
+        else if (JS_VALUE_TYPE_TYPED_ARRAY == from->typ)
+        {
+            length = from->u.typed->length;
+        }
+        else
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, who, line);
+        }
+        if (length < 0 || length > (MAX_INT - TYPED_ALIGN) / size)
+        {
+            ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, who, line);
+        }
+        buffer = TYPED_create_buffer(inter, length * size, line);
+    }
+    v.typ = JS_VALUE_TYPE_TYPED_ARRAY;
+    v.u.typed = typed = INTERPRETER_create_heap(inter, JS_VALUE_TYPE_TYPED_ARRAY, 0, line);
+    typed->kind = kind;
+    typed->buffer = buffer.u.buffer;
+    typed->data = buffer.u.buffer->data + offset;
+    typed->offset = offset;
+    typed->length = length;
+    if (NULL != from && JS_VALUE_TYPE_ARRAY == from->typ)
+    {
+        for (i = 0; i < length; i++)
+        {
+            TYPED_set(typed, i, from->u.array->elements + i);
+        }
+    }
+    else if (NULL != from && JS_VALUE_TYPE_TYPED_ARRAY == from->typ)
+    {
+        for (i = 0; i < length; i++)
+        {
+            TYPED_get(from->u.typed, i, &element);
+            TYPED_set(typed, i, &element);
+        }
+    }
+    return v;
+}
+
+void TYPED_get(JsTypedArray *typed, int index, JsValue *v)
+{
+    switch (typed->kind)
+    {
+    case JS_TYPED_FLOAT64:
+        v->typ = JS_VALUE_TYPE_FLOAT;
+        v->u.floatvalue = ((double *)typed->data)[index];
+        break;
+    case JS_TYPED_INT32:
+        v->typ = JS_VALUE_TYPE_INT;
+        v->u.intvalue = ((int *)typed->data)[index];
+        break;
+    case JS_TYPED_UINT8:
+        v->typ = JS_VALUE_TYPE_INT;
+        v->u.intvalue = ((unsigned char *)typed->data)[index];
+        break;
+    }
+}
+
+void TYPED_set(JsTypedArray *typed, int index, const JsValue *v)
+{
+    switch (typed->kind)
+    {
+    case JS_TYPED_FLOAT64:
+        ((double *)typed->data)[index] = JS_VALUE_TYPE_INT == v->typ ? v->u.intvalue : js_value_to_double(v);
+        break;
+    case JS_TYPED_INT32:
+        ((int *)typed->data)[index] = JS_VALUE_TYPE_INT == v->typ ? v->u.intvalue : typed_to_int(js_value_to_double(v));
+        break;
+    case JS_TYPED_UINT8:
+        ((unsigned char *)typed->data)[index] = JS_VALUE_TYPE_INT == v->typ ? v->u.intvalue : typed_to_int(js_value_to_double(v));
+        break;
+    }
+}
+
+/*
+ * bulk methods,each one c loop over the numbers instead of a script loop.
+ * Float64Array runs on the simd kernels,Int32Array on those for ints.
+ * other element types and arrays of two element types go element by
+ * element through TYPED_get and TYPED_set,converting like a[i] = x does.
+ */
+
+double typed_number(JsTypedArray *typed, int index)
+{
+    JsValue v;
+    TYPED_get(typed, index, &v);
+    return JS_VALUE_TYPE_INT == v.typ ? v.u.intvalue : v.u.floatvalue;
+}
+
+void typed_put(JsTypedArray *typed, int index, double d)
+{
+    JsValue v;
+    v.typ = JS_VALUE_TYPE_FLOAT;
+    v.u.floatvalue = d;
+    TYPED_set(typed, index, &v);
+}
+
+/*the other typed array of add,mul and dot,as long as this one*/
+JsTypedArray *typed_operand(const JsValue *args, int count, JsTypedArray *typed, char *method, int line)
+{
+    if (count < 1 || JS_VALUE_TYPE_TYPED_ARRAY != args[0].typ)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, method, line);
+    }
+    if (args[0].u.typed->length != typed->length)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, method, line);
+    }
+    return args[0].u.typed;
+}
+
+double typed_number_arg(const JsValue *args, int count, char *method, int line)
+{
+    if (count < 1 || (JS_VALUE_TYPE_INT != args[0].typ && JS_VALUE_TYPE_FLOAT != args[0].typ))
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, method, line);
+    }
+    return js_value_to_double(args);
+}
+
+/*a sum of ints is an int while it fits*/
+JsValue typed_long(long l)
+{
+    JsValue v;
+    if (l >= -MAX_INT && l <= MAX_INT)
+    {
+        v.typ = JS_VALUE_TYPE_INT;
+        v.u.intvalue = (int)l;
+        return v;
+    }
+    v.typ = JS_VALUE_TYPE_FLOAT;
+    v.u.floatvalue = (double)l;
+    return v;
+}
+
+/*min or max of ints,or of floats when the kernels cannot take them*/
+JsValue typed_extreme(JsTypedArray *typed, char max)
+{
+    JsValue v;
+    double d;
+    double m = max ? -INFINITY : INFINITY;
+    int i;
+    for (i = 0; i < typed->length; i++)
+    {
+        d = typed_number(typed, i);
+        if (d != d)
+        {
+            m = d;
+            break;
+        }
+        if (max ? d > m : d < m)
+        {
+            m = d;
+        }
+    }
+    if (JS_TYPED_FLOAT64 != typed->kind && typed->length > 0)
+    {
+        return typed_long((long)m);
+    }
+    v.typ = JS_VALUE_TYPE_FLOAT;
+    v.u.floatvalue = m;
+    return v;
+}
+
+/*a.set(source,offset) copies an array or a typed array into a*/
+void typed_copy(JsTypedArray *typed, const JsValue *args, int count, int line)
+{
+    int offset = 0;
+    int length;
+    int size = TYPED_element_size(typed->kind);
+    int i;
+    JsValue element;
+    if (count > 1)
+    {
+        offset = typed_int(args + 1, "set", line);
+    }
+    if (count > 0 && JS_VALUE_TYPE_ARRAY == args[0].typ)
+    {
+        length = args[0].u.array->length;
+    }
+    else if (count > 0 && JS_VALUE_TYPE_TYPED_ARRAY == args[0].typ)
+    {
+        length = args[0].u.typed->length;
+    }
+    else
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_TYPE_NOE_RIGHT, "set", line);
+        return;
+    }
+    if (offset < 0 || offset > typed->length - length)
+    {
+        ERROR_runtime_error(RUNTIME_ERROR_INDEX_OUT_RANGE, "set", line);
+    }
+    if (JS_VALUE_TYPE_ARRAY == args[0].typ)
+    {
+        for (i = 0; i < length; i++)
+        {
+            TYPED_set(typed, offset + i, args[0].u.array->elements + i);
+        }
+    }
+    else if (args[0].u.typed->kind == typed->kind)
+    { /*the two may be views of one buffer*/
+        memmove(typed->data + offset * size, args[0].u.typed->data, length * size);
+    }
+    else
+    {
+        for (i = 0; i < length; i++)
+        {
+            TYPED_get(args[0].u.typed, i, &element);
+            TYPED_set(typed, offset + i, &element);
+        }
+    }
+}
+
+JsValue TYPED_call(const JsValue *typed, char *method, const JsValue *args, int count, int line)
+{
+    JsTypedArray *a = typed->u.typed;
+    JsTypedArray *b;
+    SimdKernels *k = SIMD_kernels();
+    char f64 = JS_TYPED_FLOAT64 == a->kind;
+    JsValue v = *typed; /*methods that change the array give it back*/
+    unsigned int u;
+    double d;
+    long l;
+    int i;
+    if (0 == strcmp(method, "add") || 0 == strcmp(method, "mul"))
+    {
+        b = typed_operand(args, count, a, method, line);
+        if (a->kind == b->kind && JS_TYPED_UINT8 != a->kind)
+        {
+            if ('a' == method[0] && f64)
+            {
+                k->add_f64((double *)a->data, (double *)b->data, a->length);
+            }
+            else if ('a' == method[0])
+            {
+                k->add_i32((int *)a->data, (int *)b->data, a->length);
+            }
+            else if (f64)
+            {
+                k->mul_f64((double *)a->data, (double *)b->data, a->length);
+            }
+            else
+            {
+                k->mul_i32((int *)a->data, (int *)b->data, a->length);
+            }
+            return v;
+        }
+        for (i = 0; i < a->length; i++)
+        {
+            d = 'a' == method[0] ? typed_number(a, i) + typed_number(b, i) : typed_number(a, i) * typed_number(b, i);
+            typed_put(a, i, d);
+        }
+        return v;
+    }
+    if (0 == strcmp(method, "scale"))
+    {
+        d = typed_number_arg(args, count, method, line);
+        if (f64)
+        {
+            k->scale_f64((double *)a->data, d, a->length);
+            return v;
+        }
+        for (i = 0; i < a->length; i++)
+        {
+            typed_put(a, i, typed_number(a, i) * d);
+        }
+        return v;
+    }
+    if (0 == strcmp(method, "fill"))
+    {
+        d = typed_number_arg(args, count, method, line);
+        if (f64)
+        {
+            k->fill_f64((double *)a->data, d, a->length);
+        }
+        else if (a->length > 0)
+        { /*the first element converts the number,the rest are copies of it*/
+            TYPED_set(a, 0, args);
+            for (i = 1; i < a->length; i *= 2)
+            {
+                memcpy(a->data + i * TYPED_element_size(a->kind), a->data,
+                       (i * 2 <= a->length ? i : a->length - i) * TYPED_element_size(a->kind));
+            }
+        }
+        return v;
+    }
+    if (0 == strcmp(method, "set"))
+    {
+        typed_copy(a, args, count, line);
+        v.typ = JS_VALUE_TYPE_UNDEFINED;
+        return v;
+    }
+    if (0 == strcmp(method, "prefixSum"))
+    {
+        if (f64)
+        {
+            k->prefix_f64((double *)a->data, a->length);
+            return v;
+        }
+        for (i = 0, u = 0; i < a->length; i++)
+        { /*ints wrap*/
+            TYPED_get(a, i, &v);
+            u += (unsigned int)v.u.intvalue;
+            v.u.intvalue = (int)u;
+            TYPED_set(a, i, &v);
+        }
+        return *typed;
+    }
+    if (0 == strcmp(method, "dot"))
+    {
+        b = typed_operand(args, count, a, method, line);
+        v.typ = JS_VALUE_TYPE_FLOAT;
+        if (f64 && JS_TYPED_FLOAT64 == b->kind)
+        {
+            v.u.floatvalue = k->dot_f64((double *)a->data, (double *)b->data, a->length);
+            return v;
+        }
+        for (i = 0, d = 0; i < a->length; i++)
+        {
+            d += typed_number(a, i) * typed_number(b, i);
+        }
+        v.u.floatvalue = d;
+        return v;
+    }
+    if (0 == strcmp(method, "sum"))
+    {
+        if (f64)
+        {
+            v.typ = JS_VALUE_TYPE_FLOAT;
+            v.u.floatvalue = k->sum_f64((double *)a->data, a->length);
+            return v;
+        }
+        for (i = 0, l = 0; i < a->length; i++)
+        {
+            l += (long)typed_number(a, i);
+        }
+        return typed_long(l);
+    }
+    if (0 == strcmp(method, "min") || 0 == strcmp(method, "max"))
+    {
+        if (f64 && a->length > 0)
+        {
+            v.typ = JS_VALUE_TYPE_FLOAT;
+            v.u.floatvalue = 'a' == method[1] ? k->max_f64((double *)a->data, a->length)
+                                              : k->min_f64((double *)a->data, a->length);
+            return v;
+        }
+        return typed_extreme(a, 'a' == method[1]);
+    }
+    ERROR_runtime_error(RUNTIME_ERROR_METHOD_NOT_FOUND, method, line);
+    return v;
+}
@@ -0,0 +1,25 @@
+#ifndef TYPED_H
+#define TYPED_H
+#include "js.h"
+
+int TYPED_element_size(JS_TYPED_TYPE kind);
+
+/*length zeroed bytes*/
+JsValue TYPED_create_buffer(JsInterpreter *inter, int length, int line);
+
+/*new Float64Array(length),(array),(typed array) or (buffer,byte offset,length)*/
+JsValue TYPED_create(JsInterpreter *inter, JS_TYPED_TYPE kind, const JsValue *args, int count, int line);
+
+/*element index as an int or a float,index must be in range*/
+void TYPED_get(JsTypedArray *typed, int index, JsValue *v);
+
+/*v converted the way the element type converts numbers,index must be in range*/
+void TYPED_set(JsTypedArray *typed, int index, const JsValue *v);
+
+/*
+ * a.add(b),a.mul(b),a.scale(k),a.fill(x),a.prefixSum() change a and give it back,
+ * a.set(source,offset) copies into a,a.dot(b),a.sum(),a.min() and a.max() give a number
+ */
+JsValue TYPED_call(const JsValue *typed, char *method, const JsValue *args, int count, int line);
+
+#endif
@@ -4,15 +4,12 @@
 #include "js.h"
 #include "memory.h"
 
-JsInterpreter *current_interpreter; /*current interpreter*/
-STRING *literal_string_holder;
-
-int alloc_temprory_string();
-
-int appendchar_temprory_string(char c);
+extern JsInterpreter *current_interpreter; /*current interpreter*/
 
 void increment_line_number();
 
+void reset_line_number();
+
 int get_line_number();
 
 #endif
\ No newline at end of file